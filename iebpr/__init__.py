@@ -8,9 +8,13 @@ except ImportError:
 	raise ImportError("missing core component '_iebpr'\n"
 		"reinstallation may be required")
 
-from ._iebpr import IebprError, IebprPrerunValidateError
+from ._iebpr import IebprError, IebprPrerunValidateError, IebprRunStopped
+from ._iebpr import get_kernel_isa, set_kernel_isa
+from ._iebpr import get_memory_policy, set_memory_policy
+from ._iebpr import map_result_arena
 from ._iebpr import EnvState, SbrPhase, SbrStage, RandConfig, \
-	StateRandConfig, TraitRandConfig, Simulation
+	StateRandConfig, TraitRandConfig, Simulation, RunProfile, PhaseProfile, \
+	SubtypeProfile, HwProfile, HwSectionProfile, RunProgress
 from . import util
 from .util import RandType, AgentSubtype
 from .agent_template import get_template
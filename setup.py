@@ -3,6 +3,7 @@
 import importlib
 import os
 import setuptools
+import sys
 
 
 def discover_files_by_extension(dirname: str, ext: str) -> list:
@@ -18,6 +19,27 @@ def get_numpy_include_dir() -> str:
 	return numpy.get_include()
 
 
+def get_opt_flags() -> list:
+	# link-time optimization across translation units on top of python's
+	# default -O3; for a profile-guided build (gcc), install with
+	# IEBPR_PGO=generate, run src/pgo/train.py, remove build/ and reinstall
+	# with IEBPR_PGO=use; profiles are kept in IEBPR_PGO_DIR, and both builds
+	# must run from the same source tree
+	ret = ["-flto=auto"]
+	pgo = os.environ.get("IEBPR_PGO", "")
+	pgo_dir = os.path.abspath(os.environ.get("IEBPR_PGO_DIR",
+		os.path.join("src", "pgo", "profile")))
+	if pgo == "generate":
+		ret.append("-fprofile-generate=" + pgo_dir)
+	elif pgo == "use":
+		ret.extend(["-fprofile-use=" + pgo_dir, "-fprofile-correction",
+			"-Wno-missing-profile"])
+	elif pgo:
+		raise ValueError("IEBPR_PGO must be 'generate' or 'use', not '%s'"
+			% pgo)
+	return ret
+
+
 # c++ extension module
 ext__iebpr = setuptools.Extension(
 	"iebpr._iebpr",
@@ -27,9 +49,11 @@ ext__iebpr = setuptools.Extension(
 	],
 	define_macros=[],
 	library_dirs=[],
-	libraries=[],
-	extra_compile_args=["-std=c++11", "-Wall", "-Wno-missing-braces"],
-	extra_link_args=[],
+	# shm_open() of result arenas is in librt before glibc 2.34
+	libraries=["rt"] if sys.platform.startswith("linux") else [],
+	extra_compile_args=["-std=c++11", "-pthread", "-Wall", "-Wno-missing-braces"]
+		+ get_opt_flags(),
+	extra_link_args=["-pthread"] + get_opt_flags(),
 	# py_limited_api=True,
 )
 
@@ -1,4 +1,10 @@
+#include <atomic>
+#include <random>
+#include <system_error>
+#include <thread>
 #include "iebpr/agent_pool.hpp"
+#include "iebpr/checkpoint.hpp"
+#include "iebpr/kernel_dispatch.hpp"
 
 namespace iebpr
 {
@@ -10,6 +16,14 @@ namespace iebpr
 		return sum;
 	}
 
+	size_t AgentPool::n_active_agent(void) const noexcept
+	{
+		size_t sum = 0;
+		for (auto &v : agent_subtype)
+			sum += v->n_active();
+		return sum;
+	}
+
 	size_t AgentPool::n_subtype(void) const noexcept
 	{
 		return agent_subtype.size();
@@ -96,12 +110,16 @@ namespace iebpr
 					return ec;
 			}
 		}
+		if ((!backing_dir.empty()) && (!PoolMemory::is_backing_dir_usable(backing_dir)))
+			return pool_backing_dir_unusable;
 		return none;
 	}
 
-	void AgentPool::prerun_init(stvalue_t timestep)
+	void AgentPool::prerun_init(stvalue_t timestep, bool instantiate)
 	{
-		// allocate spaces for agents
+		// allocate spaces for agents, from a backing file if set
+		if (agent_data.get_allocator().get_backing_dir() != backing_dir)
+			agent_data = decltype(agent_data)(decltype(agent_data)::allocator_type(backing_dir));
 		agent_data.resize(n_agent());
 		auto curr_pool_begin = agent_data.begin();
 
@@ -114,11 +132,50 @@ namespace iebpr
 			// instantiate agents
 			v->state_cfg_apply_num_adjust();
 			v->trait_cfg_apply_rate_adjust(timestep);
-			v->instantiate_agents();
+			if (instantiate && (!instantiate_threads))
+				v->instantiate_agents();
+			v->trait_reservoir.reset(v->trait_cfg, trait_reservoir_size);
+		}
+		if (instantiate && instantiate_threads)
+			_instantiate_agents_parallel();
+		// from the randomizer state after instantiation
+		seed_trait_reservoirs();
+		return;
+	}
+
+	void AgentPool::seed_trait_reservoirs(void)
+	{
+		// draw from a copy, the main sequence is left as is; the draws are
+		// mixed with the subtype index, as seeding with a raw draw would only
+		// continue the main sequence
+		auto engine = _rand.engine;
+		for (size_t i = 0; i < agent_subtype.size(); i++)
+		{
+			uint32_t seed;
+			std::seed_seq seq{(uint32_t)engine(), (uint32_t)i};
+			seq.generate(&seed, &seed + 1);
+			if (agent_subtype[i]->trait_reservoir.is_enabled())
+				agent_subtype[i]->trait_reservoir.seed(seed);
 		}
 		return;
 	}
 
+	void AgentPool::start_trait_reservoirs(void)
+	{
+		if (!trait_reservoir_thread)
+			return;
+		for (auto &v : agent_subtype)
+			v->trait_reservoir.start_thread();
+		return;
+	}
+
+	void AgentPool::stop_trait_reservoirs(void) noexcept
+	{
+		for (auto &v : agent_subtype)
+			v->trait_reservoir.stop_thread();
+		return;
+	}
+
 	error_enum AgentPool::prerun_validate(void) const noexcept
 	{
 		// total num of agent match sum from all subtypes
@@ -135,11 +192,225 @@ namespace iebpr
 		return none;
 	}
 
+	void AgentPool::save_config(BinWriter &writer) const
+	{
+		writer.write_value<uint64_t>(agent_subtype.size());
+		for (auto &v : agent_subtype)
+		{
+			writer.write_value<uint32_t>(v->subtype());
+			writer.write_value<uint64_t>(v->n_agent);
+			v->state_cfg.save_config(writer);
+			v->trait_cfg.save_config(writer);
+		}
+		writer.write_value<uint64_t>(trait_reservoir_size);
+		writer.write_value<uint8_t>(trait_reservoir_thread);
+		writer.write_value<uint64_t>(instantiate_threads);
+		writer.write_string(backing_dir);
+		return;
+	}
+
+	error_enum AgentPool::load_config(BinReader &reader)
+	{
+		uint64_t n_subtype, n_agent;
+		uint32_t subtype;
+		if (!reader.read_value(n_subtype))
+			return checkpoint_bad_format;
+		clear_agent_subtype();
+		for (uint64_t i = 0; i < n_subtype; i++)
+		{
+			auto state_cfg = StateRandConfig();
+			auto trait_cfg = TraitRandConfig();
+			if (!(reader.read_value(subtype) && reader.read_value(n_agent)))
+				return checkpoint_bad_format;
+			if (!AgentSubtypeBase::is_valid_subtype_enum((AgentSubtypeBase::subtype_enum)subtype))
+				return checkpoint_bad_format;
+			if (auto ret = state_cfg.load_config(reader))
+				return ret;
+			if (auto ret = trait_cfg.load_config(reader))
+				return ret;
+			add_agent_subtype((AgentSubtypeBase::subtype_enum)subtype, n_agent, state_cfg, trait_cfg);
+		}
+		uint64_t reservoir_size, n_thread;
+		uint8_t reservoir_thread;
+		if (!(reader.read_value(reservoir_size) && reader.read_value(reservoir_thread) &&
+			  reader.read_value(n_thread) && reader.read_string(backing_dir)))
+			return checkpoint_bad_format;
+		trait_reservoir_size = reservoir_size;
+		trait_reservoir_thread = reservoir_thread;
+		instantiate_threads = n_thread;
+		return none;
+	}
+
+	void AgentPool::save_progress(BinWriter &writer) const
+	{
+		writer.write_value<uint64_t>(agent_subtype.size());
+		for (auto &v : agent_subtype)
+		{
+			writer.write_value<uint32_t>(v->subtype());
+			writer.write_value<uint64_t>(v->n_agent);
+			writer.write_value<uint64_t>(v->n_active());
+		}
+		writer.write_value<uint64_t>(agent_data.size());
+		writer.write_block(agent_data.data(), agent_data.size() * sizeof(AgentData), checkpoint::block_align);
+		for (auto &v : agent_subtype)
+		{
+			writer.write_value<uint64_t>(v->trait_reservoir.capacity());
+			if (v->trait_reservoir.is_enabled())
+				v->trait_reservoir.save_state(writer);
+		}
+		return;
+	}
+
+	error_enum AgentPool::load_progress(BinReader &reader)
+	{
+		uint64_t n_subtype, n_agent, n_active;
+		uint32_t subtype;
+		if (!reader.read_value(n_subtype))
+			return checkpoint_bad_format;
+		if (n_subtype != agent_subtype.size())
+			return checkpoint_config_mismatch;
+		for (auto &v : agent_subtype)
+		{
+			if (!(reader.read_value(subtype) && reader.read_value(n_agent) &&
+				  reader.read_value(n_active)))
+				return checkpoint_bad_format;
+			if ((subtype != v->subtype()) || (n_agent != v->n_agent))
+				return checkpoint_config_mismatch;
+			if (n_active > n_agent)
+				return checkpoint_bad_format;
+			v->_active_end = v->_pool_begin + n_active;
+		}
+		if (!reader.read_value(n_agent))
+			return checkpoint_bad_format;
+		if (n_agent != agent_data.size())
+			return checkpoint_config_mismatch;
+		// copy straight from the (mapped) block
+		auto src = reader.view_block(n_agent * sizeof(AgentData), checkpoint::block_align);
+		if (!src)
+			return checkpoint_bad_format;
+		std::memcpy(agent_data.data(), src, n_agent * sizeof(AgentData));
+		for (auto &v : agent_subtype)
+		{
+			uint64_t capacity;
+			if (!reader.read_value(capacity))
+				return checkpoint_bad_format;
+			if (capacity != v->trait_reservoir.capacity())
+				return checkpoint_config_mismatch;
+			if (v->trait_reservoir.is_enabled())
+				if (auto ret = v->trait_reservoir.load_state(reader))
+					return ret;
+		}
+		return none;
+	}
+
+	void AgentPool::fork_from(const AgentPool &other)
+	{
+		clear_agent_subtype();
+		for (auto &v : other.agent_subtype)
+			add_agent_subtype(v->subtype(), v->n_agent, v->state_cfg, v->trait_cfg);
+		agent_data = other.agent_data;
+		// pool ranges are at the same offsets as in other
+		for (size_t i = 0; i < agent_subtype.size(); i++)
+		{
+			_set_agent_data(*agent_subtype[i], agent_data.begin() +
+												   (other.agent_subtype[i]->pool_begin() -
+													other.agent_data.begin()));
+			agent_subtype[i]->_active_end = agent_subtype[i]->_pool_begin +
+											other.agent_subtype[i]->n_active();
+			agent_subtype[i]->trait_reservoir.copy_from(other.agent_subtype[i]->trait_reservoir);
+		}
+		trait_reservoir_size = other.trait_reservoir_size;
+		trait_reservoir_thread = other.trait_reservoir_thread;
+		instantiate_threads = other.instantiate_threads;
+		backing_dir = other.backing_dir;
+		return;
+	}
+
+	void AgentPool::scale_state_content(stvalue_t factor) noexcept
+	{
+		// free slots are cleared, no need to scale
+		for (auto &v : agent_subtype)
+			if (v->n_active())
+				stream_agents(v->pool_begin(), v->active_end(),
+							  [factor](AgentSubtypeBase::agent_itr_t begin, AgentSubtypeBase::agent_itr_t end)
+							  { KernelDispatch::table().scale_state_content(&*begin, end - begin, factor); });
+		return;
+	}
+
+	void AgentPool::aggregate_agents(stvalue_t tolerance)
+	{
+		for (auto &v : agent_subtype)
+			v->aggregate_agents(tolerance);
+		return;
+	}
+
+	bool AgentPool::is_file_backed(void) const noexcept
+	{
+		return PoolMemory::is_file_backed(agent_data.data());
+	}
+
+	void AgentPool::_instantiate_agents_parallel(void)
+	{
+		struct Range
+		{
+			AgentSubtypeBase *subtype;
+			AgentSubtypeBase::agent_itr_t begin, end;
+			uint32_t seed;
+		};
+		std::vector<Range> ranges;
+		for (auto &v : agent_subtype)
+		{
+			// one draw per subtype, mixed with the index of each range
+			const uint32_t base = _rand.engine();
+			uint32_t index = 0;
+			for (auto begin = v->pool_begin(); begin < v->pool_end(); index++)
+			{
+				auto end = ((size_t)(v->pool_end() - begin) > _instantiate_range)
+							   ? begin + _instantiate_range
+							   : v->pool_end();
+				uint32_t seed;
+				std::seed_seq seq{base, index};
+				seq.generate(&seed, &seed + 1);
+				ranges.push_back({v.get(), begin, end, seed});
+				begin = end;
+			}
+		}
+
+		// ranges are taken in turn by the threads and this one
+		std::atomic<size_t> next(0);
+		auto worker = [&ranges, &next](void)
+		{
+			for (size_t i; (i = next++) < ranges.size();)
+			{
+				Randomizer rand(ranges[i].seed);
+				ranges[i].subtype->instantiate_agents(rand, ranges[i].begin, ranges[i].end);
+			}
+		};
+		std::vector<std::thread> threads;
+		for (size_t i = 1; (i < instantiate_threads) && (i < ranges.size()); i++)
+		{
+			// go on with the threads created so far
+			try
+			{
+				threads.emplace_back(worker);
+			}
+			catch (const std::system_error &)
+			{
+				break;
+			}
+		}
+		worker();
+		for (auto &t : threads)
+			t.join();
+		return;
+	}
+
 	void AgentPool::_set_agent_data(AgentSubtypeBase &subtype,
 									const decltype(agent_data)::iterator &begin)
 	{
 		subtype._pool_begin = begin;
 		subtype._pool_end = begin + subtype.n_agent;
+		subtype._active_end = subtype._pool_end;
 		return;
 	}
 
@@ -1,6 +1,9 @@
+#include <algorithm>
+#include <cmath>
 #include <utility>
 #include <cstring>
 #include "iebpr/agent_subtype_base.hpp"
+#include "iebpr/kernel_dispatch.hpp"
 
 namespace iebpr
 {
@@ -60,20 +63,39 @@ namespace iebpr
 		return;
 	}
 
-	void AgentSubtypeBase::agent_action_aerobic(const EnvState &env, EnvState &d_env, AgentData &agent)
+	void AgentSubtypeBase::instantiate_agents(Randomizer &rand, agent_itr_t begin, agent_itr_t end)
 	{
+		state_cfg.randomize(rand, &*begin, end - begin);
+		trait_cfg.randomize(rand, &*begin, end - begin);
 		return;
 	}
 
-	void AgentSubtypeBase::agent_action_anaerobic(const EnvState &env, EnvState &d_env, AgentData &agent)
+	void AgentSubtypeBase::agent_action_aerobic(const EnvState &env, EnvState &d_env, AgentData &agent,
+												SubstrateUptake &uptake)
 	{
 		return;
 	}
 
-	void AgentSubtypeBase::agent_split(agent_itr_t agent_itr)
+	void AgentSubtypeBase::agent_action_anaerobic(const EnvState &env, EnvState &d_env, AgentData &agent,
+												  SubstrateUptake &uptake)
+	{
+		return;
+	}
+
+	void AgentSubtypeBase::uptake_demand_aerobic(const EnvState &env, EnvState &demand, const AgentData &agent) const
+	{
+		return;
+	}
+
+	void AgentSubtypeBase::uptake_demand_anaerobic(const EnvState &env, EnvState &demand, const AgentData &agent) const
+	{
+		return;
+	}
+
+	bool AgentSubtypeBase::agent_split(agent_itr_t agent_itr)
 	{
 		if (n_agent <= 1)
-			return;
+			return false;
 
 		// update the splitting agent state, except split_biomass and rela_count
 		auto sb = agent_itr->state.split_biomass;
@@ -85,6 +107,15 @@ namespace iebpr
 		// copy the state, will be the splitted agent state
 		AgentState split_state = agent_itr->state;
 
+		// aggregated agents left free slots
+		if (_active_end < _pool_end)
+		{
+			_active_end->state = split_state;
+			randomize_split_trait(_active_end->trait);
+			_active_end++;
+			return true;
+		}
+
 		// find the two agents with lowest biomass and merge
 		// when reaching here we have at least two agents
 		agent_itr_t to_merge_itrs[2] = {pool_begin(), pool_begin() + 1};
@@ -100,18 +131,138 @@ namespace iebpr
 		// the merged one is used for the new split agent
 		to_merge_itrs[0]->state = split_state;
 		// trait of the new split will be randomized (approximate mutation (?))
-		trait_cfg.randomize(_rand, to_merge_itrs[0]->trait);
+		randomize_split_trait(to_merge_itrs[0]->trait);
+		return true;
+	}
+
+	// coordinates compared by aggregate_agents(): traits as they are, and the
+	// state as content fractions and split progress, i.e. independent of
+	// agent size, so agents of different sizes can be merged; bool traits
+	// are not values, they are left 0 here and keyed by _aggregate_key()
+	constexpr size_t _n_aggregate_coord = AgentTrait::arr_size() + 4;
+
+	static void _aggregate_coord(const AgentData &agent, stvalue_t *coord) noexcept
+	{
+		const auto &state = agent.state;
+		std::memcpy(coord, agent.trait.as_arr(), sizeof(AgentTrait));
+		std::fill(coord + AgentTrait::bt_begin(), coord + AgentTrait::bt_end(), 0);
+		coord += AgentTrait::arr_size();
+		coord[0] = state.split_biomass > 0 ? state.biomass / state.split_biomass : 0;
+		coord[1] = state.glycogen / state.biomass;
+		coord[2] = state.pha / state.biomass;
+		coord[3] = state.polyp / state.biomass;
 		return;
 	}
 
-	AgentState AgentSubtypeBase::summarize_agent_state(void) const noexcept
+	// bin indices of the coordinates, 0 if the bin width is 0; clamped to
+	// stay in range with tiny tolerances; bool traits are keyed by their
+	// bivalue_t values, so they must match exactly
+	static void _aggregate_key(const AgentData &agent, const stvalue_t *bin, int64_t *key) noexcept
+	{
+		static_assert(sizeof(int64_t) == sizeof(bivalue_t), "");
+		constexpr stvalue_t key_max = 1e18;
+		stvalue_t coord[_n_aggregate_coord];
+		_aggregate_coord(agent, coord);
+		for (size_t i = 0; i < _n_aggregate_coord; i++)
+			key[i] = bin[i] > 0 ? (int64_t)std::max(std::min(std::floor(coord[i] / bin[i]), key_max), -key_max)
+								: 0;
+		std::memcpy(key + AgentTrait::bt_begin(), &agent.trait.bt, sizeof(AgentBoolTrait));
+		return;
+	}
+
+	static uint64_t _hash_aggregate_key(const int64_t *key) noexcept
+	{
+		// fnv-1a over the bin indices
+		uint64_t h = 0xcbf29ce484222325ULL;
+		for (size_t i = 0; i < _n_aggregate_coord; i++)
+		{
+			h ^= (uint64_t)key[i];
+			h *= 0x100000001b3ULL;
+		}
+		return h;
+	}
+
+	void AgentSubtypeBase::aggregate_agents(stvalue_t tolerance)
 	{
-		AgentState ret = AgentState();
+		const size_t n = n_active();
+		if (n < 2)
+			return;
 
-		for (auto itr = pool_begin(); itr < pool_end(); itr++)
-			ret.merge_with(itr->state, true);
+		// bin widths, by the mean magnitude of each coordinate
+		stvalue_t bin[_n_aggregate_coord] = {};
+		stvalue_t coord[_n_aggregate_coord];
+		size_t n_alive = 0;
+		for (agent_itr_t itr = pool_begin(); itr < active_end(); itr++)
+			if (itr->is_active())
+			{
+				_aggregate_coord(*itr, coord);
+				for (size_t i = 0; i < _n_aggregate_coord; i++)
+					bin[i] += std::abs(coord[i]);
+				n_alive++;
+			}
+		for (size_t i = 0; i < _n_aggregate_coord; i++)
+			bin[i] *= tolerance / (n_alive ? n_alive : 1);
 
-		return ret;
+		// agents with the same key are sorted next to each other by the key
+		// hash, then by position; each is merged into the first one with the
+		// same key, hash collisions are told apart by comparing the keys
+		std::vector<std::pair<uint64_t, size_t>> order(0);
+		order.reserve(n_alive);
+		int64_t key[_n_aggregate_coord];
+		for (size_t i = 0; i < n; i++)
+			if (pool_begin()[i].is_active())
+			{
+				_aggregate_key(pool_begin()[i], bin, key);
+				order.push_back({_hash_aggregate_key(key), i});
+			}
+		std::sort(order.begin(), order.end());
+		// first agents of each key in a run of the same hash, and their keys
+		std::vector<size_t> heads(0);
+		std::vector<int64_t> head_keys(0);
+		for (auto run = order.begin(); run < order.end();)
+		{
+			heads.clear();
+			head_keys.clear();
+			auto run_end = run;
+			for (; (run_end < order.end()) && (run_end->first == run->first); run_end++)
+			{
+				auto &agent = pool_begin()[run_end->second];
+				_aggregate_key(agent, bin, key);
+				size_t h = 0;
+				for (; h < heads.size(); h++)
+					if (std::equal(key, key + _n_aggregate_coord, head_keys.begin() + h * _n_aggregate_coord))
+						break;
+				if (h == heads.size())
+				{
+					heads.push_back(run_end->second);
+					head_keys.insert(head_keys.end(), key, key + _n_aggregate_coord);
+					continue;
+				}
+				pool_begin()[heads[h]].merge_with(agent);
+				agent.state.clear_state_content();
+#ifndef NO_RUN_PROFILE
+				profile_counter.n_aggregate++;
+#endif
+			}
+			run = run_end;
+		}
+
+		// compact, in order, and free the rest
+		auto new_end = std::stable_partition(pool_begin(), active_end(),
+											 [](const AgentData &agent)
+											 { return agent.is_active(); });
+		for (auto itr = new_end; itr < active_end(); itr++)
+			itr->state.clear_state_content();
+		_active_end = new_end;
+		return;
+	}
+
+	AgentState AgentSubtypeBase::summarize_agent_state(void) const noexcept
+	{
+		// free slots are cleared, summing them up changes nothing
+		if (pool_begin() == active_end())
+			return AgentState();
+		return KernelDispatch::table().summarize_agent_state(&*pool_begin(), n_active());
 	}
 
 	bool AgentSubtypeBase::is_valid_subtype_enum(subtype_enum subtype, bool allow_none)
@@ -24,4 +24,34 @@ namespace iebpr
 		return;
 	}
 
+	void StateRandConfig::randomize(Randomizer &rand, AgentData *agents, size_t n)
+	{
+		constexpr size_t stride = sizeof(AgentData) / agent_field_size;
+		for (size_t i = 0; i < arr_size(); i++)
+			rand.gen_values(as_arr()[i], agents->state.as_arr() + i, n, stride);
+		for (size_t i = 0; i < n; i++)
+		{
+			auto &state = agents[i].state;
+			assert(state.rela_count == agent_subtype_consts::INIT_RELA_COUNT);
+			state.split_biomass = std::max(state.split_biomass,
+										   state.biomass * agent_subtype_consts::MIN_RELA_SPLIT_BIOMASS);
+		}
+		return;
+	}
+
+	void StateRandConfig::save_config(BinWriter &writer) const
+	{
+		for (size_t i = 0; i < arr_size(); i++)
+			as_arr()[i].save_config(writer);
+		return;
+	}
+
+	error_enum StateRandConfig::load_config(BinReader &reader)
+	{
+		for (size_t i = 0; i < arr_size(); i++)
+			if (auto ret = as_arr()[i].load_config(reader))
+				return ret;
+		return none;
+	}
+
 } // namespace iebpr
\ No newline at end of file
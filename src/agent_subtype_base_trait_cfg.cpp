@@ -35,4 +35,29 @@ namespace iebpr
 		return;
 	}
 
+	void TraitRandConfig::randomize(Randomizer &rand, AgentData *agents, size_t n)
+	{
+		// bool traits are generated as values of the same size, thus all
+		// columns alike
+		constexpr size_t stride = sizeof(AgentData) / agent_field_size;
+		for (size_t i = 0; i < AgentTrait::arr_size(); i++)
+			rand.gen_values(as_arr()[i], agents->trait.as_arr() + i, n, stride);
+		return;
+	}
+
+	void TraitRandConfig::save_config(BinWriter &writer) const
+	{
+		for (size_t i = 0; i < arr_size(); i++)
+			as_arr()[i].save_config(writer);
+		return;
+	}
+
+	error_enum TraitRandConfig::load_config(BinReader &reader)
+	{
+		for (size_t i = 0; i < arr_size(); i++)
+			if (auto ret = as_arr()[i].load_config(reader))
+				return ret;
+		return none;
+	}
+
 } // namespace iebpr
\ No newline at end of file
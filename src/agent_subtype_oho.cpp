@@ -1,68 +1,40 @@
 #include "iebpr/agent_subtype_oho.hpp"
+#include "iebpr/agent_kinetics.hpp"
 
 namespace iebpr
 {
+	// kinetics are in agent_kinetics.hpp, shared with the lockstep kernels of
+	// ReplicateBatch; inactive agents are skipped by the callers
+	using OhoScalarKinetics = OhoKinetics<ScalarLanes>;
 
 	AgentSubtypeBase::subtype_enum AgentSubtypeOho::subtype(void) const noexcept
 	{
 		return oho;
 	}
 
-	void AgentSubtypeOho::agent_action_aerobic(const EnvState &env, EnvState &d_env, AgentData &agent)
+	void AgentSubtypeOho::uptake_demand_aerobic(const EnvState &env, EnvState &demand, const AgentData &agent) const
 	{
-		// agent state change
-		auto d_state = AgentState();
-
-		// prepare data
-		const auto monod_vfa = agent.monod_vfa(env);
-		const auto monod_op = agent.monod_op(env);
-
-		// cell growth
-		if ((env.vfa_conc > 0) && (env.op_conc > 0))
-		{
-			const auto delta = agent.trait.rate.mu * monod_vfa * monod_op * agent.state.biomass;
-			d_state.biomass += delta;
-			d_env.vfa_conc -= delta / agent.trait.reg.y_h;
-			d_env.op_conc -= delta * agent.trait.reg.i_bmp;
-		}
-		// biomass decay
-		{
-			const auto delta = agent.trait.rate.b_aerobic * agent.state.biomass;
-			d_state.biomass -= delta;
-			d_env.vfa_conc += delta * agent_subtype_consts::VFA_PER_DECAYED_BIOMASS;
-			d_env.op_conc += delta * agent.trait.reg.i_bmp;
-		}
-		// update to agent
-		assert(d_state.rela_count == 0);
-		assert(d_state.split_biomass == 0);
-		agent.state.merge_with(d_state);
-		assert((agent.state.rela_count != stvalue_inf) &&
-			   (agent.state.rela_count != -stvalue_inf) &&
-			   (agent.state.rela_count != stvalue_nan));
+		OhoScalarKinetics::uptake_demand_aerobic(true, env, demand, agent);
 		return;
 	}
 
-	void AgentSubtypeOho::agent_action_anaerobic(const EnvState &env, EnvState &d_env, AgentData &agent)
+	void AgentSubtypeOho::uptake_demand_anaerobic(const EnvState &env, EnvState &demand, const AgentData &agent) const
 	{
-		// agent state change
-		auto d_state = AgentState();
+		OhoScalarKinetics::uptake_demand_anaerobic(true, env, demand, agent);
+		return;
+	}
 
-		// prepare data
+	void AgentSubtypeOho::agent_action_aerobic(const EnvState &env, EnvState &d_env, AgentData &agent,
+											   SubstrateUptake &uptake)
+	{
+		OhoScalarKinetics::action_aerobic(true, env, d_env, agent, uptake);
+		return;
+	}
 
-		// biomass decay
-		{
-			const auto delta = agent.trait.rate.b_anaerobic * agent.state.biomass;
-			d_state.biomass -= delta;
-			d_env.vfa_conc += delta * agent_subtype_consts::VFA_PER_DECAYED_BIOMASS;
-			d_env.op_conc += delta * agent.trait.reg.i_bmp;
-		}
-		// update to agent
-		assert(d_state.rela_count == 0);
-		assert(d_state.split_biomass == 0);
-		agent.state.merge_with(d_state);
-		assert((agent.state.rela_count != stvalue_inf) &&
-			   (agent.state.rela_count != -stvalue_inf) &&
-			   (agent.state.rela_count != stvalue_nan));
+	void AgentSubtypeOho::agent_action_anaerobic(const EnvState &env, EnvState &d_env, AgentData &agent,
+												 SubstrateUptake &uptake)
+	{
+		OhoScalarKinetics::action_anaerobic(true, env, d_env, agent, uptake);
 		return;
 	}
 
@@ -0,0 +1,314 @@
+#include <cstring>
+#include <memory>
+#include "../iebpr/agent_pool.hpp"
+#include "../iebpr/recorder.hpp"
+#include "../iebpr/sbr_control.hpp"
+#include "bench_util.hpp"
+
+// microbenchmarks of simulation hot paths, built by `make bench`; each case
+// runs on fixtures generated with a fixed seed, so numbers are comparable
+// between builds given the same options
+
+namespace iebpr
+{
+	// grants benchmarks access to private hot paths
+	struct BenchAccess
+	{
+		static void timestep_update_env(SbrControl &sbr, AgentPool &pool)
+		{
+			sbr._timestep_update_env(pool);
+			return;
+		}
+		static void snapshot_record(Recorder &recorder, const SbrControl &sbr, const AgentPool &pool)
+		{
+			recorder._snapshot_record(sbr, pool);
+			return;
+		}
+	};
+
+	namespace bench
+	{
+		using subtype_enum = AgentSubtypeBase::subtype_enum;
+
+		constexpr stvalue_t timestep = SbrControl::default_timestep;
+
+		static void _set_constant(Randomizer::RandConfig &cfg, stvalue_t mean)
+		{
+			cfg.type = Randomizer::constant;
+			cfg.mean = mean;
+			return;
+		}
+
+		static void _set_normal(Randomizer::RandConfig &cfg, stvalue_t mean, stvalue_t stddev)
+		{
+			cfg.type = Randomizer::normal;
+			cfg.mean = mean;
+			cfg.stddev = stddev;
+			return;
+		}
+
+		// configs follow iebpr/agent_template, biomass is spread so that agents
+		// reach split at different steps
+		static void _template_cfg(subtype_enum subtype, StateRandConfig &state_cfg,
+								  TraitRandConfig &trait_cfg)
+		{
+			_set_normal(state_cfg.biomass, 100, 20);
+			_set_constant(state_cfg.split_biomass, 200);
+			_set_constant(trait_cfg.b_aerobic, 0.4);
+			_set_constant(trait_cfg.b_anaerobic, 0.1);
+			_set_constant(trait_cfg.k_hac, 0.01);
+			_set_constant(trait_cfg.y_h, 0.6);
+			_set_constant(trait_cfg.i_bmp, 0.015);
+			if (subtype == subtype_enum::oho)
+			{
+				_set_constant(trait_cfg.mu, 4.0);
+				_set_constant(trait_cfg.k_op, 0.01);
+				return;
+			}
+			// pao and gao
+			_set_constant(state_cfg.glycogen, 10);
+			_set_constant(state_cfg.pha, 20);
+			_set_constant(trait_cfg.mu, 1.5);
+			_set_constant(trait_cfg.q_glycogen, 1.85);
+			_set_constant(trait_cfg.q_pha, 3.0);
+			_set_constant(trait_cfg.m_aerobic, 2.0);
+			_set_constant(trait_cfg.m_anaerobic, 2.0);
+			_set_constant(trait_cfg.b_glycogen, 0.1);
+			_set_constant(trait_cfg.b_pha, 0.1);
+			_set_constant(trait_cfg.x_glycogen_max, 0.2);
+			_set_constant(trait_cfg.x_pha_max, 0.2);
+			_set_constant(trait_cfg.k_glycogen, 0.01);
+			_set_constant(trait_cfg.k_pha, 0.01);
+			_set_constant(trait_cfg.ki_glycogen, 0.01);
+			_set_constant(trait_cfg.ki_pha, 0.01);
+			_set_constant(trait_cfg.y_glycogen_pha, 0.6);
+			_set_constant(trait_cfg.y_pha_hac, 0.6);
+			if (subtype == subtype_enum::gao)
+			{
+				_set_constant(trait_cfg.k_op, 0.01);
+				return;
+			}
+			// pao only
+			_set_constant(state_cfg.polyp, 20);
+			_set_constant(trait_cfg.q_polyp, 2.0);
+			_set_constant(trait_cfg.b_polyp, 0.1);
+			_set_constant(trait_cfg.x_polyp_max, 0.3);
+			_set_constant(trait_cfg.k_op_polyp, 0.01);
+			_set_constant(trait_cfg.k_polyp, 0.01);
+			_set_constant(trait_cfg.ki_polyp, 0.01);
+			_set_constant(trait_cfg.y_polyp_pha, 0.6);
+			_set_constant(trait_cfg.y_prel, 0.75);
+			return;
+		}
+
+		// a single subtype pool in a single phase reactor
+		struct Fixture
+		{
+		public:
+			Randomizer rand;
+			AgentPool pool;
+			SbrControl sbr;
+			Recorder recorder;
+
+			explicit Fixture(Randomizer::seed_t seed, subtype_enum subtype, size_t n_agent,
+							 bool aerobic = true)
+				: rand(seed), pool(rand), sbr(rand, SbrControl::discrete, timestep), recorder()
+			{
+				auto state_cfg = StateRandConfig();
+				auto trait_cfg = TraitRandConfig();
+				_template_cfg(subtype, state_cfg, trait_cfg);
+				pool.add_agent_subtype(subtype, n_agent, state_cfg, trait_cfg);
+				// balanced inflow/outflow, volume stays constant
+				auto stage = SbrControl::Stage();
+				stage.n_cycle = 1;
+				stage.append_phase(SbrControl::Phase(1, 10, 200, 25, 0, 10, aerobic));
+				sbr.append_stage(stage);
+				sbr.init_env.volume = 40;
+				sbr.init_env.vfa_conc = 10;
+				sbr.init_env.op_conc = 10;
+				pool.prerun_init(timestep);
+				sbr.prerun_init(pool);
+			}
+		};
+
+		using fixture_ptr_t = std::unique_ptr<Fixture>;
+
+		static void bench_agent_action(const Runner &runner)
+		{
+			const size_t n_agent = 10000;
+			const auto n_step = runner.opts().scaled(200);
+			for (auto subtype : {subtype_enum::pao, subtype_enum::gao, subtype_enum::oho})
+				for (bool aerobic : {true, false})
+				{
+					auto name = std::string("agent_action/") +
+								AgentSubtypeBase::subtype_enum_to_name(subtype) +
+								(aerobic ? "/aerobic" : "/anaerobic");
+					auto fix = fixture_ptr_t();
+					runner.run(
+						name, n_agent, n_step * n_agent, sizeof(AgentData),
+						[&]()
+						{ fix.reset(new Fixture(runner.opts().seed, subtype, n_agent, aerobic)); },
+						[&]()
+						{
+							auto &v = *fix->pool.agent_subtype.front();
+							const auto &env = fix->sbr.env;
+							// env is kept constant, only agents evolve
+							auto d_env = EnvState();
+							auto uptake = SubstrateUptake();
+							for (uint64_t i = 0; i < n_step; i++)
+								for (auto itr = v.pool_begin(); itr < v.pool_end(); itr++)
+									v.agent_action(env, d_env, itr, uptake);
+							sink(d_env.vfa_conc + d_env.op_conc);
+						});
+				}
+			return;
+		}
+
+		static void bench_agent_split(const Runner &runner)
+		{
+			for (size_t n_agent : {100, 1000, 10000})
+			{
+				// each split scans the whole pool for the two smallest agents
+				const auto n_split = runner.opts().scaled(2000000 / n_agent);
+				auto fix = fixture_ptr_t();
+				runner.run(
+					"agent_split/" + std::to_string(n_agent), n_agent, n_split * n_agent, sizeof(AgentState),
+					[&]()
+					{ fix.reset(new Fixture(runner.opts().seed, subtype_enum::pao, n_agent)); },
+					[&]()
+					{
+						auto &v = *fix->pool.agent_subtype.front();
+						for (uint64_t i = 0; i < n_split; i++)
+							v.agent_split(v.pool_begin() + i % n_agent);
+						sink(v.pool_begin()->state.biomass);
+					});
+			}
+			return;
+		}
+
+		static void bench_timestep_update_env(const Runner &runner)
+		{
+			const size_t n_agent = 10000;
+			const auto n_step = runner.opts().scaled(1000);
+			auto fix = fixture_ptr_t();
+			runner.run(
+				"timestep_update_env", n_agent, n_step * n_agent, sizeof(AgentState),
+				[&]()
+				{ fix.reset(new Fixture(runner.opts().seed, subtype_enum::pao, n_agent)); },
+				[&]()
+				{
+					for (uint64_t i = 0; i < n_step; i++)
+						BenchAccess::timestep_update_env(fix->sbr, fix->pool);
+					sink(fix->sbr.env.vfa_conc);
+				});
+			return;
+		}
+
+		static void bench_summarize_agent_state(const Runner &runner)
+		{
+			const size_t n_agent = 10000;
+			const auto n_call = runner.opts().scaled(1000);
+			auto fix = fixture_ptr_t();
+			runner.run(
+				"summarize_agent_state", n_agent, n_call * n_agent, sizeof(AgentState),
+				[&]()
+				{ fix.reset(new Fixture(runner.opts().seed, subtype_enum::pao, n_agent)); },
+				[&]()
+				{
+					const auto &v = *fix->pool.agent_subtype.front();
+					for (uint64_t i = 0; i < n_call; i++)
+						sink(v.summarize_agent_state().biomass);
+				});
+			return;
+		}
+
+		static void bench_snapshot_record(const Runner &runner)
+		{
+			const size_t n_agent = 10000;
+			const auto n_call = runner.opts().scaled(100);
+			auto fix = fixture_ptr_t();
+			runner.run(
+				"snapshot_record", n_agent, n_call * n_agent,
+				sizeof(AgentState) + sizeof(AgentStateRecEntry),
+				[&]()
+				{
+					fix.reset(new Fixture(runner.opts().seed, subtype_enum::pao, n_agent));
+					// records are due from step 1, take one step so that every
+					// call takes a snapshot
+					fix->recorder.snapshot_rec_timepoints.assign(n_call, timestep);
+					fix->recorder.prerun_init(fix->sbr, fix->pool);
+					fix->sbr.timestep_update(fix->pool);
+				},
+				[&]()
+				{
+					for (uint64_t i = 0; i < n_call; i++)
+						BenchAccess::snapshot_record(fix->recorder, fix->sbr, fix->pool);
+					sink(fix->recorder.snapshot_rec.front().size());
+				});
+			return;
+		}
+
+		static void bench_gen_value(const Runner &runner)
+		{
+			const auto n_value = runner.opts().scaled(1000000);
+			for (auto type : {Randomizer::none, Randomizer::constant, Randomizer::normal,
+							  Randomizer::uniform, Randomizer::bernoulli, Randomizer::obsvalues})
+			{
+				auto cfg = Randomizer::RandConfig();
+				cfg.type = type;
+				cfg.stddev = 0.2;
+				cfg.low = 0.5;
+				cfg.high = 1.5;
+				cfg.mean = (type == Randomizer::bernoulli) ? 0.5 : 1;
+				if (type == Randomizer::obsvalues)
+				{
+					auto values = std::vector<stvalue_t>(0);
+					for (size_t i = 1; i <= 100; i++)
+						values.push_back(i * 0.01);
+					cfg.set_value_list(values);
+				}
+				auto rand = std::unique_ptr<Randomizer>();
+				// one value per agent-step
+				runner.run(
+					std::string("gen_value/") + Randomizer::randtype_enum_to_name(type),
+					0, n_value, sizeof(stvalue_t),
+					[&]()
+					{ rand.reset(new Randomizer(runner.opts().seed)); },
+					[&]()
+					{
+						// bernoulli results are integer bits, combine as bits
+						// to avoid denormal float arithmetic
+						uint64_t bits = 0;
+						for (uint64_t i = 0; i < n_value; i++)
+						{
+							const auto value = rand->gen_value(cfg);
+							uint64_t v;
+							std::memcpy(&v, &value, sizeof(v));
+							bits ^= v;
+						}
+						sink(bits & 0xff);
+					});
+			}
+			return;
+		}
+
+	} // namespace bench
+
+} // namespace iebpr
+
+int main(int argc, char **argv)
+{
+	using namespace iebpr::bench;
+	auto opts = Options();
+	if (opts.parse(argc, argv))
+		return 1;
+	auto runner = Runner(opts);
+	runner.print_header();
+	bench_agent_action(runner);
+	bench_agent_split(runner);
+	bench_timestep_update_env(runner);
+	bench_summarize_agent_state(runner);
+	bench_snapshot_record(runner);
+	bench_gen_value(runner);
+	return 0;
+}
\ No newline at end of file
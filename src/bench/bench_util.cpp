@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "../iebpr/kernel_dispatch.hpp"
+#include "bench_util.hpp"
+
+// count heap allocation of the whole program, including the library code
+// under benchmark; these replacements are only linked into the bench binary
+static std::atomic<size_t> _allocated_bytes(0);
+
+void *operator new(size_t size)
+{
+	_allocated_bytes += size;
+	if (auto p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+	return;
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	std::free(p);
+	return;
+}
+
+namespace iebpr
+{
+	namespace bench
+	{
+		size_t allocated_bytes(void) noexcept
+		{
+			return _allocated_bytes;
+		}
+
+		static volatile stvalue_t _sink = 0;
+
+		void sink(stvalue_t value) noexcept
+		{
+			_sink = _sink + value;
+			return;
+		}
+
+		int Options::parse(int argc, char **argv)
+		{
+			for (int i = 1; i < argc; i++)
+			{
+				const bool has_value = (i + 1 < argc);
+				if ((!std::strcmp(argv[i], "--reps")) && has_value)
+					reps = std::max(std::atoi(argv[++i]), 1);
+				else if ((!std::strcmp(argv[i], "--seed")) && has_value)
+					seed = std::strtoul(argv[++i], nullptr, 10);
+				else if ((!std::strcmp(argv[i], "--scale")) && has_value)
+					scale = std::atof(argv[++i]);
+				else if ((!std::strcmp(argv[i], "--filter")) && has_value)
+					filter = argv[++i];
+				else
+				{
+					std::fprintf(stderr, "usage: %s [--reps N] [--seed N] [--scale X] [--filter NAME]\n", argv[0]);
+					return 1;
+				}
+			}
+			return (scale > 0) ? 0 : 1;
+		}
+
+		uint64_t Options::scaled(uint64_t work) const noexcept
+		{
+			return std::max<uint64_t>(work * scale, 1);
+		}
+
+		bool Runner::selected(const std::string &name) const
+		{
+			return name.find(_opts.filter) != std::string::npos;
+		}
+
+		void Runner::print_header(void) const
+		{
+			std::printf("# reps=%u seed=%lu scale=%g isa=%s\n", _opts.reps, (unsigned long)_opts.seed, _opts.scale,
+						KernelDispatch::isa_enum_to_name(KernelDispatch::selected_isa()));
+			std::printf("%-36s %8s %12s %14s %14s %14s\n", "case", "n_agent", "agent-steps",
+						"ns/agent-step", "alloc B/a-s", "data B/a-s");
+			return;
+		}
+
+		void Runner::run(const std::string &name, size_t n_agent, uint64_t agent_steps,
+						 size_t data_bytes, const std::function<void(void)> &setup,
+						 const std::function<void(void)> &run) const
+		{
+			if (!selected(name))
+				return;
+			using _clock = std::chrono::steady_clock;
+			auto ns = std::vector<double>(0);
+			auto alloc = std::vector<double>(0);
+			for (unsigned i = 0; i < _opts.reps; i++)
+			{
+				setup();
+				const auto alloc_begin = allocated_bytes();
+				const auto begin = _clock::now();
+				run();
+				const auto end = _clock::now();
+				const auto alloc_end = allocated_bytes();
+				ns.push_back(std::chrono::duration<double, std::nano>(end - begin).count() / agent_steps);
+				alloc.push_back((double)(alloc_end - alloc_begin) / agent_steps);
+			}
+			// median, robust to the odd slow repetition
+			std::sort(ns.begin(), ns.end());
+			std::sort(alloc.begin(), alloc.end());
+			std::printf("%-36s %8zu %12llu %14.3f %14.3f %14zu\n", name.c_str(), n_agent,
+						(unsigned long long)agent_steps, ns[ns.size() / 2],
+						alloc[alloc.size() / 2], data_bytes);
+			std::fflush(stdout);
+			return;
+		}
+
+	} // namespace bench
+
+} // namespace iebpr
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef __IEBPR_BENCH_UTIL_HPP__
+#define __IEBPR_BENCH_UTIL_HPP__
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "../iebpr/def.hpp"
+#include "../iebpr/randomizer.hpp"
+
+namespace iebpr
+{
+	namespace bench
+	{
+		// heap bytes allocated by operator new since program start
+		size_t allocated_bytes(void) noexcept;
+
+		// keeps benchmarked results alive, so the work is not optimized away
+		void sink(stvalue_t value) noexcept;
+
+		struct Options
+		{
+		public:
+			// timed repetitions of each case, the median is reported
+			unsigned reps;
+			// seed of every fixture, results are repeatable with the same seed
+			Randomizer::seed_t seed;
+			// multiply the work of each case, < 1 for a quick smoke run
+			double scale;
+			// run only cases whose name contains this
+			std::string filter;
+
+			explicit Options(void) noexcept
+				: reps(5), seed(0), scale(1), filter() {}
+
+			// parse command line, return 0 on success, 1 on fail
+			int parse(int argc, char **argv);
+			// scale work count, at least 1
+			uint64_t scaled(uint64_t work) const noexcept;
+		};
+
+		// runs and reports cases; one agent-step is one agent processed once by
+		// the benchmarked function, e.g. one agent_action() call
+		class Runner
+		{
+		private:
+			const Options &_opts;
+
+		public:
+			explicit Runner(const Options &opts) noexcept
+				: _opts(opts) {}
+
+			inline const Options &opts(void) const noexcept { return _opts; };
+			// true if the case is selected by filter
+			bool selected(const std::string &name) const;
+			// print table header
+			void print_header(void) const;
+			// call setup() then time run() for each repetition; run() processes
+			// agent_steps agent-steps; data_bytes is the size of data the
+			// function reads/writes per agent-step, nominal, from type sizes
+			void run(const std::string &name, size_t n_agent, uint64_t agent_steps,
+					 size_t data_bytes, const std::function<void(void)> &setup,
+					 const std::function<void(void)> &run) const;
+		};
+
+	} // namespace bench
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+"""
+end-to-end scaling benchmark; runs the sbr schedule of doc/example.py with
+agents configured from iebpr/agent_template/*_template.json, sweeping agent
+count, subtype mix, simulation type, timestep and recording density, and
+writes a json report
+
+each scenario runs in a fresh worker process so that peak rss is measured per
+scenario; requires iebpr to be importable, e.g.:
+
+	python3 src/bench/scaling.py -n 1000 10000 100000 -o scaling.json
+"""
+
+import argparse
+import contextlib
+import datetime
+import itertools
+import json
+import os
+import platform
+import resource
+import subprocess
+import sys
+import time
+
+
+# phase lengths in minutes, following doc/example.py
+CYCLE_PHASES = [
+	# (name, minutes, aeration)
+	("inflow", 30, False),
+	("anaerobic", 90, False),
+	("aerobic", 180, True),
+	("withdraw", 30, True),
+	("outflow", 30, True),
+]
+
+SUBTYPE_MIXES = {
+	"pao": ["pao"],
+	"pao+gao": ["pao", "gao"],
+	"pao+gao+oho": ["pao", "gao", "oho"],
+}
+
+
+def get_args():
+	ap = argparse.ArgumentParser(description=__doc__.strip().split(";")[0],
+		formatter_class=argparse.RawDescriptionHelpFormatter)
+	ap.add_argument("-n", "--n-agent", type=int, nargs="+",
+		default=[1000, 10000, 100000], metavar="N",
+		help="total number of agents, split evenly among subtypes of a mix "
+			"[1000 10000 100000]")
+	ap.add_argument("-m", "--mix", type=str, nargs="+",
+		default=["pao+gao+oho"], choices=sorted(SUBTYPE_MIXES),
+		help="subtype mix [pao+gao+oho]")
+	ap.add_argument("-s", "--simutype", type=str, nargs="+",
+		default=["discrete", "pcontinuous"],
+		choices=["discrete", "pcontinuous"],
+		help="simulation type [discrete pcontinuous]")
+	ap.add_argument("-t", "--timestep", type=float, nargs="+",
+		default=[1e-5], metavar="DT",
+		help="timestep in day [1e-5]")
+	ap.add_argument("-r", "--rec-per-cycle", type=int, nargs="+",
+		default=[100], metavar="R",
+		help="state records per cycle; 0 disables recording [100]")
+	ap.add_argument("--snapshot-per-cycle", type=int, default=0,
+		metavar="R", help="snapshot records per cycle [0]")
+	ap.add_argument("-c", "--n-cycle", type=int, default=1,
+		help="sbr cycles per run [1]")
+	ap.add_argument("--seed", type=int, default=0,
+		help="simulation seed [0]")
+	ap.add_argument("-o", "--output", type=str, default="-",
+		metavar="json", help="report output, '-' for stdout [-]")
+	# internal, run one scenario and print its result
+	ap.add_argument("--worker", type=str, default=None,
+		help=argparse.SUPPRESS)
+	args = ap.parse_args()
+	return args
+
+
+def make_simulation(scenario: dict):
+	import numpy
+	from iebpr import Simulation, EnvState, SbrPhase, SbrStage, AgentSubtype
+	from iebpr.agent_template import get_template, randconfig_from_template
+
+	sim = Simulation(seed=scenario["seed"],
+		pcontinuous=(scenario["simutype"] == "pcontinuous"),
+		timestep=scenario["timestep"])
+	sim.init_env = EnvState(volume=40, vfa_conc=0, op_conc=0)
+	# sbr schedule
+	phases = list()
+	for name, minutes, aeration in CYCLE_PHASES:
+		time_len = minutes / 60 / 24
+		kw = dict()
+		if name == "inflow":
+			kw = dict(inflow_rate=5 / time_len, inflow_vfa_conc=200,
+				inflow_op_conc=25)
+		elif name == "withdraw":
+			kw = dict(withdraw_rate=1 / time_len)
+		elif name == "outflow":
+			kw = dict(outflow_rate=4 / time_len)
+		phases.append(SbrPhase(time_len=time_len, aeration=aeration, **kw))
+	stage = SbrStage(n_cycle=scenario["n_cycle"], cycle_phases=phases)
+	sim.append_sbr_stage(stage)
+	# agents
+	mix = SUBTYPE_MIXES[scenario["mix"]]
+	for i, subtype in enumerate(mix):
+		n_agent = scenario["n_agent"] // len(mix) + \
+			(i < scenario["n_agent"] % len(mix))
+		sim.add_agent_subtype(AgentSubtype[subtype], n_agent=n_agent,
+			state_cfg=randconfig_from_template(get_template(subtype + "_state")),
+			trait_cfg=randconfig_from_template(get_template(subtype + "_trait")))
+	# records, evenly spread over the run
+	total_time_len = sim.total_time_len
+	n_rec = scenario["rec_per_cycle"] * scenario["n_cycle"]
+	if n_rec:
+		sim.set_state_rec_timepoints(numpy.linspace(0, total_time_len, n_rec))
+	n_snapshot = scenario["snapshot_per_cycle"] * scenario["n_cycle"]
+	if n_snapshot:
+		sim.set_snapshot_rec_timepoints(
+			numpy.linspace(0, total_time_len, n_snapshot))
+	return sim
+
+
+def run_scenario(scenario: dict) -> dict:
+	sim = make_simulation(scenario)
+	n_step = round(sim.total_time_len / scenario["timestep"])
+	t = time.perf_counter()
+	sim.run()
+	wall_time = time.perf_counter() - t
+	res = dict(
+		wall_time=wall_time,
+		n_step=n_step,
+		steps_per_s=n_step / wall_time,
+		agent_steps_per_s=n_step * scenario["n_agent"] / wall_time,
+		# ru_maxrss is in KiB on linux
+		peak_rss_bytes=resource.getrusage(resource.RUSAGE_SELF).ru_maxrss * 1024,
+		# seconds spent in sections of the main loop, available if the build
+		# collects run profiles
+		time_split=None,
+	)
+	profile = getattr(sim, "last_run_profile", None)
+	if profile is not None:
+		res["time_split"] = dict(
+			agents=profile.total.agent_time,
+			env=profile.total.env_time,
+			recorder=profile.total.recorder_time,
+		)
+	return res
+
+
+def iter_scenarios(args):
+	for n_agent, mix, simutype, timestep, rec_per_cycle in itertools.product(
+			args.n_agent, args.mix, args.simutype, args.timestep,
+			args.rec_per_cycle):
+		yield dict(n_agent=n_agent, mix=mix, simutype=simutype,
+			timestep=timestep, rec_per_cycle=rec_per_cycle,
+			snapshot_per_cycle=args.snapshot_per_cycle, n_cycle=args.n_cycle,
+			seed=args.seed)
+	return
+
+
+def run_worker(scenario: dict) -> dict:
+	proc = subprocess.run([sys.executable, os.path.abspath(__file__),
+		"--worker", json.dumps(scenario)], stdout=subprocess.PIPE)
+	if proc.returncode:
+		return dict(error="worker exited with %d" % proc.returncode)
+	return json.loads(proc.stdout)
+
+
+def get_meta(args) -> dict:
+	import iebpr
+	return dict(
+		iebpr_version=iebpr.__version__,
+		python=platform.python_version(),
+		platform=platform.platform(),
+		machine=platform.machine(),
+		cpu_count=os.cpu_count(),
+		date=datetime.datetime.now().isoformat(timespec="seconds"),
+		argv=sys.argv[1:],
+	)
+
+
+def main():
+	args = get_args()
+	if args.worker is not None:
+		json.dump(run_scenario(json.loads(args.worker)), sys.stdout)
+		return
+	report = dict(meta=get_meta(args), results=list())
+	for scenario in iter_scenarios(args):
+		res = run_worker(scenario)
+		report["results"].append(dict(scenario=scenario, **res))
+		print("%s: %s" % (json.dumps(scenario), "error" if "error" in res else
+			"%.3g agent-steps/s" % res["agent_steps_per_s"]), file=sys.stderr)
+	with (contextlib.nullcontext(sys.stdout) if args.output == "-" else
+			open(args.output, "w")) as fp:
+		json.dump(report, fp, indent="\t")
+	return
+
+
+if __name__ == "__main__":
+	main()
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include "../iebpr/simulation.hpp"
+#include "json.hpp"
+#include "run_desc.hpp"
+#include "results.hpp"
+
+// iebpr-run: run a simulation described by a json file without python, and
+// write the results as .npy files; see run_desc.hpp and results.hpp
+
+using namespace iebpr;
+
+static void _usage(const char *prog)
+{
+	std::fprintf(stderr,
+				 "usage: %s [-h] [-q] [-o OUTDIR] RUN_JSON\n"
+				 "\n"
+				 "run the simulation described by RUN_JSON and write results into OUTDIR\n"
+				 "\n"
+				 "options:\n"
+				 "  -h         show this help and exit\n"
+				 "  -q         do not print run summary\n"
+				 "  -o OUTDIR  output directory, created if not exists (default: .)\n",
+				 prog);
+	return;
+}
+
+// same messages as raised by the python interface
+static const char *_error_enum_to_msg(error_enum ec) noexcept
+{
+	switch (ec)
+	{
+	case unexpected_rand_type:
+		return "unexpected random type";
+	case normal_nonneg_lowprob:
+		return "type=normal, nonneg=True: probablity to draw non-negative value is too low";
+	case uniform_low_high_swap:
+		return "type=uniform: low > high";
+	case uniform_nonneg_lowprob:
+		return "type=uniform, nonneg=True: probablity to draw non-negative value is too low";
+	case bernoulli_error_mean:
+		return "type=bernoulli: mean < 0 or mean > 1";
+	case invalid_timestep:
+		return "timestep <= 0";
+	case invalid_init_volume:
+		return "init sbr living volume <= 0";
+	case total_agent_mismatch_subtype_sum:
+		return "total agent allocated mismatch sum from subtypes";
+	case agent_subtype_pool_overlap:
+		return "agent instance overlap found between subtypes";
+	case bool_trait_wrong_rand_type:
+		return "agent bool trait random type is not bernoulli/none";
+	case pool_backing_dir_unusable:
+		return "cannot create agent pool backing file in pool_backing_dir";
+	case rec_time_exceed_simulation:
+		return "recording time exceeds simulation time range";
+	case rec_step_smaller_than_timestep:
+		return "recording step smaller than timestep";
+	case sigint:
+		return "interrupted";
+	case trace_io_error:
+		return "failed to write trace file";
+	case checkpoint_io_error:
+		return "failed to read/write checkpoint file";
+	case checkpoint_bad_format:
+		return "bad checkpoint file format";
+	case checkpoint_version_mismatch:
+		return "unsupported checkpoint file version";
+	case checkpoint_config_mismatch:
+		return "checkpoint does not match current simulation configs";
+	case checkpoint_not_initialized:
+		return "no simulation progress to save, resume or fork from";
+	case replicate_not_discrete:
+		return "replicates must be of discrete simulation type";
+	case replicate_config_mismatch:
+		return "replicates do not share the same configs";
+	case replicate_aggregation_enabled:
+		return "replicates cannot run in lockstep with adaptive aggregation";
+	case run_cancelled:
+		return "cancelled";
+	case run_step_budget_exhausted:
+		return "stopped after max_steps";
+	case run_time_budget_exhausted:
+		return "stopped after max_wall_time";
+	case run_deadline_exceeded:
+		return "stopped at deadline";
+	default:
+		return "uncategorized error";
+	}
+}
+
+static std::string _dirname(const std::string &path)
+{
+	auto pos = path.find_last_of('/');
+	if (pos == std::string::npos)
+		return ".";
+	return pos ? path.substr(0, pos) : "/";
+}
+
+static void _print_summary(const Simulation &sim)
+{
+	const auto total = sim.last_run_profile().total();
+	std::printf("simulated %.3f time in %lld ms, %llu steps, %llu agent steps\n",
+				sim.total_time_len(), (long long)sim.last_run_duration().count(),
+				(unsigned long long)total.n_step, (unsigned long long)total.n_agent_step);
+	if (RunProfile::enabled)
+		std::printf("agent %.3f s, env %.3f s, transit %.3f s, recorder %.3f s\n",
+					total.agent_time, total.env_time, total.transit_time, total.recorder_time);
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	auto out_dir = std::string(".");
+	const char *desc_path = nullptr;
+	bool quiet = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!std::strcmp(argv[i], "-h"))
+		{
+			_usage(argv[0]);
+			return 0;
+		}
+		else if (!std::strcmp(argv[i], "-q"))
+			quiet = true;
+		else if ((!std::strcmp(argv[i], "-o")) && (i + 1 < argc))
+			out_dir = argv[++i];
+		else if ((argv[i][0] != '-') && (!desc_path))
+			desc_path = argv[i];
+		else
+		{
+			_usage(argv[0]);
+			return 2;
+		}
+	}
+	if (!desc_path)
+	{
+		_usage(argv[0]);
+		return 2;
+	}
+
+	auto err = std::string();
+	auto desc = cli::JsonValue();
+	if (!cli::JsonValue::parse_file(desc_path, desc, err))
+	{
+		std::fprintf(stderr, "%s: %s\n", desc_path, err.c_str());
+		return 1;
+	}
+	Simulation sim;
+	sim.run_control.handle_sigint = true;
+	if (!cli::load_run_desc(desc, _dirname(desc_path), sim, err))
+	{
+		std::fprintf(stderr, "%s: %s\n", desc_path, err.c_str());
+		return 1;
+	}
+	if (mkdir(out_dir.c_str(), 0777) && (errno != EEXIST))
+	{
+		std::fprintf(stderr, "%s: %s\n", out_dir.c_str(), std::strerror(errno));
+		return 1;
+	}
+
+	auto ec = sim.run();
+	// an interrupted or stopped run still has partial records worth saving
+	const bool stopped = (ec == sigint) || (ec == run_cancelled) || (ec == run_step_budget_exhausted) ||
+						 (ec == run_time_budget_exhausted) || (ec == run_deadline_exceeded);
+	if (ec && (!stopped))
+	{
+		std::fprintf(stderr, "(ERROR 0x%x) %s\n", ec, _error_enum_to_msg(ec));
+		return 1;
+	}
+	if (!cli::write_results(sim, out_dir, err))
+	{
+		std::fprintf(stderr, "%s\n", err.c_str());
+		return 1;
+	}
+	if (stopped)
+	{
+		std::fprintf(stderr, "%s, partial results written\n", _error_enum_to_msg(ec));
+		return (ec == sigint) ? 130 : 124;
+	}
+	if (!quiet)
+		_print_summary(sim);
+	return 0;
+}
\ No newline at end of file
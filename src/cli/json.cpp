@@ -0,0 +1,336 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "json.hpp"
+
+namespace iebpr
+{
+	namespace cli
+	{
+		// recursive descent parser over the whole text
+		class _JsonParser
+		{
+		private:
+			const char *_begin;
+			const char *_curr;
+			const char *_end;
+			std::string &_err;
+
+		public:
+			explicit _JsonParser(const std::string &text, std::string &err) noexcept
+				: _begin(text.data()), _curr(text.data()), _end(text.data() + text.size()),
+				  _err(err) {}
+
+			bool parse_document(JsonValue &ret)
+			{
+				if (!parse_value(ret, 0))
+					return false;
+				_skip_space();
+				if (_curr != _end)
+					return _fail("trailing characters after json value");
+				return true;
+			}
+
+		private:
+			// limit nesting, so that malformed input cannot overflow the stack
+			constexpr static unsigned _max_depth = 256;
+
+			bool _fail(const char *msg)
+			{
+				size_t line = 1;
+				for (auto p = _begin; p < _curr; p++)
+					line += (*p == '\n');
+				_err = std::string(msg) + " at line " + std::to_string(line);
+				return false;
+			}
+
+			void _skip_space(void) noexcept
+			{
+				while ((_curr < _end) && *_curr && std::strchr(" \t\r\n", *_curr))
+					_curr++;
+				return;
+			}
+
+			bool _consume(const char *literal) noexcept
+			{
+				auto len = std::strlen(literal);
+				if (((size_t)(_end - _curr) < len) || std::strncmp(_curr, literal, len))
+					return false;
+				_curr += len;
+				return true;
+			}
+
+			bool parse_value(JsonValue &ret, unsigned depth)
+			{
+				if (depth > _max_depth)
+					return _fail("json nested too deep");
+				_skip_space();
+				if (_curr >= _end)
+					return _fail("unexpected end of json");
+				ret = JsonValue();
+				switch (*_curr)
+				{
+				case '{':
+					return _parse_object(ret, depth);
+				case '[':
+					return _parse_array(ret, depth);
+				case '"':
+					ret.type = JsonValue::string;
+					return _parse_string(ret.s);
+				case 't':
+				case 'f':
+					ret.type = JsonValue::boolean;
+					ret.b = (*_curr == 't');
+					return _consume(ret.b ? "true" : "false") || _fail("invalid literal");
+				case 'n':
+					return _consume("null") || _fail("invalid literal");
+				default:
+					return _parse_number(ret);
+				}
+			}
+
+			bool _parse_object(JsonValue &ret, unsigned depth)
+			{
+				ret.type = JsonValue::object;
+				_curr++;
+				_skip_space();
+				if ((_curr < _end) && (*_curr == '}'))
+				{
+					_curr++;
+					return true;
+				}
+				while (true)
+				{
+					_skip_space();
+					if ((_curr >= _end) || (*_curr != '"'))
+						return _fail("expected object key");
+					auto key = std::string();
+					if (!_parse_string(key))
+						return false;
+					_skip_space();
+					if ((_curr >= _end) || (*_curr++ != ':'))
+						return _fail("expected ':' after object key");
+					ret.obj.emplace_back(std::move(key), JsonValue());
+					if (!parse_value(ret.obj.back().second, depth + 1))
+						return false;
+					_skip_space();
+					if (_curr >= _end)
+						return _fail("unexpected end of json in object");
+					if (*_curr == '}')
+					{
+						_curr++;
+						return true;
+					}
+					if (*_curr++ != ',')
+						return _fail("expected ',' or '}' in object");
+				}
+			}
+
+			bool _parse_array(JsonValue &ret, unsigned depth)
+			{
+				ret.type = JsonValue::array;
+				_curr++;
+				_skip_space();
+				if ((_curr < _end) && (*_curr == ']'))
+				{
+					_curr++;
+					return true;
+				}
+				while (true)
+				{
+					ret.arr.emplace_back();
+					if (!parse_value(ret.arr.back(), depth + 1))
+						return false;
+					_skip_space();
+					if (_curr >= _end)
+						return _fail("unexpected end of json in array");
+					if (*_curr == ']')
+					{
+						_curr++;
+						return true;
+					}
+					if (*_curr++ != ',')
+						return _fail("expected ',' or ']' in array");
+				}
+			}
+
+			bool _parse_hex4(unsigned &code)
+			{
+				if (_end - _curr < 4)
+					return _fail("invalid \\u escape");
+				code = 0;
+				for (int i = 0; i < 4; i++)
+				{
+					auto c = *_curr++;
+					code <<= 4;
+					if ((c >= '0') && (c <= '9'))
+						code |= c - '0';
+					else if ((c >= 'a') && (c <= 'f'))
+						code |= c - 'a' + 10;
+					else if ((c >= 'A') && (c <= 'F'))
+						code |= c - 'A' + 10;
+					else
+						return _fail("invalid \\u escape");
+				}
+				return true;
+			}
+
+			static void _append_utf8(std::string &s, unsigned code)
+			{
+				if (code < 0x80)
+					s += (char)code;
+				else if (code < 0x800)
+				{
+					s += (char)(0xc0 | (code >> 6));
+					s += (char)(0x80 | (code & 0x3f));
+				}
+				else if (code < 0x10000)
+				{
+					s += (char)(0xe0 | (code >> 12));
+					s += (char)(0x80 | ((code >> 6) & 0x3f));
+					s += (char)(0x80 | (code & 0x3f));
+				}
+				else
+				{
+					s += (char)(0xf0 | (code >> 18));
+					s += (char)(0x80 | ((code >> 12) & 0x3f));
+					s += (char)(0x80 | ((code >> 6) & 0x3f));
+					s += (char)(0x80 | (code & 0x3f));
+				}
+				return;
+			}
+
+			bool _parse_string(std::string &ret)
+			{
+				// skip the opening quote
+				_curr++;
+				while (_curr < _end)
+				{
+					auto c = *_curr++;
+					if (c == '"')
+						return true;
+					if (c != '\\')
+					{
+						ret += c;
+						continue;
+					}
+					if (_curr >= _end)
+						break;
+					switch (c = *_curr++)
+					{
+					case '"':
+					case '\\':
+					case '/':
+						ret += c;
+						break;
+					case 'b':
+						ret += '\b';
+						break;
+					case 'f':
+						ret += '\f';
+						break;
+					case 'n':
+						ret += '\n';
+						break;
+					case 'r':
+						ret += '\r';
+						break;
+					case 't':
+						ret += '\t';
+						break;
+					case 'u':
+					{
+						unsigned code = 0, low = 0;
+						if (!_parse_hex4(code))
+							return false;
+						// surrogate pair
+						if ((code >= 0xd800) && (code < 0xdc00) && _consume("\\u"))
+						{
+							if (!_parse_hex4(low))
+								return false;
+							code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+						}
+						_append_utf8(ret, code);
+						break;
+					}
+					default:
+						return _fail("invalid escape in string");
+					}
+				}
+				return _fail("unterminated string");
+			}
+
+			bool _parse_number(JsonValue &ret)
+			{
+				// strtod accepts a superset of json numbers, good enough for
+				// configs; the text is not guaranteed to be null-terminated
+				// within _end, so copy the token first
+				auto p = _curr;
+				while ((p < _end) && *p && std::strchr("+-.0123456789eE", *p))
+					p++;
+				if (p == _curr)
+					return _fail("unexpected character");
+				auto token = std::string(_curr, p);
+				char *token_end = nullptr;
+				ret.type = JsonValue::number;
+				ret.n = std::strtod(token.c_str(), &token_end);
+				if (token_end != token.c_str() + token.size())
+					return _fail("invalid number");
+				_curr = p;
+				return true;
+			}
+		};
+
+		const JsonValue *JsonValue::get(const std::string &key) const noexcept
+		{
+			if (type != object)
+				return nullptr;
+			for (const auto &v : obj)
+				if (v.first == key)
+					return &v.second;
+			return nullptr;
+		}
+
+		const char *JsonValue::type_enum_to_name(type_enum type) noexcept
+		{
+			switch (type)
+			{
+			case null:
+				return "null";
+			case boolean:
+				return "boolean";
+			case number:
+				return "number";
+			case string:
+				return "string";
+			case array:
+				return "array";
+			case object:
+				return "object";
+			default:
+				return "unknown";
+			}
+		}
+
+		bool JsonValue::parse(const std::string &text, JsonValue &ret, std::string &err)
+		{
+			return _JsonParser(text, err).parse_document(ret);
+		}
+
+		bool JsonValue::parse_file(const std::string &path, JsonValue &ret, std::string &err)
+		{
+			std::ifstream fs(path);
+			if (!fs)
+			{
+				err = "cannot open file";
+				return false;
+			}
+			std::stringstream ss;
+			ss << fs.rdbuf();
+			return parse(ss.str(), ret, err);
+		}
+
+	} // namespace cli
+
+} // namespace iebpr
\ No newline at end of file
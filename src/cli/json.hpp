@@ -0,0 +1,53 @@
+#ifndef __IEBPR_CLI_JSON_HPP__
+#define __IEBPR_CLI_JSON_HPP__
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// minimal json reader for run descriptions, keeps object keys in file order
+
+namespace iebpr
+{
+	namespace cli
+	{
+		class JsonValue
+		{
+		public:
+			using type_enum = enum {
+				null = 0,
+				boolean,
+				number,
+				string,
+				array,
+				object,
+			};
+
+			type_enum type;
+			bool b;
+			double n;
+			std::string s;
+			std::vector<JsonValue> arr;
+			std::vector<std::pair<std::string, JsonValue>> obj;
+
+			explicit JsonValue(void) noexcept
+				: type(null), b(false), n(0), s(), arr(0), obj(0) {}
+
+			// find member of an object by key, nullptr if missing or not an
+			// object
+			const JsonValue *get(const std::string &key) const noexcept;
+			// name of type, for error messages
+			static const char *type_enum_to_name(type_enum type) noexcept;
+
+			// parse text into ret; on failure return false and describe the
+			// error with line number in err
+			static bool parse(const std::string &text, JsonValue &ret, std::string &err);
+			// read and parse a file
+			static bool parse_file(const std::string &path, JsonValue &ret, std::string &err);
+		};
+
+	} // namespace cli
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
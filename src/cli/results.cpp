@@ -0,0 +1,147 @@
+#include <cstdint>
+#include <cstdio>
+#include "results.hpp"
+
+namespace iebpr
+{
+	namespace cli
+	{
+		// same as EnvStateRecDescr and AgentStateRecDescr of the python
+		// interface, little-endian
+		static const char *const _env_state_rec_descr =
+			"[('volume', '<f8'), ('vfa_conc', '<f8'), ('op_conc', '<f8'), ('is_aerobic', '<i8')]";
+		static const char *const _agent_state_rec_descr =
+			"[('biomass', '<f8'), ('rela_count', '<f8'), ('glycogen', '<f8'), ('pha', '<f8'), "
+			"('polyp', '<f8')]";
+		static_assert(EnvStateRecEntry::arr_size() == 4, "_env_state_rec_descr outdated");
+		static_assert(AgentStateRecEntry::arr_size() == 5, "_agent_state_rec_descr outdated");
+
+		static bool _is_little_endian(void) noexcept
+		{
+			const uint16_t v = 1;
+			return *(const uint8_t *)&v == 1;
+		}
+
+		bool write_npy(const std::string &path, const std::string &descr,
+					   const std::vector<size_t> &shape, const void *data, size_t n_bytes)
+		{
+			// header dict, padded with spaces and ended with newline so that
+			// the data starts 64-byte aligned
+			auto header = "{'descr': " + descr + ", 'fortran_order': False, 'shape': (";
+			for (size_t i = 0; i < shape.size(); i++)
+				header += (i ? ", " : "") + std::to_string(shape[i]);
+			// a 1-d shape tuple needs the trailing comma
+			header += (shape.size() == 1) ? ",), }" : "), }";
+			const size_t prefix_size = 10;
+			header.append(63 - (prefix_size + header.size()) % 64, ' ');
+			header += '\n';
+			if (header.size() > 0xffff)
+				return false;
+			auto fp = std::fopen(path.c_str(), "wb");
+			if (!fp)
+				return false;
+			const uint16_t header_size = header.size();
+			const uint8_t header_size_le[2] = {(uint8_t)(header_size & 0xff), (uint8_t)(header_size >> 8)};
+			bool good = (std::fwrite("\x93NUMPY\x01\x00", 1, 8, fp) == 8) &&
+						(std::fwrite(header_size_le, 1, 2, fp) == 2) &&
+						(std::fwrite(header.data(), 1, header.size(), fp) == header.size()) &&
+						((!n_bytes) || (std::fwrite(data, 1, n_bytes, fp) == n_bytes));
+			good = (!std::fclose(fp)) && good;
+			return good;
+		}
+
+		// results are written as in memory, which must match the descr
+		static bool _write_rec(const std::string &path, const std::string &descr,
+							   const std::vector<size_t> &shape, const void *data,
+							   size_t n_bytes, std::string &err)
+		{
+			if (write_npy(path, descr, shape, data, n_bytes))
+				return true;
+			err = path + ": failed to write";
+			return false;
+		}
+
+		// flatten records of equal length into one contiguous array
+		template <typename T, typename A>
+		static std::vector<T> _flatten(const std::vector<std::vector<T, A>> &vec)
+		{
+			auto ret = std::vector<T>(0);
+			for (const auto &v : vec)
+				ret.insert(ret.end(), v.begin(), v.end());
+			return ret;
+		}
+
+		static bool _write_summary(const Simulation &sim, const std::string &path, std::string &err)
+		{
+			auto fp = std::fopen(path.c_str(), "w");
+			if (!fp)
+			{
+				err = path + ": failed to write";
+				return false;
+			}
+			const auto &profile = sim.last_run_profile();
+			const auto total = profile.total();
+			std::fprintf(fp, "{\n\t\"subtypes\": [");
+			const auto subtypes = sim.n_agent_by_subtype();
+			for (size_t i = 0; i < subtypes.size(); i++)
+				std::fprintf(fp, "%s{\"subtype\": \"%s\", \"n_agent\": %zu}", i ? ", " : "",
+							 Simulation::subtype_enum_to_name(subtypes[i].subtype), subtypes[i].n_agent);
+			std::fprintf(fp, "],\n\t\"total_time_len\": %.17g,\n", sim.total_time_len());
+			std::fprintf(fp, "\t\"last_run_duration_ms\": %lld,\n",
+						 (long long)sim.last_run_duration().count());
+			std::fprintf(fp, "\t\"n_step\": %llu,\n\t\"n_agent_step\": %llu,\n",
+						 (unsigned long long)total.n_step, (unsigned long long)total.n_agent_step);
+			std::fprintf(fp, "\t\"agent_time\": %.6f,\n\t\"env_time\": %.6f,\n"
+							 "\t\"transit_time\": %.6f,\n\t\"recorder_time\": %.6f\n}\n",
+						 total.agent_time, total.env_time, total.transit_time, total.recorder_time);
+			if (std::ferror(fp) | std::fclose(fp))
+			{
+				err = path + ": failed to write";
+				return false;
+			}
+			return true;
+		}
+
+		bool write_results(const Simulation &sim, const std::string &out_dir, std::string &err)
+		{
+			if (!_is_little_endian())
+			{
+				err = "writing results on big-endian hosts is not supported";
+				return false;
+			}
+			const auto prefix = out_dir + "/";
+			const auto &env_rec = sim.retrieve_env_state_rec();
+			const auto &agent_rec = sim.retrieve_agent_state_rec();
+			const auto &snapshot_rec = sim.retrieve_snapshot_rec();
+			// agent state records are by timepoint then subtype
+			const auto agent_flat = _flatten(agent_rec);
+			const auto state_tp = sim.get_state_rec_timepoints();
+			const auto snapshot_tp = sim.get_snapshot_rec_timepoints();
+			if ((!_write_rec(prefix + "env_state_rec.npy", _env_state_rec_descr, {env_rec.size()},
+							 env_rec.data(), env_rec.size() * sizeof(EnvStateRecEntry), err)) ||
+				(!_write_rec(prefix + "agent_state_rec.npy", _agent_state_rec_descr,
+							 {agent_rec.size(), agent_rec.empty() ? 0 : agent_rec[0].size()}, agent_flat.data(),
+							 agent_flat.size() * sizeof(AgentStateRecEntry), err)) ||
+				(!_write_rec(prefix + "state_rec_timepoints.npy", "'<f8'", {state_tp.size()},
+							 state_tp.data(), state_tp.size() * sizeof(stvalue_t), err)) ||
+				(!_write_rec(prefix + "snapshot_rec_timepoints.npy", "'<f8'", {snapshot_tp.size()},
+							 snapshot_tp.data(), snapshot_tp.size() * sizeof(stvalue_t), err)))
+				return false;
+			// snapshots are by subtype then timepoint
+			const auto subtypes = sim.n_agent_by_subtype();
+			for (size_t i = 0; i < snapshot_rec.size(); i++)
+			{
+				const auto &vec = snapshot_rec[i];
+				const auto flat = _flatten(vec);
+				const auto name = prefix + "snapshot_rec." + std::to_string(i) + "." +
+								  Simulation::subtype_enum_to_name(subtypes[i].subtype) + ".npy";
+				if (!_write_rec(name, _agent_state_rec_descr, {vec.size(), vec.empty() ? 0 : vec[0].size()},
+								flat.data(), flat.size() * sizeof(AgentStateRecEntry), err))
+					return false;
+			}
+			return _write_summary(sim, prefix + "summary.json", err);
+		}
+
+	} // namespace cli
+
+} // namespace iebpr
\ No newline at end of file
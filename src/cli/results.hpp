@@ -0,0 +1,34 @@
+#ifndef __IEBPR_CLI_RESULTS_HPP__
+#define __IEBPR_CLI_RESULTS_HPP__
+
+#include <string>
+#include <vector>
+#include "../iebpr/simulation.hpp"
+
+// results of a run as .npy files, with the same dtypes as the arrays returned
+// by the python interface, loadable with numpy.load():
+//
+//	env_state_rec.npy: (n_state_rec,) of EnvStateRecDescr
+//	agent_state_rec.npy: (n_state_rec, n_subtype) of AgentStateRecDescr
+//	snapshot_rec.<i>.<subtype>.npy: (n_snapshot_rec, n_agent) of
+//		AgentStateRecDescr, one per subtype
+//	state_rec_timepoints.npy, snapshot_rec_timepoints.npy: float64
+//	summary.json: subtypes, run duration and profile totals
+
+namespace iebpr
+{
+	namespace cli
+	{
+		// write array data to a .npy file (format version 1.0); descr is a
+		// numpy dtype description; return false on io error
+		bool write_npy(const std::string &path, const std::string &descr,
+					   const std::vector<size_t> &shape, const void *data, size_t n_bytes);
+		// write all results of sim into out_dir, which must exist; on failure
+		// return false and describe the error in err
+		bool write_results(const Simulation &sim, const std::string &out_dir, std::string &err);
+
+	} // namespace cli
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
@@ -0,0 +1,600 @@
+#include <cmath>
+#include <cstring>
+#include "run_desc.hpp"
+
+namespace iebpr
+{
+	namespace cli
+	{
+		// field names of configs, in member order; keep aligned with
+		// StateRandConfig and TraitRandConfig
+		static const char *const _state_cfg_names[] = {
+			"biomass",
+			"rela_count",
+			"split_biomass",
+			"glycogen",
+			"pha",
+			"polyp",
+		};
+		static_assert(sizeof(_state_cfg_names) / sizeof(_state_cfg_names[0]) ==
+						  StateRandConfig::arr_size(),
+					  "_state_cfg_names misaligned with StateRandConfig");
+
+		static const char *const _trait_cfg_names[] = {
+			"mu",
+			"q_glycogen",
+			"q_pha",
+			"q_polyp",
+			"m_aerobic",
+			"m_anaerobic",
+			"b_aerobic",
+			"b_anaerobic",
+			"b_glycogen",
+			"b_pha",
+			"b_polyp",
+			"x_glycogen_min",
+			"x_glycogen_max",
+			"x_pha_min",
+			"x_pha_max",
+			"x_polyp_min",
+			"x_polyp_max",
+			"k_hac",
+			"k_op",
+			"k_op_polyp",
+			"k_glycogen",
+			"k_pha",
+			"k_polyp",
+			"ki_glycogen",
+			"ki_pha",
+			"ki_polyp",
+			"y_h",
+			"y_glycogen_pha",
+			"y_polyp_pha",
+			"y_pha_hac",
+			"y_prel",
+			"i_bmp",
+			"enable_tca",
+			"maint_polyp_first",
+		};
+		static_assert(sizeof(_trait_cfg_names) / sizeof(_trait_cfg_names[0]) ==
+						  TraitRandConfig::arr_size(),
+					  "_trait_cfg_names misaligned with TraitRandConfig");
+
+		//======================================================================
+		// value helpers, all return false and set err on failure; ctx names
+		// the field in error messages
+
+		static bool _fail(std::string &err, const std::string &ctx, const std::string &msg)
+		{
+			err = ctx + ": " + msg;
+			return false;
+		}
+
+		static bool _expect_type(const JsonValue &v, JsonValue::type_enum type,
+								 const std::string &ctx, std::string &err)
+		{
+			if (v.type == type)
+				return true;
+			return _fail(err, ctx, std::string("expected ") + JsonValue::type_enum_to_name(type) +
+									   ", got " + JsonValue::type_enum_to_name(v.type));
+		}
+
+		static bool _get_number(const JsonValue &v, const std::string &ctx,
+								double &ret, std::string &err)
+		{
+			if (!_expect_type(v, JsonValue::number, ctx, err))
+				return false;
+			ret = v.n;
+			return true;
+		}
+
+		static bool _get_count(const JsonValue &v, const std::string &ctx,
+							   uint64_t &ret, std::string &err)
+		{
+			if (!_expect_type(v, JsonValue::number, ctx, err))
+				return false;
+			if ((v.n < 0) || (v.n != std::floor(v.n)))
+				return _fail(err, ctx, "expected non-negative integer");
+			ret = (uint64_t)v.n;
+			return true;
+		}
+
+		static bool _get_bool(const JsonValue &v, const std::string &ctx,
+							  bool &ret, std::string &err)
+		{
+			if (!_expect_type(v, JsonValue::boolean, ctx, err))
+				return false;
+			ret = v.b;
+			return true;
+		}
+
+		static bool _get_string(const JsonValue &v, const std::string &ctx,
+								std::string &ret, std::string &err)
+		{
+			if (!_expect_type(v, JsonValue::string, ctx, err))
+				return false;
+			ret = v.s;
+			return true;
+		}
+
+		static std::string _resolve_path(const std::string &base_dir, const std::string &path)
+		{
+			if (base_dir.empty() || path.empty() || (path[0] == '/'))
+				return path;
+			return base_dir + "/" + path;
+		}
+
+		//======================================================================
+		// agent templates
+
+		static Randomizer::rand_t _randtype_name_to_enum(const std::string &name) noexcept
+		{
+			for (auto type : {Randomizer::none, Randomizer::constant, Randomizer::normal,
+							  Randomizer::uniform, Randomizer::bernoulli, Randomizer::obsvalues})
+				if (name == Randomizer::randtype_enum_to_name(type))
+					return type;
+			return Randomizer::invalid;
+		}
+
+		// a template value is a number, a number-like string (both as
+		// constant) or an object of RandConfig fields
+		static bool _load_rand_config(const JsonValue &v, const std::string &ctx,
+									  Randomizer::RandConfig &cfg, std::string &err)
+		{
+			cfg = Randomizer::RandConfig();
+			if ((v.type == JsonValue::number) || (v.type == JsonValue::string))
+			{
+				cfg.type = Randomizer::constant;
+				if (v.type == JsonValue::number)
+					cfg.mean = v.n;
+				else
+				{
+					char *end = nullptr;
+					cfg.mean = std::strtod(v.s.c_str(), &end);
+					if (v.s.empty() || (end != v.s.c_str() + v.s.size()))
+						return _fail(err, ctx, "string value is not a number");
+				}
+				return true;
+			}
+			if (!_expect_type(v, JsonValue::object, ctx, err))
+				return false;
+			auto type = v.get("type");
+			if (!type)
+				return _fail(err, ctx, "key 'type' is missing");
+			for (const auto &kv : v.obj)
+			{
+				const auto &key = kv.first;
+				const auto &val = kv.second;
+				const auto field_ctx = ctx + "." + key;
+				bool non_neg;
+				if (key == "type")
+				{
+					std::string name;
+					if (!_get_string(val, field_ctx, name, err))
+						return false;
+					if ((cfg.type = _randtype_name_to_enum(name)) == Randomizer::invalid)
+						return _fail(err, field_ctx, "invalid distribution type '" + name + "'");
+				}
+				else if (key == "mean")
+				{
+					if (!_get_number(val, field_ctx, cfg.mean, err))
+						return false;
+				}
+				else if (key == "stddev")
+				{
+					if (!_get_number(val, field_ctx, cfg.stddev, err))
+						return false;
+				}
+				else if (key == "low")
+				{
+					if (!_get_number(val, field_ctx, cfg.low, err))
+						return false;
+				}
+				else if (key == "high")
+				{
+					if (!_get_number(val, field_ctx, cfg.high, err))
+						return false;
+				}
+				else if (key == "non_neg")
+				{
+					if (!_get_bool(val, field_ctx, non_neg, err))
+						return false;
+					cfg.non_neg = non_neg;
+				}
+				else if (key == "value_list")
+				{
+					if (!_expect_type(val, JsonValue::array, field_ctx, err))
+						return false;
+					auto values = std::vector<stvalue_t>(val.arr.size());
+					for (size_t i = 0; i < values.size(); i++)
+						if (!_get_number(val.arr[i], field_ctx + "[" + std::to_string(i) + "]",
+										 values[i], err))
+							return false;
+					cfg.set_value_list(values);
+				}
+				else
+					return _fail(err, field_ctx, "unknown key");
+			}
+			return true;
+		}
+
+		// fill cfg_arr (arr_size configs named by names) from an agent
+		// template, given inline or as a path to a template json file
+		static bool _load_template(const JsonValue &v, const std::string &ctx,
+								   const std::string &base_dir, const char *const *names,
+								   size_t n_name, Randomizer::RandConfig *cfg_arr,
+								   std::string &err)
+		{
+			if (v.type == JsonValue::string)
+			{
+				auto path = _resolve_path(base_dir, v.s);
+				auto t = JsonValue();
+				if (!JsonValue::parse_file(path, t, err))
+					return _fail(err, ctx, path + ": " + err);
+				return _load_template(t, ctx + "(" + path + ")", base_dir, names, n_name,
+									  cfg_arr, err);
+			}
+			if (!_expect_type(v, JsonValue::object, ctx, err))
+				return false;
+			for (const auto &kv : v.obj)
+			{
+				size_t i = 0;
+				while ((i < n_name) && std::strcmp(names[i], kv.first.c_str()))
+					i++;
+				if (i >= n_name)
+					return _fail(err, ctx + "." + kv.first, "unknown key");
+				if (!_load_rand_config(kv.second, ctx + "." + kv.first, cfg_arr[i], err))
+					return false;
+			}
+			return true;
+		}
+
+		static bool _load_agents(const JsonValue &v, const std::string &base_dir,
+								 Simulation &sim, std::string &err)
+		{
+			if (!_expect_type(v, JsonValue::array, "agents", err))
+				return false;
+			for (size_t i = 0; i < v.arr.size(); i++)
+			{
+				const auto &agent = v.arr[i];
+				const auto ctx = "agents[" + std::to_string(i) + "]";
+				if (!_expect_type(agent, JsonValue::object, ctx, err))
+					return false;
+				auto subtype = Simulation::subtype_enum::invalid;
+				uint64_t n_agent = 0;
+				auto state_cfg = StateRandConfig();
+				auto trait_cfg = TraitRandConfig();
+				for (const auto &kv : agent.obj)
+				{
+					const auto &key = kv.first;
+					const auto field_ctx = ctx + "." + key;
+					if (key == "subtype")
+					{
+						std::string name;
+						if (!_get_string(kv.second, field_ctx, name, err))
+							return false;
+						for (auto t : {Simulation::subtype_enum::pao, Simulation::subtype_enum::gao,
+									   Simulation::subtype_enum::oho})
+							if (name == Simulation::subtype_enum_to_name(t))
+								subtype = t;
+						if (subtype == Simulation::subtype_enum::invalid)
+							return _fail(err, field_ctx, "invalid subtype '" + name + "'");
+					}
+					else if (key == "n_agent")
+					{
+						if (!_get_count(kv.second, field_ctx, n_agent, err))
+							return false;
+					}
+					else if (key == "state_cfg")
+					{
+						if (!_load_template(kv.second, field_ctx, base_dir, _state_cfg_names,
+											StateRandConfig::arr_size(), state_cfg.as_arr(), err))
+							return false;
+					}
+					else if (key == "trait_cfg")
+					{
+						if (!_load_template(kv.second, field_ctx, base_dir, _trait_cfg_names,
+											TraitRandConfig::arr_size(), trait_cfg.as_arr(), err))
+							return false;
+					}
+					else
+						return _fail(err, field_ctx, "unknown key");
+				}
+				if (subtype == Simulation::subtype_enum::invalid)
+					return _fail(err, ctx, "key 'subtype' is missing");
+				sim.add_agent_subtype(subtype, n_agent, state_cfg, trait_cfg);
+			}
+			return true;
+		}
+
+		//======================================================================
+		// sbr
+
+		static bool _load_init_env(const JsonValue &v, Simulation &sim, std::string &err)
+		{
+			if (!_expect_type(v, JsonValue::object, "init_env", err))
+				return false;
+			auto env = EnvState();
+			for (const auto &kv : v.obj)
+			{
+				const auto &key = kv.first;
+				const auto ctx = "init_env." + key;
+				double *field = (key == "volume")	  ? &env.volume
+								: (key == "vfa_conc") ? &env.vfa_conc
+								: (key == "op_conc")  ? &env.op_conc
+													  : nullptr;
+				if (!field)
+					return _fail(err, ctx, "unknown key");
+				if (!_get_number(kv.second, ctx, *field, err))
+					return false;
+			}
+			sim.set_init_env(env);
+			return true;
+		}
+
+		static bool _load_phase(const JsonValue &v, const std::string &ctx,
+								SbrControl::Phase &phase, std::string &err)
+		{
+			if (!_expect_type(v, JsonValue::object, ctx, err))
+				return false;
+			for (const auto &kv : v.obj)
+			{
+				const auto &key = kv.first;
+				const auto field_ctx = ctx + "." + key;
+				if (key == "aeration")
+				{
+					bool aeration;
+					if (!_get_bool(kv.second, field_ctx, aeration, err))
+						return false;
+					phase.aeration = aeration;
+					continue;
+				}
+				double *field = (key == "time_len")			 ? &phase.time_len
+								: (key == "inflow_rate")	 ? &phase.inflow_rate
+								: (key == "inflow_vfa_conc") ? &phase.inflow_vfa_conc
+								: (key == "inflow_op_conc")	 ? &phase.inflow_op_conc
+								: (key == "withdraw_rate")	 ? &phase.withdraw_rate
+								: (key == "outflow_rate")	 ? &phase.outflow_rate
+								: (key == "volume_reset")	 ? &phase.volume_reset
+															 : nullptr;
+				if (!field)
+					return _fail(err, field_ctx, "unknown key");
+				if (!_get_number(kv.second, field_ctx, *field, err))
+					return false;
+			}
+			return true;
+		}
+
+		static bool _load_stages(const JsonValue &v, Simulation &sim, std::string &err)
+		{
+			if (!_expect_type(v, JsonValue::array, "stages", err))
+				return false;
+			for (size_t i = 0; i < v.arr.size(); i++)
+			{
+				const auto &stage_v = v.arr[i];
+				const auto ctx = "stages[" + std::to_string(i) + "]";
+				if (!_expect_type(stage_v, JsonValue::object, ctx, err))
+					return false;
+				auto stage = SbrControl::Stage();
+				for (const auto &kv : stage_v.obj)
+				{
+					const auto &key = kv.first;
+					const auto field_ctx = ctx + "." + key;
+					if (key == "n_cycle")
+					{
+						uint64_t n_cycle;
+						if (!_get_count(kv.second, field_ctx, n_cycle, err))
+							return false;
+						stage.n_cycle = n_cycle;
+					}
+					else if (key == "cycle_phases")
+					{
+						if (!_expect_type(kv.second, JsonValue::array, field_ctx, err))
+							return false;
+						for (size_t j = 0; j < kv.second.arr.size(); j++)
+						{
+							auto phase = SbrControl::Phase();
+							if (!_load_phase(kv.second.arr[j], field_ctx + "[" + std::to_string(j) + "]",
+											 phase, err))
+								return false;
+							stage.append_phase(phase);
+						}
+					}
+					else
+						return _fail(err, field_ctx, "unknown key");
+				}
+				sim.append_sbr_stage(stage);
+			}
+			return true;
+		}
+
+		//======================================================================
+		// recorder
+
+		static bool _load_timepoints(const JsonValue &v, const std::string &ctx,
+									 std::vector<stvalue_t> &ret, std::string &err)
+		{
+			ret.clear();
+			if (v.type == JsonValue::array)
+			{
+				ret.resize(v.arr.size());
+				for (size_t i = 0; i < ret.size(); i++)
+					if (!_get_number(v.arr[i], ctx + "[" + std::to_string(i) + "]", ret[i], err))
+						return false;
+				return true;
+			}
+			if (!_expect_type(v, JsonValue::object, ctx, err))
+				return false;
+			// evenly spaced, stop included, as numpy.linspace
+			auto start = v.get("start");
+			auto stop = v.get("stop");
+			auto num = v.get("num");
+			if ((!start) || (!stop) || (!num) || (v.obj.size() != 3))
+				return _fail(err, ctx, "expected exactly keys 'start', 'stop' and 'num'");
+			double start_v, stop_v;
+			uint64_t num_v;
+			if ((!_get_number(*start, ctx + ".start", start_v, err)) ||
+				(!_get_number(*stop, ctx + ".stop", stop_v, err)) ||
+				(!_get_count(*num, ctx + ".num", num_v, err)))
+				return false;
+			// same arithmetic as numpy.linspace, so that timepoints are
+			// identical to those set from python
+			ret.resize(num_v);
+			const double step = (num_v > 1) ? (stop_v - start_v) / (num_v - 1) : 0;
+			for (uint64_t i = 0; i < num_v; i++)
+				ret[i] = i * step + start_v;
+			if (num_v > 1)
+				ret.back() = stop_v;
+			return true;
+		}
+
+		//======================================================================
+
+		bool load_run_desc(const JsonValue &desc, const std::string &base_dir,
+						   Simulation &sim, std::string &err)
+		{
+			if (!_expect_type(desc, JsonValue::object, "run description", err))
+				return false;
+			auto timepoints = std::vector<stvalue_t>(0);
+			for (const auto &kv : desc.obj)
+			{
+				const auto &key = kv.first;
+				const auto &v = kv.second;
+				double number;
+				uint64_t count;
+				bool flag;
+				if (key == "seed")
+				{
+					if (!_get_count(v, key, count, err))
+						return false;
+					sim.set_seed(count);
+				}
+				else if (key == "pcontinuous")
+				{
+					if (!_get_bool(v, key, flag, err))
+						return false;
+					sim.set_simutype(flag ? Simulation::simutype_enum::pcontinuous
+										  : Simulation::simutype_enum::discrete);
+				}
+				else if (key == "timestep")
+				{
+					if (!_get_number(v, key, number, err))
+						return false;
+					sim.set_timestep(number);
+				}
+				else if (key == "hydraulic_span")
+				{
+					if (!_get_count(v, key, count, err))
+						return false;
+					sim.set_hydraulic_span(count);
+				}
+				else if (key == "implicit_uptake_ratio")
+				{
+					if (!_get_number(v, key, number, err))
+						return false;
+					sim.set_implicit_uptake_ratio(number);
+				}
+				else if (key == "aggregate_tolerance")
+				{
+					if (!_get_number(v, key, number, err))
+						return false;
+					if (!(number >= 0))
+						return _fail(err, key, "expected non-negative number");
+					sim.set_aggregate_tolerance(number);
+				}
+				else if (key == "trait_reservoir_size")
+				{
+					if (!_get_count(v, key, count, err))
+						return false;
+					sim.set_trait_reservoir_size(count);
+				}
+				else if (key == "trait_reservoir_thread")
+				{
+					if (!_get_bool(v, key, flag, err))
+						return false;
+					sim.set_trait_reservoir_thread(flag);
+				}
+				else if (key == "instantiate_threads")
+				{
+					if (!_get_count(v, key, count, err))
+						return false;
+					sim.set_instantiate_threads(count);
+				}
+				else if (key == "pool_backing_dir")
+				{
+					std::string dir;
+					if (!_get_string(v, key, dir, err))
+						return false;
+					sim.set_pool_backing_dir(dir);
+				}
+				else if (key == "checkpoint_file")
+				{
+					if (!_get_string(v, key, sim.checkpoint_file, err))
+						return false;
+				}
+				else if (key == "checkpoint_interval")
+				{
+					if (!_get_number(v, key, sim.checkpoint_interval, err))
+						return false;
+				}
+				else if (key == "trace_file")
+				{
+					if (!_get_string(v, key, sim.trace_file, err))
+						return false;
+				}
+				else if (key == "trace_sample_interval")
+				{
+					if (!_get_count(v, key, sim.trace_sample_interval, err))
+						return false;
+				}
+				else if (key == "max_steps")
+				{
+					if (!_get_count(v, key, sim.run_control.max_steps, err))
+						return false;
+				}
+				else if (key == "max_wall_time")
+				{
+					if (!_get_number(v, key, sim.run_control.max_wall_time, err))
+						return false;
+				}
+				else if (key == "perf_counters")
+				{
+					if (!_get_bool(v, key, sim.perf_counters, err))
+						return false;
+				}
+				else if (key == "init_env")
+				{
+					if (!_load_init_env(v, sim, err))
+						return false;
+				}
+				else if (key == "stages")
+				{
+					if (!_load_stages(v, sim, err))
+						return false;
+				}
+				else if (key == "agents")
+				{
+					if (!_load_agents(v, base_dir, sim, err))
+						return false;
+				}
+				else if (key == "state_rec_timepoints")
+				{
+					if (!_load_timepoints(v, key, timepoints, err))
+						return false;
+					sim.set_state_rec_timepoints(std::move(timepoints));
+				}
+				else if (key == "snapshot_rec_timepoints")
+				{
+					if (!_load_timepoints(v, key, timepoints, err))
+						return false;
+					sim.set_snapshot_rec_timepoints(std::move(timepoints));
+				}
+				else
+					return _fail(err, key, "unknown key");
+			}
+			return true;
+		}
+
+	} // namespace cli
+
+} // namespace iebpr
\ No newline at end of file
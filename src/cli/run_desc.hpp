@@ -0,0 +1,38 @@
+#ifndef __IEBPR_CLI_RUN_DESC_HPP__
+#define __IEBPR_CLI_RUN_DESC_HPP__
+
+#include <string>
+#include "../iebpr/simulation.hpp"
+#include "json.hpp"
+
+// run description: a json object configuring a Simulation, with fields named
+// after the python interface; see doc/example.run.json
+//
+//	seed, pcontinuous, timestep, hydraulic_span, implicit_uptake_ratio,
+//	aggregate_tolerance, trait_reservoir_size, trait_reservoir_thread,
+//	instantiate_threads, pool_backing_dir, checkpoint_file,
+//	checkpoint_interval, trace_file, trace_sample_interval, max_steps,
+//	max_wall_time, perf_counters: as Simulation attributes, all optional
+//	init_env: {volume, vfa_conc, op_conc}
+//	stages: [{n_cycle, cycle_phases: [{time_len, inflow_rate, inflow_vfa_conc,
+//		inflow_op_conc, withdraw_rate, outflow_rate, aeration, volume_reset}]}]
+//	agents: [{subtype, n_agent, state_cfg, trait_cfg}], where state_cfg and
+//		trait_cfg are agent templates (as in iebpr/agent_template), either
+//		inline or as path to a template json file
+//	state_rec_timepoints, snapshot_rec_timepoints: list of time, or
+//		{start, stop, num} for evenly spaced timepoints like numpy.linspace
+
+namespace iebpr
+{
+	namespace cli
+	{
+		// configure sim by desc; relative paths of template files are resolved
+		// from base_dir; on failure return false and describe the error in err
+		bool load_run_desc(const JsonValue &desc, const std::string &base_dir,
+						   Simulation &sim, std::string &err);
+
+	} // namespace cli
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
@@ -0,0 +1,691 @@
+#ifndef __IEBPR_AGENT_KINETICS_HPP__
+#define __IEBPR_AGENT_KINETICS_HPP__
+
+#include <algorithm>
+#include "def.hpp"
+#include "env_state.hpp"
+#include "agent_data.hpp"
+#include "agent_subtype_base.hpp"
+#include "agent_subtype_consts.hpp"
+
+// kinetics are always inlined, so that the lane blends below fold away in the
+// scalar agent actions, and the vector lanes are compiled for the instruction
+// set of the calling kernel
+#ifndef kinetics_inline
+#define kinetics_inline inline __attribute__((always_inline))
+#endif
+
+namespace iebpr
+{
+	//==========================================================================
+	// the kinetics of agent subtypes are written once over lanes, either one
+	// agent (ScalarLanes) or the same agent in several replicates advanced in
+	// lockstep (see ReplicateBatch); a lanes type L provides:
+	//   value_t, mask_t: value and condition of all lanes
+	//   env_t, state_t, agent_t, uptake_t: EnvState, AgentState, AgentData and
+	//     SubstrateUptake with value_t fields, only those used by kinetics
+	//   zero(), any(m), all(act, m), select(m, a, b), min(a, b)
+	//   test(bt): condition from a bool trait
+	//   add(m, acc, v), sub(m, acc, v): acc += v or acc -= v where m is set
+	//   merge_state(act, state, d_state): AgentState::merge_with()
+	// conditions are combined with &, as && on vectors compares each side to 0
+	// again; a block taken under a condition in the scalar kinetics is taken if any
+	// lane meets it, and only updates those lanes; only lanes in act (the
+	// active agents) are ever updated, so every lane gets the exact result
+	// of the scalar kinetics
+
+	// lanes of a single agent, used by AgentSubtype*::agent_action_*()
+	struct ScalarLanes
+	{
+	public:
+		using value_t = stvalue_t;
+		using mask_t = bool;
+		using env_t = EnvState;
+		using state_t = AgentState;
+		using agent_t = AgentData;
+		using uptake_t = SubstrateUptake;
+
+		static kinetics_inline value_t zero(void) noexcept { return 0; }
+		static kinetics_inline mask_t test(bivalue_t bt) noexcept { return bt; }
+		static kinetics_inline bool any(mask_t m) noexcept { return m; }
+		static kinetics_inline bool all(mask_t act, mask_t m) noexcept { return (!act) || m; }
+		static kinetics_inline value_t select(mask_t m, value_t a, value_t b) noexcept { return m ? a : b; }
+		static kinetics_inline value_t min(value_t a, value_t b) noexcept { return std::min(a, b); }
+		static kinetics_inline void add(mask_t m, value_t &acc, value_t v) noexcept
+		{
+			if (m)
+				acc += v;
+			return;
+		}
+		static kinetics_inline void sub(mask_t m, value_t &acc, value_t v) noexcept
+		{
+			if (m)
+				acc -= v;
+			return;
+		}
+		static kinetics_inline void merge_state(mask_t, state_t &state, const state_t &d_state) noexcept
+		{
+			state.merge_with(d_state);
+			return;
+		}
+	};
+
+	// check that the agent is sane after an action
+	template <typename L>
+	static kinetics_inline bool _is_sane_after_action(const typename L::mask_t &act,
+													  const typename L::agent_t &agent,
+													  const typename L::state_t &d_state) noexcept
+	{
+		// not auto, which drops the alignment attribute of lane vectors
+		const typename L::value_t &rela_count = agent.state.rela_count;
+		return L::all(act, (d_state.rela_count == 0) && (d_state.split_biomass == 0) &&
+							   (rela_count != stvalue_inf) && (rela_count != -stvalue_inf) &&
+							   (rela_count != stvalue_nan));
+	}
+
+	//==========================================================================
+	// pao
+
+	template <typename L>
+	struct PaoKinetics
+	{
+	public:
+		using value_t = typename L::value_t;
+		using mask_t = typename L::mask_t;
+		using env_t = typename L::env_t;
+		using state_t = typename L::state_t;
+		using agent_t = typename L::agent_t;
+		using uptake_t = typename L::uptake_t;
+
+		// substrate uptake processes, shared by action_* and uptake_demand_*
+
+		// polyp synthesis, also the op uptake
+		static kinetics_inline value_t polyp_synthesis(const mask_t &act, const env_t &env, const agent_t &agent) noexcept
+		{
+			const mask_t m = act & (env.op_conc > 0) & (agent.i_polyp() > 0) & (agent.x_pha() > 0);
+			if (!L::any(m))
+				return L::zero();
+			const auto monod_op_polyp = env.op_conc / (env.op_conc + agent.trait.reg.k_op_polyp);
+			return L::select(m, agent.trait.rate.q_polyp * monod_op_polyp * agent.monod_pha() * agent.inhib_polyp() * agent.state.biomass,
+							 L::zero());
+		}
+
+		// acetate uptake / pha synthesis (glycolysis)
+		static kinetics_inline value_t vfa_uptake_glycolysis(const mask_t &act, const env_t &env, const agent_t &agent) noexcept
+		{
+			const mask_t m = act & (env.vfa_conc > 0) & (agent.x_glycogen() > 0) & (agent.i_pha() > 0) & (agent.x_polyp() > 0);
+			if (!L::any(m))
+				return L::zero();
+			return L::select(m, agent.trait.rate.q_pha * agent.monod_vfa(env) * agent.monod_glycogen() * agent.inhib_pha() * agent.monod_polyp() * agent.state.biomass,
+							 L::zero());
+		}
+
+		// acetate uptake / pha synthesis (tca, if enable_tca = true)
+		static kinetics_inline value_t vfa_uptake_tca(const mask_t &act, const env_t &env, const agent_t &agent) noexcept
+		{
+			const mask_t m = act & (env.vfa_conc > 0) & (agent.i_pha() > 0) & (agent.x_polyp() > 0) & L::test(agent.trait.bt.enable_tca);
+			if (!L::any(m))
+				return L::zero();
+			return L::select(m, agent.trait.rate.q_pha * agent.monod_vfa(env) * (1 - agent.monod_glycogen()) * agent.inhib_pha() * agent.monod_polyp() * agent.state.biomass,
+							 L::zero());
+		}
+
+		static kinetics_inline void uptake_demand_aerobic(const mask_t &act, const env_t &env, env_t &demand, const agent_t &agent) noexcept
+		{
+			L::add(act, demand.op_conc, polyp_synthesis(act, env, agent));
+			return;
+		}
+
+		static kinetics_inline void uptake_demand_anaerobic(const mask_t &act, const env_t &env, env_t &demand, const agent_t &agent) noexcept
+		{
+			L::add(act, demand.vfa_conc, vfa_uptake_glycolysis(act, env, agent) + vfa_uptake_tca(act, env, agent));
+			return;
+		}
+
+		static kinetics_inline void action_aerobic(const mask_t &act, const env_t &env, env_t &d_env, agent_t &agent,
+												   uptake_t &uptake) noexcept
+		{
+			// agent state change
+			auto d_state = state_t();
+
+			// prepare data
+			const auto x_glycogen = agent.x_glycogen();
+			const auto monod_glycogen = agent.monod_glycogen();
+			const auto i_glycogen = agent.i_glycogen();
+			const auto inhib_glycogen = agent.inhib_glycogen();
+			const auto x_pha = agent.x_pha();
+			const auto monod_pha = agent.monod_pha();
+			const auto x_polyp = agent.x_polyp();
+			const auto monod_polyp = agent.monod_polyp();
+			assert(L::all(act, (monod_glycogen >= 0) && (monod_glycogen <= 1)));
+			assert(L::all(act, (monod_pha >= 0) && (monod_pha <= 1)));
+			assert(L::all(act, (monod_polyp >= 0) && (monod_polyp <= 1)));
+			assert(L::all(act, (agent.inhib_polyp() >= 0) && (agent.inhib_polyp() <= 1)));
+
+			// glycogen synthesis
+			{
+				const mask_t m = act & (i_glycogen > 0) & (x_pha > 0);
+				if (L::any(m))
+				{
+					const auto delta = agent.trait.rate.q_glycogen * inhib_glycogen *
+									   monod_pha * agent.state.biomass;
+					L::add(m, d_state.glycogen, delta);
+					L::sub(m, d_state.pha, delta / agent.trait.reg.y_glycogen_pha);
+				}
+			}
+			// polyp synthesis
+			{
+				const auto delta = polyp_synthesis(act, env, agent) * uptake.op_scale;
+				const mask_t m = act & (delta != 0);
+				if (L::any(m))
+				{
+					L::add(m, d_state.polyp, delta);
+					L::sub(m, d_state.pha, delta / agent.trait.reg.y_polyp_pha);
+					L::sub(m, d_env.op_conc, delta);
+					L::add(m, uptake.op, delta);
+				}
+			}
+			// biomass growth on pha, pao uses internal polyp as p source
+			{
+				const mask_t m = act & (x_pha > 0) & (x_polyp > 0);
+				if (L::any(m))
+				{
+					const auto delta = agent.trait.rate.mu * monod_pha * monod_polyp * agent.state.biomass;
+					L::add(m, d_state.biomass, delta);
+					L::sub(m, d_state.pha, delta / agent.trait.reg.y_h);
+					L::sub(m, d_state.polyp, delta * agent.trait.reg.i_bmp);
+				}
+			}
+			// maintenance (not bound with decay)
+			{
+				// maintenance
+				// portion resolved by calculation order
+				const auto p_pha = monod_pha;
+				const auto p_glycogen = L::min(1 - p_pha, monod_glycogen);
+				const auto p_polyp = L::min(1 - p_pha - p_glycogen, monod_polyp);
+				assert(L::all(act, p_glycogen >= 0));
+				assert(L::all(act, p_polyp >= 0));
+				// belows are order-free
+				// glycogen
+				{
+					const auto delta = p_glycogen * agent.trait.rate.m_aerobic *
+									   agent_subtype_consts::GLYC_PER_ATP_AER *
+									   agent.state.biomass;
+					L::sub(act, d_state.glycogen, delta);
+				}
+				// pha
+				{
+					const auto delta = p_pha * agent.trait.rate.m_aerobic *
+									   agent_subtype_consts::PHA_PER_ATP_AER *
+									   agent.state.biomass;
+					L::sub(act, d_state.pha, delta);
+				}
+				// polyp
+				{
+					const auto delta = p_polyp * agent.trait.rate.m_aerobic *
+									   agent_subtype_consts::POLYP_PER_ATP *
+									   agent.state.biomass;
+					L::sub(act, d_state.polyp, delta);
+					L::add(act, d_env.op_conc, delta);
+				}
+			}
+			// biomass decay
+			{
+				const auto delta = agent.trait.rate.b_aerobic * agent.state.biomass;
+				L::sub(act, d_state.biomass, delta);
+				L::add(act, d_env.vfa_conc, delta * agent_subtype_consts::VFA_PER_DECAYED_BIOMASS);
+				L::add(act, d_env.op_conc, delta * agent.trait.reg.i_bmp);
+			}
+			// glycogen intrinsic decay, release as vfa
+			{
+				const mask_t m = act & (x_glycogen > 0);
+				if (L::any(m))
+				{
+					const auto delta = agent.trait.rate.b_glycogen * x_glycogen * agent.state.biomass;
+					L::sub(m, d_state.glycogen, delta);
+					L::add(m, d_env.vfa_conc, delta);
+				}
+			}
+			// pha intrinsic decay, release as vfa
+			{
+				const mask_t m = act & (x_pha > 0);
+				if (L::any(m))
+				{
+					const auto delta = agent.trait.rate.b_pha * x_pha * agent.state.biomass;
+					L::sub(m, d_state.pha, delta);
+					L::add(m, d_env.vfa_conc, delta);
+				}
+			}
+			// polyp intrinsic decay, release as op
+			{
+				const mask_t m = act & (x_polyp > 0);
+				if (L::any(m))
+				{
+					const auto delta = agent.trait.rate.b_polyp * x_polyp * agent.state.biomass;
+					L::sub(m, d_state.polyp, delta);
+					L::add(m, d_env.op_conc, delta);
+				}
+			}
+			// update to agent
+			L::merge_state(act, agent.state, d_state);
+			assert((_is_sane_after_action<L>(act, agent, d_state)));
+			return;
+		}
+
+		static kinetics_inline void action_anaerobic(const mask_t &act, const env_t &env, env_t &d_env, agent_t &agent,
+													 uptake_t &uptake) noexcept
+		{
+			// agent state change
+			auto d_state = state_t();
+
+			// prepare data
+			const auto x_glycogen = agent.x_glycogen();
+			const auto monod_glycogen = agent.monod_glycogen();
+			const auto x_pha = agent.x_pha();
+			const auto x_polyp = agent.x_polyp();
+			const auto monod_polyp = agent.monod_polyp();
+
+			// acetate uptake / pha synthesis (glycolysis)
+			// delta = vfa for easier calculation
+			{
+				const auto delta = vfa_uptake_glycolysis(act, env, agent) * uptake.vfa_scale;
+				const mask_t m = act & (delta != 0);
+				if (L::any(m))
+				{
+					L::sub(m, d_env.vfa_conc, delta);
+					L::add(m, uptake.vfa, delta);
+					L::add(m, d_env.op_conc, delta * agent.trait.reg.y_prel);
+					// d_glycogen + d_vfa = d_pha for conservation of mass
+					L::sub(m, d_state.glycogen, delta * (agent.trait.reg.y_pha_hac - 1));
+					L::add(m, d_state.pha, delta * agent.trait.reg.y_pha_hac);
+					L::sub(m, d_state.polyp, delta * agent.trait.reg.y_prel);
+				}
+			}
+			// acetate uptake / pha synthesis (tca, if enable_tca = true)
+			// delta = vfa for easier calculation
+			{
+				const auto delta = vfa_uptake_tca(act, env, agent) * uptake.vfa_scale;
+				const mask_t m = act & (delta != 0);
+				if (L::any(m))
+				{
+					L::sub(m, d_env.vfa_conc, delta);
+					L::add(m, uptake.vfa, delta);
+					L::add(m, d_env.op_conc, delta * agent.trait.reg.y_prel);
+					L::add(m, d_state.pha, delta); // conservation of mass
+					L::sub(m, d_state.polyp, delta * agent.trait.reg.y_prel);
+				}
+			}
+			// maintenance-bound biomass decay
+			{
+				// maintenance
+				// portion resolved by calculation order
+				const mask_t polyp_first = L::test(agent.trait.bt.maint_polyp_first);
+				const auto p_glycogen = L::select(polyp_first, L::min(1 - monod_polyp, monod_glycogen), monod_glycogen);
+				const auto p_polyp = L::select(polyp_first, monod_polyp, L::min(1 - monod_glycogen, monod_polyp));
+				// belows are order-free
+				// glycogen
+				{
+					const auto delta = p_glycogen * agent.trait.rate.m_anaerobic *
+									   agent_subtype_consts::GLYC_PER_ATP_ANA *
+									   agent.state.biomass;
+					L::sub(act, d_state.glycogen, delta);
+					L::add(act, d_state.pha, delta * agent_subtype_consts::PHA_PER_GLYC_ANA_ATP);
+				}
+				// polyp
+				{
+					const auto delta = p_polyp * agent.trait.rate.m_anaerobic *
+									   agent_subtype_consts::POLYP_PER_ATP *
+									   agent.state.biomass;
+					L::sub(act, d_state.polyp, delta);
+					L::add(act, d_env.op_conc, delta);
+				}
+				// biomass decay
+				{
+					const auto delta = (1 - p_glycogen - p_polyp) * agent.trait.rate.b_anaerobic * agent.state.biomass;
+					L::sub(act, d_state.biomass, delta);
+					L::add(act, d_env.vfa_conc, delta * agent_subtype_consts::VFA_PER_DECAYED_BIOMASS);
+					L::add(act, d_env.op_conc, delta * agent.trait.reg.i_bmp);
+				}
+			}
+			// glycogen intrinsic decay, release as vfa
+			{
+				const mask_t m = act & (x_glycogen > 0);
+				if (L::any(m))
+				{
+					const auto delta = agent.trait.rate.b_glycogen * x_glycogen * agent.state.biomass;
+					L::sub(m, d_state.glycogen, delta);
+					L::add(m, d_env.vfa_conc, delta);
+				}
+			}
+			// pha intrinsic decay, release as vfa
+			{
+				const mask_t m = act & (x_pha > 0);
+				if (L::any(m))
+				{
+					const auto delta = agent.trait.rate.b_pha * x_pha * agent.state.biomass;
+					L::sub(m, d_state.pha, delta);
+					L::add(m, d_env.vfa_conc, delta);
+				}
+			}
+			// polyp intrinsic decay, release as op
+			{
+				const mask_t m = act & (x_polyp > 0);
+				if (L::any(m))
+				{
+					const auto delta = agent.trait.rate.b_polyp * x_polyp * agent.state.biomass;
+					L::sub(m, d_state.polyp, delta);
+					L::add(m, d_env.op_conc, delta);
+				}
+			}
+			// update to agent
+			L::merge_state(act, agent.state, d_state);
+			assert((_is_sane_after_action<L>(act, agent, d_state)));
+			return;
+		}
+	};
+
+	//==========================================================================
+	// gao
+
+	template <typename L>
+	struct GaoKinetics
+	{
+	public:
+		using value_t = typename L::value_t;
+		using mask_t = typename L::mask_t;
+		using env_t = typename L::env_t;
+		using state_t = typename L::state_t;
+		using agent_t = typename L::agent_t;
+		using uptake_t = typename L::uptake_t;
+
+		// substrate uptake processes, shared by action_* and uptake_demand_*
+
+		// biomass growth on pha, op uptake is delta * i_bmp
+		static kinetics_inline value_t growth(const mask_t &act, const env_t &env, const agent_t &agent) noexcept
+		{
+			const mask_t m = act & (env.op_conc > 0) & (agent.x_pha() > 0);
+			if (!L::any(m))
+				return L::zero();
+			return L::select(m, agent.trait.rate.mu * agent.monod_pha() * agent.monod_op(env) * agent.state.biomass,
+							 L::zero());
+		}
+
+		// acetate uptake / pha synthesis
+		static kinetics_inline value_t vfa_uptake(const mask_t &act, const env_t &env, const agent_t &agent) noexcept
+		{
+			const mask_t m = act & (env.vfa_conc > 0) & (agent.x_glycogen() > 0) & (agent.i_pha() > 0);
+			if (!L::any(m))
+				return L::zero();
+			return L::select(m, agent.trait.rate.q_pha * agent.monod_vfa(env) * agent.monod_glycogen() * agent.inhib_pha() * agent.state.biomass,
+							 L::zero());
+		}
+
+		static kinetics_inline void uptake_demand_aerobic(const mask_t &act, const env_t &env, env_t &demand, const agent_t &agent) noexcept
+		{
+			L::add(act, demand.op_conc, growth(act, env, agent) * agent.trait.reg.i_bmp);
+			return;
+		}
+
+		static kinetics_inline void uptake_demand_anaerobic(const mask_t &act, const env_t &env, env_t &demand, const agent_t &agent) noexcept
+		{
+			L::add(act, demand.vfa_conc, vfa_uptake(act, env, agent));
+			return;
+		}
+
+		static kinetics_inline void action_aerobic(const mask_t &act, const env_t &env, env_t &d_env, agent_t &agent,
+												   uptake_t &uptake) noexcept
+		{
+			// agent state change
+			auto d_state = state_t();
+
+			// prepare data
+			const auto x_glycogen = agent.x_glycogen();
+			const auto monod_glycogen = agent.monod_glycogen();
+			const auto i_glycogen = agent.i_glycogen();
+			const auto inhib_glycogen = agent.inhib_glycogen();
+			const auto x_pha = agent.x_pha();
+			const auto monod_pha = agent.monod_pha();
+
+			// glycogen synthesis
+			{
+				const mask_t m = act & (i_glycogen > 0) & (x_pha > 0);
+				if (L::any(m))
+				{
+					const auto delta = agent.trait.rate.q_glycogen * monod_pha * inhib_glycogen * agent.state.biomass;
+					L::add(m, d_state.glycogen, delta);
+					L::sub(m, d_state.pha, delta / agent.trait.reg.y_glycogen_pha);
+				}
+			}
+			// biomass growth on pha
+			{
+				const auto delta = growth(act, env, agent) * uptake.op_scale;
+				const mask_t m = act & (delta != 0);
+				if (L::any(m))
+				{
+					L::add(m, d_state.biomass, delta);
+					L::sub(m, d_state.pha, delta / agent.trait.reg.y_h);
+					L::sub(m, d_env.op_conc, delta * agent.trait.reg.i_bmp);
+					L::add(m, uptake.op, delta * agent.trait.reg.i_bmp);
+				}
+			}
+			// maintenance (not bound with decay)
+			{
+				// portion resolved by calculation order
+				// pha first, then glycogen
+				const auto p_pha = monod_pha;
+				const auto p_glycogen = L::min(1 - p_pha, monod_glycogen);
+				// belows are order-free
+				// glycogen
+				{
+					const auto delta = p_glycogen * agent.trait.rate.m_aerobic *
+									   agent_subtype_consts::GLYC_PER_ATP_AER *
+									   agent.state.biomass;
+					L::sub(act, d_state.glycogen, delta);
+				}
+				// pha
+				{
+					const auto delta = p_pha * agent.trait.rate.m_aerobic *
+									   agent_subtype_consts::PHA_PER_ATP_AER *
+									   agent.state.biomass;
+					L::sub(act, d_state.pha, delta);
+				}
+			}
+			// biomass decay
+			{
+				const auto delta = agent.trait.rate.b_aerobic * agent.state.biomass;
+				L::sub(act, d_state.biomass, delta);
+				L::add(act, d_env.vfa_conc, delta * agent_subtype_consts::VFA_PER_DECAYED_BIOMASS);
+				L::add(act, d_env.op_conc, delta * agent.trait.reg.i_bmp);
+			}
+			// glycogen intrinsic decay, release as vfa
+			{
+				const mask_t m = act & (x_glycogen > 0);
+				if (L::any(m))
+				{
+					const auto delta = agent.trait.rate.b_glycogen * x_glycogen * agent.state.biomass;
+					L::sub(m, d_state.glycogen, delta);
+					L::add(m, d_env.vfa_conc, delta);
+				}
+			}
+			// pha intrinsic decay, release as vfa
+			{
+				const mask_t m = act & (x_pha > 0);
+				if (L::any(m))
+				{
+					const auto delta = agent.trait.rate.b_pha * x_pha * agent.state.biomass;
+					L::sub(m, d_state.pha, delta);
+					L::add(m, d_env.vfa_conc, delta);
+				}
+			}
+			// update to agent
+			L::merge_state(act, agent.state, d_state);
+			assert((_is_sane_after_action<L>(act, agent, d_state)));
+			return;
+		}
+
+		static kinetics_inline void action_anaerobic(const mask_t &act, const env_t &env, env_t &d_env, agent_t &agent,
+													 uptake_t &uptake) noexcept
+		{
+			// agent state change
+			auto d_state = state_t();
+
+			// prepare data
+			const auto x_glycogen = agent.x_glycogen();
+			const auto monod_glycogen = agent.monod_glycogen();
+			const auto x_pha = agent.x_pha();
+
+			// acetate uptake / pha synthesis
+			// delta = vfa for easier calculation
+			{
+				const auto delta = vfa_uptake(act, env, agent) * uptake.vfa_scale;
+				const mask_t m = act & (delta != 0);
+				if (L::any(m))
+				{
+					L::sub(m, d_env.vfa_conc, delta);
+					L::add(m, uptake.vfa, delta);
+					// d_glycogen + d_vfa = d_pha for conservation of mass
+					L::sub(m, d_state.glycogen, delta * (agent.trait.reg.y_pha_hac - 1));
+					L::add(m, d_state.pha, delta * agent.trait.reg.y_pha_hac);
+				}
+			}
+			// maintenance-bound biomass decay
+			{
+				const auto p_glycogen = monod_glycogen;
+				// maintenance
+				{
+					// glycogen
+					const auto delta = p_glycogen * agent.trait.rate.m_anaerobic *
+									   agent_subtype_consts::GLYC_PER_ATP_ANA *
+									   agent.state.biomass;
+					L::sub(act, d_state.glycogen, delta);
+					L::add(act, d_state.pha, delta * agent_subtype_consts::PHA_PER_GLYC_ANA_ATP);
+				}
+				// biomass decay
+				{
+					const auto delta = (1 - p_glycogen) * agent.trait.rate.b_anaerobic * agent.state.biomass;
+					L::sub(act, d_state.biomass, delta);
+					L::add(act, d_env.vfa_conc, delta * agent_subtype_consts::VFA_PER_DECAYED_BIOMASS);
+					L::add(act, d_env.op_conc, delta * agent.trait.reg.i_bmp);
+				}
+			}
+			// glycogen intrinsic decay, release as vfa
+			{
+				const mask_t m = act & (x_glycogen > 0);
+				if (L::any(m))
+				{
+					const auto delta = agent.trait.rate.b_glycogen * x_glycogen * agent.state.biomass;
+					L::sub(m, d_state.glycogen, delta);
+					L::add(m, d_env.vfa_conc, delta);
+				}
+			}
+			// pha intrinsic decay, release as vfa
+			{
+				const mask_t m = act & (x_pha > 0);
+				if (L::any(m))
+				{
+					const auto delta = agent.trait.rate.b_pha * x_pha * agent.state.biomass;
+					L::sub(m, d_state.pha, delta);
+					L::add(m, d_env.vfa_conc, delta);
+				}
+			}
+			// update to agent
+			L::merge_state(act, agent.state, d_state);
+			assert((_is_sane_after_action<L>(act, agent, d_state)));
+			return;
+		}
+	};
+
+	//==========================================================================
+	// oho
+
+	template <typename L>
+	struct OhoKinetics
+	{
+	public:
+		using value_t = typename L::value_t;
+		using mask_t = typename L::mask_t;
+		using env_t = typename L::env_t;
+		using state_t = typename L::state_t;
+		using agent_t = typename L::agent_t;
+		using uptake_t = typename L::uptake_t;
+
+		// substrate uptake processes, shared by action_* and uptake_demand_*
+
+		// cell growth, vfa uptake is delta / y_h and op uptake is delta * i_bmp
+		static kinetics_inline value_t growth(const mask_t &act, const env_t &env, const agent_t &agent) noexcept
+		{
+			const mask_t m = act & (env.vfa_conc > 0) & (env.op_conc > 0);
+			if (!L::any(m))
+				return L::zero();
+			return L::select(m, agent.trait.rate.mu * agent.monod_vfa(env) * agent.monod_op(env) * agent.state.biomass,
+							 L::zero());
+		}
+
+		static kinetics_inline void uptake_demand_aerobic(const mask_t &act, const env_t &env, env_t &demand, const agent_t &agent) noexcept
+		{
+			const auto g = growth(act, env, agent);
+			L::add(act, demand.vfa_conc, g / agent.trait.reg.y_h);
+			L::add(act, demand.op_conc, g * agent.trait.reg.i_bmp);
+			return;
+		}
+
+		static kinetics_inline void uptake_demand_anaerobic(const mask_t &act, const env_t &env, env_t &demand, const agent_t &agent) noexcept
+		{
+			return;
+		}
+
+		static kinetics_inline void action_aerobic(const mask_t &act, const env_t &env, env_t &d_env, agent_t &agent,
+												   uptake_t &uptake) noexcept
+		{
+			// agent state change
+			auto d_state = state_t();
+
+			// cell growth, limited by the more depleted substrate
+			{
+				const auto delta = growth(act, env, agent) * L::min(uptake.vfa_scale, uptake.op_scale);
+				const mask_t m = act & (delta != 0);
+				if (L::any(m))
+				{
+					L::add(m, d_state.biomass, delta);
+					L::sub(m, d_env.vfa_conc, delta / agent.trait.reg.y_h);
+					L::sub(m, d_env.op_conc, delta * agent.trait.reg.i_bmp);
+					L::add(m, uptake.vfa, delta / agent.trait.reg.y_h);
+					L::add(m, uptake.op, delta * agent.trait.reg.i_bmp);
+				}
+			}
+			// biomass decay
+			{
+				const auto delta = agent.trait.rate.b_aerobic * agent.state.biomass;
+				L::sub(act, d_state.biomass, delta);
+				L::add(act, d_env.vfa_conc, delta * agent_subtype_consts::VFA_PER_DECAYED_BIOMASS);
+				L::add(act, d_env.op_conc, delta * agent.trait.reg.i_bmp);
+			}
+			// update to agent
+			L::merge_state(act, agent.state, d_state);
+			assert((_is_sane_after_action<L>(act, agent, d_state)));
+			return;
+		}
+
+		static kinetics_inline void action_anaerobic(const mask_t &act, const env_t &env, env_t &d_env, agent_t &agent,
+													 uptake_t &uptake) noexcept
+		{
+			// agent state change
+			auto d_state = state_t();
+
+			// biomass decay
+			{
+				const auto delta = agent.trait.rate.b_anaerobic * agent.state.biomass;
+				L::sub(act, d_state.biomass, delta);
+				L::add(act, d_env.vfa_conc, delta * agent_subtype_consts::VFA_PER_DECAYED_BIOMASS);
+				L::add(act, d_env.op_conc, delta * agent.trait.reg.i_bmp);
+			}
+			// update to agent
+			L::merge_state(act, agent.state, d_state);
+			assert((_is_sane_after_action<L>(act, agent, d_state)));
+			return;
+		}
+	};
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
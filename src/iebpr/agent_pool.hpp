@@ -2,9 +2,12 @@
 #define __IEBPR_AGENT_POOL_HPP__
 
 #include <memory>
+#include <string>
 #include <vector>
 #include "error_def.hpp"
+#include "pool_memory.hpp"
 #include "randomizer.hpp"
+#include "serializer.hpp"
 #include "agent_subtype_base.hpp"
 #include "agent_subtype_gao.hpp"
 #include "agent_subtype_oho.hpp"
@@ -18,12 +21,24 @@ namespace iebpr
 		Randomizer &_rand;
 
 	public:
-		std::vector<AgentData> agent_data;
+		pool_vector<AgentData> agent_data;
 		std::vector<std::unique_ptr<AgentSubtypeBase>> agent_subtype;
+		// number of split traits each subtype pre-generates in its trait
+		// reservoir, from an own random substream; 0 to disable
+		size_t trait_reservoir_size;
+		// refill trait reservoirs on background threads during main loop
+		bool trait_reservoir_thread;
+		// instantiate agents in ranges with own random substreams, on this
+		// many threads; 0 to instantiate serially from the randomizer
+		size_t instantiate_threads;
+		// directory to create the backing file of agent data in, so the pool
+		// can exceed ram; empty to keep agent data in memory
+		std::string backing_dir;
 
 	public:
 		explicit AgentPool(Randomizer &rand) noexcept
-			: _rand(rand), agent_data(0), agent_subtype(0) {}
+			: _rand(rand), agent_data(0), agent_subtype(0), trait_reservoir_size(0),
+			  trait_reservoir_thread(false), instantiate_threads(0), backing_dir() {}
 
 		//======================================================================
 		// EXTERNAL API
@@ -31,6 +46,9 @@ namespace iebpr
 
 		// total number of agents
 		size_t n_agent(void) const noexcept;
+		// total number of agents before the active end of each subtype, same
+		// as n_agent() unless agents are aggregated
+		size_t n_active_agent(void) const noexcept;
 		// total number of subtypes
 		size_t n_subtype(void) const noexcept;
 		// clear all agent data pool and agent subtype data
@@ -48,11 +66,77 @@ namespace iebpr
 		// self validate before init
 		error_enum preinit_validate(void) const noexcept;
 		// initialize data before simulation run
-		void prerun_init(stvalue_t timestep);
+		// agent instantiation can be skipped if agent data will be restored
+		// from a checkpoint
+		void prerun_init(stvalue_t timestep, bool instantiate = true);
+		// reseed trait reservoirs, if enabled, from the current randomizer
+		// state, without drawing from the randomizer
+		void seed_trait_reservoirs(void);
+		// start background refill of trait reservoirs, if enabled
+		void start_trait_reservoirs(void);
+		// stop background refill of trait reservoirs
+		void stop_trait_reservoirs(void) noexcept;
 		// self validate after init, before simulation
 		error_enum prerun_validate(void) const noexcept;
+		// dump subtype configs and pool settings, for pickling
+		void save_config(BinWriter &writer) const;
+		// restore configs dumped by save_config(); subtypes are recreated,
+		// agent data is not
+		error_enum load_config(BinReader &reader);
+		// dump agent data, for checkpoint
+		void save_progress(BinWriter &writer) const;
+		// restore agent data dumped by save_progress(), must be called after
+		// prerun_init(); the subtype configs must match those at dumping
+		error_enum load_progress(BinReader &reader);
+		// copy subtype configs and agent data from other, subtypes are
+		// recreated to use own randomizer
+		void fork_from(const AgentPool &other);
+		// scale state content of active agents, i.e. by hydraulics
+		void scale_state_content(stvalue_t factor) noexcept;
+		// aggregate agents of each subtype, see
+		// AgentSubtypeBase::aggregate_agents()
+		void aggregate_agents(stvalue_t tolerance);
+		// true if agent data is mapped from a backing file
+		bool is_file_backed(void) const noexcept;
+		// call fn(begin, end) to pass over agents in [begin, end) in order; if
+		// file-backed, in blocks, each read ahead while the previous one is
+		// processed and released after, so the pass streams through the
+		// backing file
+		template <typename fn_t>
+		void stream_agents(AgentSubtypeBase::agent_itr_t begin, AgentSubtypeBase::agent_itr_t end,
+						   fn_t fn) const
+		{
+			if (!is_file_backed())
+			{
+				fn(begin, end);
+				return;
+			}
+			auto block_end = [end](AgentSubtypeBase::agent_itr_t itr)
+			{ return ((size_t)(end - itr) > _stream_block) ? itr + _stream_block : end; };
+			if (begin < end)
+				PoolMemory::prefetch(&*begin, (block_end(begin) - begin) * sizeof(AgentData));
+			for (auto itr = begin; itr < end;)
+			{
+				auto next = block_end(itr);
+				if (next < end)
+					PoolMemory::prefetch(&*next, (block_end(next) - next) * sizeof(AgentData));
+				fn(itr, next);
+				PoolMemory::release(&*itr, (next - itr) * sizeof(AgentData));
+				itr = next;
+			}
+			return;
+		}
 
 	private:
+		// agents per range of parallel instantiation, each range draws from
+		// its own substream; results thus only depend on this, not on the
+		// number of threads
+		static constexpr size_t _instantiate_range = 4096;
+		// agents per block of stream_agents(), ~5 MB
+		static constexpr size_t _stream_block = 16384;
+
+		// instantiate agents of all subtypes in ranges on instantiate_threads
+		void _instantiate_agents_parallel(void);
 		// set a contiguous range of agent data instances for a subtype
 		void _set_agent_data(AgentSubtypeBase &subtype,
 							 const decltype(agent_data)::iterator &begin);
@@ -3,20 +3,41 @@
 
 #include <vector>
 #include "env_state.hpp"
+#include "pool_memory.hpp"
 #include "agent_subtype_base_state_cfg.hpp"
 #include "agent_subtype_base_trait_cfg.hpp"
+#include "trait_reservoir.hpp"
 #include "agent_subtype_consts.hpp"
+#include "run_profile.hpp"
 
 namespace iebpr
 {
 	class AgentPool;
 
+	//==========================================================================
+	// substrate uptake of agent actions; uptake processes are scaled by
+	// vfa_scale/op_scale, below 1 when uptake is limited by semi-implicit
+	// integration in substrate depletion regime (see
+	// SbrControl::implicit_uptake_ratio); the actual uptake is accumulated
+	// into vfa/op
+	struct SubstrateUptake
+	{
+	public:
+		stvalue_t vfa_scale;
+		stvalue_t op_scale;
+		stvalue_t vfa;
+		stvalue_t op;
+
+		explicit SubstrateUptake(stvalue_t vfa_scale = 1, stvalue_t op_scale = 1) noexcept
+			: vfa_scale(vfa_scale), op_scale(op_scale), vfa(0), op(0) {}
+	};
+
 	//==========================================================================
 	// agent state randomizer config full set
 	class AgentSubtypeBase
 	{
 	public:
-		using agent_itr_t = std::vector<AgentData>::iterator;
+		using agent_itr_t = pool_vector<AgentData>::iterator;
 		// enum type for agent subtypes
 		// currently only pao, gao, and oho are implemented
 		using subtype_enum = enum : enum_base_t {
@@ -51,16 +72,23 @@ namespace iebpr
 		StateRandConfig state_cfg;
 		TraitRandConfig trait_cfg;
 		const size_t n_agent;
+		// pre-generated traits for split agents, if enabled by AgentPool
+		TraitReservoir trait_reservoir;
+		// split/merge counts, cleared at the start of each run
+		RunProfile::SubtypeCounter profile_counter;
 
 	private:
 		Randomizer &_rand;
 		agent_itr_t _pool_begin;
 		agent_itr_t _pool_end;
+		// agents are active only before this, the slots after are free; is
+		// _pool_end unless agents are aggregated (see aggregate_agents())
+		agent_itr_t _active_end;
 
 	public:
 		explicit AgentSubtypeBase(Randomizer &rand, size_t n_agent)
-			: state_cfg(), trait_cfg(), n_agent(n_agent), _rand(rand),
-			  _pool_begin(), _pool_end()
+			: state_cfg(), trait_cfg(), n_agent(n_agent), trait_reservoir(), profile_counter(),
+			  _rand(rand), _pool_begin(), _pool_end(), _active_end()
 		{
 		}
 		virtual ~AgentSubtypeBase(void) noexcept;
@@ -77,6 +105,10 @@ namespace iebpr
 		const decltype(_pool_begin) pool_begin(void) const noexcept { return _pool_begin; }
 		// end of pool range
 		const decltype(_pool_end) pool_end(void) const noexcept { return _pool_end; }
+		// end of active agents in pool range
+		const decltype(_active_end) active_end(void) const noexcept { return _active_end; }
+		// number of agents before active_end()
+		size_t n_active(void) const noexcept { return _active_end - _pool_begin; }
 		// check if the agent data range overlaps with another subtype claim
 		bool has_data_overlap_with(const AgentSubtypeBase &other) const noexcept;
 		// report subtype and number of agents
@@ -87,30 +119,85 @@ namespace iebpr
 		void trait_cfg_apply_rate_adjust(stvalue_t timestep) noexcept;
 		// fill agent state and trait, use generated random values
 		void instantiate_agents(void);
+		// fill agent state and trait of [begin, end) column by column, use
+		// values generated by rand instead
+		void instantiate_agents(Randomizer &rand, agent_itr_t begin, agent_itr_t end);
 		// update env and agent state, check agent split in the end
-		void agent_action(const EnvState &env, EnvState &d_env, agent_itr_t agent_itr)
+		void agent_action(const EnvState &env, EnvState &d_env, agent_itr_t agent_itr,
+						  SubstrateUptake &uptake)
 		{
 			if (!agent_itr->is_active())
 				return;
 
 			// agent action (cell process)
 			// calls subtype-dependent implementations
-			env.is_aerobic ? this->agent_action_aerobic(env, d_env, *agent_itr)
-						   : this->agent_action_anaerobic(env, d_env, *agent_itr);
+			env.is_aerobic ? this->agent_action_aerobic(env, d_env, *agent_itr, uptake)
+						   : this->agent_action_anaerobic(env, d_env, *agent_itr, uptake);
 
 			if (agent_itr->can_split())
+			{
+#ifndef NO_RUN_PROFILE
+				// a split into a free slot merges none
+				const bool merge = (_active_end == _pool_end);
+				if (agent_split(agent_itr))
+				{
+					profile_counter.n_split[env.is_aerobic != 0]++;
+					profile_counter.n_merge[env.is_aerobic != 0] += merge;
+				}
+#else
 				agent_split(agent_itr);
+#endif
+			}
 
 			return;
 		}
 		// agent action under anaerobic conditions
 		// called internally by agent_action; subtype-dependent implementation
-		virtual void agent_action_aerobic(const EnvState &env, EnvState &d_env, AgentData &agent);
+		virtual void agent_action_aerobic(const EnvState &env, EnvState &d_env, AgentData &agent,
+										  SubstrateUptake &uptake);
 		// agent action under anaerobic conditions
 		// called internally by agent_action; subtype-dependent implementation
-		virtual void agent_action_anaerobic(const EnvState &env, EnvState &d_env, AgentData &agent);
-		// called when agent biomass >= split_biomass
-		void agent_split(agent_itr_t agent_itr);
+		virtual void agent_action_anaerobic(const EnvState &env, EnvState &d_env, AgentData &agent,
+											SubstrateUptake &uptake);
+		// add substrate uptake of agent_action() at full scale into demand,
+		// as positive values in vfa_conc and op_conc
+		void uptake_demand(const EnvState &env, EnvState &demand, agent_itr_t agent_itr) const
+		{
+			if (!agent_itr->is_active())
+				return;
+			env.is_aerobic ? this->uptake_demand_aerobic(env, demand, *agent_itr)
+						   : this->uptake_demand_anaerobic(env, demand, *agent_itr);
+			return;
+		}
+		// substrate uptake under aerobic conditions
+		// called internally by uptake_demand; subtype-dependent implementation
+		virtual void uptake_demand_aerobic(const EnvState &env, EnvState &demand, const AgentData &agent) const;
+		// substrate uptake under anaerobic conditions
+		// called internally by uptake_demand; subtype-dependent implementation
+		virtual void uptake_demand_anaerobic(const EnvState &env, EnvState &demand, const AgentData &agent) const;
+		// called when agent biomass >= split_biomass; return true if split,
+		// false if the subtype has too few agents to split; the new agent
+		// takes the first free slot if any, otherwise the slot freed by
+		// merging the two agents with lowest biomass
+		bool agent_split(agent_itr_t agent_itr);
+		// merge active agents that are within tolerance of each other into
+		// super-individuals, i.e. agents with the same bool traits, and rate
+		// and regular traits, content fractions and split progress (biomass /
+		// split_biomass) in the same bins of tolerance times the mean of the
+		// subtype; active agents are then moved to the front of the pool
+		// range and the rest are cleared as free slots, which splits fill
+		// again as new traits bring back heterogeneity
+		void aggregate_agents(stvalue_t tolerance);
+		// randomize the trait of a new split agent, taken from the trait
+		// reservoir if enabled
+		void randomize_split_trait(AgentTrait &trait)
+		{
+			if (trait_reservoir.is_enabled())
+				trait_reservoir.pop(trait);
+			else
+				trait_cfg.randomize(_rand, trait);
+			return;
+		}
 		// summarize current state of agents
 		AgentState summarize_agent_state(void) const noexcept;
 	};
@@ -29,6 +29,12 @@ namespace iebpr
 		void adjust_to_n_agent(size_t n_agent) noexcept;
 		// generate set of values
 		void randomize(Randomizer &rand, AgentState &state);
+		// generate values for the states of n agents, column by column
+		void randomize(Randomizer &rand, AgentData *agents, size_t n);
+		// dump configs, for pickling
+		void save_config(BinWriter &writer) const;
+		// restore configs dumped by save_config()
+		error_enum load_config(BinReader &reader);
 	};
 
 // ensure StateRandConfig is aligned with AgentState field-wise
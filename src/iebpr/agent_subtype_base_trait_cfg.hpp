@@ -52,6 +52,12 @@ namespace iebpr
 		void adjust_to_timestep(stvalue_t timestep) noexcept;
 		// generate set of values
 		void randomize(Randomizer &rand, AgentTrait &trait);
+		// generate values for the traits of n agents, column by column
+		void randomize(Randomizer &rand, AgentData *agents, size_t n);
+		// dump configs, for pickling
+		void save_config(BinWriter &writer) const;
+		// restore configs dumped by save_config()
+		error_enum load_config(BinReader &reader);
 	};
 
 // ensure TraitRandConfig is aligned with AgentTrait
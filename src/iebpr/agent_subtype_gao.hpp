@@ -10,8 +10,12 @@ namespace iebpr
 	public:
 		using AgentSubtypeBase::AgentSubtypeBase;
 		subtype_enum subtype(void) const noexcept;
-		void agent_action_aerobic(const EnvState &env, EnvState &d_env, AgentData &agent);
-		void agent_action_anaerobic(const EnvState &env, EnvState &d_env, AgentData &agent);
+		void agent_action_aerobic(const EnvState &env, EnvState &d_env, AgentData &agent,
+								  SubstrateUptake &uptake);
+		void agent_action_anaerobic(const EnvState &env, EnvState &d_env, AgentData &agent,
+									SubstrateUptake &uptake);
+		void uptake_demand_aerobic(const EnvState &env, EnvState &demand, const AgentData &agent) const;
+		void uptake_demand_anaerobic(const EnvState &env, EnvState &demand, const AgentData &agent) const;
 	};
 
 } // namespace iebpr
@@ -0,0 +1,81 @@
+#ifndef __IEBPR_CHECKPOINT_HPP__
+#define __IEBPR_CHECKPOINT_HPP__
+
+#include <cstring>
+#include "def.hpp"
+#include "agent_data.hpp"
+
+namespace iebpr
+{
+	// checkpoint file layout:
+	//   checkpoint::Header
+	//   section Randomizer
+	//   section SbrControl
+	//   section AgentPool, agent data block aligned to checkpoint::block_align,
+	//     then trait reservoir states
+	//   section Recorder
+	// image layout, of a whole simulation (for pickling):
+	//   checkpoint::Header, with image_magic
+	//   section Config, of SbrControl, AgentPool, Recorder and Simulation
+	//   uint8_t, non-zero if progress follows
+	//   section Randomizer
+	//   sections SbrControl, AgentPool and Recorder, if progress follows
+	// each section starts with its checkpoint::section_enum tag; all values are
+	// stored in native endianness, files are not portable between platforms
+	// with different endianness or type sizes, this is checked in the header
+	namespace checkpoint
+	{
+		// bump this when the layout changes
+		constexpr uint32_t version = 7;
+		constexpr char magic[8] = {'I', 'E', 'B', 'P', 'R', 'C', 'K', 'P'};
+		constexpr char image_magic[8] = {'I', 'E', 'B', 'P', 'R', 'I', 'M', 'G'};
+		constexpr uint64_t endian_mark = 0x0102030405060708ULL;
+		// large data blocks are aligned in file, so the mapped file can be
+		// copied from directly
+		constexpr size_t block_align = 64;
+
+		using section_enum = enum : enum_base_t {
+			randomizer = 0x52414e44, // "RAND"
+			sbr_control = 0x53425243, // "SBRC"
+			agent_pool = 0x504f4f4c, // "POOL"
+			recorder = 0x52454344, // "RECD"
+			config = 0x434f4e46, // "CONF"
+		};
+
+		struct Header
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t agent_data_size;
+			uint64_t endian_mark;
+
+			// header of a checkpoint file, or of an image if image is true
+			explicit Header(bool image = false) noexcept
+				: version(checkpoint::version), agent_data_size(sizeof(AgentData)),
+				  endian_mark(checkpoint::endian_mark)
+			{
+				std::memcpy(magic, image ? image_magic : checkpoint::magic, sizeof(magic));
+			}
+
+			// true if magic matches, of an image if image is true
+			inline bool is_magic(bool image = false) const noexcept
+			{
+				return std::memcmp(magic, image ? image_magic : checkpoint::magic,
+								   sizeof(magic)) == 0;
+			}
+			// true if the header is written by a compatible build
+			inline bool is_compatible(bool image = false) const noexcept
+			{
+				return is_magic(image) &&
+					   (agent_data_size == sizeof(AgentData)) &&
+					   (endian_mark == checkpoint::endian_mark);
+			}
+		};
+
+		static_assert(sizeof(Header) == 24, "");
+
+	} // namespace checkpoint
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
@@ -19,18 +19,39 @@ namespace iebpr
 		// SbrControll
 		invalid_timestep = 0x200,
 		invalid_init_volume,
+		stage_index_out_of_range,
+		stage_already_started,
 
 		// AgentPool
 		total_agent_mismatch_subtype_sum = 0x300,
 		agent_subtype_pool_overlap,
 		bool_trait_wrong_rand_type,
+		pool_backing_dir_unusable,
 
 		// Recorder
 		rec_time_exceed_simulation = 0x400,
 		rec_step_smaller_than_timestep,
+		result_arena_io_error,
+		result_arena_too_small,
+		result_arena_misaligned,
 
 		// Simulation
 		sigint = 0x500,
+		trace_io_error,
+		replicate_not_discrete,
+		replicate_config_mismatch,
+		replicate_aggregation_enabled,
+		run_cancelled,
+		run_step_budget_exhausted,
+		run_time_budget_exhausted,
+		run_deadline_exceeded,
+
+		// Checkpoint
+		checkpoint_io_error = 0x600,
+		checkpoint_bad_format,
+		checkpoint_version_mismatch,
+		checkpoint_config_mismatch,
+		checkpoint_not_initialized,
 
 	} error_enum;
 
@@ -0,0 +1,61 @@
+#ifndef __IEBPR_KERNEL_DISPATCH_HPP__
+#define __IEBPR_KERNEL_DISPATCH_HPP__
+
+#include "def.hpp"
+#include "agent_data.hpp"
+
+namespace iebpr
+{
+	// data-parallel kernels over the agent pool, with implementations by
+	// instruction set; the best one supported by the cpu is selected when
+	// the library is loaded, unless forced by environment variable IEBPR_ISA
+	// (generic, avx2 or avx512); all implementations give bit-identical
+	// results, so the selection only affects speed; agent kinetics are not
+	// dispatched here, they are compiled for the build target (only the
+	// lockstep kernels of ReplicateBatch follow selected_isa())
+	class KernelDispatch
+	{
+	public:
+		enum isa_enum : enum_base_t
+		{
+			generic = 0,
+			avx2,
+			avx512,
+			n_isa,
+			invalid = 0xffffffff,
+		};
+
+		struct Table
+		{
+		public:
+			isa_enum isa;
+			// AgentState::scale_state_content() of the state of n agents
+			void (*scale_state_content)(AgentData *data, size_t n, stvalue_t factor) noexcept;
+			// sum of the state of n agents, same as merging all with
+			// AgentState::merge_with(no_check = true) in order
+			AgentState (*summarize_agent_state)(const AgentData *data, size_t n) noexcept;
+		};
+
+		//======================================================================
+		// EXTERNAL API
+		//======================================================================
+
+		// interpret isa enum value to string
+		static const char *isa_enum_to_name(isa_enum isa) noexcept;
+		// translate string to isa enum, returns invalid on failure
+		static isa_enum isa_name_to_enum(const char *name) noexcept;
+		// check if the cpu and the build support isa
+		static bool is_supported(isa_enum isa) noexcept;
+		// best isa supported
+		static isa_enum detect_isa(void) noexcept;
+		// isa of the selected kernels
+		static isa_enum selected_isa(void) noexcept;
+		// select kernels of isa; return false if not supported
+		static bool select(isa_enum isa) noexcept;
+		// kernels currently selected
+		static const Table &table(void) noexcept;
+	};
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
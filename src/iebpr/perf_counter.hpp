@@ -0,0 +1,74 @@
+#ifndef __IEBPR_PERF_COUNTER_HPP__
+#define __IEBPR_PERF_COUNTER_HPP__
+
+#include "def.hpp"
+
+namespace iebpr
+{
+	// hardware performance counters of the calling thread, user space only,
+	// by linux perf_event_open(2); events that cannot be opened (unsupported
+	// cpu or kernel, virtualized pmu, perf_event_paranoid, non-linux build)
+	// are left out and read as zero
+	class PerfCounter
+	{
+	public:
+		enum event_enum
+		{
+			cycles = 0,
+			instructions,
+			llc_misses,
+			branch_misses,
+			n_event,
+		};
+
+		// counts indexed by event_enum
+		struct Values
+		{
+		public:
+			uint64_t value[n_event];
+
+			explicit Values(void) noexcept
+				: value{0, 0, 0, 0} {}
+			Values &operator+=(const Values &other) noexcept;
+		};
+
+	private:
+		// fd by event, -1 if not open
+		int _fd[n_event];
+		// fd of group leader, -1 if none is open
+		int _leader;
+		// open events in the order they were added to the group, which is
+		// also the order of values in a group read
+		event_enum _order[n_event];
+		unsigned _n_open;
+
+	public:
+		explicit PerfCounter(void) noexcept
+			: _fd{-1, -1, -1, -1}, _leader(-1), _order(), _n_open(0) {}
+		~PerfCounter(void) noexcept { close(); }
+		PerfCounter(const PerfCounter &) = delete;
+		PerfCounter &operator=(const PerfCounter &) = delete;
+
+		//======================================================================
+		// EXTERNAL API
+		//======================================================================
+
+		// interpret event enum value to string
+		static const char *event_enum_to_name(event_enum event) noexcept;
+		// open and start counters as one group; return number of events
+		// opened, 0 if counters are unavailable
+		unsigned open(void) noexcept;
+		// stop and close all counters
+		void close(void) noexcept;
+		// check if event is being counted
+		bool is_open(event_enum event) const noexcept;
+		// number of events being counted
+		unsigned n_open(void) const noexcept;
+		// read current counts since open(), scaled for multiplexing; return
+		// false if unavailable
+		bool read(Values &values) const noexcept;
+	};
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
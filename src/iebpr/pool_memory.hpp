@@ -0,0 +1,142 @@
+#ifndef __IEBPR_POOL_MEMORY_HPP__
+#define __IEBPR_POOL_MEMORY_HPP__
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "def.hpp"
+
+namespace iebpr
+{
+	// memory of large buffers, i.e. the agent pool and records; by default
+	// from the heap as any std::vector; may be mapped on huge pages and
+	// interleaved over numa nodes instead, with a process-wide policy set
+	// when the library is loaded by environment variables IEBPR_HUGEPAGES
+	// (none, thp, 2m or 1g) and IEBPR_NUMA (local or interleave); unusable
+	// settings fall back to smaller pages and the default numa policy, and
+	// results never depend on them; a buffer may also be mapped from an
+	// unlinked file in a backing directory, to hold more than fits in ram
+	class PoolMemory
+	{
+	public:
+		enum hugepage_enum : enum_base_t
+		{
+			// heap memory, no huge pages
+			hugepage_none = 0,
+			// transparent huge pages, by madvise()
+			hugepage_thp,
+			// 2 MB or 1 GB pages from hugetlbfs, falling back to smaller ones
+			// and then transparent huge pages if the pool is exhausted
+			hugepage_2m,
+			hugepage_1g,
+			n_hugepage,
+			hugepage_invalid = 0xffffffff,
+		};
+
+		enum numa_enum : enum_base_t
+		{
+			// pages on the node of the thread first touching them; buffers
+			// are filled by the thread that runs the main loop
+			numa_local = 0,
+			// pages round-robin over all allowed nodes
+			numa_interleave,
+			n_numa,
+			numa_invalid = 0xffffffff,
+		};
+
+		// buffers smaller than this are always from the heap
+		static constexpr size_t min_mapped_bytes = 2 << 20;
+
+		//======================================================================
+		// EXTERNAL API
+		//======================================================================
+
+		// interpret enum values to string
+		static const char *hugepage_enum_to_name(hugepage_enum hugepage) noexcept;
+		static const char *numa_enum_to_name(numa_enum numa) noexcept;
+		// translate string to enum values, returns *_invalid on failure
+		static hugepage_enum hugepage_name_to_enum(const char *name) noexcept;
+		static numa_enum numa_name_to_enum(const char *name) noexcept;
+		// current policy
+		static hugepage_enum hugepage(void) noexcept;
+		static numa_enum numa(void) noexcept;
+		// set policy of buffers allocated from now on; return false if any
+		// value is invalid
+		static bool set_policy(hugepage_enum hugepage, numa_enum numa) noexcept;
+
+		//======================================================================
+		// INTERNAL API
+		//======================================================================
+
+		// allocate bytes by the current policy, throws std::bad_alloc; if
+		// backing_dir is given, map from a file created there instead, or by
+		// the policy if that fails
+		static void *allocate(size_t bytes, const std::string *backing_dir = nullptr);
+		// free memory from allocate()
+		static void deallocate(void *ptr) noexcept;
+		// true if the buffer from allocate() is mapped from a file
+		static bool is_file_backed(const void *ptr) noexcept;
+		// true if a backing file can be created in dir
+		static bool is_backing_dir_usable(const std::string &dir) noexcept;
+		// hint that [ptr, ptr + bytes) is soon read, to start reading its
+		// pages in from the backing file
+		static void prefetch(const void *ptr, size_t bytes) noexcept;
+		// hint that [ptr, ptr + bytes) is not used for a while, so its pages
+		// are evicted ahead of other memory
+		static void release(const void *ptr, size_t bytes) noexcept;
+	};
+
+	// allocator of containers on PoolMemory, from backing files in
+	// backing_dir if set; goes along with the container on assignment
+	template <typename T>
+	struct PoolAllocator
+	{
+		using value_type = T;
+		using propagate_on_container_copy_assignment = std::true_type;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		std::shared_ptr<const std::string> backing_dir;
+
+		PoolAllocator(void) noexcept : backing_dir() {}
+		explicit PoolAllocator(const std::string &dir)
+			: backing_dir(dir.empty() ? nullptr : std::make_shared<const std::string>(dir)) {}
+		template <typename U>
+		PoolAllocator(const PoolAllocator<U> &other) noexcept : backing_dir(other.backing_dir) {}
+
+		T *allocate(size_t n)
+		{
+			if (n > size_t(-1) / sizeof(T))
+				throw std::bad_alloc();
+			return (T *)PoolMemory::allocate(n * sizeof(T), backing_dir.get());
+		}
+		void deallocate(T *ptr, size_t) noexcept { PoolMemory::deallocate(ptr); }
+		// backing directory, empty if none
+		inline const std::string &get_backing_dir(void) const noexcept
+		{
+			static const std::string none;
+			return backing_dir ? *backing_dir : none;
+		}
+	};
+
+	template <typename T, typename U>
+	inline bool operator==(const PoolAllocator<T> &a, const PoolAllocator<U> &b) noexcept
+	{
+		return a.get_backing_dir() == b.get_backing_dir();
+	}
+	template <typename T, typename U>
+	inline bool operator!=(const PoolAllocator<T> &a, const PoolAllocator<U> &b) noexcept
+	{
+		return !(a == b);
+	}
+
+	// vector on PoolMemory
+	template <typename T>
+	using pool_vector = std::vector<T, PoolAllocator<T>>;
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
@@ -5,7 +5,9 @@
 
 #include <Python.h>
 #include <structmember.h>
+#include <atomic>
 #include "simulation.hpp"
+#include "replicate_batch.hpp"
 #include "python_interface_util.hpp"
 #include "python_interface_datastruct.hpp"
 #include "python_interface_agent_configs.hpp"
@@ -18,6 +20,9 @@ namespace iebpr
 		{
 			PyObject_HEAD;
 			Simulation cdata;
+			// set while cdata runs without the gil, by run(), run_async() etc.;
+			// other methods and setters then raise RuntimeError
+			std::atomic<bool> running;
 			static const PyTypeObject *const type;
 		};
 
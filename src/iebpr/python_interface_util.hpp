@@ -4,6 +4,20 @@
 #define __IEBPR_PYTHON_INTERFACE_UTIL_HPP__
 
 #include <Python.h>
+#include <utility>
+#include <vector>
+#include "error_def.hpp"
+#include "serializer.hpp"
+#include "checkpoint.hpp"
+
+// per-object critical sections came with free-threaded builds (python 3.13);
+// before, the gil already serializes access to objects
+#ifndef Py_BEGIN_CRITICAL_SECTION
+#define Py_BEGIN_CRITICAL_SECTION(op) {
+#define Py_END_CRITICAL_SECTION() }
+#define Py_BEGIN_CRITICAL_SECTION2(a, b) {
+#define Py_END_CRITICAL_SECTION2() }
+#endif
 
 namespace iebpr
 {
@@ -12,11 +26,101 @@ namespace iebpr
 		// exception types
 		extern PyObject *PyExc_IebprError;
 		extern PyObject *PyExc_IebprPrerunValidateError;
+		extern PyObject *PyExc_IebprRunStopped;
 
-		// misc types
+		// misc types; created once by module_bind_simulation() and never
+		// changed after, so shared by all threads without locking
 		extern PyObject *EnvStateRecDescr;
 		extern PyObject *AgentStateRecDescr;
 
+		// wrap a getter, setter or method F of a type in a critical section
+		// on self, so that threads of free-threaded builds do not race on
+		// cdata; the same as F with the gil
+		template <PyObject *(*F)(PyObject *, void *)>
+		PyObject *locked_getter(PyObject *self, void *closure)
+		{
+			PyObject *ret = nullptr;
+			Py_BEGIN_CRITICAL_SECTION(self);
+			ret = F(self, closure);
+			Py_END_CRITICAL_SECTION();
+			return ret;
+		}
+
+		template <int (*F)(PyObject *, PyObject *, void *)>
+		int locked_setter(PyObject *self, PyObject *value, void *closure)
+		{
+			int ret = -1;
+			Py_BEGIN_CRITICAL_SECTION(self);
+			ret = F(self, value, closure);
+			Py_END_CRITICAL_SECTION();
+			return ret;
+		}
+
+		template <PyObject *(*F)(PyObject *, PyObject *)>
+		PyObject *locked_method(PyObject *self, PyObject *args)
+		{
+			PyObject *ret = nullptr;
+			Py_BEGIN_CRITICAL_SECTION(self);
+			ret = F(self, args);
+			Py_END_CRITICAL_SECTION();
+			return ret;
+		}
+
+		// __reduce__() of config type T, whose cdata has save_config() and
+		// load_config(); pickled as an image of cdata in bytes; created by
+		// copyreg.__newobj__, i.e. tp_new without __init__(), which may
+		// require arguments
+		template <typename T>
+		PyObject *config_reduce(PyObject *self, PyObject *args)
+		{
+			PyObject *copyreg = nullptr, *newobj = nullptr, *state = nullptr, *ret = nullptr;
+			auto buf = std::vector<char>(0);
+			BinWriter writer(buf);
+			writer.write_value(checkpoint::Header(true));
+			Py_BEGIN_CRITICAL_SECTION(self);
+			((T *)self)->cdata.save_config(writer);
+			Py_END_CRITICAL_SECTION();
+			if (!(copyreg = PyImport_ImportModule("copyreg")) ||
+				!(newobj = PyObject_GetAttrString(copyreg, "__newobj__")) ||
+				!(state = PyBytes_FromStringAndSize(buf.data(), buf.size())))
+				goto fail;
+			ret = Py_BuildValue("(O(O)O)", newobj, Py_TYPE(self), state);
+		fail:
+			Py_XDECREF(state);
+			Py_XDECREF(newobj);
+			Py_XDECREF(copyreg);
+			return ret;
+		}
+
+		// __setstate__() of config type T, see config_reduce(); cdata is left
+		// unchanged on error
+		template <typename T>
+		PyObject *config_setstate(PyObject *self, PyObject *args)
+		{
+			Py_buffer view;
+			if (PyObject_GetBuffer(args, &view, PyBUF_SIMPLE))
+				return nullptr;
+			auto cdata = decltype(((T *)self)->cdata)();
+			BinReader reader(view.buf, view.len);
+			checkpoint::Header header;
+			auto good = reader.read_value(header) && header.is_compatible(true) &&
+						(header.version == checkpoint::version) &&
+						(cdata.load_config(reader) == none) && (reader.remain() == 0);
+			PyBuffer_Release(&view);
+			if (!good)
+			{
+				PyErr_Format(PyExc_ValueError, "bad pickled state of %s, "
+											   "may be pickled by an incompatible build",
+							 Py_TYPE(self)->tp_name);
+				return nullptr;
+			}
+			Py_BEGIN_CRITICAL_SECTION(self);
+			// moved, so that iterators into cdata stay valid
+			((T *)self)->cdata = std::move(cdata);
+			Py_END_CRITICAL_SECTION();
+			Py_RETURN_NONE;
+		}
+
 	} // namespace python_interface
 
 } // namespace iebpr
@@ -5,6 +5,7 @@
 #include <vector>
 #include "def.hpp"
 #include "error_def.hpp"
+#include "serializer.hpp"
 
 namespace iebpr
 {
@@ -47,12 +48,16 @@ namespace iebpr
 											   // scale will only be applied to constant/normal/uniform/obsvalues results
 
 			explicit RandConfig(void) noexcept
-				: type(none), mean(0), low(0), high(0), value_list(0), non_neg(1), _scale(1){};
+				: type(none), mean(0), stddev(0), low(0), high(0), value_list(0), non_neg(1), _scale(1){};
 
 			// set value_list, ensure sorted
 			void set_value_list(const decltype(value_list) &values);
 			// validate randomizer settings
 			error_enum validate(rand_t force_type = invalid) const noexcept;
+			// dump config, for pickling
+			void save_config(BinWriter &writer) const;
+			// restore config dumped by save_config()
+			error_enum load_config(BinReader &reader);
 		};
 
 		std::default_random_engine engine;
@@ -72,6 +77,13 @@ namespace iebpr
 		void seed(seed_t seed) noexcept;
 		// generate a random value using config
 		stvalue_t gen_value(const RandConfig &cfg);
+		// generate n random values using config into a column with stride
+		// (in values) between elements; same as n calls of gen_value()
+		void gen_values(const RandConfig &cfg, stvalue_t *dst, size_t n, size_t stride);
+		// dump engine and distribution states, for checkpoint
+		void save_state(BinWriter &writer) const;
+		// restore states dumped by save_state()
+		error_enum load_state(BinReader &reader);
 
 	private:
 		stvalue_t _obsvalues_gen_handler(const RandConfig &cfg);
@@ -4,6 +4,9 @@
 #include <algorithm>
 #include <vector>
 #include "error_def.hpp"
+#include "pool_memory.hpp"
+#include "serializer.hpp"
+#include "result_arena.hpp"
 #include "env_state.hpp"
 #include "agent_pool.hpp"
 #include "sbr_control.hpp"
@@ -46,20 +49,33 @@ namespace iebpr
 	public:
 		std::vector<stvalue_t> state_rec_timepoints;
 		std::vector<stvalue_t> snapshot_rec_timepoints;
-		std::vector<EnvStateRecEntry> env_state_rec;
+		// records that may grow large are on PoolMemory
+		pool_vector<EnvStateRecEntry> env_state_rec;
 		std::vector<std::vector<AgentStateRecEntry>> agent_state_rec;
-		std::vector<std::vector<std::vector<AgentStateRecEntry>>> snapshot_rec;
+		std::vector<std::vector<pool_vector<AgentStateRecEntry>>> snapshot_rec;
 
 	private:
 		decltype(state_rec_timepoints)::iterator _next_state_rec_time_itr;
 		decltype(snapshot_rec_timepoints)::iterator _next_snapshot_rec_time_itr;
+		// timepoints converted to steps in prerun_init(), aligned with the
+		// timepoints vectors
+		std::vector<uint64_t> _state_rec_steps;
+		std::vector<uint64_t> _snapshot_rec_steps;
+		// records are also written here while attached
+		ResultArena _arena;
+		ResultArena::Shape _arena_shape;
+		// bytes of records taken, kept as records are taken
+		uint64_t _state_rec_bytes;
+		uint64_t _snapshot_rec_bytes;
 
 	public:
 		explicit Recorder(void) noexcept
 			: state_rec_timepoints(0), snapshot_rec_timepoints(0),
 			  env_state_rec(0), agent_state_rec(0), snapshot_rec(0),
 			  _next_state_rec_time_itr(state_rec_timepoints.begin()),
-			  _next_snapshot_rec_time_itr(snapshot_rec_timepoints.begin())
+			  _next_snapshot_rec_time_itr(snapshot_rec_timepoints.begin()),
+			  _state_rec_steps(0), _snapshot_rec_steps(0), _arena(), _arena_shape(),
+			  _state_rec_bytes(0), _snapshot_rec_bytes(0)
 		{
 		}
 
@@ -67,18 +83,59 @@ namespace iebpr
 		// INTERNAL API
 		//======================================================================
 
+		// microbenchmarks (bench/) time private hot paths directly
+		friend struct BenchAccess;
 		// self validate before simulation run
 		error_enum preinit_validate(void) const noexcept;
 		// initialize data before init
-		void prerun_init(const AgentPool &pool);
-		// take record, called in simulation main loop
+		void prerun_init(const SbrControl &sbr, const AgentPool &pool);
+		// number of timesteps before the next record is due, at least 1;
+		// SbrControl::no_step if no more records
+		uint64_t steps_to_next_record(const SbrControl &sbr) const noexcept;
+		// take record if due, called in simulation main loop
 		void record(const SbrControl &sbr, const AgentPool &pool);
 		// self validate after init, before simulation
 		error_enum prerun_validate(const SbrControl &sbr) const noexcept;
+		// dump timepoints, for pickling
+		void save_config(BinWriter &writer) const;
+		// restore timepoints dumped by save_config()
+		error_enum load_config(BinReader &reader);
+		// dump records taken so far, for checkpoint
+		void save_progress(BinWriter &writer) const;
+		// restore records dumped by save_progress(), must be called after
+		// prerun_init(); the timepoints must match those at dumping
+		error_enum load_progress(BinReader &reader);
+		// copy timepoints and records from other, iterators are rebased to
+		// own timepoints
+		void fork_from(const Recorder &other);
+		// locate the next record timepoints after timepoints are changed
+		// during a run; timepoints not after current time are skipped
+		void relocate_progress(const SbrControl &sbr);
+		// bytes of state records (env and agent) taken
+		inline uint64_t state_rec_bytes(void) const noexcept { return _state_rec_bytes; };
+		// bytes of snapshot records taken
+		inline uint64_t snapshot_rec_bytes(void) const noexcept { return _snapshot_rec_bytes; };
+		// shape of a result arena of all records, i.e. of records taken and
+		// still due if in_progress, or of the timepoints otherwise
+		ResultArena::Shape result_arena_shape(const AgentPool &pool, bool in_progress) const;
+		// write records taken so far into a result arena, at offset of the
+		// shared memory object name, and the following ones as they are
+		// taken until detach_arena(); called after prerun_init()
+		error_enum attach_arena(const std::string &name, uint64_t offset, const AgentPool &pool);
+		void detach_arena(void) noexcept;
 
 	private:
+		// convert timepoints to steps
+		void _compile_rec_steps(const SbrControl &sbr);
 		void _state_record(const SbrControl &sbr, const AgentPool &pool);
 		void _snapshot_record(const SbrControl &sbr, const AgentPool &pool);
+		// count bytes of records as a whole, after they are replaced
+		void _count_rec_bytes(void) noexcept;
+		// write the i-th state and snapshot records into the arena
+		void _arena_state_record(size_t i) noexcept;
+		void _arena_snapshot_record(size_t i) noexcept;
+		// publish the number of records written into the arena
+		void _arena_set_taken(void) noexcept;
 	};
 
 } // namespace iebpr
@@ -0,0 +1,47 @@
+#ifndef __IEBPR_REPLICATE_BATCH_HPP__
+#define __IEBPR_REPLICATE_BATCH_HPP__
+
+#include <vector>
+#include "def.hpp"
+#include "error_def.hpp"
+#include "simulation.hpp"
+
+namespace iebpr
+{
+	// runs replicates of a discrete-time simulation, i.e. simulations with the
+	// same configs but seeds, in lockstep; agent data are stored replicate-
+	// major, with the same agent of several replicates in one vector (2 lanes
+	// with the generic kernels of KernelDispatch, 4 with avx2/avx512), so
+	// agent kinetics run on all lanes at once, and the phase schedule and
+	// agent scaling by hydraulics are done once for all; env, random numbers
+	// and agent splits are kept by replicate, so each replicate gets exactly
+	// the results of its own run()
+	class ReplicateBatch
+	{
+	public:
+		//======================================================================
+		// EXTERNAL API
+		//======================================================================
+
+		// run all replicates from start; replicates may differ in seed and
+		// agent randomizer configs, while the simulation type (discrete),
+		// timestep, hydraulics, init env, stages, agent subtypes and record
+		// timepoints must be the same; each replicate then holds its own
+		// records and progress, e.g. to be resume()-ed or forked alone;
+		// checkpoint, perf counter and trace settings are not used, and the
+		// timings of the run profile are for the whole batch, counted in the
+		// first replicate; adaptive aggregation is not supported
+		static error_enum run(const std::vector<Simulation *> &replicates);
+
+	private:
+		// lanes of width replicates and main loop of a run, in
+		// replicate_batch.cpp
+		template <size_t width>
+		struct Lockstep;
+		// check if all replicates can run in lockstep with the first
+		static error_enum _check_lockstep(const std::vector<Simulation *> &replicates) noexcept;
+	};
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef __IEBPR_RESULT_ARENA_HPP__
+#define __IEBPR_RESULT_ARENA_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "def.hpp"
+#include "error_def.hpp"
+
+namespace iebpr
+{
+	// records written into a region of a posix shared memory object as they
+	// are taken, so that other processes map the results without copies;
+	// the object is created by the caller, e.g. by multiprocessing's
+	// SharedMemory, and may hold the arenas of many simulations at different
+	// offsets; the region is described by its header:
+	//   ResultArena::Header
+	//   ResultArena::SubtypeEntry[n_subtype]
+	//   env state records, [n_state_rec]
+	//   agent state records, [n_state_rec][n_subtype]
+	//   snapshot records of each subtype, [n_snapshot_rec][n_agent]
+	// tables are aligned to ResultArena::align from the start of the region,
+	// offsets are from there; values are in native endianness
+	class ResultArena
+	{
+	public:
+		constexpr static char magic[8] = {'I', 'E', 'B', 'P', 'R', 'R', 'E', 'S'};
+		// bump this when the layout changes
+		constexpr static uint32_t version = 1;
+		// alignment of the region and its tables
+		constexpr static size_t align = 64;
+
+		struct Header
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t n_subtype;
+			uint32_t env_entry_size;
+			uint32_t agent_entry_size;
+			// bytes of the region
+			uint64_t total_bytes;
+			// capacity of records
+			uint64_t n_state_rec;
+			uint64_t n_snapshot_rec;
+			// records written so far, increased after each record is
+			// written, so may be polled by readers during a run
+			std::atomic<uint64_t> n_state_taken;
+			std::atomic<uint64_t> n_snapshot_taken;
+			uint64_t env_offset;
+			uint64_t agent_offset;
+		};
+
+		struct SubtypeEntry
+		{
+			uint32_t subtype;
+			uint32_t reserved;
+			uint64_t n_agent;
+			uint64_t snapshot_offset;
+		};
+
+		// sizes of a region, offsets are filled by layout()
+		struct Shape
+		{
+			uint32_t env_entry_size;
+			uint32_t agent_entry_size;
+			uint64_t n_state_rec;
+			uint64_t n_snapshot_rec;
+			uint64_t env_offset;
+			uint64_t agent_offset;
+			std::vector<SubtypeEntry> subtypes;
+		};
+
+	private:
+		// mapping of the pages covering the region
+		void *_map_base;
+		size_t _map_bytes;
+		Header *_header;
+
+	public:
+		explicit ResultArena(void) noexcept
+			: _map_base(nullptr), _map_bytes(0), _header(nullptr) {}
+		~ResultArena(void) noexcept { close(); }
+		ResultArena(const ResultArena &) = delete;
+		ResultArena &operator=(const ResultArena &) = delete;
+
+		//======================================================================
+		// INTERNAL API
+		//======================================================================
+
+		// fill offsets of shape, return bytes of the region
+		static uint64_t layout(Shape &shape) noexcept;
+		// header of a region in [data, data + size), as written by open(); nullptr
+		// if invalid, i.e. not written by a compatible build or truncated
+		static const Header *view(const void *data, size_t size, uint32_t env_entry_size,
+								  uint32_t agent_entry_size) noexcept;
+		// map the region at offset in the shared memory object name (a
+		// leading slash is added if missing) and write its header, with no
+		// records taken; the object must be large enough for the shape
+		error_enum open(const std::string &name, uint64_t offset, Shape &shape);
+		// unmap the region, records written are kept in the object
+		void close(void) noexcept;
+		inline bool is_open(void) const noexcept { return _header != nullptr; };
+		// address of the table at offset of the region
+		inline void *at(uint64_t offset) const noexcept { return (char *)_header + offset; };
+		// publish the number of records written
+		inline void set_taken(uint64_t n_state, uint64_t n_snapshot) noexcept
+		{
+			_header->n_state_taken.store(n_state, std::memory_order_release);
+			_header->n_snapshot_taken.store(n_snapshot, std::memory_order_release);
+		}
+	};
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
@@ -0,0 +1,108 @@
+#ifndef __IEBPR_RUN_CONTROL_HPP__
+#define __IEBPR_RUN_CONTROL_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include "error_def.hpp"
+#include "signal.hpp"
+
+namespace iebpr
+{
+	// decides when the main loop of a run stops early: on cancellation
+	// requested from any thread, on a step or wall time budget, on a
+	// deadline, or on sigint if handled; checked between spans of the main
+	// loop, and the step budget also limits the span length, so a run
+	// stops exactly after the budget; stopped runs can be resumed
+	class RunControl
+	{
+	public:
+		// progress of a run, see progress()
+		struct Progress
+		{
+			// timesteps elapsed in the simulation
+			uint64_t curr_step;
+			// timesteps per second of wall time in the run so far
+			double steps_per_sec;
+			// true while the run is going
+			bool running;
+		};
+
+	private:
+		using _clock = std::chrono::steady_clock;
+
+		std::atomic<bool> _cancel;
+		// published progress, read lock-free from other threads
+		std::atomic<bool> _running;
+		std::atomic<uint64_t> _progress_step;
+		std::atomic<uint64_t> _begin_step;
+		std::atomic<int64_t> _begin_ns;
+		std::atomic<int64_t> _end_ns;
+		SignalHandler<SIGINT> _sigint;
+		// set in begin() for the current run
+		uint64_t _step_end;
+		bool _timed;
+		_clock::time_point _budget_end;
+		_clock::time_point _deadline;
+		error_enum _stop;
+
+	public:
+		// steps each run()/resume() may advance, 0 for no limit
+		uint64_t max_steps;
+		// seconds each run()/resume() may take, 0 for no limit
+		double max_wall_time;
+		// wall clock time, in seconds since epoch, to stop runs at, 0 for
+		// none
+		double deadline;
+		// stop runs on sigint, shared by all simulations running meanwhile;
+		// the process handler is replaced during the run
+		bool handle_sigint;
+
+		explicit RunControl(void) noexcept
+			: _cancel(false), _running(false), _progress_step(0), _begin_step(0), _begin_ns(0),
+			  _end_ns(0), _sigint(), _step_end(0), _timed(false), _budget_end(),
+			  _deadline(), _stop(none), max_steps(0), max_wall_time(0), deadline(0),
+			  handle_sigint(false) {}
+		RunControl(const RunControl &) = delete;
+		RunControl &operator=(const RunControl &) = delete;
+
+		//======================================================================
+		// EXTERNAL API
+		//======================================================================
+
+		// request the current run, or the next one if none, to stop; safe to
+		// call from any thread and from signal handlers
+		inline void cancel(void) noexcept { _cancel.store(true, std::memory_order_relaxed); }
+		// true if a cancellation is requested and not yet taken by a run
+		inline bool is_cancel_requested(void) const noexcept
+		{
+			return _cancel.load(std::memory_order_relaxed);
+		}
+		// progress of the current or last run, published between spans of the
+		// main loop; lock-free, safe to call from any thread during the run
+		Progress progress(void) const noexcept;
+
+		//======================================================================
+		// INTERNAL API
+		//======================================================================
+
+		// start the limits of a run from step curr_step; sigint is not
+		// handled in this run if no_sigint
+		void begin(uint64_t curr_step, bool no_sigint = false);
+		// steps left in the step budget
+		inline uint64_t steps_left(uint64_t curr_step) const noexcept
+		{
+			return (curr_step < _step_end) ? _step_end - curr_step : 0;
+		}
+		// true if the run should stop before the next span; the reason is
+		// kept for end()
+		bool should_stop(uint64_t curr_step) noexcept;
+		// end the run at step curr_step, takes a pending cancellation;
+		// return the reason the run stopped early, none if it did not
+		error_enum end(uint64_t curr_step) noexcept;
+	};
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
@@ -0,0 +1,159 @@
+#ifndef __IEBPR_RUN_PROFILE_HPP__
+#define __IEBPR_RUN_PROFILE_HPP__
+
+#include <chrono>
+#include <vector>
+#include "def.hpp"
+#include "perf_counter.hpp"
+
+// build with NO_RUN_PROFILE defined to remove all run profile counting and
+// timing; the counters below then stay zero
+
+namespace iebpr
+{
+	// counters of a run, see Simulation::last_run_profile()
+	struct RunProfile
+	{
+	public:
+		// true if counters are collected in this build
+#ifndef NO_RUN_PROFILE
+		constexpr static bool enabled = true;
+#else
+		constexpr static bool enabled = false;
+#endif
+
+		// counters by phase type
+		struct PhaseCounter
+		{
+		public:
+			uint64_t n_step;
+			// sum of number of agents over steps
+			uint64_t n_agent_step;
+			// wall time in seconds
+			double agent_time;
+			double env_time;
+			double transit_time;
+			double recorder_time;
+			// hardware counters, only if sampled; agent kinetics and env update
+			// alternate in every step, so they are counted together, read
+			// once per span
+			PerfCounter::Values kinetics_hw;
+			PerfCounter::Values recorder_hw;
+
+			explicit PhaseCounter(void) noexcept
+				: n_step(0), n_agent_step(0), agent_time(0), env_time(0),
+				  transit_time(0), recorder_time(0), kinetics_hw(),
+				  recorder_hw() {}
+		};
+
+		// counters of an agent subtype by phase type, indexed by aeration;
+		// a split frees its slot by merging the two smallest agents, so each
+		// split comes with a merge, unless there are free slots left by
+		// adaptive aggregation
+		struct SubtypeCounter
+		{
+		public:
+			uint64_t n_split[2];
+			uint64_t n_merge[2];
+			// agents merged by aggregation (see SbrControl::aggregate_tolerance)
+			uint64_t n_aggregate;
+			// active agents at the end of the run
+			uint64_t n_active;
+			// AgentSubtypeBase::subtype_enum, set at the end of the run, so the
+			// profile stays valid after the pool is changed
+			enum_base_t subtype;
+
+			explicit SubtypeCounter(void) noexcept
+				: n_split{0, 0}, n_merge{0, 0}, n_aggregate(0), n_active(0), subtype(0) {}
+		};
+
+		// indexed by aeration, i.e. phase[0] is anaerobic, phase[1] aerobic
+		PhaseCounter phase[2];
+		// aligned with AgentPool::agent_subtype
+		std::vector<SubtypeCounter> subtype;
+		// bytes of records taken
+		uint64_t state_rec_bytes;
+		uint64_t snapshot_rec_bytes;
+		// bytes allocated for agent pool data, i.e. its capacity; the pool
+		// does not grow during a run
+		uint64_t pool_bytes;
+		// hardware counters sampled during the run, nullptr if not sampled;
+		// owned by Simulation and only valid during the run
+		const PerfCounter *perf;
+		// events sampled, bit (1 << PerfCounter::event_enum) set if sampled
+		unsigned hw_events;
+
+		explicit RunProfile(void) noexcept
+			: phase(), subtype(0), state_rec_bytes(0), snapshot_rec_bytes(0),
+			  pool_bytes(0), perf(nullptr), hw_events(0) {}
+
+		//======================================================================
+		// INTERNAL API
+		//======================================================================
+
+		// clear all counters
+		void reset(size_t n_subtype);
+		// sum of both phase types
+		PhaseCounter total(void) const noexcept;
+	};
+
+	// accumulate wall time, and hardware counts if perf is given, of
+	// consecutive code sections into counters; no-op if built with
+	// NO_RUN_PROFILE
+	class ProfileTimer
+	{
+#ifndef NO_RUN_PROFILE
+	private:
+		using _clock = std::chrono::steady_clock;
+		_clock::time_point _last;
+		const PerfCounter *_perf;
+		PerfCounter::Values _last_hw;
+
+	public:
+		explicit ProfileTimer(const PerfCounter *perf = nullptr) noexcept
+			: _last(_clock::now()), _perf(perf), _last_hw()
+		{
+			if (_perf && (!_perf->read(_last_hw)))
+				_perf = nullptr;
+		}
+		// add time since construction or last lap() to acc
+		inline void lap(double &acc) noexcept
+		{
+			auto now = _clock::now();
+			acc += std::chrono::duration<double>(now - _last).count();
+			_last = now;
+			return;
+		}
+		// add hardware counts since construction or last read to hw; time
+		// is not lapped, so sections lapped by time only can share one read
+		inline void lap_hw(PerfCounter::Values &hw) noexcept
+		{
+			if (_perf)
+			{
+				auto now = PerfCounter::Values();
+				_perf->read(now);
+				for (size_t i = 0; i < PerfCounter::n_event; i++)
+					hw.value[i] += now.value[i] - _last_hw.value[i];
+				_last_hw = now;
+			}
+			return;
+		}
+		// same as lap(acc), also add hardware counts to hw
+		inline void lap(double &acc, PerfCounter::Values &hw) noexcept
+		{
+			lap_hw(hw);
+			lap(acc);
+			return;
+		}
+#else
+	public:
+		explicit ProfileTimer(const PerfCounter * = nullptr) noexcept {}
+		inline void lap(double &) noexcept {}
+		inline void lap_hw(PerfCounter::Values &) noexcept {}
+		inline void lap(double &, PerfCounter::Values &) noexcept {}
+#endif
+	};
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
@@ -0,0 +1,145 @@
+#ifndef __IEBPR_RUN_TRACE_HPP__
+#define __IEBPR_RUN_TRACE_HPP__
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include "def.hpp"
+#include "agent_pool.hpp"
+#include "sbr_control.hpp"
+#include "recorder.hpp"
+
+namespace iebpr
+{
+	// writes trace event format json, loadable in perfetto or chrome://tracing
+	class TraceWriter
+	{
+	private:
+		std::FILE *_fp;
+		bool _good;
+		uint64_t _n_event;
+
+	public:
+		explicit TraceWriter(void) noexcept
+			: _fp(nullptr), _good(false), _n_event(0) {}
+		~TraceWriter(void) noexcept { close(); }
+		TraceWriter(const TraceWriter &) = delete;
+		TraceWriter &operator=(const TraceWriter &) = delete;
+
+		//======================================================================
+		// INTERNAL API
+		//======================================================================
+
+		// open file and start the event list; return false on io error
+		bool open(const std::string &path);
+		// finish the json and close; return false if any write failed
+		bool close(void) noexcept;
+		inline bool is_open(void) const noexcept { return _fp != nullptr; };
+		// name a track in the viewer
+		void thread_name(unsigned tid, const char *name);
+		// span [ts, ts + dur) in microseconds; args is the body of a json
+		// object, may be empty
+		void complete(unsigned tid, const char *cat, const char *name,
+					  double ts, double dur, const char *args = "");
+		// counter value from ts on
+		void counter(const char *name, double ts, uint64_t value);
+
+	private:
+		// write separator before a new event
+		void _next_event(void);
+	};
+
+	// traces a run of the main loop: spans of stages, cycles and phases,
+	// snapshot records, sampled state records, work chunks and agent splits;
+	// high frequency events are aggregated (work, splits) or sampled (state
+	// records) over windows of sample_interval main loop spans, so that the
+	// file size is bounded by the number of phases and windows
+	class RunTracer
+	{
+	public:
+		// tracks in the viewer, as thread ids
+		using track_enum = enum : unsigned {
+			work = 0,
+			stage,
+			cycle,
+			phase,
+			recorder,
+		};
+
+	private:
+		using _clock = std::chrono::steady_clock;
+
+		// an open span of the sbr schedule
+		struct _ScheduleSpan
+		{
+			size_t index;
+			double ts;
+			stvalue_t begin_time;
+		};
+
+		TraceWriter _writer;
+		_clock::time_point _origin;
+		uint64_t _sample_interval;
+		_ScheduleSpan _stage;
+		_ScheduleSpan _cycle;
+		_ScheduleSpan _phase;
+		bivalue_t _aeration;
+		// current window
+		double _window_ts;
+		uint64_t _window_n_span;
+		uint64_t _window_n_step;
+		uint64_t _window_n_agent_step;
+		uint64_t _window_n_split;
+		// between spans
+		double _work_end_ts;
+		uint64_t _n_split;
+		uint64_t _n_state_rec;
+		uint64_t _state_rec_bytes;
+		uint64_t _snapshot_rec_bytes;
+
+	public:
+		explicit RunTracer(void) noexcept
+			: _writer(), _origin(), _sample_interval(1), _stage(), _cycle(),
+			  _phase(), _aeration(0), _window_ts(0), _window_n_span(0),
+			  _window_n_step(0), _window_n_agent_step(0), _window_n_split(0),
+			  _work_end_ts(0), _n_split(0), _n_state_rec(0), _state_rec_bytes(0),
+			  _snapshot_rec_bytes(0) {}
+
+		//======================================================================
+		// INTERNAL API
+		//======================================================================
+
+		inline bool is_open(void) const noexcept { return _writer.is_open(); };
+		// open trace file; return false on io error
+		bool open(const std::string &path);
+		// start tracing from current progress, at the start of main loop
+		void begin(uint64_t sample_interval, const SbrControl &sbr,
+				   const AgentPool &pool, const Recorder &recorder);
+		// after sbr.timestep_update() of a span
+		void after_update(const SbrControl &sbr, const AgentPool &pool, uint64_t n_step);
+		// after recorder.record() of a span
+		void after_record(const SbrControl &sbr, const Recorder &recorder);
+		// close spans still open at the end of main loop, which are partial
+		// if the run was interrupted; return false if any write failed
+		bool end(const SbrControl &sbr);
+
+	private:
+		// microseconds since begin()
+		double _now(void) const noexcept;
+		// position of sbr in the schedule
+		static void _schedule_position(const SbrControl &sbr, size_t &stage,
+									   size_t &cycle, size_t &phase) noexcept;
+		// total splits of all subtypes, 0 if built with NO_RUN_PROFILE
+		static uint64_t _total_split(const AgentPool &pool) noexcept;
+		// start spans at current sbr position
+		void _open_schedule(const SbrControl &sbr, double ts, bool stage,
+							bool cycle);
+		// write spans of sbr schedule, ending at ts
+		void _close_schedule(stvalue_t end_time, double ts, bool stage, bool cycle);
+		// write aggregated events of the current window and start a new one
+		void _flush_window(void);
+	};
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
@@ -1,12 +1,16 @@
 #ifndef __IEBPR_SBR_CONTROL_HPP__
 #define __IEBPR_SBR_CONTROL_HPP__
 
+#include <cmath>
+#include <limits>
 #include <vector>
 #include <random>
 #include "error_def.hpp"
 #include "randomizer.hpp"
+#include "serializer.hpp"
 #include "env_state.hpp"
 #include "agent_pool.hpp"
+#include "run_profile.hpp"
 
 namespace iebpr
 {
@@ -92,7 +96,8 @@ namespace iebpr
 			// return true if inflow volume and outflow (outflow + widthdraw)
 			// volume are balanced through one cycle
 			bool is_flow_balanced(void) const noexcept;
-			// start the stage, return 0 on success, 1 on fail
+			// start the stage, return 0 on success, 1 on fail (stage has no phase
+			// or no cycle to run)
 			int start_stage(void);
 			// update stage to the next phase
 			// return 0 on success, 1 on fail (usually stage has already finished)
@@ -101,6 +106,8 @@ namespace iebpr
 			inline bool finishd_last_cycle(void) const noexcept { return (elapsed_cycle >= n_cycle); };
 			// get the current phase
 			inline Phase &get_curr_phase(void) { return *_curr_phase_itr; };
+			// get the index of current phase
+			inline size_t get_curr_phase_index(void) const noexcept { return _curr_phase_itr - cycle_phases.begin(); };
 			// reset current phase itr
 			inline void reset_curr_phase(void) noexcept
 			{
@@ -114,6 +121,10 @@ namespace iebpr
 				reset_curr_phase();
 				return;
 			};
+			// dump config, for pickling; progress is not included
+			void save_config(BinWriter &writer) const;
+			// restore config dumped by save_config(), progress is reset
+			error_enum load_config(BinReader &reader);
 		};
 
 		// initial env state; set this by directly access this member variable;
@@ -125,24 +136,64 @@ namespace iebpr
 		// current phase with rates adjusted by timestep
 		// for optimization purpose, to reduce repeated calculations
 		Phase rate_adjusted_phase;
+		// 0: update hydraulics (inflow/withdraw/outflow) every timestep
+		// n > 0: update hydraulics in closed form over spans of up to n
+		// timesteps, coupled with agent kinetics by operator splitting
+		uint64_t hydraulic_span;
+		// 0: explicit substrate uptake
+		// r > 0: semi-implicit substrate uptake in depletion regime, i.e.
+		// when the agents' substrate uptake in the last timestep exceeds r
+		// times the concentration; prevents negative concentrations
+		stvalue_t implicit_uptake_ratio;
+		// 0: agent count of each subtype is fixed
+		// t > 0: adaptive aggregation, agents within relative tolerance t of
+		// each other are merged at each phase transition, and their slots
+		// are left free for later splits (see AgentSubtypeBase::
+		// aggregate_agents()); agents are then only updated up to the
+		// active end of each subtype
+		stvalue_t aggregate_tolerance;
+		// counters of the current run, timesteps and agent/env/transit time
+		// are collected in timestep_update(); see Simulation::last_run_profile()
+		RunProfile profile;
 
 	private:
-		stvalue_t _curr_time;
+		// schedule of a stage compiled in prerun_init(); phase end times are
+		// relative to the start of a cycle, indexed from phase_offset in
+		// _phase_end_time
+		struct StageSchedule
+		{
+			stvalue_t begin_time;
+			stvalue_t cycle_time_len;
+			size_t phase_offset;
+		};
+
+		// time is counted in integer steps, so that schedules are exact in
+		// long runs instead of drifting with floating point accumulation
+		uint64_t _curr_step;
 		stvalue_t _timestep;
-		stvalue_t _phase_trans_time;
+		uint64_t _phase_trans_step;
 		decltype(stages)::iterator _curr_stage_itr;
 		Randomizer &_rand;
 		std::uniform_int_distribution<size_t> _rand_agent;
+		std::vector<StageSchedule> _stage_schedule;
+		std::vector<stvalue_t> _phase_end_time;
+		// gross substrate uptake by agents in the last timestep, to detect
+		// depletion; is_aerobic holds the aeration of that timestep
+		EnvState _last_uptake;
 
 	public:
 		constexpr static decltype(_timestep) default_timestep = 1e-5;
+		// returned by steps_to_next_transition() when all stages are finished
+		constexpr static uint64_t no_step = std::numeric_limits<uint64_t>::max();
 
 	public:
 		explicit SbrControl(Randomizer &rand, simutype_enum simutype = discrete,
 							decltype(_timestep) timestep = default_timestep) noexcept
 			: init_env(), env(), stages(0), simutype(simutype), rate_adjusted_phase(),
-			  _curr_time(0), _timestep(timestep), _phase_trans_time(0),
-			  _curr_stage_itr(stages.begin()), _rand(rand), _rand_agent()
+			  hydraulic_span(0), implicit_uptake_ratio(0), aggregate_tolerance(0), profile(),
+			  _curr_step(0), _timestep(timestep), _phase_trans_step(0),
+			  _curr_stage_itr(stages.begin()), _rand(rand), _rand_agent(),
+			  _stage_schedule(0), _phase_end_time(0), _last_uptake()
 		{
 		}
 
@@ -150,6 +201,11 @@ namespace iebpr
 		// INTERNAL API
 		//======================================================================
 
+		// microbenchmarks (bench/) time private hot paths directly
+		friend struct BenchAccess;
+		// advances replicates in lockstep with their own env but shared agent
+		// kernels and hydraulics
+		friend class ReplicateBatch;
 		// get timestep
 		inline stvalue_t get_timestep(void) const { return _timestep; };
 		// set timestep
@@ -159,17 +215,33 @@ namespace iebpr
 			return;
 		};
 		// get current elapsed simulation time
-		inline stvalue_t get_curr_time(void) const noexcept { return _curr_time; };
+		inline stvalue_t get_curr_time(void) const noexcept { return _curr_step * _timestep; };
+		// get number of elapsed timesteps
+		inline uint64_t get_curr_step(void) const noexcept { return _curr_step; };
+		// convert time to the first step that reaches it
+		inline uint64_t time_to_step(stvalue_t time) const noexcept
+		{
+			// tolerate rounding error in the division, so that a time exactly
+			// on a step boundary maps to that step
+			auto step = std::ceil(time / _timestep - 1e-6);
+			return step > 0 ? (uint64_t)step : 0;
+		};
 		// num of stages currently set
 		inline size_t n_stage(void) const noexcept { return stages.size(); };
-		// append a stage config
-		inline void append_stage(const Stage &stage)
-		{
-			stages.push_back(stage);
-			return;
-		}
+		// append a stage config; current progress is kept, if all previous
+		// stages are finished, the run continues with the new stage
+		void append_stage(const Stage &stage);
 		// clear all stage config
 		void clear_stage(void) noexcept;
+		// replace the stage config at index; if in_progress, only stages
+		// after the current one can be replaced
+		error_enum set_stage(size_t index, const Stage &stage, bool in_progress);
+		// replace a phase config of the stage at stage_index; if in_progress,
+		// phases of finished stages cannot be replaced, nor can time_len be
+		// changed in the current stage; a change of the current phase takes
+		// effect from the next timestep
+		error_enum set_phase(size_t stage_index, size_t phase_index, const Phase &phase,
+							 bool in_progress);
 		// total simulation time length of all stages
 		stvalue_t total_time_len(void) const noexcept;
 		// return true if all stages have balanced inflow volume and outflow
@@ -177,6 +249,8 @@ namespace iebpr
 		bool is_flow_balanced(void) const noexcept;
 		// get the current stage
 		inline Stage &get_curr_stage(void) { return *_curr_stage_itr; };
+		// get the index of current stage, n_stage() if all are finished
+		inline size_t get_curr_stage_index(void) const noexcept { return _curr_stage_itr - stages.begin(); };
 		// reset current stage itr
 		inline void reset_curr_stage(void)
 		{
@@ -185,8 +259,12 @@ namespace iebpr
 		};
 		// true when curr_stage_itr reaches the end of stage config
 		inline bool finished_last_stage(void) const noexcept { return (_curr_stage_itr >= stages.end()); };
-		// called to update env and agent state at each time step
-		void timestep_update(AgentPool &pool);
+		// number of timesteps before the next phase transition, at least 1;
+		// no_step if all stages are finished
+		uint64_t steps_to_next_transition(void) const noexcept;
+		// update env and agent state for n_step timesteps, then try transit
+		// phase; n_step must not exceed steps_to_next_transition()
+		void timestep_update(AgentPool &pool, uint64_t n_step = 1);
 		// try transit phase
 		void transit_phase(void);
 		// self validate before init
@@ -195,18 +273,52 @@ namespace iebpr
 		void prerun_init(AgentPool &pool) noexcept;
 		// self validate after init, before simulation
 		error_enum prerun_validate(void) const noexcept;
+		// dump configs (simulation type, timestep, init env, stages etc.),
+		// for pickling
+		void save_config(BinWriter &writer) const;
+		// restore configs dumped by save_config(), progress is reset
+		error_enum load_config(BinReader &reader);
+		// dump simulation progress, for checkpoint
+		void save_progress(BinWriter &writer) const;
+		// restore progress dumped by save_progress(), must be called after
+		// prerun_init(); the stage/phase configs must match those at dumping
+		error_enum load_progress(BinReader &reader);
+		// copy configs and progress from other, iterators are rebased to own
+		// stages
+		void fork_from(const SbrControl &other);
 
 	private:
 		// set the sbr status to the first state/phase with non-zero time length
 		void _prerun_init_stage_phase_status(void) noexcept;
+		// start from the first non-empty stage at or after from
+		void _start_stage_phase_status(decltype(stages)::iterator from) noexcept;
+		// compile stage and phase time lengths into _stage_schedule
+		void _compile_schedule(void);
+		// step at which the current phase ends
+		uint64_t _curr_phase_end_step(void) const noexcept;
 		// force finish sbr run
 		void _force_set_finish(void) noexcept;
+		// agent action for n_step timesteps, w/o env physical process
+		void _timestep_update_agents(AgentPool &pool, uint64_t n_step);
+		// true if substrate uptake should be semi-implicit in this timestep
+		bool _is_uptake_depleting(void) const noexcept;
+		// uptake scaled by the semi-implicit euler step given full demand
+		SubstrateUptake _implicit_uptake(const EnvState &demand) const noexcept;
 		// agent action for discrete-time simulation type
 		void _timestep_update_agents_discrete(AgentPool &pool);
+		// apply env change and uptake of agent action in a discrete timestep
+		void _apply_agent_change_discrete(const EnvState &d_env, const SubstrateUptake &uptake) noexcept;
 		// agent action for pseudo-continuous simulation type
 		void _timestep_update_agents_pcontinuous(AgentPool &pool);
 		// physical process update (inflow/outflow)
 		void _timestep_update_env(AgentPool &pool);
+		// the env part of the above, return the factor to scale agent content
+		// by, 0 if all agent content is washed out
+		stvalue_t _timestep_update_hydraulics(void) noexcept;
+		// physical process update over n_step timesteps, in closed form
+		void _span_update_env(AgentPool &pool, uint64_t n_step);
+		// the env part of the above, same as _timestep_update_hydraulics()
+		stvalue_t _span_update_hydraulics(uint64_t n_step) noexcept;
 		// find next phase, may across stages
 		void _transit_next_phase_recursive(void) noexcept;
 	};
@@ -0,0 +1,206 @@
+#ifndef __IEBPR_SERIALIZER_HPP__
+#define __IEBPR_SERIALIZER_HPP__
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "def.hpp"
+
+namespace iebpr
+{
+	// a range of memory kept out of a binary stream, see BinWriter
+	struct BinBlock
+	{
+		const void *data;
+		size_t size;
+	};
+
+	// binary writer, dumps raw (native endianness) data either into a file or
+	// into an in-memory buffer; all write functions are no-op once an error
+	// occurred, check good() in the end
+	// with a memory buffer, large vectors and blocks can be kept out of the
+	// stream as references into the written objects, which must outlive them;
+	// they are read back by a BinReader given the same blocks in order
+	class BinWriter
+	{
+	private:
+		std::FILE *_fp;
+		std::vector<char> *_buf;
+		std::vector<BinBlock> *_blocks;
+		size_t _pos;
+		bool _good;
+
+	public:
+		// vectors and blocks of at least this many bytes are kept out of the
+		// stream, if blocks are given
+		constexpr static size_t min_block_size = 1 << 16;
+
+		// write to file, the file is not owned by the writer
+		explicit BinWriter(std::FILE *fp) noexcept
+			: _fp(fp), _buf(nullptr), _blocks(nullptr), _pos(0), _good(fp != nullptr) {}
+		// write to (append to) memory buffer
+		explicit BinWriter(std::vector<char> &buf) noexcept
+			: _fp(nullptr), _buf(&buf), _blocks(nullptr), _pos(buf.size()), _good(true) {}
+		// write to memory buffer, with large vectors and blocks appended to
+		// blocks instead
+		explicit BinWriter(std::vector<char> &buf, std::vector<BinBlock> &blocks) noexcept
+			: _fp(nullptr), _buf(&buf), _blocks(&blocks), _pos(buf.size()), _good(true) {}
+
+		//======================================================================
+		// INTERNAL API
+		//======================================================================
+
+		// true if no error occurred
+		inline bool good(void) const noexcept { return _good; };
+		// number of bytes written so far
+		inline size_t pos(void) const noexcept { return _pos; };
+		// write raw bytes
+		void write(const void *data, size_t size);
+		// pad with zeros until pos() is a multiple of alignment
+		void align(size_t alignment);
+		// write a trivially copyable value
+		template <typename T>
+		inline void write_value(const T &v)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "");
+			write(&v, sizeof(T));
+			return;
+		}
+		// write vector size followed by its elements
+		template <typename T, typename A>
+		inline void write_vector(const std::vector<T, A> &v)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "");
+			write_value<uint64_t>(v.size());
+			if (!_keep_block(v.data(), v.size() * sizeof(T)))
+				write(v.data(), v.size() * sizeof(T));
+			return;
+		}
+		// write a large block of raw bytes, aligned in the stream; the size
+		// is not written
+		void write_block(const void *data, size_t size, size_t alignment);
+		// write string length followed by its characters
+		void write_string(const std::string &s);
+
+	private:
+		// keep a block out of the stream if large enough; return false if it
+		// is to be written in the stream
+		bool _keep_block(const void *data, size_t size);
+	};
+
+	// binary reader on a contiguous memory range, usually a mapped file; all
+	// read functions fail (return false) after the first out-of-range read
+	class BinReader
+	{
+	private:
+		const char *_begin;
+		const char *_end;
+		const char *_curr;
+		const std::vector<BinBlock> *_blocks;
+		size_t _next_block;
+		bool _good;
+
+	public:
+		explicit BinReader(const void *data, size_t size) noexcept
+			: _begin((const char *)data), _end((const char *)data + size),
+			  _curr((const char *)data), _blocks(nullptr), _next_block(0),
+			  _good(data != nullptr) {}
+		// read a stream written with blocks, see BinWriter
+		explicit BinReader(const void *data, size_t size, const std::vector<BinBlock> &blocks) noexcept
+			: _begin((const char *)data), _end((const char *)data + size),
+			  _curr((const char *)data), _blocks(&blocks), _next_block(0),
+			  _good(data != nullptr) {}
+
+		//======================================================================
+		// INTERNAL API
+		//======================================================================
+
+		// true if no error occurred
+		inline bool good(void) const noexcept { return _good; };
+		// number of bytes consumed so far
+		inline size_t pos(void) const noexcept { return _curr - _begin; };
+		// remaining bytes
+		inline size_t remain(void) const noexcept { return _end - _curr; };
+		// return pointer to the next size bytes and advance, nullptr on fail;
+		// used to access large blocks without an intermediate copy
+		const void *view(size_t size) noexcept;
+		// read raw bytes
+		bool read(void *data, size_t size) noexcept;
+		// skip padding until pos() is a multiple of alignment
+		bool align(size_t alignment) noexcept;
+		// read a trivially copyable value
+		template <typename T>
+		inline bool read_value(T &v) noexcept
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "");
+			return read(&v, sizeof(T));
+		}
+		// read vector written by BinWriter::write_vector
+		template <typename T, typename A>
+		bool read_vector(std::vector<T, A> &v)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "");
+			uint64_t size;
+			if (!read_value(size))
+				return false;
+			if (_is_block(size, sizeof(T)))
+			{
+				auto src = _take_block(size * sizeof(T));
+				if (!src)
+					return false;
+				v.resize(size);
+				std::memcpy(v.data(), src, size * sizeof(T));
+				return true;
+			}
+			if (size > remain() / sizeof(T))
+				return _good = false;
+			v.resize(size);
+			return read(v.data(), size * sizeof(T));
+		}
+		// return pointer to a block written by BinWriter::write_block, nullptr
+		// on fail
+		const void *view_block(size_t size, size_t alignment) noexcept;
+		// read string written by BinWriter::write_string
+		bool read_string(std::string &s);
+
+	private:
+		// true if n elements of elem_size bytes were kept out of the stream
+		inline bool _is_block(uint64_t n, size_t elem_size) const noexcept
+		{
+			return _blocks && (n >= (BinWriter::min_block_size + elem_size - 1) / elem_size);
+		}
+		// take the next block, which must be of size bytes
+		const void *_take_block(size_t size) noexcept;
+	};
+
+	// read-only memory map of a whole file, unmapped on destruction
+	class MappedFile
+	{
+	private:
+		void *_data;
+		size_t _size;
+
+	public:
+		explicit MappedFile(void) noexcept
+			: _data(nullptr), _size(0) {}
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+		~MappedFile(void) noexcept;
+
+		//======================================================================
+		// INTERNAL API
+		//======================================================================
+
+		// map file, return 0 on success, 1 on fail
+		int open(const std::string &path) noexcept;
+		// unmap file
+		void close(void) noexcept;
+		inline const void *data(void) const noexcept { return _data; };
+		inline size_t size(void) const noexcept { return _size; };
+	};
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
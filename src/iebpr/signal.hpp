@@ -2,22 +2,34 @@
 #define __IEBPR_SIGNAL_HPP__
 
 #include <csignal>
+#include <mutex>
 
 namespace iebpr
 {
+	// replaces the process handler of a signal while any instance is active,
+	// and reports whether the signal was received since the first of them
+	// was activated; instances may be activated concurrently, the original
+	// handler is restored when the last one is deactivated
 	template <int SIGNAL_TYPE>
 	class SignalHandler
 	{
 	private:
-		// if using multi-threading, these need to be volatile
-		// which... so far will not be implemented
-		volatile bool _in_use;
+		bool _in_use;
 		static volatile std::sig_atomic_t _sig_set;
-		struct sigaction _saved_sigint_act;
+		// guard the below, shared by all instances
+		static std::mutex _mutex;
+		static unsigned _n_active;
+		static struct sigaction _saved_act;
 
 	public:
 		SignalHandler(void) noexcept
 			: _in_use(false){};
+		~SignalHandler(void) noexcept
+		{
+			deactivate();
+		}
+		SignalHandler(const SignalHandler &) = delete;
+		SignalHandler &operator=(const SignalHandler &) = delete;
 
 		// activation, replace signal handler with local signal handler, and
 		// save original signal handler for later restore
@@ -25,27 +37,34 @@ namespace iebpr
 		{
 			if (_in_use)
 				return;
-			// save the old signal action
-			sigaction(SIGNAL_TYPE, nullptr, &_saved_sigint_act);
-			// replace with local action
-			std::signal(SIGNAL_TYPE, _signal_handler);
-			_sig_set = 0;
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (!_n_active++)
+			{
+				// save the old signal action and replace with local action
+				struct sigaction act = {};
+				act.sa_handler = _signal_handler;
+				sigemptyset(&act.sa_mask);
+				_sig_set = 0;
+				sigaction(SIGNAL_TYPE, &act, &_saved_act);
+			}
 			_in_use = true;
 			return;
 		}
 
-		bool sig_received(void) noexcept
+		bool sig_received(void) const noexcept
 		{
-			return _sig_set;
+			return _in_use && _sig_set;
 		}
 
 		// does the reverse to activate()
-		void deactivate(void)
+		void deactivate(void) noexcept
 		{
 			if (!_in_use)
 				return;
+			std::lock_guard<std::mutex> lock(_mutex);
 			// restore original handler
-			std::signal(SIGNAL_TYPE, _saved_sigint_act.sa_handler);
+			if (!--_n_active)
+				sigaction(SIGNAL_TYPE, &_saved_act, nullptr);
 			_in_use = false;
 			return;
 		}
@@ -60,6 +79,12 @@ namespace iebpr
 
 	template <int SIGNAL_TYPE>
 	volatile std::sig_atomic_t SignalHandler<SIGNAL_TYPE>::_sig_set = 0;
+	template <int SIGNAL_TYPE>
+	std::mutex SignalHandler<SIGNAL_TYPE>::_mutex;
+	template <int SIGNAL_TYPE>
+	unsigned SignalHandler<SIGNAL_TYPE>::_n_active = 0;
+	template <int SIGNAL_TYPE>
+	struct sigaction SignalHandler<SIGNAL_TYPE>::_saved_act;
 
 } // namespace iebpr
 
@@ -1,6 +1,7 @@
 #ifndef __IEBPR_SIMULATION_HPP__
 #define __IEBPR_SIMULATION_HPP__
 
+#include <string>
 #include <vector>
 #include "def.hpp"
 #include "error_def.hpp"
@@ -9,7 +10,11 @@
 #include "sbr_control.hpp"
 #include "recorder.hpp"
 #include "timer.hpp"
-#include "signal.hpp"
+#include "run_control.hpp"
+#include "serializer.hpp"
+#include "checkpoint.hpp"
+#include "run_profile.hpp"
+#include "run_trace.hpp"
 
 namespace iebpr
 {
@@ -23,19 +28,61 @@ namespace iebpr
 	private:
 		Timer _timer;
 		Randomizer _rand;
+		// true when sbr, pool and recorder hold a valid progress, i.e. after
+		// a run() or load_checkpoint(); required by resume()
+		bool _initialized;
+		// forks taken, mixed into the seed of each branch's substream
+		mutable uint32_t _n_fork;
+		stvalue_t _next_checkpoint_time;
+		// opened for the duration of a run if perf_counters is set
+		PerfCounter _perf;
+		// writes trace_file during a run
+		RunTracer _tracer;
+		// summary of agents of each subtype, taken when a run or its
+		// progress is initialized, and at the end of each main loop
+		std::vector<AgentStateRecEntry> _curr_agent_state;
 
 	public:
+		// max number of timesteps run in the main loop between checks of
+		// run_control and checkpoint
+		constexpr static uint64_t max_span_steps = 1024;
+
 		SbrControl sbr;
 		AgentPool pool;
 		Recorder recorder;
-		SignalHandler<SIGINT> sigint_handler;
+		// cancellation, budgets and deadline of run()/resume()
+		RunControl run_control;
+		// save a checkpoint to this file periodically during run, every
+		// checkpoint_interval simulation time; disabled if either is not set
+		std::string checkpoint_file;
+		stvalue_t checkpoint_interval;
+		// sample hardware performance counters into last_run_profile(), once
+		// per span of the main loop; agent kinetics and env update are counted
+		// together; falls back silently to timing only if counters are
+		// unavailable
+		bool perf_counters;
+		// write a trace event timeline of each run() or resume() to this
+		// file, overwritten each time; disabled if not set
+		std::string trace_file;
+		// sample state records and aggregate work and splits in the trace
+		// over this many main loop spans
+		uint64_t trace_sample_interval;
+		// also write records into a result arena at result_shm_offset of this
+		// posix shared memory object during runs; disabled if not set, see
+		// ResultArena
+		std::string result_shm;
+		uint64_t result_shm_offset;
 
 		explicit Simulation(decltype(_rand.engine)::result_type seed = 0,
 							bool pcontinuous = false,
 							stvalue_t timestep = SbrControl::default_timestep) noexcept
-			: _rand(seed), sbr(_rand, pcontinuous ? simutype_enum::pcontinuous : simutype_enum::discrete,
-							   timestep),
-			  pool(_rand), recorder() {}
+			: _rand(seed), _initialized(false), _n_fork(0), _next_checkpoint_time(0), _perf(), _tracer(),
+			  _curr_agent_state(0),
+			  sbr(_rand, pcontinuous ? simutype_enum::pcontinuous : simutype_enum::discrete,
+				  timestep),
+			  pool(_rand), recorder(), run_control(), checkpoint_file(),
+			  checkpoint_interval(0), perf_counters(false), trace_file(),
+			  trace_sample_interval(1), result_shm(), result_shm_offset(0) {}
 
 		//======================================================================
 		// EXTERNAL API
@@ -46,8 +93,9 @@ namespace iebpr
 		static bool is_valid_randtype_enum(rand_t type) noexcept;
 		// interpret random type enum value to string
 		static const char *randtype_enum_to_name(rand_t type) noexcept;
-		// set random seed
-		void set_seed(Randomizer::seed_t seed) noexcept;
+		// set random seed; trait reservoirs, if enabled after a run, are
+		// reseeded from it as well
+		void set_seed(Randomizer::seed_t seed);
 
 		//======================================================================
 		// SbrControl setup
@@ -62,10 +110,31 @@ namespace iebpr
 		stvalue_t get_timestep(void) const noexcept;
 		// set timestep of SbrControl subunit
 		void set_timestep(stvalue_t timestep) noexcept;
+		// get closed-form hydraulics span, 0 if disabled
+		uint64_t get_hydraulic_span(void) const noexcept;
+		// set closed-form hydraulics span, 0 to update hydraulics every
+		// timestep
+		void set_hydraulic_span(uint64_t n_step) noexcept;
+		// get semi-implicit uptake threshold ratio, 0 if disabled
+		stvalue_t get_implicit_uptake_ratio(void) const noexcept;
+		// set semi-implicit uptake threshold ratio, 0 to disable
+		void set_implicit_uptake_ratio(stvalue_t ratio) noexcept;
+		// get adaptive aggregation tolerance, 0 if disabled
+		stvalue_t get_aggregate_tolerance(void) const noexcept;
+		// set adaptive aggregation tolerance, 0 to disable
+		void set_aggregate_tolerance(stvalue_t tolerance) noexcept;
 		// add stage config to SbrControl subunit
 		void append_sbr_stage(const SbrControl::Stage &stage);
 		// clear all stage config
 		void clear_sbr_stage(void) noexcept;
+		// replace the stage config at index; in a run in progress, only
+		// stages after the current one can be replaced
+		error_enum set_sbr_stage(size_t index, const SbrControl::Stage &stage);
+		// replace a phase config of a stage; in a run in progress, phases of
+		// finished stages cannot be replaced, nor can time_len be changed in
+		// the current stage
+		error_enum set_sbr_phase(size_t stage_index, size_t phase_index,
+								 const SbrControl::Phase &phase);
 		// return total simulation time length
 		stvalue_t total_time_len(void) const noexcept;
 		// return true if all stages have balanced inflow volume and outflow
@@ -91,6 +160,27 @@ namespace iebpr
 							   const TraitRandConfig &trait_cfg);
 		// clear all agent subtype
 		void clear_agent_subtype(void) noexcept;
+		// get number of pre-generated split traits per subtype, 0 if disabled
+		size_t get_trait_reservoir_size(void) const noexcept;
+		// set number of pre-generated split traits per subtype, 0 to disable;
+		// applied at next run()
+		void set_trait_reservoir_size(size_t size) noexcept;
+		// get if trait reservoirs are refilled on background threads
+		bool get_trait_reservoir_thread(void) const noexcept;
+		// set if trait reservoirs are refilled on background threads; results
+		// are the same either way
+		void set_trait_reservoir_thread(bool enable) noexcept;
+		// get number of threads to instantiate agents on, 0 if serial
+		size_t get_instantiate_threads(void) const noexcept;
+		// set number of threads to instantiate agents on, 0 to instantiate
+		// serially from the main random sequence; results are the same for
+		// any number > 0
+		void set_instantiate_threads(size_t n_thread) noexcept;
+		// get directory of the agent pool backing file, empty if in memory
+		const std::string &get_pool_backing_dir(void) const noexcept;
+		// set directory to create the agent pool backing file in, empty to
+		// keep agents in memory; applied at next run()
+		void set_pool_backing_dir(const std::string &dir);
 
 		//======================================================================
 		// Recorder
@@ -99,7 +189,8 @@ namespace iebpr
 		size_t n_state_rec_timepoints(void) const noexcept;
 		// get state record timepoints, as copy
 		std::vector<stvalue_t> get_state_rec_timepoints(void) const;
-		// set state record timepoints
+		// set state record timepoints; if set during a run, only timepoints
+		// after current time will be recorded on resume()
 		void set_state_rec_timepoints(std::vector<stvalue_t> &timepoints);
 		void set_state_rec_timepoints(std::vector<stvalue_t> &&timepoints);
 		// clear state record timepoints
@@ -109,7 +200,7 @@ namespace iebpr
 		size_t n_snapshot_rec_timepoints(void) const noexcept;
 		// get snapshot record timepoints, as copy
 		std::vector<stvalue_t> get_snapshot_rec_timepoints(void) const;
-		// set snapshot record timepoints
+		// set snapshot record timepoints; same as above
 		void set_snapshot_rec_timepoints(std::vector<stvalue_t> &timepoints);
 		void set_snapshot_rec_timepoints(std::vector<stvalue_t> &&timepoints);
 		// clear snapshot record timepoints
@@ -118,16 +209,95 @@ namespace iebpr
 		//======================================================================
 		// Simulation
 
-		// run simulation, main loop
-		error_enum run(void);
+		// run simulation, main loop; sigint is left alone in this run if
+		// no_sigint, regardless of run_control.handle_sigint, e.g. for runs
+		// on a thread other than the main one
+		error_enum run(bool no_sigint = false);
+		// continue an interrupted run or a run restored from checkpoint, see
+		// run()
+		error_enum resume(bool no_sigint = false);
+		// advance the run by n_step timesteps, or to the end of the last
+		// stage; starts a new run if none is in progress, i.e. before the
+		// first run() or load_checkpoint(); all progress is kept between
+		// calls, and results are the same as of a single run()
+		error_enum advance(uint64_t n_step);
+		// advance the run to the first timestep at or after time, see
+		// advance(); nothing is done if time has been reached
+		error_enum run_until(stvalue_t time);
+		// current simulation time and timestep of the run in progress
+		stvalue_t curr_time(void) const noexcept;
+		uint64_t curr_step(void) const noexcept;
+		// current env state of the run in progress
+		const EnvState &curr_env(void) const noexcept;
+		// summary of agents of each subtype (totals, as in agent state
+		// records) as of the end of the last main loop, i.e. last run(),
+		// resume(), advance() or run_until(), or when the run was started or
+		// restored
+		const std::vector<AgentStateRecEntry> &curr_agent_state(void) const noexcept;
+		// save current progress to a checkpoint file
+		error_enum save_checkpoint(const std::string &path) const;
+		// restore progress from a checkpoint file, then resume() continues
+		// the run bit-identically; all configs must be set up the same as
+		// they were when the checkpoint was saved
+		error_enum load_checkpoint(const std::string &path);
+		// dump all configs and, if a run is in progress, the progress into
+		// an image; large blocks are kept by reference if writer is set up so
+		error_enum save_image(BinWriter &writer) const;
+		// restore from an image written by save_image(), replacing all
+		// configs and progress; on error, configs are left partially loaded
+		error_enum load_image(BinReader &reader);
+		// copy configs and current progress into branch, which then can be
+		// further configured (e.g. append stages, reseed) and resume()-ed
+		// independently; the branch draws from its own random substream,
+		// unless same_stream is set to continue the same sequence as this;
+		// checkpoint, perf counter, trace and result arena settings are not
+		// copied
+		error_enum fork(Simulation &branch, bool same_stream = false) const;
+		// bytes of the result arena needed by the next run() or resume(), of
+		// the current timepoints and agent subtypes
+		uint64_t result_arena_bytes(void) const;
 		// get simulation run duration
 		std::chrono::milliseconds last_run_duration(void) const noexcept;
+		// counters of the last run() or resume(); all zero if built with
+		// NO_RUN_PROFILE
+		const RunProfile &last_run_profile(void) const noexcept;
 		// retireve env state record results from simulation
 		const decltype(Recorder::env_state_rec) &retrieve_env_state_rec(void) const noexcept;
 		// retireve agent state record results from simulation
 		const decltype(Recorder::agent_state_rec) &retrieve_agent_state_rec(void) const noexcept;
 		// retireve record snapshot results from simulation
 		const decltype(Recorder::snapshot_rec) &retrieve_snapshot_rec(void) const noexcept;
+
+	private:
+		// runs simulations in lockstep with their own progress
+		friend class ReplicateBatch;
+		// validate configs, initialize from start and validate again, shared
+		// by run() and ReplicateBatch::run()
+		error_enum _init_run(void);
+		// validate configs before init
+		error_enum _preinit_validate(void) const noexcept;
+		// validate after init
+		error_enum _prerun_validate(void) const noexcept;
+		// the main loop, continues from current progress until step_end
+		error_enum _main_loop(uint64_t step_end = SbrControl::no_step, bool no_sigint = false);
+		// save progress sections, from the randomizer state on
+		void _save_progress(BinWriter &writer) const;
+		// initialize, then load progress sections saved by _save_progress()
+		error_enum _load_progress(BinReader &reader);
+		// save/load settings of Simulation itself, for image
+		void _save_config(BinWriter &writer) const;
+		error_enum _load_config(BinReader &reader);
+		// attach the recorder to the result arena if result_shm is set
+		error_enum _attach_result_arena(void);
+		// take the summary of agents into _curr_agent_state
+		void _update_curr_agent_state(void);
+		// update the next auto checkpoint time to be after current time
+		void _schedule_next_checkpoint(void) noexcept;
+		// clear run profile counters, at the start of main loop
+		void _begin_run_profile(void);
+		// collect counters kept outside sbr, at the end of main loop; the
+		// record bytes are counted from those at the start
+		void _end_run_profile(uint64_t state_rec_bytes, uint64_t snapshot_rec_bytes);
 	};
 
 } // namespace iebpr
@@ -0,0 +1,102 @@
+#ifndef __IEBPR_TRAIT_RESERVOIR_HPP__
+#define __IEBPR_TRAIT_RESERVOIR_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "error_def.hpp"
+#include "randomizer.hpp"
+#include "serializer.hpp"
+#include "agent_data.hpp"
+#include "agent_subtype_base_trait_cfg.hpp"
+
+namespace iebpr
+{
+	// ring buffer of traits pre-generated by a trait randomizer config, for
+	// split agents; traits are generated in bulk from an own random substream
+	// and popped in the same order, either refilled in the pop that finds it
+	// empty, or ahead on a background thread; the popped sequence only
+	// depends on the substream seed, not on how it was refilled
+	class TraitReservoir
+	{
+	private:
+		Randomizer _rand;
+		TraitRandConfig _cfg;
+		std::vector<AgentTrait> _buf;
+		// number of traits popped and generated so far; the buffer holds
+		// those in [_head, _tail), at (index % capacity)
+		std::atomic<uint64_t> _head;
+		std::atomic<uint64_t> _tail;
+		// background refill
+		std::thread _thread;
+		mutable std::mutex _mutex;
+		std::condition_variable _cv;
+		bool _stop;
+		bool _waiting;
+
+	public:
+		explicit TraitReservoir(void) noexcept
+			: _rand(), _cfg(), _buf(0), _head(0), _tail(0), _thread(), _mutex(), _cv(),
+			  _stop(false), _waiting(false) {}
+		~TraitReservoir(void) noexcept;
+		TraitReservoir(const TraitReservoir &) = delete;
+		TraitReservoir &operator=(const TraitReservoir &) = delete;
+
+		//======================================================================
+		// INTERNAL API
+		//======================================================================
+
+		// true if traits are taken from the reservoir
+		inline bool is_enabled(void) const noexcept { return !_buf.empty(); }
+		// number of traits the buffer holds at most
+		inline size_t capacity(void) const noexcept { return _buf.size(); }
+		// set the config and capacity and drop buffered traits; capacity 0
+		// disables the reservoir
+		void reset(const TraitRandConfig &cfg, size_t capacity);
+		// drop buffered traits and restart the substream from seed
+		void seed(Randomizer::seed_t seed);
+		// start refilling on a background thread
+		void start_thread(void);
+		// stop the background thread, buffered traits are kept
+		void stop_thread(void) noexcept;
+		// take the next trait
+		inline void pop(AgentTrait &trait)
+		{
+			const auto head = _head.load(std::memory_order_relaxed);
+			if (_tail.load(std::memory_order_acquire) == head)
+				_refill_for_pop();
+			trait = _buf[head % capacity()];
+			_head.store(head + 1, std::memory_order_release);
+			if (_thread.joinable() && (head + 1 + capacity() - _tail.load() == _refill_min()))
+				_notify();
+			return;
+		}
+		// dump substream state and buffered traits, for checkpoint; the
+		// background thread pauses meanwhile
+		void save_state(BinWriter &writer) const;
+		// restore states dumped by save_state(), must be called after
+		// reset() with the same capacity
+		error_enum load_state(BinReader &reader);
+		// copy config, substream state and buffered traits from other, for
+		// fork
+		void copy_from(const TraitReservoir &other);
+
+	private:
+		// free slots to wake the background thread for
+		inline size_t _refill_min(void) const noexcept { return (capacity() + 1) / 2; }
+		// generate one trait into the slot of _tail, the buffer must not be
+		// full
+		void _generate(void);
+		// wait for the background thread, or refill in place if none
+		void _refill_for_pop(void);
+		// wake the background thread
+		void _notify(void);
+		// background thread main
+		void _refill_loop(void);
+	};
+
+} // namespace iebpr
+
+#endif
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "iebpr/perf_counter.hpp"
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace iebpr
+{
+	PerfCounter::Values &PerfCounter::Values::operator+=(const Values &other) noexcept
+	{
+		for (size_t i = 0; i < n_event; i++)
+			value[i] += other.value[i];
+		return *this;
+	}
+
+	const char *PerfCounter::event_enum_to_name(event_enum event) noexcept
+	{
+		switch (event)
+		{
+		case cycles:
+			return "cycles";
+		case instructions:
+			return "instructions";
+		case llc_misses:
+			return "llc_misses";
+		case branch_misses:
+			return "branch_misses";
+		default:
+			return "unknown";
+		}
+	}
+
+#ifdef __linux__
+	static int _perf_event_open(PerfCounter::event_enum event, int group_fd) noexcept
+	{
+		static const uint64_t config[PerfCounter::n_event] = {
+			PERF_COUNT_HW_CPU_CYCLES,
+			PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_CACHE_MISSES,
+			PERF_COUNT_HW_BRANCH_MISSES,
+		};
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = config[event];
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+						   PERF_FORMAT_TOTAL_TIME_RUNNING;
+		// the whole group is started at once by the leader
+		attr.disabled = (group_fd == -1);
+		// user space only, allowed with the default perf_event_paranoid
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		// calling thread on any cpu
+		return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+	}
+
+	unsigned PerfCounter::open(void) noexcept
+	{
+		close();
+		for (size_t i = 0; i < n_event; i++)
+		{
+			auto event = (event_enum)i;
+			auto fd = _perf_event_open(event, _leader);
+			if (fd < 0)
+				continue;
+			if (_leader == -1)
+				_leader = fd;
+			_fd[event] = fd;
+			_order[_n_open++] = event;
+		}
+		if ((_leader != -1) && (ioctl(_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) < 0))
+			close();
+		return _n_open;
+	}
+
+	void PerfCounter::close(void) noexcept
+	{
+		if (_leader != -1)
+			ioctl(_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+		// leader last
+		for (size_t i = n_event; i > 0; i--)
+			if ((_fd[i - 1] != -1) && (_fd[i - 1] != _leader))
+				::close(_fd[i - 1]);
+		if (_leader != -1)
+			::close(_leader);
+		for (auto &fd : _fd)
+			fd = -1;
+		_leader = -1;
+		_n_open = 0;
+		return;
+	}
+
+	bool PerfCounter::read(Values &values) const noexcept
+	{
+		if (!_n_open)
+			return false;
+		// nr, time_enabled, time_running, then a value per open event
+		uint64_t buf[3 + n_event];
+		auto size = ::read(_leader, buf, sizeof(buf));
+		if ((size < (ssize_t)(sizeof(uint64_t) * (3 + _n_open))) || (buf[0] != _n_open) || (!buf[2]))
+			return false;
+		// extrapolate if the group was not always on the pmu
+		const double scale = (double)buf[1] / buf[2];
+		values = Values();
+		for (size_t i = 0; i < _n_open; i++)
+			values.value[_order[i]] = (buf[2] == buf[1]) ? buf[3 + i] : (uint64_t)(buf[3 + i] * scale);
+		return true;
+	}
+#else
+	unsigned PerfCounter::open(void) noexcept
+	{
+		return 0;
+	}
+
+	void PerfCounter::close(void) noexcept
+	{
+		return;
+	}
+
+	bool PerfCounter::read(Values &values) const noexcept
+	{
+		return false;
+	}
+#endif
+
+	bool PerfCounter::is_open(event_enum event) const noexcept
+	{
+		return _fd[event] != -1;
+	}
+
+	unsigned PerfCounter::n_open(void) const noexcept
+	{
+		return _n_open;
+	}
+
+} // namespace iebpr
\ No newline at end of file
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+# pgo training workload of the python extension, the same scenarios as
+# make pgo runs through cli/iebpr-run; see setup.py for the build steps
+
+import argparse
+import glob
+import json
+import os
+
+import numpy
+
+import iebpr
+from iebpr import Simulation, EnvState, SbrPhase, SbrStage, AgentSubtype
+from iebpr.agent_template import randconfig_from_template
+
+
+def get_args():
+	ap = argparse.ArgumentParser(description="run the pgo training scenarios "
+		"(train.*.run.json) with the installed iebpr module")
+	ap.add_argument("run_json", type=str, nargs="*",
+		default=sorted(glob.glob(os.path.join(os.path.dirname(__file__),
+			"train.*.run.json"))),
+		help="run descriptions to train with [all train.*.run.json]")
+	return ap.parse_args()
+
+
+def load_template(v, base_dir: str):
+	if isinstance(v, str):
+		v = json.load(open(os.path.join(base_dir, v), "r"))
+	return randconfig_from_template(v)
+
+
+def load_timepoints(v) -> numpy.ndarray:
+	if isinstance(v, dict):
+		return numpy.linspace(v["start"], v["stop"], v["num"])
+	return numpy.asarray(v, dtype=float)
+
+
+def simulation_from_run_desc(fname: str) -> Simulation:
+	desc = json.load(open(fname, "r"))
+	base_dir = os.path.dirname(fname)
+	sim = Simulation(seed=desc.get("seed", 0),
+		pcontinuous=desc.get("pcontinuous", False),
+		timestep=desc.get("timestep", 1e-5))
+	for key in ["hydraulic_span", "implicit_uptake_ratio", "aggregate_tolerance",
+			"trait_reservoir_size", "trait_reservoir_thread", "instantiate_threads",
+			"pool_backing_dir"]:
+		if key in desc:
+			setattr(sim, key, desc[key])
+	sim.init_env = EnvState(**desc["init_env"])
+	for s in desc["stages"]:
+		sim.append_sbr_stage(SbrStage(n_cycle=s["n_cycle"],
+			cycle_phases=[SbrPhase(**p) for p in s["cycle_phases"]]))
+	for a in desc["agents"]:
+		sim.add_agent_subtype(AgentSubtype[a["subtype"]],
+			n_agent=a["n_agent"],
+			state_cfg=load_template(a["state_cfg"], base_dir),
+			trait_cfg=load_template(a["trait_cfg"], base_dir))
+	sim.set_state_rec_timepoints(load_timepoints(desc["state_rec_timepoints"]))
+	sim.set_snapshot_rec_timepoints(
+		load_timepoints(desc["snapshot_rec_timepoints"]))
+	return sim
+
+
+def main():
+	args = get_args()
+	for fname in args.run_json:
+		sim = simulation_from_run_desc(fname)
+		sim.run()
+		# exercise the record retrieval paths as well
+		sim.retrieve_env_state_rec()
+		sim.retrieve_agent_state_rec()
+		sim.retrieve_snapshot_rec()
+		print("%s: %.3fsec" % (os.path.basename(fname),
+			sim.last_run_duration / 1000))
+	return
+
+
+if __name__ == "__main__":
+	main()
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include "iebpr/pool_memory.hpp"
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace iebpr
+{
+	// placed before each buffer, keeps the buffer aligned as the checkpoint
+	// blocks
+	struct _BufferHeader
+	{
+		// mapping of the buffer, or nullptr if from the heap
+		char *map_base;
+		size_t map_bytes;
+		// mapped from a backing file
+		bool file_backed;
+		char _pad[64 - sizeof(char *) - sizeof(size_t) - sizeof(bool)];
+	};
+	static_assert(sizeof(_BufferHeader) == 64, "");
+
+	static PoolMemory::hugepage_enum _env_hugepage(void) noexcept
+	{
+		const char *env = std::getenv("IEBPR_HUGEPAGES");
+		auto ret = (env && *env) ? PoolMemory::hugepage_name_to_enum(env) : PoolMemory::hugepage_none;
+		return (ret == PoolMemory::hugepage_invalid) ? PoolMemory::hugepage_none : ret;
+	}
+
+	static PoolMemory::numa_enum _env_numa(void) noexcept
+	{
+		const char *env = std::getenv("IEBPR_NUMA");
+		auto ret = (env && *env) ? PoolMemory::numa_name_to_enum(env) : PoolMemory::numa_local;
+		return (ret == PoolMemory::numa_invalid) ? PoolMemory::numa_local : ret;
+	}
+
+	// set when the library is loaded
+	static std::atomic<PoolMemory::hugepage_enum> _hugepage(_env_hugepage());
+	static std::atomic<PoolMemory::numa_enum> _numa(_env_numa());
+
+#ifdef __linux__
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+	// not in all libc headers, values from linux/mempolicy.h
+	constexpr int _mpol_interleave = 3;
+	constexpr int _mpol_f_mems_allowed = 1 << 2;
+
+	static inline size_t _round_up(size_t bytes, size_t page) noexcept
+	{
+		return (bytes + page - 1) / page * page;
+	}
+
+	static char *_map_hugetlb(size_t bytes, unsigned page_shift, size_t &map_bytes) noexcept
+	{
+		map_bytes = _round_up(bytes, size_t(1) << page_shift);
+		auto p = mmap(nullptr, map_bytes, PROT_READ | PROT_WRITE,
+					  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (page_shift << MAP_HUGE_SHIFT), -1, 0);
+		return (p == MAP_FAILED) ? nullptr : (char *)p;
+	}
+
+	// regular pages, aligned to 2 MB so that transparent huge pages can
+	// back all of it
+	static char *_map_aligned(size_t bytes, bool thp, size_t &map_bytes) noexcept
+	{
+		constexpr size_t align = PoolMemory::min_mapped_bytes;
+		map_bytes = _round_up(bytes, align);
+		auto p = mmap(nullptr, map_bytes + align, PROT_READ | PROT_WRITE,
+					  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+			return nullptr;
+		// trim to alignment
+		auto base = (char *)p;
+		auto head = (align - (uintptr_t)base % align) % align;
+		if (head)
+			munmap(base, head);
+		if (align - head)
+			munmap(base + head + map_bytes, align - head);
+		base += head;
+#ifdef MADV_HUGEPAGE
+		if (thp)
+			madvise(base, map_bytes, MADV_HUGEPAGE);
+#endif
+		return base;
+	}
+
+	// interleave pages over the allowed nodes, before they are touched
+	static void _interleave(char *base, size_t bytes) noexcept
+	{
+#if defined(SYS_mbind) && defined(SYS_get_mempolicy)
+		unsigned long nodes[16] = {0};
+		const unsigned long max_node = sizeof(nodes) * 8;
+		int mode;
+		if (syscall(SYS_get_mempolicy, &mode, nodes, max_node, nullptr, _mpol_f_mems_allowed))
+			return;
+		syscall(SYS_mbind, base, bytes, _mpol_interleave, nodes, max_node, 0);
+#endif
+		return;
+	}
+
+	static char *_map(size_t bytes, PoolMemory::hugepage_enum hugepage, PoolMemory::numa_enum numa,
+					  size_t &map_bytes) noexcept
+	{
+		char *base = nullptr;
+		if (hugepage == PoolMemory::hugepage_1g)
+			base = _map_hugetlb(bytes, 30, map_bytes);
+		if ((!base) && (hugepage >= PoolMemory::hugepage_2m))
+			base = _map_hugetlb(bytes, 21, map_bytes);
+		if (!base)
+			base = _map_aligned(bytes, hugepage != PoolMemory::hugepage_none, map_bytes);
+		if (base && (numa == PoolMemory::numa_interleave))
+			_interleave(base, map_bytes);
+		return base;
+	}
+
+	// create an unlinked file in dir, the descriptor or -1 on failure
+	static int _open_backing_file(const std::string &dir) noexcept
+	{
+		std::string path = dir + "/iebpr-pool-XXXXXX";
+		int fd = mkstemp(&path[0]);
+		if (fd >= 0)
+			unlink(path.c_str());
+		return fd;
+	}
+
+	// shared mapping of an unlinked file in dir, so pages are written back
+	// to the file rather than to swap; the file is gone with the mapping
+	static char *_map_file(size_t bytes, const std::string &dir, size_t &map_bytes) noexcept
+	{
+		map_bytes = _round_up(bytes, (size_t)sysconf(_SC_PAGESIZE));
+		int fd = _open_backing_file(dir);
+		if (fd < 0)
+			return nullptr;
+		// reserve the blocks up front, so a full disk fails here and not
+		// later with SIGBUS on first touch
+		void *p = MAP_FAILED;
+		if (!posix_fallocate(fd, 0, map_bytes))
+			p = mmap(nullptr, map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		return (p == MAP_FAILED) ? nullptr : (char *)p;
+	}
+
+	// page aligned range covering [ptr, ptr + bytes)
+	static void _page_range(const void *ptr, size_t bytes, char *&begin, size_t &len) noexcept
+	{
+		const uintptr_t page = sysconf(_SC_PAGESIZE);
+		const auto first = (uintptr_t)ptr / page * page;
+		begin = (char *)first;
+		len = _round_up((uintptr_t)ptr + bytes - first, page);
+		return;
+	}
+#endif
+
+	const char *PoolMemory::hugepage_enum_to_name(hugepage_enum hugepage) noexcept
+	{
+		switch (hugepage)
+		{
+		case hugepage_none:
+			return "none";
+		case hugepage_thp:
+			return "thp";
+		case hugepage_2m:
+			return "2m";
+		case hugepage_1g:
+			return "1g";
+		default:
+			return "invalid";
+		}
+	}
+
+	const char *PoolMemory::numa_enum_to_name(numa_enum numa) noexcept
+	{
+		switch (numa)
+		{
+		case numa_local:
+			return "local";
+		case numa_interleave:
+			return "interleave";
+		default:
+			return "invalid";
+		}
+	}
+
+	PoolMemory::hugepage_enum PoolMemory::hugepage_name_to_enum(const char *name) noexcept
+	{
+		for (auto hugepage : {hugepage_none, hugepage_thp, hugepage_2m, hugepage_1g})
+			if (!std::strcmp(name, hugepage_enum_to_name(hugepage)))
+				return hugepage;
+		return hugepage_invalid;
+	}
+
+	PoolMemory::numa_enum PoolMemory::numa_name_to_enum(const char *name) noexcept
+	{
+		for (auto numa : {numa_local, numa_interleave})
+			if (!std::strcmp(name, numa_enum_to_name(numa)))
+				return numa;
+		return numa_invalid;
+	}
+
+	PoolMemory::hugepage_enum PoolMemory::hugepage(void) noexcept
+	{
+		return _hugepage.load(std::memory_order_relaxed);
+	}
+
+	PoolMemory::numa_enum PoolMemory::numa(void) noexcept
+	{
+		return _numa.load(std::memory_order_relaxed);
+	}
+
+	bool PoolMemory::set_policy(hugepage_enum hugepage, numa_enum numa) noexcept
+	{
+		if ((hugepage >= n_hugepage) || (numa >= n_numa))
+			return false;
+		_hugepage.store(hugepage, std::memory_order_relaxed);
+		_numa.store(numa, std::memory_order_relaxed);
+		return true;
+	}
+
+	void *PoolMemory::allocate(size_t bytes, const std::string *backing_dir)
+	{
+		const size_t total = bytes + sizeof(_BufferHeader);
+		if (total < bytes)
+			throw std::bad_alloc();
+		_BufferHeader header = {nullptr, 0, false, {}};
+#ifdef __linux__
+		const auto hugepage = PoolMemory::hugepage();
+		const auto numa = PoolMemory::numa();
+		if (backing_dir && (total >= min_mapped_bytes))
+			header.map_base = _map_file(total, *backing_dir, header.map_bytes);
+		header.file_backed = (header.map_base != nullptr);
+		if ((!header.map_base) && ((hugepage != hugepage_none) || (numa != numa_local)) &&
+			(total >= min_mapped_bytes))
+			header.map_base = _map(total, hugepage, numa, header.map_bytes);
+#endif
+		auto base = header.map_base ? header.map_base : (char *)::operator new(total);
+		std::memcpy(base, &header, sizeof(header));
+		return base + sizeof(header);
+	}
+
+	void PoolMemory::deallocate(void *ptr) noexcept
+	{
+		if (!ptr)
+			return;
+		auto base = (char *)ptr - sizeof(_BufferHeader);
+		_BufferHeader header;
+		std::memcpy(&header, base, sizeof(header));
+#ifdef __linux__
+		if (header.map_base)
+		{
+			munmap(header.map_base, header.map_bytes);
+			return;
+		}
+#endif
+		::operator delete(base);
+		return;
+	}
+
+	bool PoolMemory::is_file_backed(const void *ptr) noexcept
+	{
+		if (!ptr)
+			return false;
+		_BufferHeader header;
+		std::memcpy(&header, (const char *)ptr - sizeof(_BufferHeader), sizeof(header));
+		return header.file_backed;
+	}
+
+	bool PoolMemory::is_backing_dir_usable(const std::string &dir) noexcept
+	{
+#ifdef __linux__
+		int fd = _open_backing_file(dir);
+		if (fd < 0)
+			return false;
+		close(fd);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void PoolMemory::prefetch(const void *ptr, size_t bytes) noexcept
+	{
+#ifdef __linux__
+		char *begin;
+		size_t len;
+		if (!bytes)
+			return;
+		_page_range(ptr, bytes, begin, len);
+		madvise(begin, len, MADV_WILLNEED);
+#endif
+		return;
+	}
+
+	void PoolMemory::release(const void *ptr, size_t bytes) noexcept
+	{
+#if defined(__linux__) && defined(MADV_COLD)
+		char *begin;
+		size_t len;
+		if (!bytes)
+			return;
+		_page_range(ptr, bytes, begin, len);
+		// fails on kernels before 5.4, then pages are evicted by lru as usual
+		madvise(begin, len, MADV_COLD);
+#endif
+		return;
+	}
+
+} // namespace iebpr
\ No newline at end of file
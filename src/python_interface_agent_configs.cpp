@@ -10,6 +10,10 @@ namespace iebpr
 		//======================================================================
 		// BINDING OF RandConfig
 		static PyMethodDef RandConfigPyObjectType_methods[] = {
+			{"__reduce__", config_reduce<RandConfigPyObject>, METH_NOARGS,
+			 "__reduce__(self, /) -> tuple\n--\npickle support, as a compact binary image"},
+			{"__setstate__", config_setstate<RandConfigPyObject>, METH_O,
+			 "__setstate__(self, state: bytes, /) -> None\n--\nrestore from the image of __reduce__()"},
 			{nullptr, nullptr, 0, nullptr},
 		};
 
@@ -123,8 +127,8 @@ namespace iebpr
 			 "    RandType.bernoulli - draw from {0, 1} with P(1) = mean\n"
 			 "    RandType.obsvalues - draw based on observed value list\n",
 			 nullptr},
-			{"value_list", RandConfigPyObjectType_get_value_list,
-			 RandConfigPyObjectType_set_value_list,
+			{"value_list", locked_getter<RandConfigPyObjectType_get_value_list>,
+			 locked_setter<RandConfigPyObjectType_set_value_list>,
 			 "list of observed values from a population <-> list[float]\n"
 			 "used by obsvalues",
 			 nullptr},
@@ -133,7 +137,11 @@ namespace iebpr
 
 		static PyObject *RandConfigPyObjectType_tp_str(PyObject *self)
 		{
-			const auto &cdata = ((RandConfigPyObject *)self)->cdata;
+			// copy, value_list may be set by other threads meanwhile
+			auto cdata = Randomizer::RandConfig();
+			Py_BEGIN_CRITICAL_SECTION(self);
+			cdata = ((RandConfigPyObject *)self)->cdata;
+			Py_END_CRITICAL_SECTION();
 			auto ss = std::stringstream();
 			// type header
 			ss << '<' << Py_TYPE(self)->tp_name
@@ -293,6 +301,10 @@ namespace iebpr
 		//======================================================================
 		// BINDING OF StateRandConfig
 		static PyMethodDef StateRandConfigPyObjectType_methods[] = {
+			{"__reduce__", config_reduce<StateRandConfigPyObject>, METH_NOARGS,
+			 "__reduce__(self, /) -> tuple\n--\npickle support, as a compact binary image"},
+			{"__setstate__", config_setstate<StateRandConfigPyObject>, METH_O,
+			 "__setstate__(self, state: bytes, /) -> None\n--\nrestore from the image of __reduce__()"},
 			{nullptr, nullptr, 0, nullptr},
 		};
 
@@ -308,7 +320,9 @@ namespace iebpr
 			auto ret = RandConfigPyObjectType.tp_new(&RandConfigPyObjectType, nullptr, nullptr);               \
 			if (!ret)                                                                                          \
 				return (PyObject *)nullptr;                                                                    \
+			Py_BEGIN_CRITICAL_SECTION(self);                                                                   \
 			((RandConfigPyObject *)ret)->cdata = ((StateRandConfigPyObject *)self)->cdata.attr;                \
+			Py_END_CRITICAL_SECTION();                                                                         \
 			assert(offsetof(StateRandConfig, attr) / sizeof(Randomizer::RandConfig) < AgentState::arr_size()); \
 			return ret;                                                                                        \
 		},                                                                                                     \
@@ -316,7 +330,9 @@ namespace iebpr
 		{                                                                                                      \
 			if (!PyObject_IsInstance(value, (PyObject *)&RandConfigPyObjectType))                              \
 				return -1;                                                                                     \
+			Py_BEGIN_CRITICAL_SECTION2(self, value);                                                           \
 			((StateRandConfigPyObject *)self)->cdata.attr = ((RandConfigPyObject *)value)->cdata;              \
+			Py_END_CRITICAL_SECTION2();                                                                        \
 			assert(offsetof(StateRandConfig, attr) / sizeof(Randomizer::RandConfig) < AgentState::arr_size()); \
 			return 0;                                                                                          \
 		},                                                                                                     \
@@ -453,6 +469,10 @@ namespace iebpr
 		//======================================================================
 		// BINDING OF TraitRandConfig
 		static PyMethodDef TraitRandConfigPyObjectType_methods[] = {
+			{"__reduce__", config_reduce<TraitRandConfigPyObject>, METH_NOARGS,
+			 "__reduce__(self, /) -> tuple\n--\npickle support, as a compact binary image"},
+			{"__setstate__", config_setstate<TraitRandConfigPyObject>, METH_O,
+			 "__setstate__(self, state: bytes, /) -> None\n--\nrestore from the image of __reduce__()"},
 			{nullptr, nullptr, 0, nullptr},
 		};
 
@@ -468,7 +488,9 @@ namespace iebpr
 			auto ret = RandConfigPyObjectType.tp_new(&RandConfigPyObjectType, nullptr, nullptr);               \
 			if (!ret)                                                                                          \
 				return (PyObject *)nullptr;                                                                    \
+			Py_BEGIN_CRITICAL_SECTION(self);                                                                   \
 			((RandConfigPyObject *)ret)->cdata = ((TraitRandConfigPyObject *)self)->cdata.attr;                \
+			Py_END_CRITICAL_SECTION();                                                                         \
 			assert(offsetof(TraitRandConfig, attr) / sizeof(Randomizer::RandConfig) < AgentTrait::arr_size()); \
 			return ret;                                                                                        \
 		},                                                                                                     \
@@ -476,7 +498,9 @@ namespace iebpr
 		{                                                                                                      \
 			if (!PyObject_IsInstance(value, (PyObject *)&RandConfigPyObjectType))                              \
 				return -1;                                                                                     \
+			Py_BEGIN_CRITICAL_SECTION2(self, value);                                                           \
 			((TraitRandConfigPyObject *)self)->cdata.attr = ((RandConfigPyObject *)value)->cdata;              \
+			Py_END_CRITICAL_SECTION2();                                                                        \
 			assert(offsetof(TraitRandConfig, attr) / sizeof(Randomizer::RandConfig) < AgentTrait::arr_size()); \
 			return 0;                                                                                          \
 		},                                                                                                     \
@@ -352,12 +352,16 @@ namespace iebpr
 		}
 
 		static PyMethodDef SbrStagePyObjectType_methods[] = {
-			{"append_phase", SbrStagePyObjectType_method_append_phase, METH_O,
+			{"append_phase", locked_method<SbrStagePyObjectType_method_append_phase>, METH_O,
 			 "append_phase(self, SbrPhase) -> None\n--\nappend a phase config to the stage"},
-			{"clear_phase", SbrStagePyObjectType_method_clear_phase, METH_NOARGS,
+			{"clear_phase", locked_method<SbrStagePyObjectType_method_clear_phase>, METH_NOARGS,
 			 "clear_phase(self, /) -> None\n--\nclear current phase configs"},
-			{"is_flow_balanced", SbrStagePyObjectType_method_is_flow_balanced, METH_NOARGS,
+			{"is_flow_balanced", locked_method<SbrStagePyObjectType_method_is_flow_balanced>, METH_NOARGS,
 			 "is_flow_balanced(self, /) -> bool\n--\nreturn True if volumes of inflow and outflow + withdraw are balanced"},
+			{"__reduce__", config_reduce<SbrStagePyObject>, METH_NOARGS,
+			 "__reduce__(self, /) -> tuple\n--\npickle support, as a compact binary image"},
+			{"__setstate__", config_setstate<SbrStagePyObject>, METH_O,
+			 "__setstate__(self, state: bytes, /) -> None\n--\nrestore from the image of __reduce__()"},
 			{nullptr, nullptr, 0, nullptr},
 		};
 
@@ -458,13 +462,13 @@ namespace iebpr
 		}
 
 		static PyGetSetDef SbrStagePyObjectType_getsets[] = {
-			{"cycle_phases", SbrStagePyObjectType_get_cycle_phases,
-			 SbrStagePyObjectType_set_cycle_phases, "SBR phase configs <-> tuple[SbrPhase]", nullptr},
-			{"n_phase", SbrStagePyObjectType_get_n_phase,
+			{"cycle_phases", locked_getter<SbrStagePyObjectType_get_cycle_phases>,
+			 locked_setter<SbrStagePyObjectType_set_cycle_phases>, "SBR phase configs <-> tuple[SbrPhase]", nullptr},
+			{"n_phase", locked_getter<SbrStagePyObjectType_get_n_phase>,
 			 nullptr, "number of added phases in this stage -> int", nullptr},
-			{"cycle_time_len", SbrStagePyObjectType_get_cycle_time_len,
+			{"cycle_time_len", locked_getter<SbrStagePyObjectType_get_cycle_time_len>,
 			 nullptr, "time length per cycle in this stage -> float", nullptr},
-			{"total_time_len", SbrStagePyObjectType_get_total_time_len,
+			{"total_time_len", locked_getter<SbrStagePyObjectType_get_total_time_len>,
 			 nullptr, "total time length of this stage -> float", nullptr},
 			{nullptr, nullptr, nullptr, nullptr, nullptr},
 		};
@@ -5,6 +5,10 @@
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #define PY_ARRAY_UNIQUE_SYMBOL _IEBPR_NPY_API
 #include <numpy/ndarrayobject.h>
+#include <algorithm>
+#include <cstdlib>
+#include "iebpr/kernel_dispatch.hpp"
+#include "iebpr/pool_memory.hpp"
 #include "iebpr/python_interface_util.hpp"
 #include "iebpr/python_interface_datastruct.hpp"
 #include "iebpr/python_interface_agent_configs.hpp"
@@ -17,11 +21,222 @@ namespace iebpr
 		// these will be filled in by add_iebpr_exception()
 		PyObject *PyExc_IebprError = nullptr;
 		PyObject *PyExc_IebprPrerunValidateError = nullptr;
+		PyObject *PyExc_IebprRunStopped = nullptr;
+
+		//======================================================================
+		// MODULE METHODS
+		//======================================================================
+
+		static PyObject *_iebpr_method_get_kernel_isa(PyObject *self, PyObject *args)
+		{
+			return PyUnicode_FromString(KernelDispatch::isa_enum_to_name(KernelDispatch::selected_isa()));
+		}
+
+		static PyObject *_iebpr_method_set_kernel_isa(PyObject *self, PyObject *args)
+		{
+			const char *name = nullptr;
+			if (!PyArg_ParseTuple(args, "s", &name))
+				return nullptr;
+			auto isa = KernelDispatch::isa_name_to_enum(name);
+			if (isa == KernelDispatch::invalid)
+			{
+				PyErr_Format(PyExc_ValueError, "unknown instruction set '%s', choose from: generic, avx2, avx512", name);
+				return nullptr;
+			}
+			if (!KernelDispatch::select(isa))
+			{
+				PyErr_Format(PyExc_ValueError, "instruction set '%s' is not supported by this cpu or build", name);
+				return nullptr;
+			}
+			Py_RETURN_NONE;
+		}
+
+		static PyObject *_iebpr_method_get_memory_policy(PyObject *self, PyObject *args)
+		{
+			return Py_BuildValue("(ss)", PoolMemory::hugepage_enum_to_name(PoolMemory::hugepage()),
+								 PoolMemory::numa_enum_to_name(PoolMemory::numa()));
+		}
+
+		static PyObject *_iebpr_method_set_memory_policy(PyObject *self, PyObject *args)
+		{
+			const char *hugepage_name = nullptr, *numa_name = nullptr;
+			if (!PyArg_ParseTuple(args, "ss", &hugepage_name, &numa_name))
+				return nullptr;
+			auto hugepage = PoolMemory::hugepage_name_to_enum(hugepage_name);
+			if (hugepage == PoolMemory::hugepage_invalid)
+			{
+				PyErr_Format(PyExc_ValueError, "unknown huge page setting '%s', choose from: none, thp, 2m, 1g", hugepage_name);
+				return nullptr;
+			}
+			auto numa = PoolMemory::numa_name_to_enum(numa_name);
+			if (numa == PoolMemory::numa_invalid)
+			{
+				PyErr_Format(PyExc_ValueError, "unknown numa policy '%s', choose from: local, interleave", numa_name);
+				return nullptr;
+			}
+			PoolMemory::set_policy(hugepage, numa);
+			Py_RETURN_NONE;
+		}
+
+		// array of nd dims on data of view, read-only, which keeps view alive
+		static PyObject *_result_arena_array(PyObject *view, PyObject *descr, int nd,
+											 const npy_intp *dims, void *data)
+		{
+			// PyArray_NewFromDescr() steals a reference to descr
+			Py_INCREF(descr);
+			PyObject *ret = PyArray_NewFromDescr(&PyArray_Type, (PyArray_Descr *)descr, nd,
+												 (npy_intp *)dims, nullptr, data,
+												 NPY_ARRAY_CARRAY_RO, nullptr);
+			if (!ret)
+				return nullptr;
+			// PyArray_SetBaseObject() steals a reference to view
+			Py_INCREF(view);
+			if (PyArray_SetBaseObject((PyArrayObject *)ret, view))
+			{
+				Py_DECREF(ret);
+				return nullptr;
+			}
+			return ret;
+		}
+
+		static PyObject *_iebpr_method_map_result_arena(PyObject *self, PyObject *args, PyObject *kwargs)
+		{
+			PyObject *buffer = nullptr, *view = nullptr, *ret = nullptr, *t = nullptr;
+			Py_ssize_t offset = 0;
+			Py_buffer *b = nullptr;
+			const ResultArena::Header *header = nullptr;
+			const ResultArena::SubtypeEntry *subtypes = nullptr;
+			npy_intp n_state = 0, n_snapshot = 0;
+			static char *kwlist[] = {
+				(char *)"buffer",
+				(char *)"offset",
+				nullptr,
+			};
+			if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|n", kwlist, &buffer, &offset))
+				return nullptr;
+			// arrays are based on a memoryview of buffer, which then cannot be
+			// released (e.g. SharedMemory.close()) until they are deleted
+			view = PyMemoryView_FromObject(buffer);
+			if (!view)
+				return nullptr;
+			b = PyMemoryView_GET_BUFFER(view);
+			if (!PyBuffer_IsContiguous(b, 'C'))
+			{
+				PyErr_SetString(PyExc_ValueError, "buffer must be contiguous");
+				goto fail;
+			}
+			if ((offset < 0) || (offset > b->len))
+			{
+				PyErr_SetString(PyExc_ValueError, "offset out of buffer");
+				goto fail;
+			}
+			header = ResultArena::view((const char *)b->buf + offset, b->len - offset,
+									   sizeof(EnvStateRecEntry), sizeof(AgentStateRecEntry));
+			if (!header)
+			{
+				PyErr_SetString(PyExc_ValueError, "no result arena at offset of buffer, "
+												  "or written by an incompatible build");
+				goto fail;
+			}
+			subtypes = (const ResultArena::SubtypeEntry *)(header + 1);
+			n_state = std::min(header->n_state_taken.load(std::memory_order_acquire), header->n_state_rec);
+			n_snapshot = std::min(header->n_snapshot_taken.load(std::memory_order_acquire),
+								  header->n_snapshot_rec);
+			ret = PyTuple_New(3);
+			if (!ret)
+				goto fail;
+			{
+				const npy_intp dims[] = {n_state, (npy_intp)header->n_subtype};
+				if (!(t = _result_arena_array(view, EnvStateRecDescr, 1, dims,
+											  (char *)header + header->env_offset)))
+					goto fail;
+				PyTuple_SET_ITEM(ret, 0, t);
+				if (!(t = _result_arena_array(view, AgentStateRecDescr, 2, dims,
+											  (char *)header + header->agent_offset)))
+					goto fail;
+				PyTuple_SET_ITEM(ret, 1, t);
+			}
+			if (!(t = PyTuple_New(header->n_subtype)))
+				goto fail;
+			PyTuple_SET_ITEM(ret, 2, t);
+			for (uint32_t i = 0; i < header->n_subtype; i++)
+			{
+				const npy_intp dims[] = {n_snapshot, (npy_intp)subtypes[i].n_agent};
+				PyObject *a = _result_arena_array(view, AgentStateRecDescr, 2, dims,
+												  (char *)header + subtypes[i].snapshot_offset);
+				if (!a)
+					goto fail;
+				PyTuple_SET_ITEM(t, i, a);
+			}
+			Py_DECREF(view);
+			return ret;
+		fail:
+			Py_XDECREF(ret);
+			Py_DECREF(view);
+			return nullptr;
+		}
 
 		static PyMethodDef _iebpr_methods[] = {
+			{"get_kernel_isa", _iebpr_method_get_kernel_isa, METH_NOARGS,
+			 PyDoc_STR("get_kernel_isa() -> str\n\n"
+					   "instruction set of the selected agent pool kernels, the best supported\n"
+					   "by the cpu unless forced by environment variable IEBPR_ISA at import")},
+			{"set_kernel_isa", _iebpr_method_set_kernel_isa, METH_VARARGS,
+			 PyDoc_STR("set_kernel_isa(isa: str) -> None\n\n"
+					   "select agent pool kernels of instruction set generic, avx2 or avx512;\n"
+					   "these are dilution scaling and state summary, and the agent kinetics of\n"
+					   "ReplicateBatch; agent kinetics of Simulation.run() are not dispatched\n"
+					   "and stay compiled for the build target; results are identical, not to\n"
+					   "be called during a run")},
+			{"get_memory_policy", _iebpr_method_get_memory_policy, METH_NOARGS,
+			 PyDoc_STR("get_memory_policy() -> tuple[str, str]\n\n"
+					   "huge page setting and numa policy of agent pool and record buffers, set\n"
+					   "by environment variables IEBPR_HUGEPAGES and IEBPR_NUMA at import")},
+			{"set_memory_policy", _iebpr_method_set_memory_policy, METH_VARARGS,
+			 PyDoc_STR("set_memory_policy(hugepages: str, numa: str) -> None\n\n"
+					   "set huge pages (none, thp, 2m or 1g) and numa policy (local or\n"
+					   "interleave) of agent pool and record buffers allocated from now on;\n"
+					   "buffers under 2 MB are always on the heap, unavailable huge pages fall\n"
+					   "back to smaller ones, and results are identical")},
+			{"map_result_arena", (PyCFunction)(void (*)(void))_iebpr_method_map_result_arena,
+			 METH_VARARGS | METH_KEYWORDS,
+			 PyDoc_STR("map_result_arena(buffer, offset: int = 0) -> tuple[numpy.ndarray, numpy.ndarray, tuple[numpy.ndarray]]\n\n"
+					   "map records written by a Simulation into a result arena at offset of\n"
+					   "buffer (e.g. multiprocessing.shared_memory.SharedMemory.buf), see\n"
+					   "Simulation.result_shm; returns read-only arrays on buffer, without copies,\n"
+					   "of the records taken so far, the same as retrieve_env_state_rec(),\n"
+					   "retrieve_agent_state_rec() and retrieve_snapshot_rec(); buffer cannot be\n"
+					   "released until the arrays are deleted")},
 			{nullptr, nullptr, 0, nullptr},
 		};
 
+		// warn if IEBPR_ISA is set but could not be honored
+		static int check_kernel_isa_env(void)
+		{
+			const char *env = std::getenv("IEBPR_ISA");
+			if ((!env) || (!*env))
+				return 0;
+			if (KernelDispatch::isa_name_to_enum(env) == KernelDispatch::selected_isa())
+				return 0;
+			return PyErr_WarnFormat(PyExc_RuntimeWarning, 1,
+									"IEBPR_ISA=%s is unknown or not supported, using %s", env,
+									KernelDispatch::isa_enum_to_name(KernelDispatch::selected_isa()));
+		}
+
+		// warn if IEBPR_HUGEPAGES or IEBPR_NUMA is set but unknown
+		static int check_memory_policy_env(void)
+		{
+			const char *env = std::getenv("IEBPR_HUGEPAGES");
+			if (env && *env && (PoolMemory::hugepage_name_to_enum(env) == PoolMemory::hugepage_invalid) &&
+				PyErr_WarnFormat(PyExc_RuntimeWarning, 1, "IEBPR_HUGEPAGES=%s is unknown, using none", env))
+				return -1;
+			env = std::getenv("IEBPR_NUMA");
+			if (env && *env && (PoolMemory::numa_name_to_enum(env) == PoolMemory::numa_invalid) &&
+				PyErr_WarnFormat(PyExc_RuntimeWarning, 1, "IEBPR_NUMA=%s is unknown, using local", env))
+				return -1;
+			return 0;
+		}
+
 		//======================================================================
 		// MODULE DEF
 		//======================================================================
@@ -102,6 +317,12 @@ extern "C"
 		PyObject *m = PyModule_Create(&iebpr::python_interface::_iebpr_def);
 		if (!m)
 			goto module_new_fail;
+#ifdef Py_GIL_DISABLED
+		// free-threaded build: objects are guarded by critical sections and
+		// runs by SimulationPyObject::running, so keep the gil disabled
+		if (PyUnstable_Module_SetGIL(m, Py_MOD_GIL_NOT_USED))
+			goto module_add_member_fail;
+#endif
 
 		// add exception types
 		if (iebpr::python_interface::add_iebpr_exception(m, "iebpr._iebpr.IebprError",
@@ -116,6 +337,12 @@ extern "C"
 														 &iebpr::python_interface::PyExc_IebprPrerunValidateError))
 			goto module_add_member_fail;
 
+		if (iebpr::python_interface::add_iebpr_exception(m, "iebpr._iebpr.IebprRunStopped",
+														 iebpr::python_interface::PyExc_IebprError,
+														 nullptr,
+														 &iebpr::python_interface::PyExc_IebprRunStopped))
+			goto module_add_member_fail;
+
 		// add wrapped c++ classes to module
 		if (iebpr::python_interface::module_bind_datastructs(m) ||
 			iebpr::python_interface::module_bind_agent_configs(m) ||
@@ -135,6 +362,10 @@ extern "C"
 			iebpr::python_interface::module_add_randtype_enum(m, iebpr::Simulation::rand_t::obsvalues))
 			goto module_add_member_fail;
 
+		if (iebpr::python_interface::check_kernel_isa_env() ||
+			iebpr::python_interface::check_memory_policy_env())
+			goto module_add_member_fail;
+
 		return m;
 	module_add_member_fail:
 		Py_DECREF(m);
@@ -3,6 +3,8 @@
 #include <cstring>
 #include <sstream>
 #include <cstdarg>
+#include <system_error>
+#include <thread>
 // numpy stuff
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #define PY_ARRAY_UNIQUE_SYMBOL _IEBPR_NPY_API
@@ -56,6 +58,84 @@ namespace iebpr
 
 		using simutype_enum = decltype(SbrControl::simutype);
 
+		//======================================================================
+		// LOCKING
+		// mark self running, for a run of cdata without the gil; return false
+		// and set RuntimeError if it is running already
+		static bool acquire_run(PyObject *self)
+		{
+			bool acquired = false;
+			// ordered with idle_*() on self
+			Py_BEGIN_CRITICAL_SECTION(self);
+			acquired = !((SimulationPyObject *)self)->running.exchange(true);
+			Py_END_CRITICAL_SECTION();
+			if (!acquired)
+				PyErr_SetString(PyExc_RuntimeError, "simulation is running, wait for it to finish first");
+			return acquired;
+		}
+
+		static void release_run(PyObject *self)
+		{
+			((SimulationPyObject *)self)->running.store(false);
+			return;
+		}
+
+		// return false and set RuntimeError if self is running
+		static bool check_not_running(PyObject *self)
+		{
+			if (!((SimulationPyObject *)self)->running.load())
+				return true;
+			PyErr_SetString(PyExc_RuntimeError, "simulation is running, wait for it to finish first");
+			return false;
+		}
+
+		// as locked_*(), and raise RuntimeError while self is running; for
+		// setters and methods of what a run reads, and getters of what a run
+		// writes
+		template <PyObject *(*F)(PyObject *, void *)>
+		static PyObject *idle_getter(PyObject *self, void *closure)
+		{
+			PyObject *ret = nullptr;
+			Py_BEGIN_CRITICAL_SECTION(self);
+			if (check_not_running(self))
+				ret = F(self, closure);
+			Py_END_CRITICAL_SECTION();
+			return ret;
+		}
+
+		template <int (*F)(PyObject *, PyObject *, void *)>
+		static int idle_setter(PyObject *self, PyObject *value, void *closure)
+		{
+			int ret = -1;
+			Py_BEGIN_CRITICAL_SECTION(self);
+			if (check_not_running(self))
+				ret = F(self, value, closure);
+			Py_END_CRITICAL_SECTION();
+			return ret;
+		}
+
+		template <PyObject *(*F)(PyObject *, PyObject *)>
+		static PyObject *idle_method(PyObject *self, PyObject *args)
+		{
+			PyObject *ret = nullptr;
+			Py_BEGIN_CRITICAL_SECTION(self);
+			if (check_not_running(self))
+				ret = F(self, args);
+			Py_END_CRITICAL_SECTION();
+			return ret;
+		}
+
+		template <PyObject *(*F)(PyObject *, PyObject *, PyObject *)>
+		static PyObject *idle_method_kw(PyObject *self, PyObject *args, PyObject *kwargs)
+		{
+			PyObject *ret = nullptr;
+			Py_BEGIN_CRITICAL_SECTION(self);
+			if (check_not_running(self))
+				ret = F(self, args, kwargs);
+			Py_END_CRITICAL_SECTION();
+			return ret;
+		}
+
 		//======================================================================
 		// BINDING OF Simulation
 		static PyObject *SimulationPyObjectType_method_append_sbr_stage(PyObject *self, PyObject *args)
@@ -67,7 +147,9 @@ namespace iebpr
 							 Py_TYPE(args)->tp_name);
 				goto fail_decref;
 			}
+			Py_BEGIN_CRITICAL_SECTION(args);
 			((SimulationPyObject *)self)->cdata.append_sbr_stage(((SbrStagePyObject *)args)->cdata);
+			Py_END_CRITICAL_SECTION();
 			Py_DECREF(args);
 			Py_RETURN_NONE;
 		fail_decref:
@@ -133,7 +215,9 @@ namespace iebpr
 							 Simulation::subtype_enum_to_name(subtype), subtype);
 				goto fail_decref;
 			}
+			Py_BEGIN_CRITICAL_SECTION2(state_cfg, trait_cfg);
 			((SimulationPyObject *)self)->cdata.add_agent_subtype(subtype, n_agent, ((StateRandConfigPyObject *)state_cfg)->cdata, ((TraitRandConfigPyObject *)trait_cfg)->cdata);
+			Py_END_CRITICAL_SECTION2();
 			Py_DECREF(state_cfg);
 			Py_DECREF(trait_cfg);
 			Py_RETURN_NONE;
@@ -285,10 +369,10 @@ namespace iebpr
 			Py_RETURN_NONE;
 		}
 
-		static PyObject *SimulationPyObjectType_method_run(PyObject *self, PyObject *args)
+		// set python exception from error number, return nullptr if an exception
+		// is set, or Py_None (new ref) on no error
+		static PyObject *set_exception_from_error_enum(PyObject *self, error_enum ec)
 		{
-			auto ec = ((SimulationPyObject *)self)->cdata.run();
-			// post run error number interpretation
 			switch (ec)
 			{
 			case none:
@@ -311,6 +395,15 @@ namespace iebpr
 			case invalid_timestep:
 				PyErr_Format(PyExc_IebprPrerunValidateError, "(ERROR 0x%x) timestep <= 0", ec);
 				break;
+			case stage_index_out_of_range:
+				PyErr_Format(PyExc_IndexError, "(ERROR 0x%x) stage or phase index out of range", ec);
+				break;
+			case stage_already_started:
+				PyErr_Format(PyExc_IebprError, "(ERROR 0x%x) stage has already started in the current run\n"
+											   "only later stages can be replaced, and only phases of the current "
+											   "stage with unchanged time_len",
+							 ec);
+				break;
 			case invalid_init_volume:
 				PyErr_Format(PyExc_IebprPrerunValidateError, "(ERROR 0x%x) init sbr living volume <= 0", ec);
 				break;
@@ -327,6 +420,10 @@ namespace iebpr
 			case bool_trait_wrong_rand_type:
 				PyErr_Format(PyExc_IebprPrerunValidateError, "(ERROR 0x%x) agent bool trait random type is not bernoulli/none", ec);
 				break;
+			case pool_backing_dir_unusable:
+				PyErr_Format(PyExc_IebprPrerunValidateError, "(ERROR 0x%x) cannot create agent pool backing file in '%s'",
+							 ec, ((SimulationPyObject *)self)->cdata.get_pool_backing_dir().c_str());
+				break;
 			case rec_time_exceed_simulation:
 				PyErr_Format(PyExc_IebprPrerunValidateError, "(ERROR 0x%x) recording time exceeds simulation time range (0-%.3f)",
 							 ec, ((SimulationPyObject *)self)->cdata.total_time_len());
@@ -334,10 +431,71 @@ namespace iebpr
 			case rec_step_smaller_than_timestep:
 				PyErr_Format(PyExc_IebprPrerunValidateError, "(ERROR 0x%x) recording step smaller than timestep", ec);
 				break;
+			case result_arena_io_error:
+				PyErr_Format(PyExc_IebprError, "(ERROR 0x%x) failed to open or map result_shm", ec);
+				break;
+			case result_arena_too_small:
+				PyErr_Format(PyExc_IebprError, "(ERROR 0x%x) result_shm is smaller than result_shm_offset + result_arena_bytes", ec);
+				break;
+			case result_arena_misaligned:
+				PyErr_Format(PyExc_IebprError, "(ERROR 0x%x) result_shm_offset is not a multiple of %u", ec,
+							 (unsigned)ResultArena::align);
+				break;
 			case sigint:
 				PyErr_SetInterrupt();
 				PyErr_CheckSignals();
 				break;
+			case trace_io_error:
+				PyErr_Format(PyExc_IebprError, "(ERROR 0x%x) failed to write trace file", ec);
+				break;
+			case checkpoint_io_error:
+				PyErr_Format(PyExc_IebprError, "(ERROR 0x%x) failed to read/write checkpoint file", ec);
+				break;
+			case checkpoint_bad_format:
+				PyErr_Format(PyExc_IebprError, "(ERROR 0x%x) bad checkpoint file format\n"
+											   "may caused by data corruption or checkpoint saved by an incompatible build",
+							 ec);
+				break;
+			case checkpoint_version_mismatch:
+				PyErr_Format(PyExc_IebprError, "(ERROR 0x%x) unsupported checkpoint file version", ec);
+				break;
+			case checkpoint_config_mismatch:
+				PyErr_Format(PyExc_IebprError, "(ERROR 0x%x) checkpoint does not match current simulation configs\n"
+											   "stages, agent subtypes, recording timepoints, timestep and simulation type "
+											   "must be set the same as when the checkpoint was saved",
+							 ec);
+				break;
+			case checkpoint_not_initialized:
+				PyErr_Format(PyExc_IebprError, "(ERROR 0x%x) no simulation progress to save, resume or fork from\n"
+											   "call run() or load_checkpoint() first",
+							 ec);
+				break;
+			case replicate_not_discrete:
+				PyErr_Format(PyExc_IebprPrerunValidateError, "(ERROR 0x%x) replicates must be of discrete simulation type", ec);
+				break;
+			case replicate_config_mismatch:
+				PyErr_Format(PyExc_IebprPrerunValidateError, "(ERROR 0x%x) replicates do not share the same configs\n"
+															 "timestep, hydraulics, init env, stages, agent subtypes and recording "
+															 "timepoints must be set the same, and each replicate must be a distinct simulation",
+							 ec);
+				break;
+			case replicate_aggregation_enabled:
+				PyErr_Format(PyExc_IebprPrerunValidateError, "(ERROR 0x%x) replicates cannot run in lockstep with adaptive aggregation\n"
+															 "set aggregate_tolerance to 0",
+							 ec);
+				break;
+			case run_cancelled:
+				PyErr_Format(PyExc_IebprRunStopped, "(ERROR 0x%x) run cancelled, call resume() to continue", ec);
+				break;
+			case run_step_budget_exhausted:
+				PyErr_Format(PyExc_IebprRunStopped, "(ERROR 0x%x) run stopped after max_steps, call resume() to continue", ec);
+				break;
+			case run_time_budget_exhausted:
+				PyErr_Format(PyExc_IebprRunStopped, "(ERROR 0x%x) run stopped after max_wall_time, call resume() to continue", ec);
+				break;
+			case run_deadline_exceeded:
+				PyErr_Format(PyExc_IebprRunStopped, "(ERROR 0x%x) run stopped at deadline, call resume() to continue", ec);
+				break;
 			default:
 				PyErr_Format(PyExc_IebprPrerunValidateError, "(ERROR 0x%x) uncategorized error");
 				break;
@@ -348,6 +506,424 @@ namespace iebpr
 			Py_RETURN_NONE;
 		}
 
+		// run fn(cdata) of self without the gil, so that other threads, and runs
+		// of other simulations, go on meanwhile
+		template <typename Fn>
+		static PyObject *run_without_gil(PyObject *self, Fn fn)
+		{
+			error_enum ec = none;
+			if (!acquire_run(self))
+				return nullptr;
+			Py_BEGIN_ALLOW_THREADS;
+			ec = fn(((SimulationPyObject *)self)->cdata);
+			Py_END_ALLOW_THREADS;
+			release_run(self);
+			// post run error number interpretation
+			return set_exception_from_error_enum(self, ec);
+		}
+
+		static PyObject *SimulationPyObjectType_method_run(PyObject *self, PyObject *args)
+		{
+			return run_without_gil(self, [](Simulation &cdata)
+								   { return cdata.run(); });
+		}
+
+		static PyObject *SimulationPyObjectType_method_resume(PyObject *self, PyObject *args)
+		{
+			return run_without_gil(self, [](Simulation &cdata)
+								   { return cdata.resume(); });
+		}
+
+		static PyObject *SimulationPyObjectType_method_set_sbr_stage(PyObject *self, PyObject *args)
+		{
+			Py_ssize_t index;
+			PyObject *stage = nullptr;
+			error_enum ec = none;
+			if (!PyArg_ParseTuple(args, "nO!", &index, SbrStagePyObject::type, &stage))
+				return nullptr;
+			if (index < 0)
+				index += ((SimulationPyObject *)self)->cdata.sbr.n_stage();
+			if (index < 0)
+				return set_exception_from_error_enum(self, stage_index_out_of_range);
+			Py_BEGIN_CRITICAL_SECTION(stage);
+			ec = ((SimulationPyObject *)self)->cdata.set_sbr_stage(index, ((SbrStagePyObject *)stage)->cdata);
+			Py_END_CRITICAL_SECTION();
+			return set_exception_from_error_enum(self, ec);
+		}
+
+		static PyObject *SimulationPyObjectType_method_set_sbr_phase(PyObject *self, PyObject *args)
+		{
+			Py_ssize_t stage_index, phase_index;
+			PyObject *phase = nullptr;
+			if (!PyArg_ParseTuple(args, "nnO!", &stage_index, &phase_index, SbrPhasePyObject::type, &phase))
+				return nullptr;
+			if ((stage_index < 0) || (phase_index < 0))
+				return set_exception_from_error_enum(self, stage_index_out_of_range);
+			auto ec = ((SimulationPyObject *)self)->cdata.set_sbr_phase(stage_index, phase_index,
+																	   ((SbrPhasePyObject *)phase)->cdata);
+			return set_exception_from_error_enum(self, ec);
+		}
+
+		static PyObject *SimulationPyObjectType_method_advance(PyObject *self, PyObject *args)
+		{
+			unsigned long long n_step;
+			if (!PyArg_ParseTuple(args, "K", &n_step))
+				return nullptr;
+			return run_without_gil(self, [n_step](Simulation &cdata)
+								   { return cdata.advance(n_step); });
+		}
+
+		static PyObject *SimulationPyObjectType_method_run_until(PyObject *self, PyObject *args)
+		{
+			double time;
+			if (!PyArg_ParseTuple(args, "d", &time))
+				return nullptr;
+			return run_without_gil(self, [time](Simulation &cdata)
+								   { return cdata.run_until(time); });
+		}
+
+		static PyObject *SimulationPyObjectType_method_cancel(PyObject *self, PyObject *args)
+		{
+			((SimulationPyObject *)self)->cdata.run_control.cancel();
+			Py_RETURN_NONE;
+		}
+
+		//======================================================================
+		// ASYNC RUN
+		// set result of future, unless it is done (i.e. cancelled) meanwhile;
+		// called in the event loop by call_soon_threadsafe()
+		static PyObject *_async_set_result(PyObject *, PyObject *args)
+		{
+			PyObject *future = nullptr, *exc = nullptr, *done = nullptr, *ret = nullptr;
+			if (!PyArg_ParseTuple(args, "OO", &future, &exc))
+				return nullptr;
+			done = PyObject_CallMethod(future, "done", nullptr);
+			if (!done)
+				return nullptr;
+			if (PyObject_IsTrue(done))
+				ret = Py_NewRef(Py_None);
+			else if (Py_IsNone(exc))
+				ret = PyObject_CallMethod(future, "set_result", "O", Py_None);
+			else
+				ret = PyObject_CallMethod(future, "set_exception", "O", exc);
+			Py_DECREF(done);
+			return ret;
+		}
+
+		static PyMethodDef _async_set_result_def = {
+			"_async_set_result", _async_set_result, METH_VARARGS, nullptr};
+
+		// done callback of the future, bound to the simulation; cancelling the
+		// future cancels the run
+		static PyObject *_async_on_done(PyObject *self, PyObject *future)
+		{
+			auto cancelled = PyObject_CallMethod(future, "cancelled", nullptr);
+			if (!cancelled)
+				return nullptr;
+			if (PyObject_IsTrue(cancelled))
+				((SimulationPyObject *)self)->cdata.run_control.cancel();
+			Py_DECREF(cancelled);
+			Py_RETURN_NONE;
+		}
+
+		static PyMethodDef _async_on_done_def = {
+			"_async_on_done", _async_on_done, METH_O, nullptr};
+
+		// worker thread of run_async(); runs without the gil, then hands the
+		// result to the event loop; owns a reference of self, loop and future
+		static void _async_worker(PyObject *self, PyObject *loop, PyObject *future, bool resume)
+		{
+			auto &cdata = ((SimulationPyObject *)self)->cdata;
+			// sigint is left to the event loop, cancel the future instead
+			const auto ec = resume ? cdata.resume(true) : cdata.run(true);
+
+			auto gil = PyGILState_Ensure();
+			PyObject *exc = nullptr, *exc_type = nullptr, *exc_tb = nullptr, *func = nullptr, *ret = nullptr;
+			if ((ret = set_exception_from_error_enum(self, ec)))
+				exc = Py_NewRef(Py_None);
+			else
+			{
+				PyErr_Fetch(&exc_type, &exc, &exc_tb);
+				PyErr_NormalizeException(&exc_type, &exc, &exc_tb);
+				if (exc && exc_tb)
+					PyException_SetTraceback(exc, exc_tb);
+				Py_XDECREF(exc_type);
+				Py_XDECREF(exc_tb);
+				if (!exc)
+					exc = Py_NewRef(Py_None);
+			}
+			Py_XDECREF(ret);
+			release_run(self);
+			func = PyCFunction_New(&_async_set_result_def, nullptr);
+			ret = func ? PyObject_CallMethod(loop, "call_soon_threadsafe", "OOO", func, future, exc) : nullptr;
+			// e.g. the loop is closed
+			if (!ret)
+				PyErr_WriteUnraisable(loop);
+			Py_XDECREF(ret);
+			Py_XDECREF(func);
+			Py_DECREF(exc);
+			Py_DECREF(future);
+			Py_DECREF(loop);
+			Py_DECREF(self);
+			PyGILState_Release(gil);
+			return;
+		}
+
+		static PyObject *SimulationPyObjectType_method_run_async(PyObject *self, PyObject *args, PyObject *kwargs)
+		{
+			int resume = 0;
+			PyObject *asyncio = nullptr, *loop = nullptr, *future = nullptr, *on_done = nullptr, *ret = nullptr;
+			static char *kwlist[] = {
+				(char *)"resume",
+				nullptr,
+			};
+			if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|$p", kwlist, &resume))
+				return nullptr;
+			if (!(asyncio = PyImport_ImportModule("asyncio")))
+				goto fail;
+			if (!(loop = PyObject_CallMethod(asyncio, "get_running_loop", nullptr)))
+				goto fail;
+			if (!(future = PyObject_CallMethod(loop, "create_future", nullptr)))
+				goto fail;
+			if (!(on_done = PyCFunction_New(&_async_on_done_def, self)))
+				goto fail;
+			if (!(ret = PyObject_CallMethod(future, "add_done_callback", "O", on_done)))
+				goto fail;
+			Py_DECREF(ret);
+
+			if (!acquire_run(self))
+				goto fail;
+			// references for the worker
+			Py_INCREF(self);
+			Py_INCREF(loop);
+			Py_INCREF(future);
+			try
+			{
+				std::thread(_async_worker, self, loop, future, (bool)resume).detach();
+			}
+			catch (const std::system_error &)
+			{
+				release_run(self);
+				Py_DECREF(self);
+				Py_DECREF(loop);
+				Py_DECREF(future);
+				PyErr_SetString(PyExc_RuntimeError, "failed to start worker thread");
+				goto fail;
+			}
+			Py_DECREF(on_done);
+			Py_DECREF(loop);
+			Py_DECREF(asyncio);
+			return future;
+		fail:
+			Py_XDECREF(on_done);
+			Py_XDECREF(future);
+			Py_XDECREF(loop);
+			Py_XDECREF(asyncio);
+			return nullptr;
+		}
+
+		static PyObject *SimulationPyObjectType_method_run_replicates(PyObject *self, PyObject *args)
+		{
+			error_enum ec = none;
+			// a tuple copy holds the replicates, which may be removed from args
+			// by other threads during the run
+			PyObject *seq = PySequence_Tuple(args);
+			if (!seq)
+				return nullptr;
+			// replicates acquired by acquire_run()
+			auto replicates = std::vector<Simulation *>(0);
+			for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(seq); i++)
+			{
+				PyObject *o = PyTuple_GET_ITEM(seq, i);
+				if (!PyObject_IsInstance(o, (PyObject *)SimulationPyObject::type))
+				{
+					PyErr_Format(PyExc_TypeError, "must be Simulation, not '%s'",
+								 Py_TYPE(o)->tp_name);
+					goto fail_release;
+				}
+				if (!acquire_run(o))
+					goto fail_release;
+				replicates.push_back(&((SimulationPyObject *)o)->cdata);
+			}
+			if (replicates.empty())
+				goto success_decref;
+			Py_BEGIN_ALLOW_THREADS;
+			ec = ReplicateBatch::run(replicates);
+			Py_END_ALLOW_THREADS;
+			for (size_t i = 0; i < replicates.size(); i++)
+				release_run(PyTuple_GET_ITEM(seq, i));
+			if (ec)
+			{
+				// messages may refer to the first replicate
+				set_exception_from_error_enum(PyTuple_GET_ITEM(seq, 0), ec);
+				goto fail_decref;
+			}
+		success_decref:
+			Py_DECREF(seq);
+			Py_RETURN_NONE;
+		fail_release:
+			for (size_t i = 0; i < replicates.size(); i++)
+				release_run(PyTuple_GET_ITEM(seq, i));
+		fail_decref:
+			Py_DECREF(seq);
+			return nullptr;
+		}
+
+		static PyObject *SimulationPyObjectType_method_save_checkpoint(PyObject *self, PyObject *args)
+		{
+			PyObject *path = nullptr;
+			if (!PyUnicode_FSConverter(args, &path))
+				return nullptr;
+			auto ec = ((SimulationPyObject *)self)->cdata.save_checkpoint(PyBytes_AS_STRING(path));
+			Py_DECREF(path);
+			return set_exception_from_error_enum(self, ec);
+		}
+
+		static PyObject *SimulationPyObjectType_method_load_checkpoint(PyObject *self, PyObject *args)
+		{
+			PyObject *path = nullptr;
+			if (!PyUnicode_FSConverter(args, &path))
+				return nullptr;
+			auto ec = ((SimulationPyObject *)self)->cdata.load_checkpoint(PyBytes_AS_STRING(path));
+			Py_DECREF(path);
+			return set_exception_from_error_enum(self, ec);
+		}
+
+		static PyObject *SimulationPyObjectType_method_reduce_ex(PyObject *self, PyObject *args)
+		{
+			PyObject *state = nullptr, *buffer = nullptr;
+			auto buf = std::vector<char>(0);
+			auto blocks = std::vector<BinBlock>(0);
+			error_enum ec = none;
+			long protocol = PyLong_AsLong(args);
+			if ((protocol == -1) && PyErr_Occurred())
+				return nullptr;
+			if (protocol < 5)
+			{
+				// all data in band
+				BinWriter writer(buf);
+				if ((ec = ((SimulationPyObject *)self)->cdata.save_image(writer)))
+					return set_exception_from_error_enum(self, ec);
+				state = PyBytes_FromStringAndSize(buf.data(), buf.size());
+				goto success;
+			}
+			else
+			{
+				// large vectors (agent data and records) as out-of-band
+				// buffers; copied once, as they are rewritten by later runs
+				BinWriter writer(buf, blocks);
+				if ((ec = ((SimulationPyObject *)self)->cdata.save_image(writer)))
+					return set_exception_from_error_enum(self, ec);
+			}
+			state = PyTuple_New(blocks.size() + 1);
+			if (!state)
+				return nullptr;
+			if (!(buffer = PyBytes_FromStringAndSize(buf.data(), buf.size())))
+				goto fail;
+			PyTuple_SET_ITEM(state, 0, buffer);
+			for (size_t i = 0; i < blocks.size(); i++)
+			{
+				PyObject *copy = PyByteArray_FromStringAndSize((const char *)blocks[i].data,
+															   blocks[i].size);
+				if (!copy)
+					goto fail;
+				buffer = PyPickleBuffer_FromObject(copy);
+				Py_DECREF(copy);
+				if (!buffer)
+					goto fail;
+				PyTuple_SET_ITEM(state, i + 1, buffer);
+			}
+		success:
+			return Py_BuildValue("(O()N)", Py_TYPE(self), state);
+		fail:
+			Py_DECREF(state);
+			return nullptr;
+		}
+
+		static PyObject *SimulationPyObjectType_method_setstate(PyObject *self, PyObject *args)
+		{
+			error_enum ec = none;
+			bool is_tuple = PyTuple_Check(args);
+			Py_ssize_t n_view = is_tuple ? PyTuple_GET_SIZE(args) : 1;
+			// views[0] is the image, the others are blocks
+			auto views = std::vector<Py_buffer>(n_view);
+			auto blocks = std::vector<BinBlock>(0);
+			Py_ssize_t n_acquired = 0;
+			if (n_view < 1)
+			{
+				PyErr_SetString(PyExc_ValueError, "bad pickled state of Simulation");
+				return nullptr;
+			}
+			for (; n_acquired < n_view; n_acquired++)
+			{
+				PyObject *o = is_tuple ? PyTuple_GET_ITEM(args, n_acquired) : args;
+				if (PyObject_GetBuffer(o, &views[n_acquired], PyBUF_SIMPLE))
+					goto fail;
+				if (n_acquired)
+					blocks.push_back({views[n_acquired].buf, (size_t)views[n_acquired].len});
+			}
+			{
+				auto load = [self](BinReader &reader)
+				{
+					auto ec = ((SimulationPyObject *)self)->cdata.load_image(reader);
+					return ((ec == none) && (reader.remain() != 0)) ? checkpoint_bad_format : ec;
+				};
+				// large vectors are only out of band in a tuple (protocol 5),
+				// in band in bytes (protocol < 5 and copy.deepcopy())
+				if (is_tuple)
+				{
+					BinReader reader(views[0].buf, views[0].len, blocks);
+					ec = load(reader);
+				}
+				else
+				{
+					BinReader reader(views[0].buf, views[0].len);
+					ec = load(reader);
+				}
+			}
+			for (Py_ssize_t i = 0; i < n_acquired; i++)
+				PyBuffer_Release(&views[i]);
+			return set_exception_from_error_enum(self, ec);
+		fail:
+			for (Py_ssize_t i = 0; i < n_acquired; i++)
+				PyBuffer_Release(&views[i]);
+			return nullptr;
+		}
+
+		static PyObject *SimulationPyObjectType_method_fork(PyObject *self, PyObject *args, PyObject *kwargs)
+		{
+			PyObject *seed = nullptr, *branch = nullptr;
+			int same_stream = 0;
+			static char *kwlist[] = {
+				(char *)"seed",
+				(char *)"same_stream",
+				nullptr,
+			};
+			if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|$Op", kwlist, &seed, &same_stream))
+				goto fail;
+			branch = PyObject_CallNoArgs((PyObject *)SimulationPyObject::type);
+			if (!branch)
+				goto fail;
+			if (auto ec = ((SimulationPyObject *)self)->cdata.fork(((SimulationPyObject *)branch)->cdata, same_stream))
+			{
+				set_exception_from_error_enum(self, ec);
+				goto fail_decref;
+			}
+			// reseed branch to use its own random sequence
+			if (seed && (!Py_IsNone(seed)))
+			{
+				auto seed_value = PyLong_AsUnsignedLongLong(seed);
+				if (PyErr_Occurred())
+					goto fail_decref;
+				((SimulationPyObject *)branch)->cdata.set_seed((Randomizer::seed_t)seed_value);
+			}
+			return branch;
+		fail_decref:
+			Py_DECREF(branch);
+		fail:
+			return nullptr;
+		}
+
 		static PyObject *SimulationPyObjectType_method_get_run_duration(PyObject *self, PyObject *args)
 		{
 			PyErr_WarnEx(PyExc_DeprecationWarning, "get_run_duration() is deprecated and will be removed in future; use data descriptor last_run_duration instead", 1);
@@ -361,7 +937,8 @@ namespace iebpr
 			const Py_intptr_t dims[1] = {
 				(Py_intptr_t)(vec.size())};
 			EnvStateRecEntry *d_ptr = nullptr;
-			// create numpy object
+			// create numpy object; PyArray_Zeros() steals a reference to descr
+			Py_INCREF(EnvStateRecDescr);
 			PyObject *ret = PyArray_Zeros(1, dims, (PyArray_Descr *)EnvStateRecDescr, 0);
 			if (!ret)
 				goto fail;
@@ -387,7 +964,8 @@ namespace iebpr
 				(Py_intptr_t)(vec.size()),
 				(Py_intptr_t)(vec.size() ? vec[0].size() : 0)};
 			AgentStateRecEntry *d_ptr;
-			// create numpy object
+			// create numpy object; PyArray_Zeros() steals a reference to descr
+			Py_INCREF(AgentStateRecDescr);
 			PyObject *ret = PyArray_Zeros(2, dims, (PyArray_Descr *)AgentStateRecDescr, 0);
 			if (!ret)
 				goto fail;
@@ -422,7 +1000,8 @@ namespace iebpr
 					(Py_intptr_t)(vec[i].size()),
 					(Py_intptr_t)(vec[i].size() ? vec[i][0].size() : 0)};
 				AgentStateRecEntry *d_ptr = nullptr;
-				// create numpy object
+				// create numpy object; PyArray_Zeros() steals a reference to descr
+				Py_INCREF(AgentStateRecDescr);
 				PyObject *t = PyArray_Zeros(2, dims, (PyArray_Descr *)AgentStateRecDescr, 0);
 				if (!t)
 					goto tuple_build_fail;
@@ -452,14 +1031,23 @@ namespace iebpr
 		static PyMethodDef SimulationPyObjectType_methods[] = {
 			// Randomizer
 			// SbrControl
-			{"append_sbr_stage", SimulationPyObjectType_method_append_sbr_stage, METH_O,
+			{"append_sbr_stage", idle_method<SimulationPyObjectType_method_append_sbr_stage>, METH_O,
 			 "append_sbr_stage(self, SbrStage, /) -> None\n--\nappend a stage config to simulation SBR control"},
-			{"clear_sbr_stage", SimulationPyObjectType_method_clear_sbr_stage, METH_NOARGS,
+			{"clear_sbr_stage", idle_method<SimulationPyObjectType_method_clear_sbr_stage>, METH_NOARGS,
 			 "clear_sbr_stage(self, /) -> None\n--\nclear all stage configs from simulation SBR control"},
-			{"is_flow_balanced", SimulationPyObjectType_method_is_flow_balanced, METH_NOARGS,
+			{"set_sbr_stage", idle_method<SimulationPyObjectType_method_set_sbr_stage>, METH_VARARGS,
+			 "set_sbr_stage(self, index: int, stage: SbrStage, /) -> None\n--\nreplace a stage config\n"
+			 "in a run in progress, only stages after the current one can be replaced"},
+			{"set_sbr_phase", idle_method<SimulationPyObjectType_method_set_sbr_phase>, METH_VARARGS,
+			 "set_sbr_phase(self, stage_index: int, phase_index: int, phase: SbrPhase, /) -> None\n--\n"
+			 "replace a phase config of a stage\n"
+			 "in a run in progress, phases of finished stages cannot be replaced, nor can time_len be "
+			 "changed in the current stage; a change of the current phase takes effect from the next "
+			 "timestep"},
+			{"is_flow_balanced", locked_method<SimulationPyObjectType_method_is_flow_balanced>, METH_NOARGS,
 			 "is_flow_balanced(self, /) -> bool\n--\nreturn true if inflow and outflow (outflow + withdraw) are balanced"},
 			// AgentPool
-			{"add_agent_subtype", (PyCFunction)SimulationPyObjectType_method_add_agent_subtype, METH_VARARGS | METH_KEYWORDS,
+			{"add_agent_subtype", (PyCFunction)(void (*)(void))idle_method_kw<SimulationPyObjectType_method_add_agent_subtype>, METH_VARARGS | METH_KEYWORDS,
 			 "add_agent_subtype(self, subtype: int, *, n_agent: int, state_cfg: StateRandConfig, trait_cfg: TraitRandConfig) -> None"
 			 "\n--\nadd agent subtype to simulation with state/trait configs\n"
 			 "subtype: int\n"
@@ -472,33 +1060,84 @@ namespace iebpr
 			 "    randomizer config set to generate agent state variables\n"
 			 "trait_cfg: TraitRandConfig\n"
 			 "    randomizer config set to generate agent trait variables\n"},
-			{"clear_agent_subtype", SimulationPyObjectType_method_clear_agent_subtype, METH_NOARGS,
+			{"clear_agent_subtype", idle_method<SimulationPyObjectType_method_clear_agent_subtype>, METH_NOARGS,
 			 "clear_agent_subtype(self, /) -> None\n--\nclear all agent subtypes from simulation"},
 			// Recorder
-			{"get_state_rec_timepoints", SimulationPyObjectType_method_get_state_rec_timepoints, METH_NOARGS,
+			{"get_state_rec_timepoints", idle_method<SimulationPyObjectType_method_get_state_rec_timepoints>, METH_NOARGS,
 			 "get_state_rec_timepoints(self, /) -> list[float]\n--\nlist timepoints for state record"},
-			{"set_state_rec_timepoints", SimulationPyObjectType_method_set_state_rec_timepoints, METH_O,
+			{"set_state_rec_timepoints", idle_method<SimulationPyObjectType_method_set_state_rec_timepoints>, METH_O,
 			 "set_state_rec_timepoints(self, list[float], /) -> None\n--\nset timepoints for state record, not necessarily sorted"},
-			{"clear_state_rec_timepoints", SimulationPyObjectType_method_clear_state_rec_timepoints, METH_NOARGS,
+			{"clear_state_rec_timepoints", idle_method<SimulationPyObjectType_method_clear_state_rec_timepoints>, METH_NOARGS,
 			 "clear_state_rec_timepoints(self, /) -> None\n--\nclear timepoints for state record"},
-			{"get_snapshot_rec_timepoints", SimulationPyObjectType_method_get_snapshot_rec_timepoints, METH_NOARGS,
+			{"get_snapshot_rec_timepoints", idle_method<SimulationPyObjectType_method_get_snapshot_rec_timepoints>, METH_NOARGS,
 			 "get_snapshot_rec_timepoints(self, /) -> list[float]\n--\nlist timespoints for snapshot record"},
-			{"set_snapshot_rec_timepoints", SimulationPyObjectType_method_set_snapshot_rec_timepoints, METH_O,
+			{"set_snapshot_rec_timepoints", idle_method<SimulationPyObjectType_method_set_snapshot_rec_timepoints>, METH_O,
 			 "set_snapshot_rec_timepoints(self, list[float], /) -> None\n--\nset timespoints for snapshot record, not necessarily sorted"},
-			{"clear_snapshot_rec_timepoints", SimulationPyObjectType_method_clear_snapshot_rec_timepoints, METH_NOARGS,
+			{"clear_snapshot_rec_timepoints", idle_method<SimulationPyObjectType_method_clear_snapshot_rec_timepoints>, METH_NOARGS,
 			 "clear_snapshot_rec_timepoints(self, /) -> None\n--\nclear timepoints for snapshot record"},
 			// Simulation
 			{"run", SimulationPyObjectType_method_run, METH_NOARGS,
-			 "run(self, /) -> None\n--\nrun simulation, raise an exception if error occurred"},
-			{"get_run_duration", SimulationPyObjectType_method_get_run_duration, METH_NOARGS,
+			 "run(self, /) -> None\n--\nrun simulation, raise an exception if error occurred\n"
+			 "the gil is released while running, so simulations can run in parallel on threads; "
+			 "other methods and data descriptors but cancel() and progress raise RuntimeError "
+			 "meanwhile"},
+			{"resume", SimulationPyObjectType_method_resume, METH_NOARGS,
+			 "resume(self, /) -> None\n--\ncontinue an interrupted run, or a run restored by load_checkpoint()"},
+			{"advance", SimulationPyObjectType_method_advance, METH_VARARGS,
+			 "advance(self, n_steps: int, /) -> None\n--\nadvance the run by n_steps timesteps, or to its end\n"
+			 "starts a new run if none is in progress (before the first run() or load_checkpoint()); "
+			 "all progress is kept between calls, so stages may be appended or replaced (set_sbr_stage(), "
+			 "set_sbr_phase()) in between; results are the same as of a single run()"},
+			{"run_until", SimulationPyObjectType_method_run_until, METH_VARARGS,
+			 "run_until(self, time: float, /) -> None\n--\nadvance the run to simulation time (day), see advance()\n"
+			 "nothing is done if time has been reached"},
+			{"run_async", (PyCFunction)(void (*)(void))SimulationPyObjectType_method_run_async, METH_VARARGS | METH_KEYWORDS,
+			 "run_async(self, /, *, resume: bool = False) -> asyncio.Future\n--\n"
+			 "run (or resume()) the simulation on a worker thread, without blocking the event loop\n"
+			 "must be called with an event loop running; the future is done with None, or with the "
+			 "exception run() would raise, when the run ends; cancelling the future cancels the run; "
+			 "progress can be polled meanwhile, while other methods and data descriptors raise "
+			 "RuntimeError; sigint is left to the event loop; await or cancel it before the "
+			 "interpreter exits"},
+			{"cancel", SimulationPyObjectType_method_cancel, METH_NOARGS,
+			 "cancel(self, /) -> None\n--\nstop the current run() or resume(), or the next one if none is running\n"
+			 "the run stops at the end of its current span of timesteps and raises IebprRunStopped; "
+			 "it can be continued by resume()"},
+			{"fork", (PyCFunction)(void (*)(void))idle_method_kw<SimulationPyObjectType_method_fork>, METH_VARARGS | METH_KEYWORDS,
+			 "fork(self, /, *, seed: int | None = None, same_stream: bool = False) -> Simulation\n--\n"
+			 "copy configs and current progress into a new Simulation\n"
+			 "the branch can be configured (e.g. append stages or set record timepoints) and resume()-ed "
+			 "independently; by default it draws from its own random substream, derived from the current "
+			 "random state and the number of forks taken; pass seed to reseed the branch, or same_stream=True "
+			 "to continue the same random sequence as self; checkpoint settings are not copied"},
+			{"run_replicates", SimulationPyObjectType_method_run_replicates, METH_O | METH_STATIC,
+			 "run_replicates(replicates: Sequence[Simulation], /) -> None\n--\nrun replicates of a discrete simulation in lockstep\n"
+			 "replicates may differ in seed and randomizer configs, while other configs (timestep, hydraulics, "
+			 "init env, stages, agent subtypes and recording timepoints) must be the same; each replicate gets "
+			 "the same results as its own run(), while the agent kinetics of 2 or 4 replicates (by the kernel isa) "
+			 "are computed together; run profile timings are for the whole batch, counted in the first replicate"},
+			{"__reduce_ex__", idle_method<SimulationPyObjectType_method_reduce_ex>, METH_O,
+			 "__reduce_ex__(self, protocol: int, /) -> tuple\n--\npickle support, as a compact binary image "
+			 "of all configs and the run progress, if any\n"
+			 "with protocol 5 or higher, agent data and records are pickled as out-of-band buffers; "
+			 "pickles are not portable across builds or platforms of different endianness"},
+			{"__setstate__", idle_method<SimulationPyObjectType_method_setstate>, METH_O,
+			 "__setstate__(self, state: bytes | tuple, /) -> None\n--\nrestore from the image of __reduce_ex__()"},
+			{"save_checkpoint", idle_method<SimulationPyObjectType_method_save_checkpoint>, METH_O,
+			 "save_checkpoint(self, path: str, /) -> None\n--\nsave current simulation progress to a checkpoint file"},
+			{"load_checkpoint", idle_method<SimulationPyObjectType_method_load_checkpoint>, METH_O,
+			 "load_checkpoint(self, path: str, /) -> None\n--\nrestore simulation progress from a checkpoint file\n"
+			 "all configs must be set the same as when the checkpoint was saved; call resume() afterwards "
+			 "to continue the run"},
+			{"get_run_duration", idle_method<SimulationPyObjectType_method_get_run_duration>, METH_NOARGS,
 			 "get_run_duration(self, /) -> int\n--\nshow the duration of last successful run, in microseconds"},
-			{"retrieve_env_state_rec", SimulationPyObjectType_method_retrieve_env_state_rec, METH_NOARGS,
+			{"retrieve_env_state_rec", idle_method<SimulationPyObjectType_method_retrieve_env_state_rec>, METH_NOARGS,
 			 "retrieve_env_state_rec(self, /) -> numpy.ndarray\n--\nretrieve environemt state recordings from simulation\n"
 			 "return a 1-dimensional numpy.ndarray of index: [timepoints]"},
-			{"retrieve_agent_state_rec", SimulationPyObjectType_method_retrieve_agent_state_rec, METH_NOARGS,
+			{"retrieve_agent_state_rec", idle_method<SimulationPyObjectType_method_retrieve_agent_state_rec>, METH_NOARGS,
 			 "retrieve_agent_state_rec(self, /) -> numpy.ndarray\n--\nretrieve agent state recordings from simulation\n"
 			 "return a 2-dimensional numpy.ndarray of index order: [timepoints, subtype]"},
-			{"retrieve_snapshot_rec", SimulationPyObjectType_method_retrieve_snapshot_rec, METH_NOARGS,
+			{"retrieve_snapshot_rec", idle_method<SimulationPyObjectType_method_retrieve_snapshot_rec>, METH_NOARGS,
 			 "retrieve_snapshot_rec(self, /) -> tuple[numpy.ndarray]\n--\nretrieve agent state snapshot recordings from simulation\n"
 			 "return a tuple of 2-dimensional numpy.ndarrays in index order: (tuple)[subtype] -> (numpy.ndarray)[timepoints, agent]"},
 			{nullptr, nullptr, 0, nullptr},
@@ -565,94 +1204,907 @@ namespace iebpr
 			return 0;
 		}
 
-		static PyObject *SimulationPyObjectType_get_total_time_len(PyObject *self, void *closure)
+		static PyObject *SimulationPyObjectType_get_hydraulic_span(PyObject *self, void *closure)
 		{
-			return Py_BuildValue("d", ((SimulationPyObject *)self)->cdata.total_time_len());
+			return Py_BuildValue("K", (unsigned long long)((SimulationPyObject *)self)->cdata.get_hydraulic_span());
 		}
 
-		static PyObject *SimulationPyObjectType_get_n_agent_subtype(PyObject *self, void *closure)
+		static int SimulationPyObjectType_set_hydraulic_span(PyObject *self, PyObject *value, void *closure)
 		{
-			return Py_BuildValue("n", ((SimulationPyObject *)self)->cdata.n_agent_subtype());
+			auto n_step = PyLong_AsUnsignedLongLong(value);
+			if (PyErr_Occurred())
+				return -1;
+			((SimulationPyObject *)self)->cdata.set_hydraulic_span(n_step);
+			return 0;
 		}
 
-		static PyObject *SimulationPyObjectType_get_total_n_agent(PyObject *self, void *closure)
+		static PyObject *SimulationPyObjectType_get_implicit_uptake_ratio(PyObject *self, void *closure)
 		{
-			return Py_BuildValue("n", ((SimulationPyObject *)self)->cdata.total_n_agent());
+			return Py_BuildValue("d", ((SimulationPyObject *)self)->cdata.get_implicit_uptake_ratio());
 		}
 
-		static PyObject *SimulationPyObjectType_get_n_agent_by_subtype(PyObject *self, void *closure)
+		static int SimulationPyObjectType_set_implicit_uptake_ratio(PyObject *self, PyObject *value, void *closure)
 		{
-			const auto vec = ((SimulationPyObject *)self)->cdata.n_agent_by_subtype();
-			auto ret = PyTuple_New(vec.size());
-			if (!ret)
-				goto tuple_new_fail;
-			// fill in values
-			for (size_t i = 0; i < vec.size(); i++)
+			auto ratio = PyFloat_AsDouble(value);
+			if (PyErr_Occurred())
+				return -1;
+			if (ratio < 0)
 			{
-				const char *subtype_name = AgentSubtypeBase::subtype_enum_to_name(vec[i].subtype);
-				auto t = Py_BuildValue("sn", subtype_name, vec[i].n_agent);
-				if (!t)
-					goto tuple_build_fail;
-				PyTuple_SetItem(ret, i, t);
-				assert(Py_REFCNT(t) == 1);
+				PyErr_SetString(PyExc_ValueError, "implicit_uptake_ratio must be non-negative");
+				return -1;
 			}
-			return ret;
-		tuple_build_fail:
-			for (size_t i = 0; i < vec.size(); i++)
-				PyTuple_SetItem(ret, i, nullptr);
-			Py_DECREF(ret);
-		tuple_new_fail:
-			PyErr_SetString(PyExc_SystemError, "failed to create return value");
-			return nullptr;
+			((SimulationPyObject *)self)->cdata.set_implicit_uptake_ratio(ratio);
+			return 0;
 		}
 
-		static PyObject *SimulationPyObjectType_get_n_state_rec_timepoints(PyObject *self, void *closure)
+		static PyObject *SimulationPyObjectType_get_aggregate_tolerance(PyObject *self, void *closure)
 		{
-			return Py_BuildValue("n", ((SimulationPyObject *)self)->cdata.n_state_rec_timepoints());
+			return Py_BuildValue("d", ((SimulationPyObject *)self)->cdata.get_aggregate_tolerance());
 		}
 
-		static PyObject *SimulationPyObjectType_get_n_snapshot_rec_timepoints(PyObject *self, void *closure)
+		static int SimulationPyObjectType_set_aggregate_tolerance(PyObject *self, PyObject *value, void *closure)
 		{
-			return Py_BuildValue("n", ((SimulationPyObject *)self)->cdata.n_snapshot_rec_timepoints());
+			auto tolerance = PyFloat_AsDouble(value);
+			if (PyErr_Occurred())
+				return -1;
+			// also rejects nan
+			if (!(tolerance >= 0))
+			{
+				PyErr_SetString(PyExc_ValueError, "aggregate_tolerance must be non-negative");
+				return -1;
+			}
+			((SimulationPyObject *)self)->cdata.set_aggregate_tolerance(tolerance);
+			return 0;
 		}
 
-		static PyObject *SimulationPyObjectType_get_last_run_duration(PyObject *self, void *closure)
+		static PyObject *SimulationPyObjectType_get_trait_reservoir_size(PyObject *self, void *closure)
 		{
-			return Py_BuildValue("K", (long long)(((SimulationPyObject *)self)->cdata.last_run_duration().count()));
+			return Py_BuildValue("n", ((SimulationPyObject *)self)->cdata.get_trait_reservoir_size());
 		}
 
-		static PyGetSetDef SimulationPyObjectType_getsets[] = {
-			// Randomizer
-			{"seed", nullptr, SimulationPyObjectType_set_seed, "random seed <- int", nullptr},
-			// SbrControll
-			{"pcontinuous", SimulationPyObjectType_get_pcontinuous,
-			 SimulationPyObjectType_set_pcontinuous,
-			 "use pseudo-continuous simulation (True) or discrete-time (False) <-> bool",
-			 nullptr},
-			{"init_env", nullptr, SimulationPyObjectType_set_init_env,
-			 "initial environment states <- EnvState", nullptr},
-			{"timestep", SimulationPyObjectType_get_timestep,
-			 SimulationPyObjectType_set_timestep, "simulation timestep, must be positive <-> float\n"
-												  "timestep should take balance between slow simulation (when too small) "
-												  "and losing precision (when too large)",
-			 nullptr},
-			{"total_time_len", SimulationPyObjectType_get_total_time_len, nullptr,
-			 "total time length of the simulation -> float", nullptr},
-			// AgentPool
-			{"n_agent_subtype", SimulationPyObjectType_get_n_agent_subtype, nullptr,
-			 "total number of agent subtypes added to simulation -> int", nullptr},
-			{"total_n_agent", SimulationPyObjectType_get_total_n_agent, nullptr,
-			 "total number of agents in all subtypes -> int", nullptr},
-			{"n_agent_by_subtype", SimulationPyObjectType_get_n_agent_by_subtype, nullptr,
-			 "list number of agents for each added subtype -> tuple[tuple[str, int]]", nullptr},
-			// Recorder
-			{"n_state_rec_timepoints", SimulationPyObjectType_get_n_state_rec_timepoints, nullptr,
-			 "number of timepoints set for state record -> int", nullptr},
-			{"n_snapshot_rec_timepoints", SimulationPyObjectType_get_n_snapshot_rec_timepoints, nullptr,
+		static int SimulationPyObjectType_set_trait_reservoir_size(PyObject *self, PyObject *value, void *closure)
+		{
+			auto size = PyLong_AsSize_t(value);
+			if (PyErr_Occurred())
+				return -1;
+			((SimulationPyObject *)self)->cdata.set_trait_reservoir_size(size);
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_trait_reservoir_thread(PyObject *self, void *closure)
+		{
+			return PyBool_FromLong(((SimulationPyObject *)self)->cdata.get_trait_reservoir_thread());
+		}
+
+		static int SimulationPyObjectType_set_trait_reservoir_thread(PyObject *self, PyObject *value, void *closure)
+		{
+			auto enable = PyObject_IsTrue(value);
+			if (enable < 0)
+				return -1;
+			((SimulationPyObject *)self)->cdata.set_trait_reservoir_thread(enable);
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_instantiate_threads(PyObject *self, void *closure)
+		{
+			return Py_BuildValue("n", ((SimulationPyObject *)self)->cdata.get_instantiate_threads());
+		}
+
+		static int SimulationPyObjectType_set_instantiate_threads(PyObject *self, PyObject *value, void *closure)
+		{
+			auto n_thread = PyLong_AsSize_t(value);
+			if (PyErr_Occurred())
+				return -1;
+			((SimulationPyObject *)self)->cdata.set_instantiate_threads(n_thread);
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_pool_backing_dir(PyObject *self, void *closure)
+		{
+			const auto &path = ((SimulationPyObject *)self)->cdata.get_pool_backing_dir();
+			if (path.empty())
+				Py_RETURN_NONE;
+			return PyUnicode_DecodeFSDefaultAndSize(path.c_str(), path.size());
+		}
+
+		static int SimulationPyObjectType_set_pool_backing_dir(PyObject *self, PyObject *value, void *closure)
+		{
+			PyObject *path = nullptr;
+			if ((!value) || Py_IsNone(value))
+			{
+				((SimulationPyObject *)self)->cdata.set_pool_backing_dir("");
+				return 0;
+			}
+			if (!PyUnicode_FSConverter(value, &path))
+				return -1;
+			((SimulationPyObject *)self)->cdata.set_pool_backing_dir(PyBytes_AS_STRING(path));
+			Py_DECREF(path);
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_curr_time(PyObject *self, void *closure)
+		{
+			return Py_BuildValue("d", ((SimulationPyObject *)self)->cdata.curr_time());
+		}
+
+		static PyObject *SimulationPyObjectType_get_curr_step(PyObject *self, void *closure)
+		{
+			return PyLong_FromUnsignedLongLong(((SimulationPyObject *)self)->cdata.curr_step());
+		}
+
+		static PyObject *SimulationPyObjectType_get_curr_env(PyObject *self, void *closure)
+		{
+			PyObject *ret = PyObject_CallNoArgs((PyObject *)EnvStatePyObject::type);
+			if (!ret)
+				return nullptr;
+			((EnvStatePyObject *)ret)->cdata = ((SimulationPyObject *)self)->cdata.curr_env();
+			return ret;
+		}
+
+		static PyObject *SimulationPyObjectType_get_curr_agent_state(PyObject *self, void *closure)
+		{
+			const auto &vec = ((SimulationPyObject *)self)->cdata.curr_agent_state();
+			const Py_intptr_t dims[1] = {(Py_intptr_t)vec.size()};
+			// PyArray_Zeros() steals a reference to descr
+			Py_INCREF(AgentStateRecDescr);
+			PyObject *ret = PyArray_Zeros(1, dims, (PyArray_Descr *)AgentStateRecDescr, 0);
+			if (!ret)
+				return nullptr;
+			std::copy(vec.begin(), vec.end(), (AgentStateRecEntry *)PyArray_DATA((PyArrayObject *)ret));
+			return ret;
+		}
+
+		static PyObject *SimulationPyObjectType_get_total_time_len(PyObject *self, void *closure)
+		{
+			return Py_BuildValue("d", ((SimulationPyObject *)self)->cdata.total_time_len());
+		}
+
+		static PyObject *SimulationPyObjectType_get_n_agent_subtype(PyObject *self, void *closure)
+		{
+			return Py_BuildValue("n", ((SimulationPyObject *)self)->cdata.n_agent_subtype());
+		}
+
+		static PyObject *SimulationPyObjectType_get_total_n_agent(PyObject *self, void *closure)
+		{
+			return Py_BuildValue("n", ((SimulationPyObject *)self)->cdata.total_n_agent());
+		}
+
+		static PyObject *SimulationPyObjectType_get_n_agent_by_subtype(PyObject *self, void *closure)
+		{
+			const auto vec = ((SimulationPyObject *)self)->cdata.n_agent_by_subtype();
+			auto ret = PyTuple_New(vec.size());
+			if (!ret)
+				goto tuple_new_fail;
+			// fill in values
+			for (size_t i = 0; i < vec.size(); i++)
+			{
+				const char *subtype_name = AgentSubtypeBase::subtype_enum_to_name(vec[i].subtype);
+				auto t = Py_BuildValue("sn", subtype_name, vec[i].n_agent);
+				if (!t)
+					goto tuple_build_fail;
+				PyTuple_SetItem(ret, i, t);
+				assert(Py_REFCNT(t) == 1);
+			}
+			return ret;
+		tuple_build_fail:
+			for (size_t i = 0; i < vec.size(); i++)
+				PyTuple_SetItem(ret, i, nullptr);
+			Py_DECREF(ret);
+		tuple_new_fail:
+			PyErr_SetString(PyExc_SystemError, "failed to create return value");
+			return nullptr;
+		}
+
+		static PyObject *SimulationPyObjectType_get_n_state_rec_timepoints(PyObject *self, void *closure)
+		{
+			return Py_BuildValue("n", ((SimulationPyObject *)self)->cdata.n_state_rec_timepoints());
+		}
+
+		static PyObject *SimulationPyObjectType_get_n_snapshot_rec_timepoints(PyObject *self, void *closure)
+		{
+			return Py_BuildValue("n", ((SimulationPyObject *)self)->cdata.n_snapshot_rec_timepoints());
+		}
+
+		static PyObject *SimulationPyObjectType_get_last_run_duration(PyObject *self, void *closure)
+		{
+			return Py_BuildValue("K", (long long)(((SimulationPyObject *)self)->cdata.last_run_duration().count()));
+		}
+
+		//======================================================================
+		// RUN PROFILE
+		// struct sequences, types will be created by module_bind_simulation()
+		static PyTypeObject *HwSectionProfileType = nullptr;
+		static PyTypeObject *HwProfileType = nullptr;
+		static PyTypeObject *PhaseProfileType = nullptr;
+		static PyTypeObject *SubtypeProfileType = nullptr;
+		static PyTypeObject *RunProfileType = nullptr;
+
+		static PyStructSequence_Field HwSectionProfileFields[] = {
+			{"cycles", "cpu cycles"},
+			{"instructions", "instructions retired"},
+			{"llc_misses", "last level cache misses"},
+			{"branch_misses", "branch mispredictions"},
+			{"ipc", "instructions per cycle"},
+			{"cycles_per_agent_step", "cpu cycles per agent-step"},
+			{"instructions_per_agent_step", "instructions retired per agent-step"},
+			{"llc_misses_per_agent_step", "last level cache misses per agent-step"},
+			{"branch_misses_per_agent_step", "branch mispredictions per agent-step"},
+			{nullptr, nullptr},
+		};
+
+		static PyStructSequence_Desc HwSectionProfileDesc = {
+			"iebpr._iebpr.HwSectionProfile",
+			"hardware counters of a section of the main loop; fields of events "
+			"not sampled are None",
+			HwSectionProfileFields, 9};
+
+		static PyStructSequence_Field HwProfileFields[] = {
+			{"kinetics", "agent kinetics and env update (HwSectionProfile)"},
+			{"recorder", "recorder (HwSectionProfile)"},
+			{nullptr, nullptr},
+		};
+
+		static PyStructSequence_Desc HwProfileDesc = {
+			"iebpr._iebpr.HwProfile",
+			"hardware counters by section of the main loop; agent kinetics and env "
+			"update alternate in every step, so they are counted together in one "
+			"section, read once per span of steps; see PhaseProfile for their "
+			"separate wall time",
+			HwProfileFields, 2};
+
+		static PyStructSequence_Field PhaseProfileFields[] = {
+			{"n_step", "number of timesteps"},
+			{"n_agent_step", "number of agent-steps, i.e. agents times timesteps"},
+			{"agent_time", "seconds spent in agent kinetics"},
+			{"env_time", "seconds spent in env update (hydraulics)"},
+			{"transit_time", "seconds spent in phase transition"},
+			{"recorder_time", "seconds spent in recorder"},
+			{"hw", "hardware counters (HwProfile), None if not sampled"},
+			{nullptr, nullptr},
+		};
+
+		static PyStructSequence_Desc PhaseProfileDesc = {
+			"iebpr._iebpr.PhaseProfile",
+			"run profile counters of a phase type, or of both types in total",
+			PhaseProfileFields, 7};
+
+		static PyStructSequence_Field SubtypeProfileFields[] = {
+			{"subtype", "agent subtype name"},
+			{"n_split_anaerobic", "number of agent splits in anaerobic phases"},
+			{"n_split_aerobic", "number of agent splits in aerobic phases"},
+			{"n_merge_anaerobic", "number of agent merges in anaerobic phases"},
+			{"n_merge_aerobic", "number of agent merges in aerobic phases"},
+			{"n_aggregate", "number of agents merged by adaptive aggregation"},
+			{"n_active", "number of active agents at the end of the run"},
+			{nullptr, nullptr},
+		};
+
+		static PyStructSequence_Desc SubtypeProfileDesc = {
+			"iebpr._iebpr.SubtypeProfile",
+			"run profile counters of an agent subtype; a split frees its slot by "
+			"merging the two smallest agents, so each split comes with a merge, "
+			"unless adaptive aggregation left free slots",
+			SubtypeProfileFields, 7};
+
+		static PyStructSequence_Field RunProfileFields[] = {
+			{"total", "counters of all phases (PhaseProfile)"},
+			{"anaerobic", "counters of anaerobic phases (PhaseProfile)"},
+			{"aerobic", "counters of aerobic phases (PhaseProfile)"},
+			{"subtypes", "counters of each agent subtype (tuple of SubtypeProfile)"},
+			{"state_rec_bytes", "bytes of state records taken"},
+			{"snapshot_rec_bytes", "bytes of snapshot records taken"},
+			{"pool_bytes", "bytes allocated for agent pool data (its capacity)"},
+			{"hw_events", "hardware counter events sampled (tuple of str), empty if "
+						  "not requested by Simulation.perf_counters or unavailable"},
+			{nullptr, nullptr},
+		};
+
+		static PyStructSequence_Desc RunProfileDesc = {
+			"iebpr._iebpr.RunProfile",
+			"run profile counters of a run() or resume()",
+			RunProfileFields, 8};
+
+		// set item i of struct sequence o, steals v; return -1 if v is null
+		static int structseq_set(PyObject *o, Py_ssize_t i, PyObject *v)
+		{
+			if (!v)
+				return -1;
+			PyStructSequence_SetItem(o, i, v);
+			return 0;
+		}
+
+		// count of event, None if not sampled
+		static PyObject *new_hw_count(const PerfCounter::Values &hw, unsigned hw_events,
+									  PerfCounter::event_enum event)
+		{
+			if (!(hw_events & (1u << event)))
+				Py_RETURN_NONE;
+			return PyLong_FromUnsignedLongLong(hw.value[event]);
+		}
+
+		// ratio of counts of two events, None if either is not sampled or
+		// the denominator is zero
+		static PyObject *new_hw_ratio(double num, double denom, bool sampled)
+		{
+			if ((!sampled) || (!denom))
+				Py_RETURN_NONE;
+			return PyFloat_FromDouble(num / denom);
+		}
+
+		static PyObject *new_hw_section_profile(const PerfCounter::Values &hw, unsigned hw_events,
+												uint64_t n_agent_step)
+		{
+			using event_enum = PerfCounter::event_enum;
+			const bool has_ipc = (hw_events & (1u << event_enum::cycles)) &&
+								 (hw_events & (1u << event_enum::instructions));
+			auto o = PyStructSequence_New(HwSectionProfileType);
+			if (!o)
+				goto new_fail;
+			for (size_t i = 0; i < PerfCounter::n_event; i++)
+			{
+				auto event = (event_enum)i;
+				if (structseq_set(o, i, new_hw_count(hw, hw_events, event)) ||
+					structseq_set(o, 5 + i, new_hw_ratio(hw.value[event], n_agent_step,
+														 hw_events & (1u << event))))
+					goto set_fail;
+			}
+			if (structseq_set(o, 4, new_hw_ratio(hw.value[event_enum::instructions],
+												 hw.value[event_enum::cycles], has_ipc)))
+				goto set_fail;
+			return o;
+		set_fail:
+			Py_DECREF(o);
+		new_fail:
+			return nullptr;
+		}
+
+		static PyObject *new_hw_profile(const RunProfile::PhaseCounter &counter, unsigned hw_events)
+		{
+			if (!hw_events)
+				Py_RETURN_NONE;
+			auto o = PyStructSequence_New(HwProfileType);
+			if (!o)
+				goto new_fail;
+			if (structseq_set(o, 0, new_hw_section_profile(counter.kinetics_hw, hw_events, counter.n_agent_step)) ||
+				structseq_set(o, 1, new_hw_section_profile(counter.recorder_hw, hw_events, counter.n_agent_step)))
+				goto set_fail;
+			return o;
+		set_fail:
+			Py_DECREF(o);
+		new_fail:
+			return nullptr;
+		}
+
+		static PyObject *new_phase_profile(const RunProfile::PhaseCounter &counter, unsigned hw_events)
+		{
+			auto o = PyStructSequence_New(PhaseProfileType);
+			if (!o)
+				goto new_fail;
+			if (structseq_set(o, 0, PyLong_FromUnsignedLongLong(counter.n_step)) ||
+				structseq_set(o, 1, PyLong_FromUnsignedLongLong(counter.n_agent_step)) ||
+				structseq_set(o, 2, PyFloat_FromDouble(counter.agent_time)) ||
+				structseq_set(o, 3, PyFloat_FromDouble(counter.env_time)) ||
+				structseq_set(o, 4, PyFloat_FromDouble(counter.transit_time)) ||
+				structseq_set(o, 5, PyFloat_FromDouble(counter.recorder_time)) ||
+				structseq_set(o, 6, new_hw_profile(counter, hw_events)))
+				goto set_fail;
+			return o;
+		set_fail:
+			Py_DECREF(o);
+		new_fail:
+			return nullptr;
+		}
+
+		static PyObject *new_subtype_profile(const RunProfile::SubtypeCounter &counter)
+		{
+			auto o = PyStructSequence_New(SubtypeProfileType);
+			if (!o)
+				goto new_fail;
+			if (structseq_set(o, 0, PyUnicode_FromString(Simulation::subtype_enum_to_name((Simulation::subtype_enum)counter.subtype))) ||
+				structseq_set(o, 1, PyLong_FromUnsignedLongLong(counter.n_split[0])) ||
+				structseq_set(o, 2, PyLong_FromUnsignedLongLong(counter.n_split[1])) ||
+				structseq_set(o, 3, PyLong_FromUnsignedLongLong(counter.n_merge[0])) ||
+				structseq_set(o, 4, PyLong_FromUnsignedLongLong(counter.n_merge[1])) ||
+				structseq_set(o, 5, PyLong_FromUnsignedLongLong(counter.n_aggregate)) ||
+				structseq_set(o, 6, PyLong_FromUnsignedLongLong(counter.n_active)))
+				goto set_fail;
+			return o;
+		set_fail:
+			Py_DECREF(o);
+		new_fail:
+			return nullptr;
+		}
+
+		static PyObject *new_hw_events(unsigned hw_events)
+		{
+			size_t n = 0;
+			for (size_t i = 0; i < PerfCounter::n_event; i++)
+				n += (hw_events >> i) & 1u;
+			auto o = PyTuple_New(n);
+			if (!o)
+				goto new_fail;
+			n = 0;
+			for (size_t i = 0; i < PerfCounter::n_event; i++)
+			{
+				if (!(hw_events & (1u << i)))
+					continue;
+				auto v = PyUnicode_FromString(PerfCounter::event_enum_to_name((PerfCounter::event_enum)i));
+				if (!v)
+					goto set_fail;
+				PyTuple_SET_ITEM(o, n++, v);
+			}
+			return o;
+		set_fail:
+			Py_DECREF(o);
+		new_fail:
+			return nullptr;
+		}
+
+		static PyObject *new_subtype_profiles(const RunProfile &profile)
+		{
+			// subtype counters are only filled after a run
+			auto o = PyTuple_New(profile.subtype.size());
+			if (!o)
+				goto new_fail;
+			for (size_t i = 0; i < profile.subtype.size(); i++)
+			{
+				auto v = new_subtype_profile(profile.subtype[i]);
+				if (!v)
+					goto set_fail;
+				PyTuple_SET_ITEM(o, i, v);
+			}
+			return o;
+		set_fail:
+			Py_DECREF(o);
+		new_fail:
+			return nullptr;
+		}
+
+		static PyObject *new_run_profile(const RunProfile &profile)
+		{
+			auto o = PyStructSequence_New(RunProfileType);
+			if (!o)
+				goto new_fail;
+			if (structseq_set(o, 0, new_phase_profile(profile.total(), profile.hw_events)) ||
+				structseq_set(o, 1, new_phase_profile(profile.phase[0], profile.hw_events)) ||
+				structseq_set(o, 2, new_phase_profile(profile.phase[1], profile.hw_events)) ||
+				structseq_set(o, 3, new_subtype_profiles(profile)) ||
+				structseq_set(o, 4, PyLong_FromUnsignedLongLong(profile.state_rec_bytes)) ||
+				structseq_set(o, 5, PyLong_FromUnsignedLongLong(profile.snapshot_rec_bytes)) ||
+				structseq_set(o, 6, PyLong_FromUnsignedLongLong(profile.pool_bytes)) ||
+				structseq_set(o, 7, new_hw_events(profile.hw_events)))
+				goto set_fail;
+			return o;
+		set_fail:
+			Py_DECREF(o);
+		new_fail:
+			return nullptr;
+		}
+
+		static PyObject *SimulationPyObjectType_get_last_run_profile(PyObject *self, void *closure)
+		{
+			if (!RunProfile::enabled)
+				Py_RETURN_NONE;
+			return new_run_profile(((SimulationPyObject *)self)->cdata.last_run_profile());
+		}
+
+		//======================================================================
+		// RUN PROGRESS
+		static PyTypeObject *RunProgressType = nullptr;
+
+		static PyStructSequence_Field RunProgressFields[] = {
+			{"time", "simulation time (day) reached"},
+			{"step", "timesteps elapsed"},
+			{"steps_per_sec", "timesteps per second of wall time in the run so far"},
+			{"running", "True while the run is going"},
+			{nullptr, nullptr},
+		};
+
+		static PyStructSequence_Desc RunProgressDesc = {
+			"iebpr._iebpr.RunProgress",
+			"progress of the current or last run, updated between spans of the main loop",
+			RunProgressFields, 4};
+
+		static PyObject *SimulationPyObjectType_get_progress(PyObject *self, void *closure)
+		{
+			const auto &cdata = ((SimulationPyObject *)self)->cdata;
+			const auto progress = cdata.run_control.progress();
+			auto o = PyStructSequence_New(RunProgressType);
+			if (!o)
+				goto new_fail;
+			if (structseq_set(o, 0, PyFloat_FromDouble(progress.curr_step * cdata.get_timestep())) ||
+				structseq_set(o, 1, PyLong_FromUnsignedLongLong(progress.curr_step)) ||
+				structseq_set(o, 2, PyFloat_FromDouble(progress.steps_per_sec)) ||
+				structseq_set(o, 3, PyBool_FromLong(progress.running)))
+				goto set_fail;
+			return o;
+		set_fail:
+			Py_DECREF(o);
+		new_fail:
+			return nullptr;
+		}
+
+		static PyObject *SimulationPyObjectType_get_checkpoint_file(PyObject *self, void *closure)
+		{
+			const auto &path = ((SimulationPyObject *)self)->cdata.checkpoint_file;
+			if (path.empty())
+				Py_RETURN_NONE;
+			return PyUnicode_DecodeFSDefaultAndSize(path.c_str(), path.size());
+		}
+
+		static int SimulationPyObjectType_set_checkpoint_file(PyObject *self, PyObject *value, void *closure)
+		{
+			PyObject *path = nullptr;
+			if ((!value) || Py_IsNone(value))
+			{
+				((SimulationPyObject *)self)->cdata.checkpoint_file.clear();
+				return 0;
+			}
+			if (!PyUnicode_FSConverter(value, &path))
+				return -1;
+			((SimulationPyObject *)self)->cdata.checkpoint_file = PyBytes_AS_STRING(path);
+			Py_DECREF(path);
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_trace_file(PyObject *self, void *closure)
+		{
+			const auto &path = ((SimulationPyObject *)self)->cdata.trace_file;
+			if (path.empty())
+				Py_RETURN_NONE;
+			return PyUnicode_DecodeFSDefaultAndSize(path.c_str(), path.size());
+		}
+
+		static int SimulationPyObjectType_set_trace_file(PyObject *self, PyObject *value, void *closure)
+		{
+			PyObject *path = nullptr;
+			if ((!value) || Py_IsNone(value))
+			{
+				((SimulationPyObject *)self)->cdata.trace_file.clear();
+				return 0;
+			}
+			if (!PyUnicode_FSConverter(value, &path))
+				return -1;
+			((SimulationPyObject *)self)->cdata.trace_file = PyBytes_AS_STRING(path);
+			Py_DECREF(path);
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_trace_sample_interval(PyObject *self, void *closure)
+		{
+			return Py_BuildValue("K", (unsigned long long)((SimulationPyObject *)self)->cdata.trace_sample_interval);
+		}
+
+		static int SimulationPyObjectType_set_trace_sample_interval(PyObject *self, PyObject *value, void *closure)
+		{
+			auto n_span = PyLong_AsUnsignedLongLong(value);
+			if (PyErr_Occurred())
+				return -1;
+			if (!n_span)
+			{
+				PyErr_SetString(PyExc_ValueError, "trace_sample_interval must be positive");
+				return -1;
+			}
+			((SimulationPyObject *)self)->cdata.trace_sample_interval = n_span;
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_result_shm(PyObject *self, void *closure)
+		{
+			const auto &name = ((SimulationPyObject *)self)->cdata.result_shm;
+			if (name.empty())
+				Py_RETURN_NONE;
+			return PyUnicode_FromStringAndSize(name.c_str(), name.size());
+		}
+
+		static int SimulationPyObjectType_set_result_shm(PyObject *self, PyObject *value, void *closure)
+		{
+			if ((!value) || Py_IsNone(value))
+			{
+				((SimulationPyObject *)self)->cdata.result_shm.clear();
+				return 0;
+			}
+			Py_ssize_t size = 0;
+			const char *name = PyUnicode_AsUTF8AndSize(value, &size);
+			if (!name)
+				return -1;
+			((SimulationPyObject *)self)->cdata.result_shm.assign(name, size);
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_result_shm_offset(PyObject *self, void *closure)
+		{
+			return Py_BuildValue("K", (unsigned long long)((SimulationPyObject *)self)->cdata.result_shm_offset);
+		}
+
+		static int SimulationPyObjectType_set_result_shm_offset(PyObject *self, PyObject *value, void *closure)
+		{
+			auto offset = PyLong_AsUnsignedLongLong(value);
+			if (PyErr_Occurred())
+				return -1;
+			if (offset % ResultArena::align)
+			{
+				PyErr_Format(PyExc_ValueError, "result_shm_offset must be a multiple of %u",
+							 (unsigned)ResultArena::align);
+				return -1;
+			}
+			((SimulationPyObject *)self)->cdata.result_shm_offset = offset;
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_result_arena_bytes(PyObject *self, void *closure)
+		{
+			return Py_BuildValue("K", (unsigned long long)((SimulationPyObject *)self)->cdata.result_arena_bytes());
+		}
+
+		static PyObject *SimulationPyObjectType_get_perf_counters(PyObject *self, void *closure)
+		{
+			if (((SimulationPyObject *)self)->cdata.perf_counters)
+				Py_RETURN_TRUE;
+			else
+				Py_RETURN_FALSE;
+		}
+
+		static int SimulationPyObjectType_set_perf_counters(PyObject *self, PyObject *value, void *closure)
+		{
+			auto enable = PyObject_IsTrue(value);
+			if (PyErr_Occurred())
+				return -1;
+			((SimulationPyObject *)self)->cdata.perf_counters = enable;
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_max_steps(PyObject *self, void *closure)
+		{
+			return PyLong_FromUnsignedLongLong(((SimulationPyObject *)self)->cdata.run_control.max_steps);
+		}
+
+		static int SimulationPyObjectType_set_max_steps(PyObject *self, PyObject *value, void *closure)
+		{
+			auto n_step = PyLong_AsUnsignedLongLong(value);
+			if (PyErr_Occurred())
+				return -1;
+			((SimulationPyObject *)self)->cdata.run_control.max_steps = n_step;
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_max_wall_time(PyObject *self, void *closure)
+		{
+			return Py_BuildValue("d", ((SimulationPyObject *)self)->cdata.run_control.max_wall_time);
+		}
+
+		static int SimulationPyObjectType_set_max_wall_time(PyObject *self, PyObject *value, void *closure)
+		{
+			auto seconds = PyFloat_AsDouble(value);
+			if (PyErr_Occurred())
+				return -1;
+			if (seconds < 0)
+			{
+				PyErr_SetString(PyExc_ValueError, "max_wall_time must be non-negative");
+				return -1;
+			}
+			((SimulationPyObject *)self)->cdata.run_control.max_wall_time = seconds;
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_deadline(PyObject *self, void *closure)
+		{
+			const auto deadline = ((SimulationPyObject *)self)->cdata.run_control.deadline;
+			if (deadline <= 0)
+				Py_RETURN_NONE;
+			return Py_BuildValue("d", deadline);
+		}
+
+		static int SimulationPyObjectType_set_deadline(PyObject *self, PyObject *value, void *closure)
+		{
+			if ((!value) || Py_IsNone(value))
+			{
+				((SimulationPyObject *)self)->cdata.run_control.deadline = 0;
+				return 0;
+			}
+			auto deadline = PyFloat_AsDouble(value);
+			if (PyErr_Occurred())
+				return -1;
+			if (deadline <= 0)
+			{
+				PyErr_SetString(PyExc_ValueError, "deadline must be positive, or None");
+				return -1;
+			}
+			((SimulationPyObject *)self)->cdata.run_control.deadline = deadline;
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_handle_sigint(PyObject *self, void *closure)
+		{
+			return PyBool_FromLong(((SimulationPyObject *)self)->cdata.run_control.handle_sigint);
+		}
+
+		static int SimulationPyObjectType_set_handle_sigint(PyObject *self, PyObject *value, void *closure)
+		{
+			auto enable = PyObject_IsTrue(value);
+			if (enable < 0)
+				return -1;
+			((SimulationPyObject *)self)->cdata.run_control.handle_sigint = enable;
+			return 0;
+		}
+
+		static PyObject *SimulationPyObjectType_get_checkpoint_interval(PyObject *self, void *closure)
+		{
+			return Py_BuildValue("d", ((SimulationPyObject *)self)->cdata.checkpoint_interval);
+		}
+
+		static int SimulationPyObjectType_set_checkpoint_interval(PyObject *self, PyObject *value, void *closure)
+		{
+			auto interval = PyFloat_AsDouble(value);
+			if (PyErr_Occurred())
+				return -1;
+			if (interval < 0)
+			{
+				PyErr_SetString(PyExc_ValueError, "checkpoint_interval must be non-negative");
+				return -1;
+			}
+			((SimulationPyObject *)self)->cdata.checkpoint_interval = interval;
+			return 0;
+		}
+
+		static PyGetSetDef SimulationPyObjectType_getsets[] = {
+			// Randomizer
+			{"seed", nullptr, idle_setter<SimulationPyObjectType_set_seed>, "random seed <- int", nullptr},
+			// SbrControll
+			{"pcontinuous", locked_getter<SimulationPyObjectType_get_pcontinuous>,
+			 idle_setter<SimulationPyObjectType_set_pcontinuous>,
+			 "use pseudo-continuous simulation (True) or discrete-time (False) <-> bool",
+			 nullptr},
+			{"init_env", nullptr, idle_setter<SimulationPyObjectType_set_init_env>,
+			 "initial environment states <- EnvState", nullptr},
+			{"timestep", locked_getter<SimulationPyObjectType_get_timestep>,
+			 idle_setter<SimulationPyObjectType_set_timestep>, "simulation timestep, must be positive <-> float\n"
+												  "timestep should take balance between slow simulation (when too small) "
+												  "and losing precision (when too large)",
+			 nullptr},
+			{"hydraulic_span", locked_getter<SimulationPyObjectType_get_hydraulic_span>,
+			 idle_setter<SimulationPyObjectType_set_hydraulic_span>, "closed-form hydraulics span in timesteps <-> int\n"
+														"0 (default) updates inflow/withdraw/outflow every timestep; "
+														"n > 0 updates them in closed form every n timesteps, "
+														"split from agent kinetics, which trades coupling accuracy "
+														"for speed with large agent pools",
+			 nullptr},
+			{"implicit_uptake_ratio", locked_getter<SimulationPyObjectType_get_implicit_uptake_ratio>,
+			 idle_setter<SimulationPyObjectType_set_implicit_uptake_ratio>, "semi-implicit substrate uptake threshold <-> float\n"
+															   "0 (default) uses explicit uptake; r > 0 switches vfa/op uptake "
+															   "to semi-implicit euler once agents consumed more than r times "
+															   "the substrate concentration in the last timestep, which keeps "
+															   "concentrations positive near depletion",
+			 nullptr},
+			{"aggregate_tolerance", locked_getter<SimulationPyObjectType_get_aggregate_tolerance>,
+			 idle_setter<SimulationPyObjectType_set_aggregate_tolerance>, "adaptive agent aggregation tolerance <-> float\n"
+															 "0 (default) keeps every agent; t > 0 merges agents of a subtype "
+															 "whose traits, content fractions and split progress are within t "
+															 "times the subtype mean of each other into super-individuals at "
+															 "each phase transition; the freed slots are filled again by later "
+															 "splits, and only active agents are updated",
+			 nullptr},
+			{"total_time_len", locked_getter<SimulationPyObjectType_get_total_time_len>, nullptr,
+			 "total time length of the simulation -> float", nullptr},
+			{"curr_time", idle_getter<SimulationPyObjectType_get_curr_time>, nullptr,
+			 "simulation time (day) reached by the run in progress -> float", nullptr},
+			{"curr_step", idle_getter<SimulationPyObjectType_get_curr_step>, nullptr,
+			 "timesteps elapsed in the run in progress -> int", nullptr},
+			{"curr_env", idle_getter<SimulationPyObjectType_get_curr_env>, nullptr,
+			 "env state of the run in progress, as copy -> EnvState", nullptr},
+			{"curr_agent_state", idle_getter<SimulationPyObjectType_get_curr_agent_state>, nullptr,
+			 "summary of agents of each subtype, as in retrieve_agent_state_rec(), taken at the end "
+			 "of the last run(), resume(), advance() or run_until() -> numpy.ndarray\n"
+			 "return a 1-dimensional numpy.ndarray of index: [subtype]", nullptr},
+			// AgentPool
+			{"n_agent_subtype", locked_getter<SimulationPyObjectType_get_n_agent_subtype>, nullptr,
+			 "total number of agent subtypes added to simulation -> int", nullptr},
+			{"total_n_agent", locked_getter<SimulationPyObjectType_get_total_n_agent>, nullptr,
+			 "total number of agents in all subtypes -> int", nullptr},
+			{"n_agent_by_subtype", idle_getter<SimulationPyObjectType_get_n_agent_by_subtype>, nullptr,
+			 "list number of agents for each added subtype -> tuple[tuple[str, int]]", nullptr},
+			{"trait_reservoir_size", locked_getter<SimulationPyObjectType_get_trait_reservoir_size>,
+			 idle_setter<SimulationPyObjectType_set_trait_reservoir_size>, "split trait reservoir size per subtype <-> int\n"
+															  "0 (default) randomizes the trait of each split agent on the fly; "
+															  "n > 0 takes them from a ring buffer of n traits pre-generated in "
+															  "bulk from a random substream of each subtype, applied at next run(); "
+															  "results are reproducible, but differ from those without",
+			 nullptr},
+			{"trait_reservoir_thread", locked_getter<SimulationPyObjectType_get_trait_reservoir_thread>,
+			 idle_setter<SimulationPyObjectType_set_trait_reservoir_thread>, "refill trait reservoirs in background <-> bool\n"
+																"False (default) refills a reservoir when it runs empty; True "
+																"refills them on a background thread per subtype during run(); "
+																"results are the same either way",
+			 nullptr},
+			{"instantiate_threads", locked_getter<SimulationPyObjectType_get_instantiate_threads>,
+			 idle_setter<SimulationPyObjectType_set_instantiate_threads>, "number of threads to instantiate agents on <-> int\n"
+															 "0 (default) instantiates agents serially from the random "
+															 "sequence of seed; n > 0 splits each subtype into ranges of "
+															 "4096 agents, each filled column by column from its own random "
+															 "substream, on n threads; results are reproducible and the same "
+															 "for any n > 0, but differ from those with 0",
+			 nullptr},
+			{"pool_backing_dir", locked_getter<SimulationPyObjectType_get_pool_backing_dir>,
+			 idle_setter<SimulationPyObjectType_set_pool_backing_dir>, "directory of the agent pool backing file, None to "
+														  "keep agents in memory <-> str\n"
+														  "if set, agent data is mapped from an unlinked file created in "
+														  "this directory at next run(), so the pool can exceed ram; passes "
+														  "over agents then stream through the file block by block; results "
+														  "are the same either way",
+			 nullptr},
+			// Recorder
+			{"n_state_rec_timepoints", locked_getter<SimulationPyObjectType_get_n_state_rec_timepoints>, nullptr,
+			 "number of timepoints set for state record -> int", nullptr},
+			{"n_snapshot_rec_timepoints", locked_getter<SimulationPyObjectType_get_n_snapshot_rec_timepoints>, nullptr,
 			 "number of timepoints set for snapshot record -> int", nullptr},
 			// Simulation
-			{"last_run_duration", SimulationPyObjectType_get_last_run_duration, nullptr,
+			{"last_run_duration", idle_getter<SimulationPyObjectType_get_last_run_duration>, nullptr,
 			 "the duration of last successful run, in milliseconds", nullptr},
+			{"progress", SimulationPyObjectType_get_progress, nullptr,
+			 "progress of the current or last run -> RunProgress\n"
+			 "lock-free, can be polled while run_async() is going", nullptr},
+			{"last_run_profile", idle_getter<SimulationPyObjectType_get_last_run_profile>, nullptr,
+			 "counters of the last run() or resume() -> RunProfile\n"
+			 "time spent in agent kinetics, env update, phase transition and "
+			 "recorder, and number of timesteps, by phase type; splits and "
+			 "merges by subtype; bytes of records taken and of agent pool; "
+			 "hardware counters if enabled by perf_counters; "
+			 "None if the core is built without run profile (NO_RUN_PROFILE)", nullptr},
+			{"checkpoint_file", locked_getter<SimulationPyObjectType_get_checkpoint_file>,
+			 idle_setter<SimulationPyObjectType_set_checkpoint_file>,
+			 "file to save checkpoints periodically during run, None to disable <-> str", nullptr},
+			{"checkpoint_interval", locked_getter<SimulationPyObjectType_get_checkpoint_interval>,
+			 idle_setter<SimulationPyObjectType_set_checkpoint_interval>,
+			 "simulation time (day) between two periodic checkpoints, 0 to disable <-> float\n"
+			 "the checkpoint file is overwritten each time", nullptr},
+			{"max_steps", locked_getter<SimulationPyObjectType_get_max_steps>,
+			 idle_setter<SimulationPyObjectType_set_max_steps>,
+			 "timesteps each run() or resume() may advance, 0 for no limit <-> int\n"
+			 "the run stops exactly after the budget and raises IebprRunStopped; "
+			 "results are the same as of an uninterrupted run", nullptr},
+			{"max_wall_time", locked_getter<SimulationPyObjectType_get_max_wall_time>,
+			 idle_setter<SimulationPyObjectType_set_max_wall_time>,
+			 "seconds each run() or resume() may take, 0 for no limit <-> float\n"
+			 "checked between spans of up to 1024 timesteps, then raises IebprRunStopped", nullptr},
+			{"deadline", locked_getter<SimulationPyObjectType_get_deadline>,
+			 idle_setter<SimulationPyObjectType_set_deadline>,
+			 "wall clock time (as time.time()) to stop runs at, None for no deadline <-> float\n"
+			 "checked between spans of up to 1024 timesteps, then raises IebprRunStopped", nullptr},
+			{"handle_sigint", locked_getter<SimulationPyObjectType_get_handle_sigint>,
+			 idle_setter<SimulationPyObjectType_set_handle_sigint>,
+			 "stop runs on sigint (ctrl-c) and raise KeyboardInterrupt <-> bool\n"
+			 "True by default; while a run is going, the process handler is replaced, "
+			 "and sigint stops all simulations running meanwhile; set False to leave "
+			 "signals to the host application", nullptr},
+			{"perf_counters", locked_getter<SimulationPyObjectType_get_perf_counters>,
+			 idle_setter<SimulationPyObjectType_set_perf_counters>,
+			 "sample hardware performance counters (cycles, instructions, llc misses, "
+			 "branch misses) by section of the main loop into last_run_profile <-> bool\n"
+			 "linux only; events that cannot be opened, e.g. due to perf_event_paranoid "
+			 "or a virtualized cpu, are silently left out", nullptr},
+			{"trace_file", locked_getter<SimulationPyObjectType_get_trace_file>,
+			 idle_setter<SimulationPyObjectType_set_trace_file>,
+			 "file to write a trace event timeline (json, for perfetto or chrome://tracing) "
+			 "of each run() or resume(), None to disable <-> str\n"
+			 "spans of stages, cycles and phases, snapshot and state records, work "
+			 "chunks and agent splits; the file is overwritten each time", nullptr},
+			{"trace_sample_interval", locked_getter<SimulationPyObjectType_get_trace_sample_interval>,
+			 idle_setter<SimulationPyObjectType_set_trace_sample_interval>,
+			 "in the trace, aggregate work chunks and agent splits over, and take one "
+			 "state record event out of, this many main loop spans (of up to 1024 "
+			 "timesteps) <-> int\nraise to bound the trace file size", nullptr},
+			{"result_shm", locked_getter<SimulationPyObjectType_get_result_shm>,
+			 idle_setter<SimulationPyObjectType_set_result_shm>,
+			 "name of a posix shared memory object (e.g. multiprocessing.shared_memory.SharedMemory.name), "
+			 "to also write records into during runs, at result_shm_offset <-> str | None\n"
+			 "the object must hold result_arena_bytes from there; other processes map the records "
+			 "without copies by map_result_arena(); None to disable (default)", nullptr},
+			{"result_shm_offset", locked_getter<SimulationPyObjectType_get_result_shm_offset>,
+			 idle_setter<SimulationPyObjectType_set_result_shm_offset>,
+			 "offset of the result arena in result_shm, a multiple of 64 <-> int", nullptr},
+			{"result_arena_bytes", idle_getter<SimulationPyObjectType_get_result_arena_bytes>, nullptr,
+			 "bytes of the result arena needed by the next run() or resume(), of the current "
+			 "recording timepoints and agent subtypes -> int\na multiple of 64", nullptr},
 			{nullptr, nullptr, nullptr, nullptr, nullptr},
 		};
 
@@ -716,8 +2168,13 @@ namespace iebpr
 		{
 			auto o = PyType_GenericNew(type, args, kwargs);
 			if (o)
+			{
 				// initialize c++ object
 				new (&(((SimulationPyObject *)o)->cdata)) Simulation();
+				new (&(((SimulationPyObject *)o)->running)) std::atomic<bool>(false);
+				// interactive sessions expect ctrl-c to stop a run
+				((SimulationPyObject *)o)->cdata.run_control.handle_sigint = true;
+			}
 			return o;
 		}
 
@@ -811,6 +2268,21 @@ namespace iebpr
 				PyModule_AddObjectRef(m, "AgentStateRecDescr", AgentStateRecDescr))
 				return -1;
 
+			// run profile types
+			if (!(HwSectionProfileType = PyStructSequence_NewType(&HwSectionProfileDesc)) ||
+				PyModule_AddType(m, HwSectionProfileType) ||
+				!(HwProfileType = PyStructSequence_NewType(&HwProfileDesc)) ||
+				PyModule_AddType(m, HwProfileType) ||
+				!(PhaseProfileType = PyStructSequence_NewType(&PhaseProfileDesc)) ||
+				PyModule_AddType(m, PhaseProfileType) ||
+				!(SubtypeProfileType = PyStructSequence_NewType(&SubtypeProfileDesc)) ||
+				PyModule_AddType(m, SubtypeProfileType) ||
+				!(RunProfileType = PyStructSequence_NewType(&RunProfileDesc)) ||
+				PyModule_AddType(m, RunProfileType) ||
+				!(RunProgressType = PyStructSequence_NewType(&RunProgressDesc)) ||
+				PyModule_AddType(m, RunProgressType))
+				return -1;
+
 			if (PyModule_AddType(m, &SimulationPyObjectType))
 				return -1;
 			return 0;
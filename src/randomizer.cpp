@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <sstream>
 #include "iebpr/randomizer.hpp"
 
 namespace iebpr
@@ -51,6 +52,31 @@ namespace iebpr
 		return;
 	}
 
+	void Randomizer::RandConfig::save_config(BinWriter &writer) const
+	{
+		writer.write_value<uint32_t>(type);
+		writer.write_value(mean);
+		writer.write_value(stddev);
+		writer.write_value(low);
+		writer.write_value(high);
+		writer.write_vector(value_list);
+		writer.write_value(non_neg);
+		writer.write_value(_scale);
+		return;
+	}
+
+	error_enum Randomizer::RandConfig::load_config(BinReader &reader)
+	{
+		uint32_t type_saved;
+		if (!(reader.read_value(type_saved) && reader.read_value(mean) &&
+			  reader.read_value(stddev) && reader.read_value(low) &&
+			  reader.read_value(high) && reader.read_vector(value_list) &&
+			  reader.read_value(non_neg) && reader.read_value(_scale)))
+			return checkpoint_bad_format;
+		type = (rand_t)type_saved;
+		return error_enum::none;
+	}
+
 	error_enum Randomizer::RandConfig::validate(Randomizer::rand_t force_type) const noexcept
 	{
 		// type check
@@ -76,6 +102,9 @@ namespace iebpr
 	void Randomizer::seed(seed_t seed) noexcept
 	{
 		engine.seed(seed);
+		// drop values cached in distributions from the old sequence
+		uniform_gen.reset();
+		normal_gen.reset();
 		return;
 	}
 
@@ -114,6 +143,99 @@ namespace iebpr
 		return ret;
 	}
 
+	void Randomizer::gen_values(const RandConfig &cfg, stvalue_t *dst, size_t n, size_t stride)
+	{
+		// dispatch once per column instead of once per value
+		const bool non_neg = cfg.non_neg;
+		switch (cfg.type)
+		{
+		case constant:
+		{
+			const auto v = cfg.mean * cfg._scale;
+			for (size_t i = 0; i < n; i++)
+				dst[i * stride] = v;
+			break;
+		}
+		case normal:
+			for (size_t i = 0; i < n; i++)
+			{
+				stvalue_t v;
+				do
+					v = (normal_gen(engine) * cfg.stddev + cfg.mean) * cfg._scale;
+				while (non_neg && (v < 0));
+				dst[i * stride] = v;
+			}
+			break;
+		case uniform:
+			for (size_t i = 0; i < n; i++)
+			{
+				stvalue_t v;
+				do
+					v = ((cfg.high - cfg.low) * uniform_gen(engine) + cfg.low) * cfg._scale;
+				while (non_neg && (v < 0));
+				dst[i * stride] = v;
+			}
+			break;
+		case bernoulli:
+			for (size_t i = 0; i < n; i++)
+			{
+				auto res = (bivalue_t)(uniform_gen(engine) <= cfg.mean);
+				std::memcpy(dst + i * stride, &res, sizeof(res));
+			}
+			break;
+		case obsvalues:
+			for (size_t i = 0; i < n; i++)
+				dst[i * stride] = _obsvalues_gen_handler(cfg) * cfg._scale;
+			break;
+		case none:
+		default:
+			for (size_t i = 0; i < n; i++)
+				std::memset(dst + i * stride, 0x0, sizeof(stvalue_t));
+			break;
+		}
+		return;
+	}
+
+	// the standard library only guarantees the text representation of
+	// engine/distribution states, which includes the cached value of
+	// normal_gen; wrap it up as strings
+	template <typename T>
+	static void _save_text_state(BinWriter &writer, const T &obj)
+	{
+		std::ostringstream ss;
+		ss << obj;
+		writer.write_string(ss.str());
+		return;
+	}
+
+	template <typename T>
+	static bool _load_text_state(BinReader &reader, T &obj)
+	{
+		std::string s;
+		if (!reader.read_string(s))
+			return false;
+		std::istringstream ss(s);
+		ss >> obj;
+		return !ss.fail();
+	}
+
+	void Randomizer::save_state(BinWriter &writer) const
+	{
+		_save_text_state(writer, engine);
+		_save_text_state(writer, uniform_gen);
+		_save_text_state(writer, normal_gen);
+		return;
+	}
+
+	error_enum Randomizer::load_state(BinReader &reader)
+	{
+		if (_load_text_state(reader, engine) &&
+			_load_text_state(reader, uniform_gen) &&
+			_load_text_state(reader, normal_gen))
+			return error_enum::none;
+		return checkpoint_bad_format;
+	}
+
 	stvalue_t Randomizer::_obsvalues_gen_handler(const RandConfig &cfg)
 	{
 		const auto &vals = cfg.value_list;
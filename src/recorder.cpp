@@ -1,3 +1,4 @@
+#include <cstring>
 #include "iebpr/recorder.hpp"
 
 namespace iebpr
@@ -7,11 +8,12 @@ namespace iebpr
 		return none;
 	}
 
-	void Recorder::prerun_init(const AgentPool &pool)
+	void Recorder::prerun_init(const SbrControl &sbr, const AgentPool &pool)
 	{
 		// sort timepoints
 		std::sort(state_rec_timepoints.begin(), state_rec_timepoints.end());
 		std::sort(snapshot_rec_timepoints.begin(), snapshot_rec_timepoints.end());
+		_compile_rec_steps(sbr);
 
 		// clear only record and reserve space for new record
 		env_state_rec.clear();
@@ -26,6 +28,7 @@ namespace iebpr
 		for (auto &v : snapshot_rec)
 			v.reserve(snapshot_rec_timepoints.size());
 		_next_snapshot_rec_time_itr = snapshot_rec_timepoints.begin();
+		_count_rec_bytes();
 		return;
 	}
 
@@ -64,6 +67,168 @@ namespace iebpr
 		return none;
 	}
 
+	void Recorder::save_config(BinWriter &writer) const
+	{
+		writer.write_vector(state_rec_timepoints);
+		writer.write_vector(snapshot_rec_timepoints);
+		return;
+	}
+
+	error_enum Recorder::load_config(BinReader &reader)
+	{
+		if (!(reader.read_vector(state_rec_timepoints) && reader.read_vector(snapshot_rec_timepoints)))
+			return checkpoint_bad_format;
+		_next_state_rec_time_itr = state_rec_timepoints.begin();
+		_next_snapshot_rec_time_itr = snapshot_rec_timepoints.begin();
+		return none;
+	}
+
+	void Recorder::save_progress(BinWriter &writer) const
+	{
+		writer.write_vector(state_rec_timepoints);
+		writer.write_vector(snapshot_rec_timepoints);
+		writer.write_vector(env_state_rec);
+		// agent state and snapshot records are nested vectors
+		writer.write_value<uint64_t>(agent_state_rec.size());
+		for (auto &v : agent_state_rec)
+			writer.write_vector(v);
+		writer.write_value<uint64_t>(snapshot_rec.size());
+		for (auto &v : snapshot_rec)
+		{
+			writer.write_value<uint64_t>(v.size());
+			for (auto &snapshot : v)
+				writer.write_vector(snapshot);
+		}
+		writer.write_value<uint64_t>(_next_state_rec_time_itr - state_rec_timepoints.begin());
+		writer.write_value<uint64_t>(_next_snapshot_rec_time_itr - snapshot_rec_timepoints.begin());
+		return;
+	}
+
+	error_enum Recorder::load_progress(BinReader &reader)
+	{
+		// timepoints are sorted in prerun_init(), compare as is
+		std::vector<stvalue_t> timepoints;
+		if (!reader.read_vector(timepoints))
+			return checkpoint_bad_format;
+		if (timepoints != state_rec_timepoints)
+			return checkpoint_config_mismatch;
+		if (!reader.read_vector(timepoints))
+			return checkpoint_bad_format;
+		if (timepoints != snapshot_rec_timepoints)
+			return checkpoint_config_mismatch;
+
+		uint64_t n_rec, n_subtype;
+		if (!reader.read_vector(env_state_rec))
+			return checkpoint_bad_format;
+		if (!reader.read_value(n_rec) || (n_rec != env_state_rec.size()))
+			return checkpoint_bad_format;
+		agent_state_rec.resize(n_rec);
+		for (auto &v : agent_state_rec)
+			if (!reader.read_vector(v))
+				return checkpoint_bad_format;
+		if (!reader.read_value(n_subtype))
+			return checkpoint_bad_format;
+		if (n_subtype != snapshot_rec.size())
+			return checkpoint_config_mismatch;
+		for (auto &v : snapshot_rec)
+		{
+			// timepoints may be changed during a run, so n_rec is not
+			// bounded by the number of timepoints
+			if (!reader.read_value(n_rec) || (n_rec > reader.remain()))
+				return checkpoint_bad_format;
+			v.resize(n_rec);
+			for (auto &snapshot : v)
+				if (!reader.read_vector(snapshot))
+					return checkpoint_bad_format;
+		}
+		uint64_t state_idx, snapshot_idx;
+		if (!(reader.read_value(state_idx) && reader.read_value(snapshot_idx)))
+			return checkpoint_bad_format;
+		if ((state_idx > state_rec_timepoints.size()) ||
+			(snapshot_idx > snapshot_rec_timepoints.size()))
+			return checkpoint_bad_format;
+		_next_state_rec_time_itr = state_rec_timepoints.begin() + state_idx;
+		_next_snapshot_rec_time_itr = snapshot_rec_timepoints.begin() + snapshot_idx;
+		_count_rec_bytes();
+		return none;
+	}
+
+	void Recorder::fork_from(const Recorder &other)
+	{
+		state_rec_timepoints = other.state_rec_timepoints;
+		snapshot_rec_timepoints = other.snapshot_rec_timepoints;
+		env_state_rec = other.env_state_rec;
+		agent_state_rec = other.agent_state_rec;
+		snapshot_rec = other.snapshot_rec;
+		_next_state_rec_time_itr = state_rec_timepoints.begin() +
+								   (other._next_state_rec_time_itr - other.state_rec_timepoints.begin());
+		_next_snapshot_rec_time_itr = snapshot_rec_timepoints.begin() +
+									  (other._next_snapshot_rec_time_itr - other.snapshot_rec_timepoints.begin());
+		_state_rec_steps = other._state_rec_steps;
+		_snapshot_rec_steps = other._snapshot_rec_steps;
+		_state_rec_bytes = other._state_rec_bytes;
+		_snapshot_rec_bytes = other._snapshot_rec_bytes;
+		return;
+	}
+
+	void Recorder::relocate_progress(const SbrControl &sbr)
+	{
+		std::sort(state_rec_timepoints.begin(), state_rec_timepoints.end());
+		std::sort(snapshot_rec_timepoints.begin(), snapshot_rec_timepoints.end());
+		_compile_rec_steps(sbr);
+		const auto curr_step = sbr.get_curr_step();
+		_next_state_rec_time_itr = state_rec_timepoints.begin() +
+								   (std::upper_bound(_state_rec_steps.begin(), _state_rec_steps.end(), curr_step) -
+									_state_rec_steps.begin());
+		_next_snapshot_rec_time_itr = snapshot_rec_timepoints.begin() +
+									  (std::upper_bound(_snapshot_rec_steps.begin(), _snapshot_rec_steps.end(), curr_step) -
+									   _snapshot_rec_steps.begin());
+		return;
+	}
+
+	void Recorder::_count_rec_bytes(void) noexcept
+	{
+		_state_rec_bytes = env_state_rec.size() * sizeof(EnvStateRecEntry);
+		for (const auto &v : agent_state_rec)
+			_state_rec_bytes += v.size() * sizeof(AgentStateRecEntry);
+		_snapshot_rec_bytes = 0;
+		for (const auto &v : snapshot_rec)
+			for (const auto &snapshot : v)
+				_snapshot_rec_bytes += snapshot.size() * sizeof(AgentStateRecEntry);
+		return;
+	}
+
+	uint64_t Recorder::steps_to_next_record(const SbrControl &sbr) const noexcept
+	{
+		auto ret = SbrControl::no_step;
+		const auto curr_step = sbr.get_curr_step();
+		// an overdue record is taken after the next step
+		auto steps_to = [curr_step](uint64_t step)
+		{ return (step > curr_step) ? (step - curr_step) : 1; };
+		if (_next_state_rec_time_itr != state_rec_timepoints.end())
+			ret = std::min(ret, steps_to(_state_rec_steps[_next_state_rec_time_itr -
+														  state_rec_timepoints.begin()]));
+		if (_next_snapshot_rec_time_itr != snapshot_rec_timepoints.end())
+			ret = std::min(ret, steps_to(_snapshot_rec_steps[_next_snapshot_rec_time_itr -
+															 snapshot_rec_timepoints.begin()]));
+		return ret;
+	}
+
+	void Recorder::_compile_rec_steps(const SbrControl &sbr)
+	{
+		// records are taken after a timestep update, so the earliest is at
+		// step 1
+		auto to_step = [&sbr](stvalue_t time)
+		{ return std::max<uint64_t>(sbr.time_to_step(time), 1); };
+		_state_rec_steps.resize(state_rec_timepoints.size());
+		std::transform(state_rec_timepoints.begin(), state_rec_timepoints.end(),
+					   _state_rec_steps.begin(), to_step);
+		_snapshot_rec_steps.resize(snapshot_rec_timepoints.size());
+		std::transform(snapshot_rec_timepoints.begin(), snapshot_rec_timepoints.end(),
+					   _snapshot_rec_steps.begin(), to_step);
+		return;
+	}
+
 	void Recorder::record(const SbrControl &sbr, const AgentPool &pool)
 	{
 		_state_record(sbr, pool);
@@ -74,7 +239,7 @@ namespace iebpr
 	void Recorder::_state_record(const SbrControl &sbr, const AgentPool &pool)
 	{
 		if ((_next_state_rec_time_itr == state_rec_timepoints.end()) ||
-			(sbr.get_curr_time() < *_next_state_rec_time_itr))
+			(sbr.get_curr_step() < _state_rec_steps[_next_state_rec_time_itr - state_rec_timepoints.begin()]))
 			return;
 		// env state record
 		env_state_rec.push_back(sbr.env);
@@ -82,7 +247,13 @@ namespace iebpr
 		auto rec = std::vector<AgentStateRecEntry>(0);
 		for (auto &v : pool.agent_subtype)
 			rec.push_back(v->summarize_agent_state());
+		_state_rec_bytes += sizeof(EnvStateRecEntry) + rec.size() * sizeof(AgentStateRecEntry);
 		agent_state_rec.push_back(rec);
+		if (_arena.is_open())
+		{
+			_arena_state_record(env_state_rec.size() - 1);
+			_arena_set_taken();
+		}
 		//
 		_next_state_rec_time_itr++;
 		return;
@@ -91,23 +262,110 @@ namespace iebpr
 	void Recorder::_snapshot_record(const SbrControl &sbr, const AgentPool &pool)
 	{
 		if ((_next_snapshot_rec_time_itr == snapshot_rec_timepoints.end()) ||
-			(sbr.get_curr_time() < *_next_snapshot_rec_time_itr))
+			(sbr.get_curr_step() < _snapshot_rec_steps[_next_snapshot_rec_time_itr - snapshot_rec_timepoints.begin()]))
 			return;
 		// take snapshot by subtype
 		for (size_t i = 0; i < pool.n_subtype(); i++)
 		{
 			auto _n = pool.agent_subtype[i]->n_agent;
-			auto snapshot = std::vector<AgentStateRecEntry>(_n);
-			std::transform(pool.agent_subtype[i]->pool_begin(),
-						   pool.agent_subtype[i]->pool_end(),
-						   snapshot.begin(),
-						   [](const AgentData &agent)
-						   { return AgentStateRecEntry(agent.state); });
+			auto snapshot = pool_vector<AgentStateRecEntry>(_n);
+			auto dst = snapshot.begin();
+			pool.stream_agents(pool.agent_subtype[i]->pool_begin(),
+							   pool.agent_subtype[i]->pool_end(),
+							   [&dst](AgentSubtypeBase::agent_itr_t begin, AgentSubtypeBase::agent_itr_t end)
+							   {
+								   dst = std::transform(begin, end, dst,
+														[](const AgentData &agent)
+														{ return AgentStateRecEntry(agent.state); });
+							   });
+			_snapshot_rec_bytes += _n * sizeof(AgentStateRecEntry);
 			snapshot_rec[i].push_back(std::move(snapshot));
 		}
+		if (_arena.is_open() && (!snapshot_rec.empty()))
+		{
+			_arena_snapshot_record(snapshot_rec.front().size() - 1);
+			_arena_set_taken();
+		}
 		//
 		_next_snapshot_rec_time_itr++;
 		return;
 	}
 
+	ResultArena::Shape Recorder::result_arena_shape(const AgentPool &pool, bool in_progress) const
+	{
+		auto shape = ResultArena::Shape();
+		shape.env_entry_size = sizeof(EnvStateRecEntry);
+		shape.agent_entry_size = sizeof(AgentStateRecEntry);
+		shape.n_state_rec = state_rec_timepoints.size();
+		shape.n_snapshot_rec = snapshot_rec_timepoints.size();
+		if (in_progress)
+		{
+			// timepoints changed during a run may leave more records than
+			// timepoints
+			shape.n_state_rec = std::max<uint64_t>(
+				shape.n_state_rec, env_state_rec.size() +
+									   (state_rec_timepoints.end() - _next_state_rec_time_itr));
+			shape.n_snapshot_rec = std::max<uint64_t>(
+				shape.n_snapshot_rec, (snapshot_rec.empty() ? 0 : snapshot_rec.front().size()) +
+										  (snapshot_rec_timepoints.end() - _next_snapshot_rec_time_itr));
+		}
+		for (auto &v : pool.agent_subtype)
+			shape.subtypes.push_back({(uint32_t)v->subtype(), 0, v->n_agent, 0});
+		return shape;
+	}
+
+	error_enum Recorder::attach_arena(const std::string &name, uint64_t offset, const AgentPool &pool)
+	{
+		_arena_shape = result_arena_shape(pool, true);
+		if (auto ret = _arena.open(name, offset, _arena_shape))
+			return ret;
+		for (size_t i = 0; i < env_state_rec.size(); i++)
+			_arena_state_record(i);
+		for (size_t i = 0; i < (snapshot_rec.empty() ? 0 : snapshot_rec.front().size()); i++)
+			_arena_snapshot_record(i);
+		_arena_set_taken();
+		return none;
+	}
+
+	void Recorder::detach_arena(void) noexcept
+	{
+		_arena.close();
+		return;
+	}
+
+	void Recorder::_arena_state_record(size_t i) noexcept
+	{
+		if (i >= _arena_shape.n_state_rec)
+			return;
+		const auto n_subtype = _arena_shape.subtypes.size();
+		std::memcpy((EnvStateRecEntry *)_arena.at(_arena_shape.env_offset) + i,
+					&env_state_rec[i], sizeof(EnvStateRecEntry));
+		std::memcpy((AgentStateRecEntry *)_arena.at(_arena_shape.agent_offset) + i * n_subtype,
+					agent_state_rec[i].data(), n_subtype * sizeof(AgentStateRecEntry));
+		return;
+	}
+
+	void Recorder::_arena_snapshot_record(size_t i) noexcept
+	{
+		if (i >= _arena_shape.n_snapshot_rec)
+			return;
+		for (size_t j = 0; j < _arena_shape.subtypes.size(); j++)
+		{
+			const auto &subtype = _arena_shape.subtypes[j];
+			const auto &snapshot = snapshot_rec[j][i];
+			std::memcpy((AgentStateRecEntry *)_arena.at(subtype.snapshot_offset) + i * subtype.n_agent,
+						snapshot.data(),
+						std::min<size_t>(snapshot.size(), subtype.n_agent) * sizeof(AgentStateRecEntry));
+		}
+		return;
+	}
+
+	void Recorder::_arena_set_taken(void) noexcept
+	{
+		const uint64_t n_snapshot = snapshot_rec.empty() ? 0 : snapshot_rec.front().size();
+		_arena.set_taken(std::min<uint64_t>(env_state_rec.size(), _arena_shape.n_state_rec),
+						 std::min<uint64_t>(n_snapshot, _arena_shape.n_snapshot_rec));
+		return;
+	}
+
 } // namespace iebpr
\ No newline at end of file
@@ -0,0 +1,861 @@
+// lane vectors never cross a call boundary, all lane functions are inlined
+// into the kernels, thus the abi of passing them is of no concern
+#pragma GCC diagnostic ignored "-Wpsabi"
+// agent kinetics must round as the scalar ones, i.e. without fused multiply-add
+// where the target (avx512f) has it
+#pragma GCC optimize("fp-contract=off")
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+#include "iebpr/replicate_batch.hpp"
+#include "iebpr/agent_kinetics.hpp"
+#include "iebpr/kernel_dispatch.hpp"
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define IEBPR_KERNEL_X86
+#endif
+
+namespace iebpr
+{
+	//==========================================================================
+	// lanes of the same agent in width replicates, see agent_kinetics.hpp; the
+	// width is that of the native vectors of a kernel isa, since gcc falls
+	// back to scalar compares on wider vectors; for avx512f, compares in the
+	// inlined kinetics keep the mask type of the generic target and are also
+	// done by lanes over 8 lanes, thus it uses 4 lanes as avx2
+
+	// vector types of width lanes, only aligned as the elements, so that
+	// lanes of a single agent may be anywhere; agent data lanes of a batch are
+	// aligned to the vectors, see _LaneGroup; gcc does not take a vector_size
+	// that depends on a template parameter
+	template <size_t width>
+	struct _LaneVector;
+
+#define _define_lane_vector(width)                                                            \
+	template <>                                                                               \
+	struct _LaneVector<width>                                                                 \
+	{                                                                                         \
+		typedef stvalue_t value_t __attribute__((vector_size(width * sizeof(stvalue_t)),      \
+												 aligned(sizeof(stvalue_t))));                \
+		typedef bivalue_t mask_t __attribute__((vector_size(width * sizeof(bivalue_t)),      \
+												aligned(sizeof(bivalue_t))));                 \
+	}
+
+	_define_lane_vector(2);
+	_define_lane_vector(4);
+
+	template <size_t width>
+	struct VectorLanes
+	{
+	public:
+		using value_t = typename _LaneVector<width>::value_t;
+		using mask_t = typename _LaneVector<width>::mask_t;
+
+		struct env_t
+		{
+		public:
+			value_t vfa_conc;
+			value_t op_conc;
+
+			explicit env_t(void) noexcept
+				: vfa_conc(), op_conc() {}
+		};
+
+		// same fields as AgentState
+		struct state_t
+		{
+		public:
+			value_t biomass;
+			value_t rela_count;
+			value_t split_biomass;
+			value_t glycogen;
+			value_t pha;
+			value_t polyp;
+
+			explicit state_t(void) noexcept
+				: biomass(), rela_count(), split_biomass(), glycogen(), pha(), polyp() {}
+		};
+
+		// same fields as AgentData, each as lanes of replicates; bool traits
+		// are kept as their raw values, true if not 0
+		struct agent_t
+		{
+		public:
+			state_t state;
+			struct
+			{
+				struct
+				{
+					value_t mu, q_glycogen, q_pha, q_polyp;
+					value_t m_aerobic, m_anaerobic;
+					value_t b_aerobic, b_anaerobic, b_glycogen, b_pha, b_polyp;
+				} rate;
+				struct
+				{
+					value_t x_glycogen_min, x_glycogen_max, x_pha_min, x_pha_max, x_polyp_min, x_polyp_max;
+					value_t k_hac, k_op, k_op_polyp, k_glycogen, k_pha, k_polyp;
+					value_t ki_glycogen, ki_pha, ki_polyp;
+					value_t y_h, y_glycogen_pha, y_polyp_pha, y_pha_hac, y_prel, i_bmp;
+				} reg;
+				struct
+				{
+					mask_t enable_tca, maint_polyp_first;
+				} bt;
+			} trait;
+
+			// same as AgentData
+			kinetics_inline mask_t is_active(void) const noexcept { return state.biomass > 0; };
+			kinetics_inline value_t monod_vfa(const env_t &env) const noexcept { return env.vfa_conc / (env.vfa_conc + trait.reg.k_hac); };
+			kinetics_inline value_t monod_op(const env_t &env) const noexcept { return env.op_conc / (env.op_conc + trait.reg.k_op); };
+			kinetics_inline value_t x_glycogen(void) const noexcept { return select(is_active(), state.glycogen / state.biomass - trait.reg.x_glycogen_min, zero()); };
+			kinetics_inline value_t x_pha(void) const noexcept { return select(is_active(), state.pha / state.biomass - trait.reg.x_pha_min, zero()); };
+			kinetics_inline value_t x_polyp(void) const noexcept { return select(is_active(), state.polyp / state.biomass - trait.reg.x_polyp_min, zero()); };
+			kinetics_inline value_t monod_glycogen(void) const noexcept { return x_glycogen() / (x_glycogen() + trait.reg.k_glycogen); };
+			kinetics_inline value_t monod_pha(void) const noexcept { return x_pha() / (x_pha() + trait.reg.k_pha); };
+			kinetics_inline value_t monod_polyp(void) const noexcept { return x_polyp() / (x_polyp() + trait.reg.k_polyp); };
+			kinetics_inline value_t i_glycogen(void) const noexcept { return select(is_active(), trait.reg.x_glycogen_max - state.glycogen / state.biomass, zero()); };
+			kinetics_inline value_t i_pha(void) const noexcept { return select(is_active(), trait.reg.x_pha_max - state.pha / state.biomass, zero()); };
+			kinetics_inline value_t i_polyp(void) const noexcept { return select(is_active(), trait.reg.x_polyp_max - state.polyp / state.biomass, zero()); };
+			kinetics_inline value_t inhib_glycogen(void) const noexcept { return i_glycogen() / (i_glycogen() + trait.reg.ki_glycogen); };
+			kinetics_inline value_t inhib_pha(void) const noexcept { return i_pha() / (i_pha() + trait.reg.ki_pha); };
+			kinetics_inline value_t inhib_polyp(void) const noexcept { return i_polyp() / (i_polyp() + trait.reg.ki_polyp); };
+		};
+
+		struct uptake_t
+		{
+		public:
+			value_t vfa_scale;
+			value_t op_scale;
+			value_t vfa;
+			value_t op;
+
+			explicit uptake_t(void) noexcept
+				: vfa_scale(value_t() + 1), op_scale(value_t() + 1), vfa(), op() {}
+		};
+
+		static kinetics_inline value_t zero(void) noexcept { return value_t(); }
+		static kinetics_inline mask_t test(const mask_t &bt) noexcept { return bt != 0; }
+		static kinetics_inline bool any(const mask_t &act) noexcept
+		{
+			mask_t m = act;
+#ifdef IEBPR_KERNEL_X86
+			// keeps the mask in a vector register; reduced by lanes as is,
+			// gcc turns the compares behind the mask into scalar ones
+			__asm__("" : "+v"(m));
+#endif
+			bivalue_t ret = 0;
+			for (size_t i = 0; i < width; i++)
+				ret |= m[i];
+			return ret != 0;
+		}
+		static kinetics_inline bool all(const mask_t &act, const mask_t &m) noexcept { return !any(act & ~m); }
+		// masks are of compares, all bits of a lane set or clear, so select
+		// blends bits; gcc takes a mask as a vector condition by comparing it
+		// to 0 again
+		static kinetics_inline value_t select(const mask_t &m, const value_t &a, const value_t &b) noexcept
+		{
+			return (value_t)((m & (mask_t)a) | (~m & (mask_t)b));
+		}
+		// as std::min()
+		static kinetics_inline value_t min(const value_t &a, const value_t &b) noexcept { return select(b < a, b, a); }
+		static kinetics_inline void add(const mask_t &m, value_t &acc, const value_t &v) noexcept
+		{
+			acc = select(m, acc + v, acc);
+			return;
+		}
+		static kinetics_inline void sub(const mask_t &m, value_t &acc, const value_t &v) noexcept
+		{
+			acc = select(m, acc - v, acc);
+			return;
+		}
+		// AgentState::merge_with() in lanes act, a lane is cleared if the
+		// biomass turns non-positive, otherwise negative contents are clamped
+		static kinetics_inline void merge_state(const mask_t &act, state_t &state, const state_t &d_state) noexcept
+		{
+			const value_t biomass = state.biomass + d_state.biomass;
+			const mask_t keep = act & (biomass > 0);
+			state.biomass = select(act, select(keep, biomass, zero()), state.biomass);
+			_merge_field(act, keep, state.rela_count, d_state.rela_count);
+			_merge_field(act, keep, state.split_biomass, d_state.split_biomass);
+			_merge_field(act, keep, state.glycogen, d_state.glycogen);
+			_merge_field(act, keep, state.pha, d_state.pha);
+			_merge_field(act, keep, state.polyp, d_state.polyp);
+			return;
+		}
+		static kinetics_inline void _merge_field(const mask_t &act, const mask_t &keep, value_t &x, const value_t &dx) noexcept
+		{
+			const value_t y = x + dx;
+			x = select(act, select(keep, select(y < 0, zero(), y), zero()), x);
+			return;
+		}
+	};
+
+	static_assert((AgentState::arr_size() == 6) && (AgentRateTrait::arr_size() == 11) &&
+					  (AgentRegularTrait::arr_size() == 21) && (AgentBoolTrait::arr_size() == 2),
+				  "lanes outdated");
+
+	// the i-th field of AgentData is the i-th value_t of agent_t
+	constexpr static size_t _n_agent_field = sizeof(AgentData) / agent_field_size;
+
+	template <size_t width>
+	static void _set_lane(typename VectorLanes<width>::agent_t &lanes, size_t lane, const AgentData &agent) noexcept
+	{
+		auto dst = reinterpret_cast<char *>(&lanes) + lane * agent_field_size;
+		auto src = reinterpret_cast<const char *>(&agent);
+		for (size_t i = 0; i < _n_agent_field; i++)
+			std::memcpy(dst + i * width * agent_field_size, src + i * agent_field_size, agent_field_size);
+		return;
+	}
+
+	template <size_t width>
+	static void _get_lane(const typename VectorLanes<width>::agent_t &lanes, size_t lane, AgentData &agent) noexcept
+	{
+		auto src = reinterpret_cast<const char *>(&lanes) + lane * agent_field_size;
+		auto dst = reinterpret_cast<char *>(&agent);
+		for (size_t i = 0; i < _n_agent_field; i++)
+			std::memcpy(dst + i * agent_field_size, src + i * width * agent_field_size, agent_field_size);
+		return;
+	}
+
+	//==========================================================================
+	// agent pools of up to width replicates, replicate-major
+
+	struct _SubtypeRange
+	{
+		AgentSubtypeBase::subtype_enum subtype;
+		size_t begin;
+		size_t end;
+	};
+
+	// allocator aligned to align bytes, which is at least that of a pointer;
+	// the heap only aligns as max_align_t before c++17
+	template <typename T, size_t align>
+	struct _AlignedAllocator
+	{
+		using value_type = T;
+		template <typename U>
+		struct rebind
+		{
+			using other = _AlignedAllocator<U, align>;
+		};
+
+		_AlignedAllocator(void) noexcept {}
+		template <typename U>
+		_AlignedAllocator(const _AlignedAllocator<U, align> &) noexcept {}
+
+		// the base pointer is kept in front of the aligned block
+		T *allocate(size_t n)
+		{
+			if (n > (size_t(-1) - align - sizeof(void *)) / sizeof(T))
+				throw std::bad_alloc();
+			auto base = (char *)::operator new(n * sizeof(T) + align + sizeof(void *));
+			auto ptr = base + sizeof(void *);
+			ptr += (align - (uintptr_t)ptr % align) % align;
+			std::memcpy(ptr - sizeof(void *), &base, sizeof(void *));
+			return (T *)ptr;
+		}
+		void deallocate(T *ptr, size_t) noexcept
+		{
+			void *base;
+			std::memcpy(&base, (char *)ptr - sizeof(void *), sizeof(void *));
+			::operator delete(base);
+			return;
+		}
+	};
+
+	template <typename T, typename U, size_t align>
+	inline bool operator==(const _AlignedAllocator<T, align> &, const _AlignedAllocator<U, align> &) noexcept
+	{
+		return true;
+	}
+	template <typename T, typename U, size_t align>
+	inline bool operator!=(const _AlignedAllocator<T, align> &, const _AlignedAllocator<U, align> &) noexcept
+	{
+		return false;
+	}
+
+	template <size_t width>
+	struct _LaneGroup
+	{
+	public:
+		using lanes_t = VectorLanes<width>;
+		// bytes of a lane vector
+		constexpr static size_t align = sizeof(typename lanes_t::value_t);
+
+		std::vector<Simulation *> replicates;
+		// agent subtypes, the same in all replicates
+		std::vector<_SubtypeRange> ranges;
+		// subtype instance of each replicate, indexed by range * width + lane
+		std::vector<AgentSubtypeBase *> subtypes;
+		// aligned to lane vectors, so that they are loaded as aligned
+		std::vector<typename lanes_t::agent_t, _AlignedAllocator<typename lanes_t::agent_t, align>> agents;
+
+		static_assert(sizeof(typename lanes_t::agent_t) == sizeof(AgentData) * width, "lanes outdated");
+		static_assert(sizeof(typename lanes_t::agent_t) % align == 0, "agents misaligned");
+	};
+
+	// AgentSubtypeBase::agent_split() in one lane; the split agent is
+	// processed in scalar, since splits are rare
+	template <size_t width>
+	static void _lane_split(_LaneGroup<width> &group, size_t range_idx, size_t agent_idx, size_t lane,
+							bool aerobic)
+	{
+		const auto &range = group.ranges[range_idx];
+		auto &subtype = *group.subtypes[range_idx * width + lane];
+		if (subtype.n_agent <= 1)
+			return;
+
+		auto agent = AgentData();
+		_get_lane<width>(group.agents[agent_idx], lane, agent);
+		// update the splitting agent state, except split_biomass and rela_count
+		auto sb = agent.state.split_biomass;
+		auto rc = agent.state.rela_count;
+		agent.state.scale_state_content(0.5);
+		agent.state.split_biomass = sb;
+		agent.state.rela_count = rc;
+		_set_lane<width>(group.agents[agent_idx], lane, agent);
+		const AgentState split_state = agent.state;
+
+		// find the two agents with lowest biomass and merge, in the same order
+		// as the scalar split
+		auto biomass = [&group, lane](size_t i)
+		{ return group.agents[i].state.biomass[lane]; };
+		size_t to_merge[2] = {range.begin, range.begin + 1};
+		auto sort = [&to_merge, &biomass](void)
+		{
+			if (biomass(to_merge[0]) <= biomass(to_merge[1]))
+				std::swap(to_merge[0], to_merge[1]);
+		};
+		sort();
+		for (size_t i = range.begin + 2; i < range.end; i++)
+			if (biomass(i) < biomass(to_merge[1]))
+			{
+				to_merge[1] = i;
+				sort();
+			}
+		auto merged = AgentData(), split = AgentData();
+		_get_lane<width>(group.agents[to_merge[1]], lane, merged);
+		_get_lane<width>(group.agents[to_merge[0]], lane, split);
+		merged.merge_with(split);
+		_set_lane<width>(group.agents[to_merge[1]], lane, merged);
+		// the merged one is used for the new split agent
+		split.state = split_state;
+		subtype.randomize_split_trait(split.trait);
+		_set_lane<width>(group.agents[to_merge[0]], lane, split);
+#ifndef NO_RUN_PROFILE
+		subtype.profile_counter.n_split[aerobic]++;
+		subtype.profile_counter.n_merge[aerobic]++;
+#endif
+		return;
+	}
+
+	// base subtype, no kinetics
+	template <typename L>
+	struct _NoKinetics
+	{
+	public:
+		using mask_t = typename L::mask_t;
+		using env_t = typename L::env_t;
+		using agent_t = typename L::agent_t;
+		using uptake_t = typename L::uptake_t;
+
+		static kinetics_inline void uptake_demand_aerobic(const mask_t &, const env_t &, env_t &, const agent_t &) noexcept {}
+		static kinetics_inline void uptake_demand_anaerobic(const mask_t &, const env_t &, env_t &, const agent_t &) noexcept {}
+		static kinetics_inline void action_aerobic(const mask_t &, const env_t &, env_t &, agent_t &, uptake_t &) noexcept {}
+		static kinetics_inline void action_anaerobic(const mask_t &, const env_t &, env_t &, agent_t &, uptake_t &) noexcept {}
+	};
+
+	// AgentSubtypeBase::agent_action() on all agents of a subtype, in order
+	template <typename kinetics_t, size_t width>
+	static kinetics_inline void _subtype_actions(_LaneGroup<width> &group, size_t range_idx,
+												 const typename VectorLanes<width>::env_t &env,
+												 typename VectorLanes<width>::env_t &d_env,
+												 typename VectorLanes<width>::uptake_t &uptake, bool aerobic)
+	{
+		using L = VectorLanes<width>;
+		const auto &range = group.ranges[range_idx];
+		for (size_t i = range.begin; i < range.end; i++)
+		{
+			auto &agent = group.agents[i];
+			const typename L::mask_t act = agent.is_active();
+			if (!L::any(act))
+				continue;
+			aerobic ? kinetics_t::action_aerobic(act, env, d_env, agent, uptake)
+					: kinetics_t::action_anaerobic(act, env, d_env, agent, uptake);
+			const typename L::mask_t split = act & agent.is_active() & (agent.state.biomass >= agent.state.split_biomass);
+			if (L::any(split))
+				for (size_t lane = 0; lane < group.replicates.size(); lane++)
+					if (split[lane])
+						_lane_split(group, range_idx, i, lane, aerobic);
+		}
+		return;
+	}
+
+	// AgentSubtypeBase::uptake_demand() of all agents of a subtype
+	template <typename kinetics_t, size_t width>
+	static kinetics_inline void _subtype_uptake_demand(const _LaneGroup<width> &group, size_t range_idx,
+													   const typename VectorLanes<width>::env_t &env,
+													   typename VectorLanes<width>::env_t &demand, bool aerobic)
+	{
+		using L = VectorLanes<width>;
+		const auto &range = group.ranges[range_idx];
+		for (size_t i = range.begin; i < range.end; i++)
+		{
+			const auto &agent = group.agents[i];
+			const typename L::mask_t act = agent.is_active();
+			if (!L::any(act))
+				continue;
+			aerobic ? kinetics_t::uptake_demand_aerobic(act, env, demand, agent)
+					: kinetics_t::uptake_demand_anaerobic(act, env, demand, agent);
+		}
+		return;
+	}
+
+	//==========================================================================
+	// lockstep kernels, compiled for each instruction set
+
+	template <size_t width>
+	static kinetics_inline void _agent_actions(_LaneGroup<width> &group, const typename VectorLanes<width>::env_t &env,
+											   typename VectorLanes<width>::env_t &d_env,
+											   typename VectorLanes<width>::uptake_t &uptake, bool aerobic)
+	{
+		using L = VectorLanes<width>;
+		for (size_t r = 0; r < group.ranges.size(); r++)
+			switch (group.ranges[r].subtype)
+			{
+			case AgentSubtypeBase::pao:
+				_subtype_actions<PaoKinetics<L>>(group, r, env, d_env, uptake, aerobic);
+				break;
+			case AgentSubtypeBase::gao:
+				_subtype_actions<GaoKinetics<L>>(group, r, env, d_env, uptake, aerobic);
+				break;
+			case AgentSubtypeBase::oho:
+				_subtype_actions<OhoKinetics<L>>(group, r, env, d_env, uptake, aerobic);
+				break;
+			default:
+				_subtype_actions<_NoKinetics<L>>(group, r, env, d_env, uptake, aerobic);
+				break;
+			}
+		return;
+	}
+
+	template <size_t width>
+	static kinetics_inline void _uptake_demand(const _LaneGroup<width> &group, const typename VectorLanes<width>::env_t &env,
+											   typename VectorLanes<width>::env_t &demand, bool aerobic)
+	{
+		using L = VectorLanes<width>;
+		for (size_t r = 0; r < group.ranges.size(); r++)
+			switch (group.ranges[r].subtype)
+			{
+			case AgentSubtypeBase::pao:
+				_subtype_uptake_demand<PaoKinetics<L>>(group, r, env, demand, aerobic);
+				break;
+			case AgentSubtypeBase::gao:
+				_subtype_uptake_demand<GaoKinetics<L>>(group, r, env, demand, aerobic);
+				break;
+			case AgentSubtypeBase::oho:
+				_subtype_uptake_demand<OhoKinetics<L>>(group, r, env, demand, aerobic);
+				break;
+			default:
+				break;
+			}
+		return;
+	}
+
+	// AgentState::scale_state_content() of all agents
+	template <size_t width>
+	static kinetics_inline void _scale_state_content(_LaneGroup<width> &group, stvalue_t factor)
+	{
+		if (factor <= 0)
+		{
+			for (auto &agent : group.agents)
+				agent.state = typename VectorLanes<width>::state_t();
+			return;
+		}
+		for (auto &agent : group.agents)
+		{
+			auto &state = agent.state;
+			state.biomass *= factor;
+			state.rela_count *= factor;
+			state.split_biomass *= factor;
+			state.glycogen *= factor;
+			state.pha *= factor;
+			state.polyp *= factor;
+		}
+		return;
+	}
+
+	template <size_t width>
+	struct _LockstepKernels
+	{
+	public:
+		using group_t = _LaneGroup<width>;
+		using env_t = typename VectorLanes<width>::env_t;
+		using uptake_t = typename VectorLanes<width>::uptake_t;
+		// one discrete timestep of agent actions
+		void (*agent_actions)(group_t &group, const env_t &env, env_t &d_env, uptake_t &uptake, bool aerobic);
+		// uptake demand of all agents, added to demand
+		void (*uptake_demand)(const group_t &group, const env_t &env, env_t &demand, bool aerobic);
+		void (*scale_state_content)(group_t &group, stvalue_t factor);
+	};
+
+#define _define_lockstep_kernels(isa, width, target_attr)                                            \
+	target_attr static void _agent_actions_##isa(_LaneGroup<width> &group,                           \
+												 const VectorLanes<width>::env_t &env,               \
+												 VectorLanes<width>::env_t &d_env,                   \
+												 VectorLanes<width>::uptake_t &uptake, bool aerobic) \
+	{                                                                                                \
+		_agent_actions(group, env, d_env, uptake, aerobic);                                          \
+	}                                                                                                \
+	target_attr static void _uptake_demand_##isa(const _LaneGroup<width> &group,                     \
+												 const VectorLanes<width>::env_t &env,               \
+												 VectorLanes<width>::env_t &demand, bool aerobic)    \
+	{                                                                                                \
+		_uptake_demand(group, env, demand, aerobic);                                                 \
+	}                                                                                                \
+	target_attr static void _scale_state_content_##isa(_LaneGroup<width> &group, stvalue_t factor)   \
+	{                                                                                                \
+		_scale_state_content(group, factor);                                                         \
+	}                                                                                                \
+	static const _LockstepKernels<width> _lockstep_kernels_##isa = {                                 \
+		_agent_actions_##isa, _uptake_demand_##isa, _scale_state_content_##isa}
+
+	// lanes as wide as the native vectors: sse2 (the x86-64 baseline) or the
+	// 128-bit simd of other targets, avx2, and avx512f with 4 lanes (see
+	// VectorLanes) but twice the registers
+	_define_lockstep_kernels(generic, 2, );
+#ifdef IEBPR_KERNEL_X86
+	_define_lockstep_kernels(avx2, 4, __attribute__((target("avx2"))));
+	_define_lockstep_kernels(avx512, 4, __attribute__((target("avx512f"))));
+#endif
+
+	//==========================================================================
+	// main loop
+
+	template <size_t width>
+	struct ReplicateBatch::Lockstep
+	{
+	public:
+		using lanes_t = VectorLanes<width>;
+
+		const std::vector<Simulation *> &replicates;
+		// the first replicate, leads phase transitions and records
+		Simulation &lead;
+		std::vector<_LaneGroup<width>> groups;
+		const _LockstepKernels<width> &kernels;
+
+		explicit Lockstep(const std::vector<Simulation *> &replicates, const _LockstepKernels<width> &kernels)
+			: replicates(replicates), lead(*replicates.front()), groups(0), kernels(kernels)
+		{
+			const auto &pool = lead.pool;
+			for (size_t begin = 0; begin < replicates.size(); begin += width)
+			{
+				auto group = _LaneGroup<width>();
+				const auto end = std::min(begin + width, replicates.size());
+				group.replicates.assign(replicates.begin() + begin, replicates.begin() + end);
+				for (auto &v : pool.agent_subtype)
+					group.ranges.push_back({v->subtype(), (size_t)(v->pool_begin() - pool.agent_data.begin()),
+											(size_t)(v->pool_end() - pool.agent_data.begin())});
+				group.subtypes.resize(group.ranges.size() * width, nullptr);
+				for (size_t i = 0; i < group.ranges.size(); i++)
+					for (size_t lane = 0; lane < group.replicates.size(); lane++)
+						group.subtypes[i * width + lane] =
+							group.replicates[lane]->pool.agent_subtype[i].get();
+				// lanes without a replicate stay inactive
+				group.agents.resize(pool.agent_data.size());
+				groups.push_back(std::move(group));
+			}
+		}
+
+		// copy agent data of replicates into lanes
+		void load_agents(void) noexcept
+		{
+			for (auto &group : groups)
+				for (size_t lane = 0; lane < group.replicates.size(); lane++)
+				{
+					const auto &agent_data = group.replicates[lane]->pool.agent_data;
+					for (size_t i = 0; i < agent_data.size(); i++)
+						_set_lane<width>(group.agents[i], lane, agent_data[i]);
+				}
+			return;
+		}
+
+		// copy agent data in lanes back to replicates
+		void store_agents(void) const noexcept
+		{
+			for (auto &group : groups)
+				for (size_t lane = 0; lane < group.replicates.size(); lane++)
+				{
+					auto &agent_data = group.replicates[lane]->pool.agent_data;
+					for (size_t i = 0; i < agent_data.size(); i++)
+						_get_lane<width>(group.agents[i], lane, agent_data[i]);
+				}
+			return;
+		}
+
+		// SbrControl::_timestep_update_agents_discrete() of all replicates
+		void timestep_update_agents(void)
+		{
+			const bool aerobic = lead.sbr.env.is_aerobic;
+			for (auto &group : groups)
+			{
+				auto env = typename lanes_t::env_t();
+				auto uptake = typename lanes_t::uptake_t();
+				bool depleting[width] = {false};
+				bool any_depleting = false;
+				for (size_t lane = 0; lane < group.replicates.size(); lane++)
+				{
+					const auto &sbr = group.replicates[lane]->sbr;
+					env.vfa_conc[lane] = sbr.env.vfa_conc;
+					env.op_conc[lane] = sbr.env.op_conc;
+					any_depleting |= (depleting[lane] = sbr._is_uptake_depleting());
+				}
+				if (any_depleting)
+				{
+					auto demand = typename lanes_t::env_t();
+					kernels.uptake_demand(group, env, demand, aerobic);
+					for (size_t lane = 0; lane < group.replicates.size(); lane++)
+					{
+						if (!depleting[lane])
+							continue;
+						auto lane_demand = EnvState();
+						lane_demand.vfa_conc = demand.vfa_conc[lane];
+						lane_demand.op_conc = demand.op_conc[lane];
+						const auto scale = group.replicates[lane]->sbr._implicit_uptake(lane_demand);
+						uptake.vfa_scale[lane] = scale.vfa_scale;
+						uptake.op_scale[lane] = scale.op_scale;
+					}
+				}
+				auto d_env = typename lanes_t::env_t();
+				kernels.agent_actions(group, env, d_env, uptake, aerobic);
+				for (size_t lane = 0; lane < group.replicates.size(); lane++)
+				{
+					auto lane_d_env = EnvState();
+					lane_d_env.vfa_conc = d_env.vfa_conc[lane];
+					lane_d_env.op_conc = d_env.op_conc[lane];
+					auto lane_uptake = SubstrateUptake();
+					lane_uptake.vfa = uptake.vfa[lane];
+					lane_uptake.op = uptake.op[lane];
+					group.replicates[lane]->sbr._apply_agent_change_discrete(lane_d_env, lane_uptake);
+				}
+			}
+			return;
+		}
+
+		// hydraulics of all replicates over a timestep, or over a span of
+		// n_step timesteps if not 0; the agent content is scaled once
+		void update_env(uint64_t n_step)
+		{
+			// the volume, thus the factor, is the same in all replicates
+			stvalue_t factor = 0;
+			for (auto sim : replicates)
+			{
+				const auto f = n_step ? sim->sbr._span_update_hydraulics(n_step)
+									  : sim->sbr._timestep_update_hydraulics();
+				assert((sim == &lead) || (f == factor));
+				factor = f;
+			}
+			if (n_step && (factor == 1))
+				return;
+			for (auto &group : groups)
+				kernels.scale_state_content(group, factor);
+			return;
+		}
+
+		// SbrControl::timestep_update() of all replicates
+		void timestep_update(uint64_t n_step)
+		{
+			auto &sbr = lead.sbr;
+			assert(n_step <= sbr.steps_to_next_transition());
+			auto &counter = sbr.profile.phase[sbr.rate_adjusted_phase.aeration != 0];
+			auto timer = ProfileTimer();
+			if (sbr.hydraulic_span && !sbr.finished_last_stage())
+			{
+				uint64_t n;
+				for (uint64_t i = 0; i < n_step; i += n)
+				{
+					n = std::min(n_step - i, sbr.hydraulic_span - (sbr._curr_step + i) % sbr.hydraulic_span);
+					for (uint64_t j = 0; j < n; j++)
+						timestep_update_agents();
+					timer.lap(counter.agent_time);
+					update_env(n);
+					timer.lap(counter.env_time);
+				}
+			}
+			else if (!sbr.finished_last_stage())
+				for (uint64_t i = 0; i < n_step; i++)
+				{
+					timestep_update_agents();
+					timer.lap(counter.agent_time);
+					update_env(0);
+					timer.lap(counter.env_time);
+				}
+
+			// phase transitions are the same in all replicates
+			for (auto sim : replicates)
+			{
+				auto &s = sim->sbr;
+#ifndef NO_RUN_PROFILE
+				auto &c = s.profile.phase[s.rate_adjusted_phase.aeration != 0];
+				c.n_step += n_step;
+				c.n_agent_step += n_step * sim->pool.n_agent();
+#endif
+				s._curr_step += n_step;
+				s.transit_phase();
+			}
+			timer.lap(counter.transit_time);
+			return;
+		}
+
+		// same as Simulation::_main_loop()
+		error_enum main_loop(void)
+		{
+			auto &sbr = lead.sbr;
+#ifndef NO_RUN_PROFILE
+			std::vector<uint64_t> state_rec_bytes, snapshot_rec_bytes;
+			for (auto sim : replicates)
+			{
+				sim->sbr.profile.reset(sim->pool.n_subtype());
+				for (auto &v : sim->pool.agent_subtype)
+					v->profile_counter = RunProfile::SubtypeCounter();
+				state_rec_bytes.push_back(sim->recorder.state_rec_bytes());
+				snapshot_rec_bytes.push_back(sim->recorder.snapshot_rec_bytes());
+			}
+#endif
+			load_agents();
+
+			// the batch stops when any replicate is stopped by its run control
+			auto should_stop = [this, &sbr](void)
+			{
+				for (auto sim : replicates)
+					if (sim->run_control.should_stop(sbr.get_curr_step()))
+						return true;
+				return false;
+			};
+			for (auto sim : replicates)
+			{
+				sim->run_control.begin(sbr.get_curr_step());
+				sim->pool.start_trait_reservoirs();
+				sim->_timer.start();
+			}
+			while (!(sbr.finished_last_stage() || should_stop()))
+			{
+				const auto to_record = lead.recorder.steps_to_next_record(sbr);
+				auto n_step = std::min({sbr.steps_to_next_transition(), to_record,
+										Simulation::max_span_steps - sbr.get_curr_step() % Simulation::max_span_steps});
+				for (auto sim : replicates)
+					n_step = std::min(n_step, sim->run_control.steps_left(sbr.get_curr_step()));
+				// records count to the phase of the span, see Simulation::_main_loop()
+				auto &counter = sbr.profile.phase[sbr.rate_adjusted_phase.aeration != 0];
+				timestep_update(n_step);
+				if (n_step < to_record)
+					continue;
+				// records are taken from the agent pools of replicates
+				auto timer = ProfileTimer();
+				store_agents();
+				for (auto sim : replicates)
+					sim->recorder.record(sim->sbr, sim->pool);
+				timer.lap(counter.recorder_time);
+			}
+			store_agents();
+			error_enum ret = none;
+			for (auto sim : replicates)
+			{
+				sim->_timer.stop();
+				sim->pool.stop_trait_reservoirs();
+				const auto stop = sim->run_control.end(sbr.get_curr_step());
+				sim->_update_curr_agent_state();
+				if (!ret)
+					ret = stop;
+			}
+#ifndef NO_RUN_PROFILE
+			for (size_t i = 0; i < replicates.size(); i++)
+				replicates[i]->_end_run_profile(state_rec_bytes[i], snapshot_rec_bytes[i]);
+#endif
+
+			return ret;
+		}
+	};
+
+	//==========================================================================
+
+	error_enum ReplicateBatch::run(const std::vector<Simulation *> &replicates)
+	{
+		if (replicates.empty())
+			return none;
+		if (auto ret = _check_lockstep(replicates))
+			return ret;
+		for (auto sim : replicates)
+			if (auto ret = sim->_init_run())
+				return ret;
+		error_enum ret = none;
+		for (auto sim : replicates)
+			if ((ret = sim->_attach_result_arena()))
+				break;
+		if (!ret)
+			switch (KernelDispatch::selected_isa())
+			{
+#ifdef IEBPR_KERNEL_X86
+			case KernelDispatch::avx512:
+				ret = Lockstep<4>(replicates, _lockstep_kernels_avx512).main_loop();
+				break;
+			case KernelDispatch::avx2:
+				ret = Lockstep<4>(replicates, _lockstep_kernels_avx2).main_loop();
+				break;
+#endif
+			default:
+				ret = Lockstep<2>(replicates, _lockstep_kernels_generic).main_loop();
+				break;
+			}
+		for (auto sim : replicates)
+			sim->recorder.detach_arena();
+		return ret;
+	}
+
+	static bool _is_same_stage(const SbrControl::Stage &a, const SbrControl::Stage &b) noexcept
+	{
+		if ((a.n_cycle != b.n_cycle) || (a.n_phase() != b.n_phase()))
+			return false;
+		return !std::memcmp(a.cycle_phases.data(), b.cycle_phases.data(),
+							a.n_phase() * sizeof(SbrControl::Phase));
+	}
+
+	error_enum ReplicateBatch::_check_lockstep(const std::vector<Simulation *> &replicates) noexcept
+	{
+		const auto &lead = *replicates.front();
+		// each lane stores back into its own replicate
+		auto sorted = replicates;
+		std::sort(sorted.begin(), sorted.end());
+		if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+			return replicate_config_mismatch;
+		for (auto sim : replicates)
+		{
+			const auto &sbr = sim->sbr;
+			if (sbr.simutype != SbrControl::discrete)
+				return replicate_not_discrete;
+			// lanes hold the same agent of each replicate
+			if (sbr.aggregate_tolerance > 0)
+				return replicate_aggregation_enabled;
+			if ((sbr.get_timestep() != lead.sbr.get_timestep()) ||
+				(sbr.hydraulic_span != lead.sbr.hydraulic_span) ||
+				(sbr.implicit_uptake_ratio != lead.sbr.implicit_uptake_ratio) ||
+				std::memcmp(&sbr.init_env, &lead.sbr.init_env, sizeof(EnvState)) ||
+				(sbr.n_stage() != lead.sbr.n_stage()) ||
+				(sim->pool.n_subtype() != lead.pool.n_subtype()) ||
+				(sim->recorder.state_rec_timepoints != lead.recorder.state_rec_timepoints) ||
+				(sim->recorder.snapshot_rec_timepoints != lead.recorder.snapshot_rec_timepoints))
+				return replicate_config_mismatch;
+			for (size_t i = 0; i < sbr.n_stage(); i++)
+				if (!_is_same_stage(sbr.stages[i], lead.sbr.stages[i]))
+					return replicate_config_mismatch;
+			for (size_t i = 0; i < sim->pool.n_subtype(); i++)
+				if ((sim->pool.agent_subtype[i]->subtype() != lead.pool.agent_subtype[i]->subtype()) ||
+					(sim->pool.agent_subtype[i]->n_agent != lead.pool.agent_subtype[i]->n_agent))
+					return replicate_config_mismatch;
+		}
+		return none;
+	}
+
+} // namespace iebpr
\ No newline at end of file
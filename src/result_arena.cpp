@@ -0,0 +1,132 @@
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "iebpr/result_arena.hpp"
+
+namespace iebpr
+{
+	constexpr char ResultArena::magic[8];
+	constexpr uint32_t ResultArena::version;
+	constexpr size_t ResultArena::align;
+
+	static inline uint64_t _align_up(uint64_t n) noexcept
+	{
+		return (n + ResultArena::align - 1) / ResultArena::align * ResultArena::align;
+	}
+
+	uint64_t ResultArena::layout(Shape &shape) noexcept
+	{
+		uint64_t pos = _align_up(sizeof(Header) + sizeof(SubtypeEntry) * shape.subtypes.size());
+		shape.env_offset = pos;
+		pos = _align_up(pos + shape.n_state_rec * shape.env_entry_size);
+		shape.agent_offset = pos;
+		pos = _align_up(pos + shape.n_state_rec * shape.subtypes.size() * shape.agent_entry_size);
+		for (auto &v : shape.subtypes)
+		{
+			v.snapshot_offset = pos;
+			pos = _align_up(pos + shape.n_snapshot_rec * v.n_agent * shape.agent_entry_size);
+		}
+		return pos;
+	}
+
+	// true if a table of n1 * n2 entries at offset is within size bytes
+	static inline bool _fits(uint64_t offset, uint64_t n1, uint64_t n2, uint64_t entry_size,
+							 uint64_t size) noexcept
+	{
+		if ((offset > size) || (offset % ResultArena::align))
+			return false;
+		if ((n1 == 0) || (n2 == 0))
+			return true;
+		return n1 <= (size - offset) / entry_size / n2;
+	}
+
+	const ResultArena::Header *ResultArena::view(const void *data, size_t size,
+												 uint32_t env_entry_size,
+												 uint32_t agent_entry_size) noexcept
+	{
+		auto header = (const Header *)data;
+		if ((size < sizeof(Header)) || ((uintptr_t)data % alignof(Header)) ||
+			std::memcmp(header->magic, magic, sizeof(magic)) ||
+			(header->version != version) ||
+			(header->env_entry_size != env_entry_size) ||
+			(header->agent_entry_size != agent_entry_size) ||
+			(header->total_bytes > size) || (header->total_bytes < sizeof(Header)))
+			return nullptr;
+		// all tables must be within the region
+		const auto total = header->total_bytes;
+		if ((header->n_subtype > (total - sizeof(Header)) / sizeof(SubtypeEntry)) ||
+			(!_fits(header->env_offset, header->n_state_rec, 1, env_entry_size, total)) ||
+			(!_fits(header->agent_offset, header->n_state_rec, header->n_subtype, agent_entry_size, total)))
+			return nullptr;
+		auto subtypes = (const SubtypeEntry *)(header + 1);
+		for (uint32_t i = 0; i < header->n_subtype; i++)
+			if (!_fits(subtypes[i].snapshot_offset, header->n_snapshot_rec, subtypes[i].n_agent,
+					   agent_entry_size, total))
+				return nullptr;
+		return header;
+	}
+
+	error_enum ResultArena::open(const std::string &name, uint64_t offset, Shape &shape)
+	{
+		close();
+		if (offset % align)
+			return result_arena_misaligned;
+		const auto bytes = layout(shape);
+		const auto path = ((!name.empty()) && (name[0] == '/')) ? name : "/" + name;
+		int fd = shm_open(path.c_str(), O_RDWR, 0);
+		if (fd < 0)
+			return result_arena_io_error;
+		struct stat st;
+		if ((fstat(fd, &st) != 0) || ((uint64_t)st.st_size < offset) ||
+			((uint64_t)st.st_size - offset < bytes))
+		{
+			::close(fd);
+			return result_arena_too_small;
+		}
+		// map from the page holding the region
+		const uint64_t page = sysconf(_SC_PAGESIZE);
+		const uint64_t map_offset = offset / page * page;
+		const size_t map_bytes = offset - map_offset + bytes;
+		auto p = mmap(nullptr, map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, map_offset);
+		// the mapping is kept valid after the descriptor is closed
+		::close(fd);
+		if (p == MAP_FAILED)
+			return result_arena_io_error;
+		_map_base = p;
+		_map_bytes = map_bytes;
+
+		// the header is written last but the counts, so that readers never
+		// see a valid header of a partially written layout
+		_header = (Header *)((char *)p + (offset - map_offset));
+		std::memset(_header->magic, 0, sizeof(_header->magic));
+		new (&_header->n_state_taken) std::atomic<uint64_t>(0);
+		new (&_header->n_snapshot_taken) std::atomic<uint64_t>(0);
+		_header->version = version;
+		_header->n_subtype = shape.subtypes.size();
+		_header->env_entry_size = shape.env_entry_size;
+		_header->agent_entry_size = shape.agent_entry_size;
+		_header->total_bytes = bytes;
+		_header->n_state_rec = shape.n_state_rec;
+		_header->n_snapshot_rec = shape.n_snapshot_rec;
+		_header->env_offset = shape.env_offset;
+		_header->agent_offset = shape.agent_offset;
+		std::memcpy((SubtypeEntry *)(_header + 1), shape.subtypes.data(), sizeof(SubtypeEntry) * shape.subtypes.size());
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(_header->magic, magic, sizeof(magic));
+		return none;
+	}
+
+	void ResultArena::close(void) noexcept
+	{
+		if (_map_base)
+			munmap(_map_base, _map_bytes);
+		_map_base = nullptr;
+		_map_bytes = 0;
+		_header = nullptr;
+		return;
+	}
+
+} // namespace iebpr
\ No newline at end of file
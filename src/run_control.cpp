@@ -0,0 +1,87 @@
+#include <limits>
+#include "iebpr/run_control.hpp"
+
+namespace iebpr
+{
+	RunControl::Progress RunControl::progress(void) const noexcept
+	{
+		Progress ret;
+		ret.running = _running.load(std::memory_order_acquire);
+		ret.curr_step = _progress_step.load(std::memory_order_relaxed);
+		const auto end_ns = ret.running ? std::chrono::duration_cast<std::chrono::nanoseconds>(
+											  _clock::now().time_since_epoch())
+											  .count()
+										: _end_ns.load(std::memory_order_relaxed);
+		const auto elapsed = (end_ns - _begin_ns.load(std::memory_order_relaxed)) * 1e-9;
+		const auto n_step = ret.curr_step - _begin_step.load(std::memory_order_relaxed);
+		ret.steps_per_sec = (elapsed > 0) ? n_step / elapsed : 0;
+		return ret;
+	}
+
+	void RunControl::begin(uint64_t curr_step, bool no_sigint)
+	{
+		_stop = none;
+		_step_end = max_steps ? curr_step + max_steps : std::numeric_limits<uint64_t>::max();
+		if (_step_end < curr_step)
+			_step_end = std::numeric_limits<uint64_t>::max();
+		// the deadline is moved to the steady clock, so the loop never reads
+		// the system clock
+		const auto now = _clock::now();
+		_timed = (max_wall_time > 0) || (deadline > 0);
+		_budget_end = _clock::time_point::max();
+		_deadline = _clock::time_point::max();
+		if (max_wall_time > 0)
+			_budget_end = now + std::chrono::duration_cast<_clock::duration>(
+									std::chrono::duration<double>(max_wall_time));
+		if (deadline > 0)
+		{
+			const auto left = deadline - std::chrono::duration<double>(
+											 std::chrono::system_clock::now().time_since_epoch())
+											 .count();
+			_deadline = now + std::chrono::duration_cast<_clock::duration>(
+								  std::chrono::duration<double>(left > 0 ? left : 0));
+		}
+		if (handle_sigint && (!no_sigint))
+			_sigint.activate();
+		_begin_step.store(curr_step, std::memory_order_relaxed);
+		_progress_step.store(curr_step, std::memory_order_relaxed);
+		_begin_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count(),
+						std::memory_order_relaxed);
+		_running.store(true, std::memory_order_release);
+		return;
+	}
+
+	bool RunControl::should_stop(uint64_t curr_step) noexcept
+	{
+		_progress_step.store(curr_step, std::memory_order_relaxed);
+		if (_cancel.load(std::memory_order_relaxed))
+			_stop = run_cancelled;
+		else if (_sigint.sig_received())
+			_stop = sigint;
+		else if (curr_step >= _step_end)
+			_stop = run_step_budget_exhausted;
+		else if (_timed)
+		{
+			const auto now = _clock::now();
+			if (now >= _deadline)
+				_stop = run_deadline_exceeded;
+			else if (now >= _budget_end)
+				_stop = run_time_budget_exhausted;
+		}
+		return _stop != none;
+	}
+
+	error_enum RunControl::end(uint64_t curr_step) noexcept
+	{
+		_sigint.deactivate();
+		_progress_step.store(curr_step, std::memory_order_relaxed);
+		_end_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(_clock::now().time_since_epoch()).count(),
+					  std::memory_order_relaxed);
+		_running.store(false, std::memory_order_release);
+		// a cancellation is taken by the run it stopped
+		if (_stop == run_cancelled)
+			_cancel.store(false, std::memory_order_relaxed);
+		return _stop;
+	}
+
+} // namespace iebpr
\ No newline at end of file
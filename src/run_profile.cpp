@@ -0,0 +1,35 @@
+#include "iebpr/run_profile.hpp"
+
+namespace iebpr
+{
+	void RunProfile::reset(size_t n_subtype)
+	{
+		phase[0] = PhaseCounter();
+		phase[1] = PhaseCounter();
+		subtype.assign(n_subtype, SubtypeCounter());
+		state_rec_bytes = 0;
+		snapshot_rec_bytes = 0;
+		pool_bytes = 0;
+		perf = nullptr;
+		hw_events = 0;
+		return;
+	}
+
+	RunProfile::PhaseCounter RunProfile::total(void) const noexcept
+	{
+		auto ret = PhaseCounter();
+		for (const auto &v : phase)
+		{
+			ret.n_step += v.n_step;
+			ret.n_agent_step += v.n_agent_step;
+			ret.agent_time += v.agent_time;
+			ret.env_time += v.env_time;
+			ret.transit_time += v.transit_time;
+			ret.recorder_time += v.recorder_time;
+			ret.kinetics_hw += v.kinetics_hw;
+			ret.recorder_hw += v.recorder_hw;
+		}
+		return ret;
+	}
+
+} // namespace iebpr
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "iebpr/run_trace.hpp"
+
+namespace iebpr
+{
+	//==========================================================================
+	// TraceWriter
+
+	bool TraceWriter::open(const std::string &path)
+	{
+		close();
+		_fp = std::fopen(path.c_str(), "w");
+		if (!_fp)
+			return false;
+		_good = (std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", _fp) >= 0);
+		_n_event = 0;
+		return _good;
+	}
+
+	bool TraceWriter::close(void) noexcept
+	{
+		if (!_fp)
+			return false;
+		if (std::fputs("\n]}\n", _fp) < 0)
+			_good = false;
+		if (std::fclose(_fp))
+			_good = false;
+		_fp = nullptr;
+		return _good;
+	}
+
+	void TraceWriter::thread_name(unsigned tid, const char *name)
+	{
+		_next_event();
+		if (std::fprintf(_fp, "{\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"name\":\"thread_name\","
+							  "\"args\":{\"name\":\"%s\"}}",
+						 tid, name) < 0)
+			_good = false;
+		_next_event();
+		if (std::fprintf(_fp, "{\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"name\":\"thread_sort_index\","
+							  "\"args\":{\"sort_index\":%u}}",
+						 tid, tid) < 0)
+			_good = false;
+		return;
+	}
+
+	void TraceWriter::complete(unsigned tid, const char *cat, const char *name,
+							   double ts, double dur, const char *args)
+	{
+		_next_event();
+		if (std::fprintf(_fp, "{\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"cat\":\"%s\",\"name\":\"%s\","
+							  "\"ts\":%.3f,\"dur\":%.3f,\"args\":{%s}}",
+						 tid, cat, name, ts, dur, args) < 0)
+			_good = false;
+		return;
+	}
+
+	void TraceWriter::counter(const char *name, double ts, uint64_t value)
+	{
+		_next_event();
+		if (std::fprintf(_fp, "{\"ph\":\"C\",\"pid\":0,\"name\":\"%s\",\"ts\":%.3f,"
+							  "\"args\":{\"value\":%llu}}",
+						 name, ts, (unsigned long long)value) < 0)
+			_good = false;
+		return;
+	}
+
+	void TraceWriter::_next_event(void)
+	{
+		if (std::fputs(_n_event++ ? ",\n" : "\n", _fp) < 0)
+			_good = false;
+		return;
+	}
+
+	//==========================================================================
+	// RunTracer
+
+	bool RunTracer::open(const std::string &path)
+	{
+		return _writer.open(path);
+	}
+
+	void RunTracer::begin(uint64_t sample_interval, const SbrControl &sbr,
+						  const AgentPool &pool, const Recorder &recorder)
+	{
+		_origin = _clock::now();
+		_sample_interval = sample_interval ? sample_interval : 1;
+		_writer.thread_name(work, "main loop");
+		_writer.thread_name(stage, "stage");
+		_writer.thread_name(cycle, "cycle");
+		_writer.thread_name(phase, "phase");
+		_writer.thread_name(track_enum::recorder, "recorder");
+		_open_schedule(sbr, 0, true, true);
+		_window_ts = 0;
+		_window_n_span = 0;
+		_window_n_step = 0;
+		_window_n_agent_step = 0;
+		_window_n_split = 0;
+		_work_end_ts = 0;
+		_n_split = _total_split(pool);
+		_n_state_rec = 0;
+		_state_rec_bytes = recorder.state_rec_bytes();
+		_snapshot_rec_bytes = recorder.snapshot_rec_bytes();
+		return;
+	}
+
+	void RunTracer::after_update(const SbrControl &sbr, const AgentPool &pool, uint64_t n_step)
+	{
+		_work_end_ts = _now();
+		_window_n_step += n_step;
+		_window_n_agent_step += n_step * pool.n_active_agent();
+		auto n_split = _total_split(pool);
+		_window_n_split += n_split - _n_split;
+		_n_split = n_split;
+		// phase transition happens at the end of timestep_update()
+		size_t stage_i, cycle_i, phase_i;
+		_schedule_position(sbr, stage_i, cycle_i, phase_i);
+		const bool new_stage = (stage_i != _stage.index);
+		const bool new_cycle = new_stage || (cycle_i != _cycle.index);
+		if (new_cycle || (phase_i != _phase.index))
+		{
+			_close_schedule(sbr.get_curr_time(), _work_end_ts, new_stage, new_cycle);
+			_open_schedule(sbr, _work_end_ts, new_stage, new_cycle);
+		}
+		return;
+	}
+
+	void RunTracer::after_record(const SbrControl &sbr, const Recorder &recorder)
+	{
+		const auto ts = _now();
+		const auto state_rec_bytes = recorder.state_rec_bytes();
+		const auto snapshot_rec_bytes = recorder.snapshot_rec_bytes();
+		char args[128];
+		if (snapshot_rec_bytes != _snapshot_rec_bytes)
+		{
+			std::snprintf(args, sizeof(args), "\"time\":%g,\"bytes\":%llu", sbr.get_curr_time(),
+						  (unsigned long long)(snapshot_rec_bytes - _snapshot_rec_bytes));
+			_writer.complete(track_enum::recorder, "record", "snapshot record", _work_end_ts,
+							 ts - _work_end_ts, args);
+		}
+		else if ((state_rec_bytes != _state_rec_bytes) && (!(_n_state_rec++ % _sample_interval)))
+		{
+			std::snprintf(args, sizeof(args), "\"time\":%g,\"sampled_1_in\":%llu",
+						  sbr.get_curr_time(), (unsigned long long)_sample_interval);
+			_writer.complete(track_enum::recorder, "record", "state record", _work_end_ts,
+							 ts - _work_end_ts, args);
+		}
+		_state_rec_bytes = state_rec_bytes;
+		_snapshot_rec_bytes = snapshot_rec_bytes;
+		if (++_window_n_span >= _sample_interval)
+			_flush_window();
+		return;
+	}
+
+	bool RunTracer::end(const SbrControl &sbr)
+	{
+		if (!_writer.is_open())
+			return false;
+		const auto ts = _now();
+		if (_window_n_span)
+			_flush_window();
+		if (!sbr.finished_last_stage())
+			_close_schedule(sbr.get_curr_time(), ts, true, true);
+		return _writer.close();
+	}
+
+	double RunTracer::_now(void) const noexcept
+	{
+		return std::chrono::duration<double, std::micro>(_clock::now() - _origin).count();
+	}
+
+	void RunTracer::_schedule_position(const SbrControl &sbr, size_t &stage,
+									   size_t &cycle, size_t &phase) noexcept
+	{
+		stage = sbr.get_curr_stage_index();
+		if (sbr.finished_last_stage())
+		{
+			cycle = 0;
+			phase = 0;
+			return;
+		}
+		const auto &v = sbr.stages[stage];
+		cycle = v.elapsed_cycle;
+		phase = v.get_curr_phase_index();
+		return;
+	}
+
+	uint64_t RunTracer::_total_split(const AgentPool &pool) noexcept
+	{
+		uint64_t ret = 0;
+		for (const auto &v : pool.agent_subtype)
+			ret += v->profile_counter.n_split[0] + v->profile_counter.n_split[1];
+		return ret;
+	}
+
+	void RunTracer::_open_schedule(const SbrControl &sbr, double ts, bool stage,
+								   bool cycle)
+	{
+		size_t stage_i, cycle_i, phase_i;
+		_schedule_position(sbr, stage_i, cycle_i, phase_i);
+		const auto time = sbr.get_curr_time();
+		if (stage)
+			_stage = _ScheduleSpan{stage_i, ts, time};
+		if (cycle)
+			_cycle = _ScheduleSpan{cycle_i, ts, time};
+		_phase = _ScheduleSpan{phase_i, ts, time};
+		_aeration = sbr.rate_adjusted_phase.aeration;
+		return;
+	}
+
+	void RunTracer::_close_schedule(stvalue_t end_time, double ts, bool stage, bool cycle)
+	{
+		char name[64];
+		char args[160];
+		std::snprintf(args, sizeof(args),
+					  "\"stage\":%zu,\"cycle\":%zu,\"phase\":%zu,\"begin_time\":%g,\"end_time\":%g",
+					  _stage.index, _cycle.index, _phase.index, _phase.begin_time, end_time);
+		_writer.complete(phase, "sbr", _aeration ? "aerobic phase" : "anaerobic phase",
+						 _phase.ts, ts - _phase.ts, args);
+		if (cycle)
+		{
+			std::snprintf(name, sizeof(name), "cycle %zu", _cycle.index);
+			std::snprintf(args, sizeof(args), "\"stage\":%zu,\"begin_time\":%g,\"end_time\":%g",
+						  _stage.index, _cycle.begin_time, end_time);
+			_writer.complete(track_enum::cycle, "sbr", name, _cycle.ts, ts - _cycle.ts, args);
+		}
+		if (stage)
+		{
+			std::snprintf(name, sizeof(name), "stage %zu", _stage.index);
+			std::snprintf(args, sizeof(args), "\"begin_time\":%g,\"end_time\":%g",
+						  _stage.begin_time, end_time);
+			_writer.complete(track_enum::stage, "sbr", name, _stage.ts, ts - _stage.ts, args);
+		}
+		return;
+	}
+
+	void RunTracer::_flush_window(void)
+	{
+		char args[128];
+		std::snprintf(args, sizeof(args), "\"n_span\":%llu,\"n_step\":%llu,\"n_agent_step\":%llu",
+					  (unsigned long long)_window_n_span, (unsigned long long)_window_n_step,
+					  (unsigned long long)_window_n_agent_step);
+		const auto ts = _now();
+		_writer.complete(work, "work", "work chunk", _window_ts, ts - _window_ts, args);
+		// split counts are only collected with run profile
+		if (RunProfile::enabled)
+			_writer.counter("agent splits", _window_ts, _window_n_split);
+		_window_ts = ts;
+		_window_n_span = 0;
+		_window_n_step = 0;
+		_window_n_agent_step = 0;
+		_window_n_split = 0;
+		return;
+	}
+
+} // namespace iebpr
\ No newline at end of file
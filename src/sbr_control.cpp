@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include "iebpr/sbr_control.hpp"
 
 namespace iebpr
@@ -38,7 +40,7 @@ namespace iebpr
 	{
 		elapsed_cycle = 0;
 		reset_curr_phase();
-		if (cycle_phases.empty())
+		if (cycle_phases.empty() || (n_cycle == 0))
 		{
 			elapsed_cycle = n_cycle;
 			return 1;
@@ -62,13 +64,62 @@ namespace iebpr
 		return finishd_last_cycle() ? 1 : 0;
 	}
 
+	void SbrControl::append_stage(const Stage &stage)
+	{
+		// push_back may reallocate, keep the stage itr as index
+		const auto was_finished = finished_last_stage();
+		const auto stage_idx = _curr_stage_itr - stages.begin();
+		stages.push_back(stage);
+		stages.back().reset_stage_progress();
+		_curr_stage_itr = stages.begin() + stage_idx;
+		_compile_schedule();
+		// all previous stages are finished, so the new stage is the next;
+		// the same transition as done in transit_phase()
+		if (was_finished)
+			_start_stage_phase_status(_curr_stage_itr);
+		return;
+	}
+
 	void SbrControl::clear_stage(void) noexcept
 	{
 		stages.clear();
 		reset_curr_stage();
+		_compile_schedule();
 		return;
 	}
 
+	error_enum SbrControl::set_stage(size_t index, const Stage &stage, bool in_progress)
+	{
+		if (index >= stages.size())
+			return stage_index_out_of_range;
+		if (in_progress && (index <= get_curr_stage_index()))
+			return stage_already_started;
+		stages[index] = stage;
+		stages[index].reset_stage_progress();
+		// later stages begin at other times, the current phase ends the same
+		_compile_schedule();
+		return none;
+	}
+
+	error_enum SbrControl::set_phase(size_t stage_index, size_t phase_index, const Phase &phase,
+									 bool in_progress)
+	{
+		if ((stage_index >= stages.size()) || (phase_index >= stages[stage_index].n_phase()))
+			return stage_index_out_of_range;
+		auto &stage = stages[stage_index];
+		const auto started = in_progress && (stage_index <= get_curr_stage_index());
+		// the schedule of past cycles in the current stage is fixed
+		if (started && ((stage_index < get_curr_stage_index()) ||
+						(phase.time_len != stage.cycle_phases[phase_index].time_len)))
+			return stage_already_started;
+		stage.cycle_phases[phase_index] = phase;
+		if (!started)
+			_compile_schedule();
+		else if (phase_index == stage.get_curr_phase_index())
+			rate_adjusted_phase = phase.adjust_rate_by_timestep(get_timestep());
+		return none;
+	}
+
 	stvalue_t SbrControl::total_time_len(void) const noexcept
 	{
 		stvalue_t ret = 0;
@@ -101,11 +152,13 @@ namespace iebpr
 	void SbrControl::prerun_init(AgentPool &pool) noexcept
 	{
 		env = init_env;
-		_curr_time = 0;
+		_curr_step = 0;
 		// reset stages
 		for (auto &stage : stages)
 			stage.reset_stage_progress();
-		_phase_trans_time = 0;
+		_compile_schedule();
+		_phase_trans_step = 0;
+		_last_uptake = EnvState();
 		_prerun_init_stage_phase_status();
 		// note the -1 @ the second parameter of _rand_agent
 		_rand_agent.param(std::uniform_int_distribution<size_t>::param_type(0, pool.n_agent() - 1));
@@ -117,14 +170,179 @@ namespace iebpr
 		return none;
 	}
 
+	void SbrControl::Stage::save_config(BinWriter &writer) const
+	{
+		writer.write_value<uint64_t>(n_cycle);
+		writer.write_vector(cycle_phases);
+		return;
+	}
+
+	error_enum SbrControl::Stage::load_config(BinReader &reader)
+	{
+		uint64_t n_cycle_saved;
+		if (!(reader.read_value(n_cycle_saved) && reader.read_vector(cycle_phases)))
+			return checkpoint_bad_format;
+		n_cycle = n_cycle_saved;
+		reset_stage_progress();
+		return none;
+	}
+
+	void SbrControl::save_config(BinWriter &writer) const
+	{
+		writer.write_value<uint32_t>(simutype);
+		writer.write_value(_timestep);
+		writer.write_value(hydraulic_span);
+		writer.write_value(implicit_uptake_ratio);
+		writer.write_value(aggregate_tolerance);
+		writer.write_value(init_env);
+		writer.write_value<uint64_t>(stages.size());
+		for (auto &v : stages)
+			v.save_config(writer);
+		return;
+	}
+
+	error_enum SbrControl::load_config(BinReader &reader)
+	{
+		uint32_t simutype_saved;
+		uint64_t n_stage;
+		if (!(reader.read_value(simutype_saved) && reader.read_value(_timestep) &&
+			  reader.read_value(hydraulic_span) && reader.read_value(implicit_uptake_ratio) &&
+			  reader.read_value(aggregate_tolerance) && reader.read_value(init_env) &&
+			  reader.read_value(n_stage)))
+			return checkpoint_bad_format;
+		if ((simutype_saved != discrete) && (simutype_saved != pcontinuous))
+			return checkpoint_bad_format;
+		simutype = (simutype_enum)simutype_saved;
+		// each stage takes at least its n_cycle and number of phases
+		if (n_stage > reader.remain() / (2 * sizeof(uint64_t)))
+			return checkpoint_bad_format;
+		clear_stage();
+		stages.resize(n_stage);
+		for (auto &v : stages)
+			if (auto ret = v.load_config(reader))
+				return ret;
+		reset_curr_stage();
+		return none;
+	}
+
+	void SbrControl::save_progress(BinWriter &writer) const
+	{
+		// config summary, used to detect mismatch on loading
+		writer.write_value<uint32_t>(simutype);
+		writer.write_value(_timestep);
+		// spans are split at multiples of hydraulic_span, which changes results
+		writer.write_value(hydraulic_span);
+		writer.write_value<uint64_t>(stages.size());
+		// compiled schedule, phase end times are relative to the cycle begin
+		for (size_t i = 0; i < stages.size(); i++)
+		{
+			writer.write_value<uint64_t>(stages[i].n_cycle);
+			writer.write_value<uint64_t>(stages[i].cycle_phases.size());
+			for (size_t j = 0; j < stages[i].cycle_phases.size(); j++)
+				writer.write_value(_phase_end_time[_stage_schedule[i].phase_offset + j]);
+		}
+		// progress, iterators are stored as index
+		writer.write_value(env);
+		writer.write_value(rate_adjusted_phase);
+		writer.write_value(_curr_step);
+		writer.write_value(_phase_trans_step);
+		writer.write_value(_last_uptake);
+		writer.write_value<uint64_t>(_curr_stage_itr - stages.begin());
+		for (auto &v : stages)
+		{
+			writer.write_value<uint64_t>(v.elapsed_cycle);
+			writer.write_value<uint64_t>(v._curr_phase_itr - v.cycle_phases.begin());
+		}
+		return;
+	}
+
+	error_enum SbrControl::load_progress(BinReader &reader)
+	{
+		uint32_t simutype_saved;
+		stvalue_t timestep_saved;
+		uint64_t hydraulic_span_saved, n_stage, n_cycle, n_phase;
+		if (!(reader.read_value(simutype_saved) && reader.read_value(timestep_saved) &&
+			  reader.read_value(hydraulic_span_saved) && reader.read_value(n_stage)))
+			return checkpoint_bad_format;
+		if ((simutype_saved != simutype) || (timestep_saved != _timestep) ||
+			(hydraulic_span_saved != hydraulic_span) || (n_stage != stages.size()))
+			return checkpoint_config_mismatch;
+		for (size_t i = 0; i < stages.size(); i++)
+		{
+			if (!(reader.read_value(n_cycle) && reader.read_value(n_phase)))
+				return checkpoint_bad_format;
+			if ((n_cycle != stages[i].n_cycle) || (n_phase != stages[i].cycle_phases.size()))
+				return checkpoint_config_mismatch;
+			for (size_t j = 0; j < n_phase; j++)
+			{
+				stvalue_t end_time;
+				if (!reader.read_value(end_time))
+					return checkpoint_bad_format;
+				if (end_time != _phase_end_time[_stage_schedule[i].phase_offset + j])
+					return checkpoint_config_mismatch;
+			}
+		}
+
+		uint64_t stage_idx, elapsed_cycle, phase_idx;
+		if (!(reader.read_value(env) && reader.read_value(rate_adjusted_phase) &&
+			  reader.read_value(_curr_step) && reader.read_value(_phase_trans_step) &&
+			  reader.read_value(_last_uptake) &&
+			  reader.read_value(stage_idx)))
+			return checkpoint_bad_format;
+		if (stage_idx > stages.size())
+			return checkpoint_bad_format;
+		_curr_stage_itr = stages.begin() + stage_idx;
+		for (auto &v : stages)
+		{
+			if (!(reader.read_value(elapsed_cycle) && reader.read_value(phase_idx)))
+				return checkpoint_bad_format;
+			if ((elapsed_cycle > v.n_cycle) || (phase_idx > v.cycle_phases.size()))
+				return checkpoint_bad_format;
+			v.elapsed_cycle = elapsed_cycle;
+			v._curr_phase_itr = v.cycle_phases.begin() + phase_idx;
+		}
+		return none;
+	}
+
+	void SbrControl::fork_from(const SbrControl &other)
+	{
+		init_env = other.init_env;
+		env = other.env;
+		stages = other.stages;
+		simutype = other.simutype;
+		rate_adjusted_phase = other.rate_adjusted_phase;
+		hydraulic_span = other.hydraulic_span;
+		implicit_uptake_ratio = other.implicit_uptake_ratio;
+		aggregate_tolerance = other.aggregate_tolerance;
+		_curr_step = other._curr_step;
+		_timestep = other._timestep;
+		_phase_trans_step = other._phase_trans_step;
+		_curr_stage_itr = stages.begin() + (other._curr_stage_itr - other.stages.begin());
+		for (size_t i = 0; i < stages.size(); i++)
+			stages[i]._curr_phase_itr = stages[i].cycle_phases.begin() +
+										(other.stages[i]._curr_phase_itr -
+										 other.stages[i].cycle_phases.begin());
+		_rand_agent = other._rand_agent;
+		_stage_schedule = other._stage_schedule;
+		_phase_end_time = other._phase_end_time;
+		_last_uptake = other._last_uptake;
+		return;
+	}
+
 	void SbrControl::_prerun_init_stage_phase_status(void) noexcept
 	{
-		for (auto si = stages.begin(); si < stages.end(); si++)
+		_start_stage_phase_status(stages.begin());
+		return;
+	}
+
+	void SbrControl::_start_stage_phase_status(decltype(stages)::iterator from) noexcept
+	{
+		for (auto si = from; si < stages.end(); si++)
 			if (!si->start_stage())
 			{
 				_curr_stage_itr = si;
 				const Phase &phase = si->get_curr_phase();
-				_phase_trans_time += phase.time_len;
+				_phase_trans_step = _curr_phase_end_step();
 				rate_adjusted_phase = phase.adjust_rate_by_timestep(get_timestep());
 				return;
 			}
@@ -133,6 +351,33 @@ namespace iebpr
 		return;
 	}
 
+	void SbrControl::_compile_schedule(void)
+	{
+		_stage_schedule.clear();
+		_phase_end_time.clear();
+		stvalue_t begin_time = 0;
+		for (auto &v : stages)
+		{
+			_stage_schedule.push_back({begin_time, v.cycle_time_len(), _phase_end_time.size()});
+			stvalue_t end_time = 0;
+			for (auto &phase : v.cycle_phases)
+				_phase_end_time.push_back(end_time += phase.time_len);
+			begin_time += v.total_time_len();
+		}
+		return;
+	}
+
+	uint64_t SbrControl::_curr_phase_end_step(void) const noexcept
+	{
+		// computed from the stage begin and cycle count instead of summing up
+		// phase lengths, so rounding errors do not accumulate over cycles
+		const auto &stage = *_curr_stage_itr;
+		const auto &sched = _stage_schedule[_curr_stage_itr - stages.begin()];
+		const auto phase_idx = stage._curr_phase_itr - stage.cycle_phases.begin();
+		return time_to_step(sched.begin_time + stage.elapsed_cycle * sched.cycle_time_len +
+							_phase_end_time[sched.phase_offset + phase_idx]);
+	}
+
 	void SbrControl::_force_set_finish(void) noexcept
 	{
 		for (auto &v : stages)
@@ -147,16 +392,19 @@ namespace iebpr
 			return;
 		if (!get_curr_stage().transit_to_next_phase())
 			return;
-		// transit to next stage
+		// transit to next stage; the new stage starts at its first phase, only
+		// skip further if it has nothing to run
 		_curr_stage_itr++;
-		if (!finished_last_stage())
-			get_curr_stage().start_stage();
-		return _transit_next_phase_recursive();
+		if (finished_last_stage())
+			return;
+		if (get_curr_stage().start_stage())
+			return _transit_next_phase_recursive();
+		return;
 	}
 
 	void SbrControl::transit_phase(void)
 	{
-		if (_curr_time < _phase_trans_time)
+		if (_curr_step < _phase_trans_step)
 			return;
 
 		// transition to a new phase
@@ -169,59 +417,192 @@ namespace iebpr
 		{
 			const Phase &phase = get_curr_stage().get_curr_phase();
 			rate_adjusted_phase = phase.adjust_rate_by_timestep(get_timestep());
-			_phase_trans_time += rate_adjusted_phase.time_len;
+			_phase_trans_step = _curr_phase_end_step();
 		}
 		return;
 	}
 
-	void SbrControl::timestep_update(AgentPool &pool)
+	uint64_t SbrControl::steps_to_next_transition(void) const noexcept
+	{
+		if (finished_last_stage())
+			return no_step;
+		// zero-length phases still last one step
+		return (_phase_trans_step > _curr_step) ? (_phase_trans_step - _curr_step) : 1;
+	}
+
+	void SbrControl::timestep_update(AgentPool &pool, uint64_t n_step)
 	{
-		if (!finished_last_stage())
+		assert(n_step <= steps_to_next_transition());
+		// the whole span is in the current phase
+		auto &counter = profile.phase[rate_adjusted_phase.aeration != 0];
+		auto timer = ProfileTimer(profile.perf);
+		// laps are timed only, hardware counters of agent kinetics and env
+		// update are read together once for the span
+		double agent_time = 0, env_time = 0;
+		if (hydraulic_span && !finished_last_stage())
 		{
-			// update biomass
-			(simutype == pcontinuous) ? _timestep_update_agents_pcontinuous(pool)
-									  : _timestep_update_agents_discrete(pool);
-			// update env
-			_timestep_update_env(pool);
+			// split at multiples of hydraulic_span, so results do not depend on
+			// how the main loop divides the run into spans
+			uint64_t n;
+			for (uint64_t i = 0; i < n_step; i += n)
+			{
+				n = std::min(n_step - i, hydraulic_span - (_curr_step + i) % hydraulic_span);
+				_timestep_update_agents(pool, n);
+				timer.lap(agent_time);
+				_span_update_env(pool, n);
+				timer.lap(env_time);
+			}
 		}
+		else if (!finished_last_stage())
+		{
+			// no phase transition within the span, no per-step bookkeeping
+			if (simutype == pcontinuous)
+				for (uint64_t i = 0; i < n_step; i++)
+				{
+					_timestep_update_agents_pcontinuous(pool);
+					timer.lap(agent_time);
+					_timestep_update_env(pool);
+					timer.lap(env_time);
+				}
+			else
+				for (uint64_t i = 0; i < n_step; i++)
+				{
+					_timestep_update_agents_discrete(pool);
+					timer.lap(agent_time);
+					_timestep_update_env(pool);
+					timer.lap(env_time);
+				}
+		}
+		timer.lap_hw(counter.kinetics_hw);
+		counter.agent_time += agent_time;
+		counter.env_time += env_time;
 
-		_curr_time += _timestep;
+		_curr_step += n_step;
+#ifndef NO_RUN_PROFILE
+		counter.n_step += n_step;
+		counter.n_agent_step += n_step * pool.n_active_agent();
+#endif
 
+		const bool transit = (_curr_step >= _phase_trans_step);
 		transit_phase();
+		if (transit && (aggregate_tolerance > 0))
+			pool.aggregate_agents(aggregate_tolerance);
+		timer.lap(counter.transit_time);
 
 		return;
 	}
 
+	void SbrControl::_timestep_update_agents(AgentPool &pool, uint64_t n_step)
+	{
+		if (simutype == pcontinuous)
+			for (uint64_t i = 0; i < n_step; i++)
+				_timestep_update_agents_pcontinuous(pool);
+		else
+			for (uint64_t i = 0; i < n_step; i++)
+				_timestep_update_agents_discrete(pool);
+		return;
+	}
+
+	bool SbrControl::_is_uptake_depleting(void) const noexcept
+	{
+		if (implicit_uptake_ratio <= 0)
+			return false;
+		// last uptake does not predict uptake after switching aeration, e.g.
+		// the burst of vfa uptake at the start of an anaerobic phase
+		if (_last_uptake.is_aerobic != env.is_aerobic)
+			return true;
+		// gross uptake, not the net change; sources (e.g. decay) may balance
+		// uptake that overshoots as soon as the concentration turns positive
+		return (_last_uptake.vfa_conc > implicit_uptake_ratio * env.vfa_conc) ||
+			   (_last_uptake.op_conc > implicit_uptake_ratio * env.op_conc);
+	}
+
+	SubstrateUptake SbrControl::_implicit_uptake(const EnvState &demand) const noexcept
+	{
+		// linearize uptake as first order in substrate, dS/dt = -(U / S) * S,
+		// the linearly implicit euler step S' = S - U * S / (S + U) is always
+		// positive, i.e. uptake is scaled by S / (S + U)
+		return SubstrateUptake(demand.vfa_conc > 0 ? env.vfa_conc / (env.vfa_conc + demand.vfa_conc) : 1,
+							   demand.op_conc > 0 ? env.op_conc / (env.op_conc + demand.op_conc) : 1);
+	}
+
 	void SbrControl::_timestep_update_agents_discrete(AgentPool &pool)
 	{
 		// update env only at the end of a complete timestep
 		auto d_env = EnvState();
+		auto uptake = SubstrateUptake();
+		if (_is_uptake_depleting())
+		{
+			// all agents see the same env, so the scale is decided by the total
+			// demand
+			auto demand = EnvState();
+			for (auto &v : pool.agent_subtype)
+				pool.stream_agents(v->pool_begin(), v->active_end(),
+								   [&](AgentSubtypeBase::agent_itr_t begin, AgentSubtypeBase::agent_itr_t end)
+								   {
+									   for (auto itr = begin; itr < end; itr++)
+										   v->uptake_demand(env, demand, itr);
+								   });
+			uptake = _implicit_uptake(demand);
+		}
+		// agents split into free slots are updated from the next timestep
 		for (auto &v : pool.agent_subtype)
-			for (auto itr = v->pool_begin(); itr < v->pool_end(); itr++)
-				v->agent_action(env, d_env, itr);
+			pool.stream_agents(v->pool_begin(), v->active_end(),
+							   [&](AgentSubtypeBase::agent_itr_t begin, AgentSubtypeBase::agent_itr_t end)
+							   {
+								   for (auto itr = begin; itr < end; itr++)
+									   v->agent_action(env, d_env, itr, uptake);
+							   });
+		_apply_agent_change_discrete(d_env, uptake);
+		return;
+	}
+
+	void SbrControl::_apply_agent_change_discrete(const EnvState &d_env, const SubstrateUptake &uptake) noexcept
+	{
 		// update env
 		assert(d_env.is_aerobic == 0);
 		env.update_change(d_env); // shouldn't change
+		_last_uptake.vfa_conc = uptake.vfa;
+		_last_uptake.op_conc = uptake.op;
+		_last_uptake.is_aerobic = env.is_aerobic;
 		return;
 	}
 
 	void SbrControl::_timestep_update_agents_pcontinuous(AgentPool &pool)
 	{
-		for (size_t i = 0; i < pool.n_agent(); i++)
+		const auto implicit_uptake = _is_uptake_depleting();
+		_last_uptake = EnvState();
+		_last_uptake.is_aerobic = env.is_aerobic;
+		// agents are drawn from the active ones of the timestep start
+		const auto n_active = pool.n_active_agent();
+		if (n_active)
+			_rand_agent.param(decltype(_rand_agent)::param_type(0, n_active - 1));
+		for (size_t i = 0; i < n_active; i++)
 		{
 
 			size_t agent_id = _rand_agent(_rand.engine);
-			assert(agent_id < pool.n_agent());
+			assert(agent_id < n_active);
 			// update env for every agent action calculation
 			auto d_env = EnvState();
 			for (auto &v : pool.agent_subtype)
 			{
-				if (agent_id < v->n_agent)
+				if (agent_id < v->n_active())
 				{
-					v->agent_action(env, d_env, v->pool_begin() + agent_id);
+					const auto itr = v->pool_begin() + agent_id;
+					auto uptake = SubstrateUptake();
+					// env is updated after each agent, so is the scale
+					if (implicit_uptake)
+					{
+						auto demand = EnvState();
+						v->uptake_demand(env, demand, itr);
+						uptake = _implicit_uptake(demand);
+					}
+					v->agent_action(env, d_env, itr, uptake);
+					_last_uptake.vfa_conc += uptake.vfa;
+					_last_uptake.op_conc += uptake.op;
 					break;
 				}
-				agent_id -= v->n_agent;
+				agent_id -= v->n_active();
 			}
 			// update env
 			assert(d_env.is_aerobic == 0); // shouldn't change
@@ -231,6 +612,13 @@ namespace iebpr
 	}
 
 	void SbrControl::_timestep_update_env(AgentPool &pool)
+	{
+		// a factor <= 0 clears all content due to total outwash
+		pool.scale_state_content(_timestep_update_hydraulics());
+		return;
+	}
+
+	stvalue_t SbrControl::_timestep_update_hydraulics(void) noexcept
 	{
 		const Phase &phase = rate_adjusted_phase;
 		assert(phase.inflow_rate == get_curr_stage().get_curr_phase().inflow_rate * get_timestep());
@@ -249,22 +637,59 @@ namespace iebpr
 			env.vfa_conc = 0;
 			env.op_conc = 0;
 			// and clear all content due to total outwash
-			for (auto &v : pool.agent_data)
-				v.state.clear_state_content();
+			return 0;
 		}
-		else
+		// scale conc. by new_c = ((new_v - dvi) * c + dvi * ci) / new_v
+		env.vfa_conc = ((env.volume - dvi) * env.vfa_conc + dvi * phase.inflow_vfa_conc) / env.volume;
+		env.op_conc = ((env.volume - dvi) * env.op_conc + dvi * phase.inflow_op_conc) / env.volume;
+		env.is_aerobic = phase.aeration; // overwrite the old value
+		// scale biomass by (old_v - dvw) / new_v
+		return (old_volume - dvw) / env.volume;
+	}
+
+	void SbrControl::_span_update_env(AgentPool &pool, uint64_t n_step)
+	{
+		// biomass is only scaled once per span
+		const auto factor = _span_update_hydraulics(n_step);
+		if (factor != 1)
+			pool.scale_state_content(factor);
+		return;
+	}
+
+	stvalue_t SbrControl::_span_update_hydraulics(uint64_t n_step) noexcept
+	{
+		// rates are volumes per timestep, so time is measured in timesteps:
+		//   V(s) = V0 + q * s, q = qi - qw - qo
+		//   dc/ds = qi / V * (ci - c)
+		//   dx/ds = -(qi - qo) / V * x, for biomass content
+		// the content decays by exp(-integral(r / V)) over the span, i.e.
+		// (V0 / V1) ^ (r / q), or exp(-r * n / V0) if q = 0
+		const Phase &phase = rate_adjusted_phase;
+		const auto qi = phase.inflow_rate;
+		const auto qo = phase.outflow_rate;
+		const auto q = qi - phase.withdraw_rate - qo;
+		const auto v0 = env.volume;
+		const auto v1 = v0 + q * n_step;
+		if (v1 <= 0)
 		{
-			// scale conc. by new_c = ((new_v - dvi) * c + dvi * ci) / new_v
-			env.vfa_conc = ((env.volume - dvi) * env.vfa_conc + dvi * phase.inflow_vfa_conc) / env.volume;
-			env.op_conc = ((env.volume - dvi) * env.op_conc + dvi * phase.inflow_op_conc) / env.volume;
-			env.is_aerobic = phase.aeration; // overwrite the old value
-			// scale biomass by (old_v - dvw) / new_v
-			auto factor = (old_volume - dvw) / env.volume;
-			for (auto &v : pool.agent_data)
-				// clear all content due to total outwash
-				v.state.scale_state_content(factor);
+			env.volume = 0;
+			env.vfa_conc = 0;
+			env.op_conc = 0;
+			// and clear all content due to total outwash
+			return 0;
 		}
-		return;
+		// log1p keeps the precision when q is close to 0
+		auto decay = [q, v0, n_step](stvalue_t r) -> stvalue_t
+		{
+			return (q == 0) ? std::exp(-r * n_step / v0)
+							: std::exp(-r / q * std::log1p(q * n_step / v0));
+		};
+		const auto conc_decay = decay(qi);
+		env.vfa_conc = phase.inflow_vfa_conc - (phase.inflow_vfa_conc - env.vfa_conc) * conc_decay;
+		env.op_conc = phase.inflow_op_conc - (phase.inflow_op_conc - env.op_conc) * conc_decay;
+		env.volume = v1;
+		env.is_aerobic = phase.aeration; // overwrite the old value
+		return decay(qi - qo);
 	}
 
 } // namespace iebpr
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "iebpr/serializer.hpp"
+
+namespace iebpr
+{
+	void BinWriter::write(const void *data, size_t size)
+	{
+		if ((!_good) || (!size))
+			return;
+		if (_fp)
+			_good = (std::fwrite(data, 1, size, _fp) == size);
+		else
+			_buf->insert(_buf->end(), (const char *)data, (const char *)data + size);
+		_pos += size;
+		return;
+	}
+
+	void BinWriter::align(size_t alignment)
+	{
+		static const char zeros[64] = {0};
+		assert(alignment <= sizeof(zeros));
+		auto pad = (alignment - _pos % alignment) % alignment;
+		write(zeros, pad);
+		return;
+	}
+
+	void BinWriter::write_block(const void *data, size_t size, size_t alignment)
+	{
+		if (_keep_block(data, size))
+			return;
+		align(alignment);
+		write(data, size);
+		return;
+	}
+
+	void BinWriter::write_string(const std::string &s)
+	{
+		write_value<uint64_t>(s.size());
+		write(s.data(), s.size());
+		return;
+	}
+
+	bool BinWriter::_keep_block(const void *data, size_t size)
+	{
+		if ((!_blocks) || (size < min_block_size))
+			return false;
+		if (_good)
+			_blocks->push_back({data, size});
+		return true;
+	}
+
+	const void *BinReader::view(size_t size) noexcept
+	{
+		if ((!_good) || (size > remain()))
+		{
+			_good = false;
+			return nullptr;
+		}
+		auto ret = _curr;
+		_curr += size;
+		return ret;
+	}
+
+	bool BinReader::read(void *data, size_t size) noexcept
+	{
+		auto src = view(size);
+		if (!src)
+			return false;
+		std::memcpy(data, src, size);
+		return true;
+	}
+
+	bool BinReader::align(size_t alignment) noexcept
+	{
+		auto pad = (alignment - pos() % alignment) % alignment;
+		return view(pad) != nullptr;
+	}
+
+	const void *BinReader::view_block(size_t size, size_t alignment) noexcept
+	{
+		if (_is_block(size, 1))
+			return _take_block(size);
+		if (!align(alignment))
+			return nullptr;
+		return view(size);
+	}
+
+	const void *BinReader::_take_block(size_t size) noexcept
+	{
+		if ((!_good) || (_next_block >= _blocks->size()) || ((*_blocks)[_next_block].size != size))
+		{
+			_good = false;
+			return nullptr;
+		}
+		return (*_blocks)[_next_block++].data;
+	}
+
+	bool BinReader::read_string(std::string &s)
+	{
+		uint64_t size;
+		if (!read_value(size))
+			return false;
+		auto src = (const char *)view(size);
+		if (!src)
+			return false;
+		s.assign(src, size);
+		return true;
+	}
+
+	MappedFile::~MappedFile(void) noexcept
+	{
+		close();
+		return;
+	}
+
+	int MappedFile::open(const std::string &path) noexcept
+	{
+		close();
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return 1;
+		struct stat st;
+		if ((fstat(fd, &st) != 0) || (st.st_size <= 0))
+		{
+			::close(fd);
+			return 1;
+		}
+		auto data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		// the mapping is kept valid after the descriptor is closed
+		::close(fd);
+		if (data == MAP_FAILED)
+			return 1;
+		// checkpoints are consumed front to back exactly once
+		madvise(data, st.st_size, MADV_SEQUENTIAL);
+		_data = data;
+		_size = st.st_size;
+		return 0;
+	}
+
+	void MappedFile::close(void) noexcept
+	{
+		if (_data)
+			munmap(_data, _size);
+		_data = nullptr;
+		_size = 0;
+		return;
+	}
+
+} // namespace iebpr
\ No newline at end of file
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include "iebpr/simulation.hpp"
 
 namespace iebpr
@@ -12,9 +15,10 @@ namespace iebpr
 		return Randomizer::randtype_enum_to_name(type);
 	}
 
-	void Simulation::set_seed(Randomizer::seed_t seed) noexcept
+	void Simulation::set_seed(Randomizer::seed_t seed)
 	{
 		_rand.seed(seed);
+		pool.seed_trait_reservoirs();
 		return;
 	}
 
@@ -46,6 +50,39 @@ namespace iebpr
 		return;
 	}
 
+	uint64_t Simulation::get_hydraulic_span(void) const noexcept
+	{
+		return sbr.hydraulic_span;
+	}
+
+	void Simulation::set_hydraulic_span(uint64_t n_step) noexcept
+	{
+		sbr.hydraulic_span = n_step;
+		return;
+	}
+
+	stvalue_t Simulation::get_implicit_uptake_ratio(void) const noexcept
+	{
+		return sbr.implicit_uptake_ratio;
+	}
+
+	void Simulation::set_implicit_uptake_ratio(stvalue_t ratio) noexcept
+	{
+		sbr.implicit_uptake_ratio = ratio;
+		return;
+	}
+
+	stvalue_t Simulation::get_aggregate_tolerance(void) const noexcept
+	{
+		return sbr.aggregate_tolerance;
+	}
+
+	void Simulation::set_aggregate_tolerance(stvalue_t tolerance) noexcept
+	{
+		sbr.aggregate_tolerance = tolerance;
+		return;
+	}
+
 	void Simulation::append_sbr_stage(const SbrControl::Stage &stage)
 	{
 		sbr.append_stage(stage);
@@ -58,6 +95,17 @@ namespace iebpr
 		return;
 	}
 
+	error_enum Simulation::set_sbr_stage(size_t index, const SbrControl::Stage &stage)
+	{
+		return sbr.set_stage(index, stage, _initialized);
+	}
+
+	error_enum Simulation::set_sbr_phase(size_t stage_index, size_t phase_index,
+										 const SbrControl::Phase &phase)
+	{
+		return sbr.set_phase(stage_index, phase_index, phase, _initialized);
+	}
+
 	stvalue_t Simulation::total_time_len(void) const noexcept
 	{
 		return sbr.total_time_len();
@@ -110,6 +158,50 @@ namespace iebpr
 		return;
 	}
 
+	size_t Simulation::get_trait_reservoir_size(void) const noexcept
+	{
+		return pool.trait_reservoir_size;
+	}
+
+	void Simulation::set_trait_reservoir_size(size_t size) noexcept
+	{
+		pool.trait_reservoir_size = size;
+		return;
+	}
+
+	bool Simulation::get_trait_reservoir_thread(void) const noexcept
+	{
+		return pool.trait_reservoir_thread;
+	}
+
+	void Simulation::set_trait_reservoir_thread(bool enable) noexcept
+	{
+		pool.trait_reservoir_thread = enable;
+		return;
+	}
+
+	size_t Simulation::get_instantiate_threads(void) const noexcept
+	{
+		return pool.instantiate_threads;
+	}
+
+	void Simulation::set_instantiate_threads(size_t n_thread) noexcept
+	{
+		pool.instantiate_threads = n_thread;
+		return;
+	}
+
+	const std::string &Simulation::get_pool_backing_dir(void) const noexcept
+	{
+		return pool.backing_dir;
+	}
+
+	void Simulation::set_pool_backing_dir(const std::string &dir)
+	{
+		pool.backing_dir = dir;
+		return;
+	}
+
 	size_t Simulation::n_state_rec_timepoints(void) const noexcept
 	{
 		return recorder.state_rec_timepoints.size();
@@ -123,18 +215,24 @@ namespace iebpr
 	void Simulation::set_state_rec_timepoints(std::vector<stvalue_t> &timepoints)
 	{
 		recorder.state_rec_timepoints = timepoints;
+		if (_initialized)
+			recorder.relocate_progress(sbr);
 		return;
 	}
 
 	void Simulation::set_state_rec_timepoints(std::vector<stvalue_t> &&timepoints)
 	{
 		recorder.state_rec_timepoints = timepoints;
+		if (_initialized)
+			recorder.relocate_progress(sbr);
 		return;
 	}
 
 	void Simulation::clear_state_rec_timepoints(void) noexcept
 	{
 		recorder.state_rec_timepoints.clear();
+		if (_initialized)
+			recorder.relocate_progress(sbr);
 		return;
 	}
 
@@ -151,56 +249,469 @@ namespace iebpr
 	void Simulation::set_snapshot_rec_timepoints(std::vector<stvalue_t> &timepoints)
 	{
 		recorder.snapshot_rec_timepoints = timepoints;
+		if (_initialized)
+			recorder.relocate_progress(sbr);
 		return;
 	}
 
 	void Simulation::set_snapshot_rec_timepoints(std::vector<stvalue_t> &&timepoints)
 	{
 		recorder.snapshot_rec_timepoints = timepoints;
+		if (_initialized)
+			recorder.relocate_progress(sbr);
 		return;
 	}
 
 	void Simulation::clear_snapshot_rec_timepoints(void) noexcept
 	{
 		recorder.snapshot_rec_timepoints.clear();
+		if (_initialized)
+			recorder.relocate_progress(sbr);
 		return;
 	}
 
-	error_enum Simulation::run(void)
+	error_enum Simulation::run(bool no_sigint)
 	{
-		// pre initialize check
-		if (auto ret = sbr.preinit_validate())
-			return ret;
-		if (auto ret = pool.preinit_validate())
+		if (auto ret = _init_run())
 			return ret;
-		if (auto ret = recorder.preinit_validate())
+		return _main_loop(SbrControl::no_step, no_sigint);
+	}
+
+	error_enum Simulation::_init_run(void)
+	{
+		_initialized = false;
+		// pre initialize check
+		if (auto ret = _preinit_validate())
 			return ret;
 
 		// initialize
 		pool.prerun_init(sbr.get_timestep());
 		sbr.prerun_init(pool);
-		recorder.prerun_init(pool);
+		recorder.prerun_init(sbr, pool);
 
 		// pre run check
+		if (auto ret = _prerun_validate())
+			return ret;
+		_initialized = true;
+		_update_curr_agent_state();
+		return none;
+	}
+
+	error_enum Simulation::resume(bool no_sigint)
+	{
+		if (!_initialized)
+			return checkpoint_not_initialized;
+		return _main_loop(SbrControl::no_step, no_sigint);
+	}
+
+	error_enum Simulation::advance(uint64_t n_step)
+	{
+		if (!_initialized)
+			if (auto ret = _init_run())
+				return ret;
+		const auto curr = sbr.get_curr_step();
+		return _main_loop((n_step < SbrControl::no_step - curr) ? curr + n_step : SbrControl::no_step);
+	}
+
+	error_enum Simulation::run_until(stvalue_t time)
+	{
+		if (!_initialized)
+			if (auto ret = _init_run())
+				return ret;
+		const auto step_end = sbr.time_to_step(time);
+		if (step_end <= sbr.get_curr_step())
+			return none;
+		return _main_loop(step_end);
+	}
+
+	stvalue_t Simulation::curr_time(void) const noexcept
+	{
+		return sbr.get_curr_time();
+	}
+
+	uint64_t Simulation::curr_step(void) const noexcept
+	{
+		return sbr.get_curr_step();
+	}
+
+	const EnvState &Simulation::curr_env(void) const noexcept
+	{
+		return sbr.env;
+	}
+
+	const std::vector<AgentStateRecEntry> &Simulation::curr_agent_state(void) const noexcept
+	{
+		return _curr_agent_state;
+	}
+
+	error_enum Simulation::save_checkpoint(const std::string &path) const
+	{
+		if (!_initialized)
+			return checkpoint_not_initialized;
+		// write to a temp file first, so that an interrupted write never
+		// corrupts an existing checkpoint
+		const auto tmp_path = path + ".tmp";
+		auto fp = std::fopen(tmp_path.c_str(), "wb");
+		if (!fp)
+			return checkpoint_io_error;
+		BinWriter writer(fp);
+		writer.write_value(checkpoint::Header());
+		_save_progress(writer);
+		auto good = writer.good();
+		good &= (std::fclose(fp) == 0);
+		if (good)
+			good = (std::rename(tmp_path.c_str(), path.c_str()) == 0);
+		if (!good)
+		{
+			std::remove(tmp_path.c_str());
+			return checkpoint_io_error;
+		}
+		return none;
+	}
+
+	// check the section tag, then load the section
+	template <typename loader_t>
+	static error_enum _load_checkpoint_section(BinReader &reader, uint32_t tag,
+											   loader_t loader)
+	{
+		uint32_t v;
+		if (!reader.read_value(v) || (v != tag))
+			return checkpoint_bad_format;
+		return loader(reader);
+	}
+
+	error_enum Simulation::load_checkpoint(const std::string &path)
+	{
+		_initialized = false;
+		if (auto ret = _preinit_validate())
+			return ret;
+
+		MappedFile file;
+		if (file.open(path))
+			return checkpoint_io_error;
+		BinReader reader(file.data(), file.size());
+		checkpoint::Header header;
+		if (!reader.read_value(header) || !header.is_magic())
+			return checkpoint_bad_format;
+		if (header.version != checkpoint::version)
+			return checkpoint_version_mismatch;
+		if (!header.is_compatible())
+			return checkpoint_bad_format;
+		return _load_progress(reader);
+	}
+
+	error_enum Simulation::save_image(BinWriter &writer) const
+	{
+		writer.write_value(checkpoint::Header(true));
+		writer.write_value<uint32_t>(checkpoint::config);
+		sbr.save_config(writer);
+		pool.save_config(writer);
+		recorder.save_config(writer);
+		_save_config(writer);
+		writer.write_value<uint8_t>(_initialized);
+		if (_initialized)
+			_save_progress(writer);
+		else
+		{
+			// keeps the seed
+			writer.write_value<uint32_t>(checkpoint::randomizer);
+			_rand.save_state(writer);
+		}
+		return writer.good() ? none : checkpoint_io_error;
+	}
+
+	error_enum Simulation::load_image(BinReader &reader)
+	{
+		_initialized = false;
+		_curr_agent_state.clear();
+		checkpoint::Header header;
+		if (!reader.read_value(header) || !header.is_magic(true))
+			return checkpoint_bad_format;
+		if (header.version != checkpoint::version)
+			return checkpoint_version_mismatch;
+		if (!header.is_compatible(true))
+			return checkpoint_bad_format;
+
+		error_enum ret = none;
+		uint8_t initialized;
+		if ((ret = _load_checkpoint_section(reader, checkpoint::config,
+											[this](BinReader &r)
+											{
+												error_enum ret = none;
+												(ret = sbr.load_config(r)) ||
+													(ret = pool.load_config(r)) ||
+													(ret = recorder.load_config(r)) ||
+													(ret = _load_config(r));
+												return ret;
+											})))
+			return ret;
+		if (!reader.read_value(initialized))
+			return checkpoint_bad_format;
+		if (initialized)
+		{
+			if ((ret = _preinit_validate()))
+				return ret;
+			return _load_progress(reader);
+		}
+		return _load_checkpoint_section(reader, checkpoint::randomizer,
+										[this](BinReader &r)
+										{ return _rand.load_state(r); });
+	}
+
+	void Simulation::_save_progress(BinWriter &writer) const
+	{
+		writer.write_value<uint32_t>(checkpoint::randomizer);
+		_rand.save_state(writer);
+		writer.write_value<uint32_t>(checkpoint::sbr_control);
+		sbr.save_progress(writer);
+		writer.write_value<uint32_t>(checkpoint::agent_pool);
+		pool.save_progress(writer);
+		writer.write_value<uint32_t>(checkpoint::recorder);
+		recorder.save_progress(writer);
+		return;
+	}
+
+	error_enum Simulation::_load_progress(BinReader &reader)
+	{
+		// initialize everything except agents, which are loaded as a whole
+		pool.prerun_init(sbr.get_timestep(), false);
+		sbr.prerun_init(pool);
+		recorder.prerun_init(sbr, pool);
+
+		error_enum ret = none;
+		if ((ret = _load_checkpoint_section(reader, checkpoint::randomizer,
+											[this](BinReader &r)
+											{ return _rand.load_state(r); })) ||
+			(ret = _load_checkpoint_section(reader, checkpoint::sbr_control,
+											[this](BinReader &r)
+											{ return sbr.load_progress(r); })) ||
+			(ret = _load_checkpoint_section(reader, checkpoint::agent_pool,
+											[this](BinReader &r)
+											{ return pool.load_progress(r); })) ||
+			(ret = _load_checkpoint_section(reader, checkpoint::recorder,
+											[this](BinReader &r)
+											{ return recorder.load_progress(r); })))
+			return ret;
+
+		if ((ret = _prerun_validate()))
+			return ret;
+		_initialized = true;
+		_update_curr_agent_state();
+		return none;
+	}
+
+	void Simulation::_save_config(BinWriter &writer) const
+	{
+		writer.write_string(checkpoint_file);
+		writer.write_value(checkpoint_interval);
+		writer.write_value<uint8_t>(perf_counters);
+		writer.write_string(trace_file);
+		writer.write_value<uint64_t>(trace_sample_interval);
+		writer.write_value<uint64_t>(run_control.max_steps);
+		writer.write_value(run_control.max_wall_time);
+		writer.write_value(run_control.deadline);
+		writer.write_value<uint8_t>(run_control.handle_sigint);
+		writer.write_string(result_shm);
+		writer.write_value(result_shm_offset);
+		return;
+	}
+
+	error_enum Simulation::_load_config(BinReader &reader)
+	{
+		uint8_t perf, sigint;
+		uint64_t sample_interval, max_steps;
+		if (!(reader.read_string(checkpoint_file) && reader.read_value(checkpoint_interval) &&
+			  reader.read_value(perf) && reader.read_string(trace_file) &&
+			  reader.read_value(sample_interval) && reader.read_value(max_steps) &&
+			  reader.read_value(run_control.max_wall_time) &&
+			  reader.read_value(run_control.deadline) && reader.read_value(sigint) &&
+			  reader.read_string(result_shm) && reader.read_value(result_shm_offset)))
+			return checkpoint_bad_format;
+		perf_counters = perf;
+		trace_sample_interval = sample_interval;
+		run_control.max_steps = max_steps;
+		run_control.handle_sigint = sigint;
+		return none;
+	}
+
+	error_enum Simulation::fork(Simulation &branch, bool same_stream) const
+	{
+		if (!_initialized)
+			return checkpoint_not_initialized;
+		// configs are small, and agent data are rewritten in every timestep
+		// thus copied eagerly
+		branch._rand = _rand;
+		branch.sbr.fork_from(sbr);
+		branch.pool.fork_from(pool);
+		branch.recorder.fork_from(recorder);
+		branch._curr_agent_state = _curr_agent_state;
+		branch._initialized = true;
+		if (!same_stream)
+		{
+			// as AgentPool::seed_trait_reservoirs(), draw from a copy so this
+			// sequence is left as is, mixed with the fork count so branches
+			// forked at the same point differ too
+			auto engine = _rand.engine;
+			uint32_t seed;
+			std::seed_seq seq{(uint32_t)engine(), ++_n_fork};
+			seq.generate(&seed, &seed + 1);
+			branch.set_seed(seed);
+		}
+		return none;
+	}
+
+	error_enum Simulation::_preinit_validate(void) const noexcept
+	{
+		if (auto ret = sbr.preinit_validate())
+			return ret;
+		if (auto ret = pool.preinit_validate())
+			return ret;
+		if (auto ret = recorder.preinit_validate())
+			return ret;
+		return none;
+	}
+
+	error_enum Simulation::_prerun_validate(void) const noexcept
+	{
 		if (auto ret = sbr.prerun_validate())
 			return ret;
 		if (auto ret = pool.prerun_validate())
 			return ret;
 		if (auto ret = recorder.prerun_validate(sbr))
 			return ret;
+		return none;
+	}
+
+	error_enum Simulation::_main_loop(uint64_t step_end, bool no_sigint)
+	{
+		const bool auto_checkpoint = (!checkpoint_file.empty()) && (checkpoint_interval > 0);
+		error_enum ret = none;
+		if ((ret = _attach_result_arena()))
+			return ret;
+		if ((!trace_file.empty()) && (!_tracer.open(trace_file)))
+		{
+			recorder.detach_arena();
+			return trace_io_error;
+		}
+		if (auto_checkpoint)
+			_schedule_next_checkpoint();
+#ifndef NO_RUN_PROFILE
+		_begin_run_profile();
+		const auto state_rec_bytes = recorder.state_rec_bytes();
+		const auto snapshot_rec_bytes = recorder.snapshot_rec_bytes();
+#endif
+		if (_tracer.is_open())
+			_tracer.begin(trace_sample_interval, sbr, pool, recorder);
 
 		// main loop
-		sigint_handler.activate();
+		run_control.begin(sbr.get_curr_step(), no_sigint);
+		pool.start_trait_reservoirs();
 		_timer.start();
-		while (!(sbr.finished_last_stage() || sigint_handler.sig_received()))
+		while (!(sbr.finished_last_stage() || (sbr.get_curr_step() >= step_end) ||
+				 run_control.should_stop(sbr.get_curr_step())))
 		{
-			sbr.timestep_update(pool);
+			// run straight to the next phase transition or record, in spans
+			// of at most max_span_steps to keep run_control/checkpoint
+			// responsive; spans are aligned to absolute steps, so results do
+			// not depend on where a run was interrupted
+			auto n_step = std::min({sbr.steps_to_next_transition(),
+									recorder.steps_to_next_record(sbr),
+									max_span_steps - sbr.get_curr_step() % max_span_steps,
+									run_control.steps_left(sbr.get_curr_step()),
+									step_end - sbr.get_curr_step()});
+			// records close the span, so they count to the phase of the span,
+			// not to the one a transition at its end switches to
+			auto &counter = sbr.profile.phase[sbr.rate_adjusted_phase.aeration != 0];
+			sbr.timestep_update(pool, n_step);
+			if (_tracer.is_open())
+				_tracer.after_update(sbr, pool, n_step);
+			auto timer = ProfileTimer(sbr.profile.perf);
 			recorder.record(sbr, pool);
+			timer.lap(counter.recorder_time, counter.recorder_hw);
+			if (_tracer.is_open())
+				_tracer.after_record(sbr, recorder);
+			if (auto_checkpoint && (sbr.get_curr_time() >= _next_checkpoint_time))
+			{
+				if ((ret = save_checkpoint(checkpoint_file)))
+					break;
+				_schedule_next_checkpoint();
+			}
 		}
 		_timer.stop();
-		sigint_handler.deactivate();
+		pool.stop_trait_reservoirs();
+		const auto stop = run_control.end(sbr.get_curr_step());
+		_update_curr_agent_state();
+		recorder.detach_arena();
+		if (_tracer.is_open() && (!_tracer.end(sbr)) && (!ret))
+			ret = trace_io_error;
+#ifndef NO_RUN_PROFILE
+		_end_run_profile(state_rec_bytes, snapshot_rec_bytes);
+#endif
+
+		if (ret)
+			return ret;
+		return stop;
+	}
+
+	error_enum Simulation::_attach_result_arena(void)
+	{
+		if (result_shm.empty())
+			return none;
+		return recorder.attach_arena(result_shm, result_shm_offset, pool);
+	}
+
+	void Simulation::_update_curr_agent_state(void)
+	{
+		_curr_agent_state.clear();
+		for (auto &v : pool.agent_subtype)
+			_curr_agent_state.push_back(v->summarize_agent_state());
+		return;
+	}
 
-		return sigint_handler.sig_received() ? error_enum::sigint : error_enum::none;
+	void Simulation::_schedule_next_checkpoint(void) noexcept
+	{
+		_next_checkpoint_time = (std::floor(sbr.get_curr_time() / checkpoint_interval) + 1) *
+								checkpoint_interval;
+		return;
+	}
+
+	void Simulation::_begin_run_profile(void)
+	{
+		sbr.profile.reset(pool.n_subtype());
+		for (auto &v : pool.agent_subtype)
+			v->profile_counter = RunProfile::SubtypeCounter();
+		if (perf_counters && _perf.open())
+		{
+			sbr.profile.perf = &_perf;
+			for (size_t i = 0; i < PerfCounter::n_event; i++)
+				if (_perf.is_open((PerfCounter::event_enum)i))
+					sbr.profile.hw_events |= 1u << i;
+		}
+		return;
+	}
+
+	void Simulation::_end_run_profile(uint64_t state_rec_bytes, uint64_t snapshot_rec_bytes)
+	{
+		auto &profile = sbr.profile;
+		for (size_t i = 0; i < pool.n_subtype(); i++)
+		{
+			profile.subtype[i] = pool.agent_subtype[i]->profile_counter;
+			profile.subtype[i].n_active = pool.agent_subtype[i]->n_active();
+			profile.subtype[i].subtype = pool.agent_subtype[i]->subtype();
+		}
+		profile.state_rec_bytes = recorder.state_rec_bytes() - state_rec_bytes;
+		profile.snapshot_rec_bytes = recorder.snapshot_rec_bytes() - snapshot_rec_bytes;
+		// the pool is allocated once before run and does not grow
+		profile.pool_bytes = pool.agent_data.capacity() * sizeof(AgentData);
+		profile.perf = nullptr;
+		_perf.close();
+		return;
+	}
+
+	uint64_t Simulation::result_arena_bytes(void) const
+	{
+		auto shape = recorder.result_arena_shape(pool, _initialized);
+		return ResultArena::layout(shape);
 	}
 
 	std::chrono::milliseconds Simulation::last_run_duration(void) const noexcept
@@ -208,6 +719,11 @@ namespace iebpr
 		return _timer.get_duration();
 	}
 
+	const RunProfile &Simulation::last_run_profile(void) const noexcept
+	{
+		return sbr.profile;
+	}
+
 	const decltype(Recorder::env_state_rec) &Simulation::retrieve_env_state_rec(void) const noexcept
 	{
 		return recorder.env_state_rec;
@@ -0,0 +1,171 @@
+#include <system_error>
+#include "iebpr/trait_reservoir.hpp"
+
+namespace iebpr
+{
+	TraitReservoir::~TraitReservoir(void) noexcept
+	{
+		stop_thread();
+	}
+
+	void TraitReservoir::reset(const TraitRandConfig &cfg, size_t capacity)
+	{
+		stop_thread();
+		_cfg = cfg;
+		_buf.clear();
+		_buf.resize(capacity);
+		_head.store(0);
+		_tail.store(0);
+		return;
+	}
+
+	void TraitReservoir::seed(Randomizer::seed_t seed)
+	{
+		stop_thread();
+		_rand.seed(seed);
+		_head.store(0);
+		_tail.store(0);
+		return;
+	}
+
+	void TraitReservoir::start_thread(void)
+	{
+		if ((!is_enabled()) || _thread.joinable())
+			return;
+		_stop = false;
+		_waiting = false;
+		// if no thread can be created, pop() refills in place as without
+		try
+		{
+			_thread = std::thread(&TraitReservoir::_refill_loop, this);
+		}
+		catch (const std::system_error &)
+		{
+		}
+		return;
+	}
+
+	void TraitReservoir::stop_thread(void) noexcept
+	{
+		if (!_thread.joinable())
+			return;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_cv.notify_all();
+		_thread.join();
+		return;
+	}
+
+	void TraitReservoir::save_state(BinWriter &writer) const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		const auto head = _head.load();
+		const auto tail = _tail.load();
+		_rand.save_state(writer);
+		writer.write_value<uint64_t>(tail - head);
+		for (auto i = head; i < tail; i++)
+			writer.write_value(_buf[i % capacity()]);
+		return;
+	}
+
+	error_enum TraitReservoir::load_state(BinReader &reader)
+	{
+		stop_thread();
+		uint64_t n_buffered;
+		if (auto ret = _rand.load_state(reader))
+			return ret;
+		if ((!reader.read_value(n_buffered)) || (n_buffered > capacity()))
+			return checkpoint_bad_format;
+		for (uint64_t i = 0; i < n_buffered; i++)
+			if (!reader.read_value(_buf[i]))
+				return checkpoint_bad_format;
+		_head.store(0);
+		_tail.store(n_buffered);
+		return none;
+	}
+
+	void TraitReservoir::copy_from(const TraitReservoir &other)
+	{
+		stop_thread();
+		std::lock_guard<std::mutex> lock(other._mutex);
+		const auto head = other._head.load();
+		const auto tail = other._tail.load();
+		_rand = other._rand;
+		_cfg = other._cfg;
+		_buf.clear();
+		_buf.resize(other.capacity());
+		// buffered traits are moved to the front
+		for (auto i = head; i < tail; i++)
+			_buf[i - head] = other._buf[i % capacity()];
+		_head.store(0);
+		_tail.store(tail - head);
+		return;
+	}
+
+	void TraitReservoir::_generate(void)
+	{
+		const auto tail = _tail.load(std::memory_order_relaxed);
+		_cfg.randomize(_rand, _buf[tail % capacity()]);
+		_tail.store(tail + 1, std::memory_order_release);
+		return;
+	}
+
+	void TraitReservoir::_refill_for_pop(void)
+	{
+		if (!_thread.joinable())
+		{
+			// fill up in place, in the same order as the thread would
+			while (_tail.load() - _head.load() < capacity())
+				_generate();
+			return;
+		}
+		std::unique_lock<std::mutex> lock(_mutex);
+		_waiting = true;
+		_cv.notify_all();
+		_cv.wait(lock, [this]
+				 { return _tail.load() != _head.load(); });
+		_waiting = false;
+		return;
+	}
+
+	void TraitReservoir::_notify(void)
+	{
+		// lock once so the thread is either waiting or will see the new
+		// _head before it waits
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+		}
+		_cv.notify_all();
+		return;
+	}
+
+	void TraitReservoir::_refill_loop(void)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		// keep filling up once started, and start again when half is free
+		bool filling = false;
+		while (!_stop)
+		{
+			const auto n_free = capacity() - (_tail.load() - _head.load());
+			if (n_free && (filling || (n_free >= _refill_min())))
+			{
+				// one trait per lock, so pop() and save_state() can get in
+				_generate();
+				filling = (n_free > 1);
+				if (_waiting)
+					_cv.notify_all();
+				lock.unlock();
+				lock.lock();
+			}
+			else
+			{
+				filling = false;
+				_cv.wait(lock);
+			}
+		}
+		return;
+	}
+
+} // namespace iebpr
\ No newline at end of file